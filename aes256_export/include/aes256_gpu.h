@@ -2,6 +2,7 @@
 #define AES256_GPU_H
 
 #include <stddef.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,13 +18,48 @@ void *aes256_gpu_init();
 // Cleanup resources
 void aes256_gpu_cleanup(void *handle);
 
+// Process-wide shared context
+// The first call creates the GPU context, later calls return the same handle
+// and take a reference. Returns NULL on failure.
+void *aes256_gpu_acquire();
+
+// Drop a reference taken by aes256_gpu_acquire(). The context is destroyed
+// when the last reference is released.
+void aes256_gpu_release(void *handle);
+
 // Submit encryption job
 // Returns 1 on success, 0 on failure
 // key must be 32 bytes, iv must be 16 bytes.
+// Safe to call concurrently on the same handle (jobs are serialized).
 int aes256_gpu_encrypt(void *handle, const unsigned char *in,
                        unsigned char *out, size_t len, const unsigned char *key,
                        const unsigned char *iv);
 
+// One independent encryption job for aes256_gpu_encrypt_batch()
+typedef struct {
+  const unsigned char *in;
+  unsigned char *out;
+  size_t len;
+  const unsigned char *key; // 32 bytes
+  const unsigned char *iv;  // 16 bytes
+} aes256_gpu_job;
+
+// Submit many jobs, each with its own key and IV, in one GPU submission
+// (batches beyond 1024 jobs or 64 MB are split into several submissions).
+// Returns 1 on success, 0 on failure
+int aes256_gpu_encrypt_batch(void *handle, const aes256_gpu_job *jobs,
+                             size_t njobs);
+
+// Encrypt one key/IV stream held in fragmented buffers (e.g. packet chains).
+// Input fragments are gathered, encrypted in one submission and scattered
+// into the output fragments, which must hold at least as many bytes.
+// in_iov and out_iov may describe the same memory for in-place operation.
+// Returns 1 on success, 0 on failure
+int aes256_gpu_encrypt_iov(void *handle, const struct iovec *in_iov,
+                           size_t in_cnt, const struct iovec *out_iov,
+                           size_t out_cnt, const unsigned char *key,
+                           const unsigned char *iv);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,12 +3,18 @@
 #include "../scheduler/aes256_batcher.hpp"
 #include <cstdio>
 #include <exception>
+#include <mutex>
 
 struct AES256Context {
   VulkanContext *vk_ctx;
   AES256Batcher *batcher;
 };
 
+// Process-wide shared context (see aes256_gpu_acquire)
+static std::mutex sharedMutex;
+static AES256Context *sharedCtx = nullptr;
+static size_t sharedRefs = 0;
+
 extern "C" {
 void *aes256_gpu_init() {
   try {
@@ -36,6 +42,27 @@ void aes256_gpu_cleanup(void *handle) {
   delete ctx;
 }
 
+void *aes256_gpu_acquire() {
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  if (!sharedCtx) {
+    sharedCtx = (AES256Context *)aes256_gpu_init();
+    if (!sharedCtx)
+      return nullptr;
+  }
+  sharedRefs++;
+  return (void *)sharedCtx;
+}
+
+void aes256_gpu_release(void *handle) {
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  if (!handle || handle != (void *)sharedCtx || sharedRefs == 0)
+    return;
+  if (--sharedRefs == 0) {
+    aes256_gpu_cleanup(sharedCtx);
+    sharedCtx = nullptr;
+  }
+}
+
 int aes256_gpu_encrypt(void *handle, const unsigned char *in,
                        unsigned char *out, size_t len, const unsigned char *key,
                        const unsigned char *iv) {
@@ -44,4 +71,26 @@ int aes256_gpu_encrypt(void *handle, const unsigned char *in,
   auto *ctx = (AES256Context *)handle;
   return ctx->batcher->submit(in, out, len, key, iv) ? 1 : 0;
 }
+
+int aes256_gpu_encrypt_batch(void *handle, const aes256_gpu_job *jobs,
+                             size_t njobs) {
+  if (!handle || (!jobs && njobs))
+    return 0;
+  auto *ctx = (AES256Context *)handle;
+  static_assert(sizeof(aes256_gpu_job) == sizeof(AES256Job),
+                "aes256_gpu_job must mirror AES256Job");
+  return ctx->batcher->submitBatch((const AES256Job *)jobs, njobs) ? 1 : 0;
+}
+
+int aes256_gpu_encrypt_iov(void *handle, const struct iovec *in_iov,
+                           size_t in_cnt, const struct iovec *out_iov,
+                           size_t out_cnt, const unsigned char *key,
+                           const unsigned char *iv) {
+  if (!handle)
+    return 0;
+  auto *ctx = (AES256Context *)handle;
+  return ctx->batcher->submitIov(in_iov, in_cnt, out_iov, out_cnt, key, iv)
+             ? 1
+             : 0;
+}
 }
@@ -7,9 +7,14 @@
 #include <string.h>
 
 // Provider Context
+// The GPU backend is shared by every cipher context of the provider. It is
+// acquired lazily on the first newctx and pinned until teardown, so creating
+// and freeing contexts never rebuilds the Vulkan device, pipeline or rings.
 typedef struct {
   OSSL_LIB_CTX *libctx;
   const OSSL_CORE_HANDLE *handle;
+  CRYPTO_RWLOCK *gpu_lock;
+  void *gpu_ctx; // Provider's own reference (see aes256_gpu_acquire)
 } PROV_CTX;
 
 // Cipher Context
@@ -37,19 +42,37 @@ static OSSL_FUNC_cipher_set_ctx_params_fn aes256_gpu_set_ctx_params;
 // Cipher Implementation
 // -------------------------------------------------------------------------
 
+// Pin the shared GPU context on the provider (first caller creates it)
+static int prov_pin_gpu(PROV_CTX *prov) {
+  int ok;
+
+  if (!CRYPTO_THREAD_write_lock(prov->gpu_lock))
+    return 0;
+  if (prov->gpu_ctx == NULL)
+    prov->gpu_ctx = aes256_gpu_acquire();
+  ok = prov->gpu_ctx != NULL;
+  CRYPTO_THREAD_unlock(prov->gpu_lock);
+  return ok;
+}
+
 static void *aes256_gpu_newctx(void *provctx) {
+  PROV_CTX *prov = (PROV_CTX *)provctx;
+
+  if (!prov_pin_gpu(prov))
+    return NULL;
+
   AES256_GPU_CTX *ctx = OPENSSL_zalloc(sizeof(AES256_GPU_CTX));
   if (ctx == NULL)
     return NULL;
 
-  // Initialize GPU context
-  ctx->gpu_ctx = aes256_gpu_init();
+  // Take a reference on the shared GPU context (cheap once pinned)
+  ctx->gpu_ctx = aes256_gpu_acquire();
   if (ctx->gpu_ctx == NULL) {
     OPENSSL_free(ctx);
     return NULL;
   }
 
-  ctx->libctx = ((PROV_CTX *)provctx)->libctx;
+  ctx->libctx = prov->libctx;
   return ctx;
 }
 
@@ -59,7 +82,7 @@ static void aes256_gpu_freectx(void *vctx) {
     return;
 
   if (ctx->gpu_ctx) {
-    aes256_gpu_cleanup(ctx->gpu_ctx);
+    aes256_gpu_release(ctx->gpu_ctx);
   }
   OPENSSL_free(ctx);
 }
@@ -215,6 +238,9 @@ static const OSSL_ALGORITHM *aes256_gpu_query(void *provctx, int operation_id,
 
 static void aes256_gpu_teardown(void *provctx) {
   PROV_CTX *ctx = (PROV_CTX *)provctx;
+  if (ctx->gpu_ctx)
+    aes256_gpu_release(ctx->gpu_ctx);
+  CRYPTO_THREAD_lock_free(ctx->gpu_lock);
   OPENSSL_free(ctx);
 }
 
@@ -231,6 +257,11 @@ int OSSL_provider_init(const OSSL_CORE_HANDLE *handle, const OSSL_DISPATCH *in,
     return 0;
 
   ctx->handle = handle;
+  ctx->gpu_lock = CRYPTO_THREAD_lock_new();
+  if (ctx->gpu_lock == NULL) {
+    OPENSSL_free(ctx);
+    return 0;
+  }
 
   // Get LibCtx
   /*
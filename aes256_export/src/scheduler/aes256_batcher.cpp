@@ -9,6 +9,9 @@
 
 #define RING_SIZE 1024 * 1024 * 64 // 64MB Ring Buffer
 
+// Job table: 16-byte header + MAX_BATCH_JOBS * (32-byte job + 240-byte keys)
+#define JOB_BUFFER_SIZE (16 + MAX_BATCH_JOBS * (32 + 240))
+
 // Standard AES S-Box
 static const uint8_t SBOX[256] = {
     0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
@@ -63,6 +66,21 @@ AES256Batcher::AES256Batcher(VulkanContext *ctx) : ctx(ctx) {
                paramBuffer, paramMemory);
   vkMapMemory(ctx->getDevice(), paramMemory, 0, 4096, 0, &paramMappedPtr);
 
+  // Upload S-Box once at offset 272 bytes
+  uint32_t *dstSBox = (uint32_t *)paramMappedPtr + 68;
+  for (int i = 0; i < 256; i++) {
+    dstSBox[i] = (uint32_t)SBOX[i];
+  }
+
+  // Job table for submitBatch()
+  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), JOB_BUFFER_SIZE,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               jobBuffer, jobMemory);
+  vkMapMemory(ctx->getDevice(), jobMemory, 0, JOB_BUFFER_SIZE, 0,
+              &jobMappedPtr);
+
   createDescriptors();
   createPipeline();
   createCommandBuffer();
@@ -74,6 +92,8 @@ AES256Batcher::AES256Batcher(VulkanContext *ctx) : ctx(ctx) {
 AES256Batcher::~AES256Batcher() {
   vkDestroyFence(ctx->getDevice(), computeFence, nullptr);
   vkDestroyPipeline(ctx->getDevice(), pipeline, nullptr);
+  if (batchPipeline != VK_NULL_HANDLE)
+    vkDestroyPipeline(ctx->getDevice(), batchPipeline, nullptr);
   vkDestroyPipelineLayout(ctx->getDevice(), pipelineLayout, nullptr);
   vkDestroyDescriptorPool(ctx->getDevice(), descriptorPool, nullptr);
   vkDestroyDescriptorSetLayout(ctx->getDevice(), descriptorSetLayout, nullptr);
@@ -81,35 +101,19 @@ AES256Batcher::~AES256Batcher() {
   vkDestroyCommandPool(ctx->getDevice(), commandPool, nullptr);
   vkDestroyBuffer(ctx->getDevice(), paramBuffer, nullptr);
   vkFreeMemory(ctx->getDevice(), paramMemory, nullptr);
+  vkDestroyBuffer(ctx->getDevice(), jobBuffer, nullptr);
+  vkFreeMemory(ctx->getDevice(), jobMemory, nullptr);
   vkDestroyBuffer(ctx->getDevice(), inputRing.buffer, nullptr);
   vkFreeMemory(ctx->getDevice(), inputRing.memory, nullptr);
   vkDestroyBuffer(ctx->getDevice(), outputRing.buffer, nullptr);
   vkFreeMemory(ctx->getDevice(), outputRing.memory, nullptr);
 }
 
-bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
-                           size_t len, const unsigned char *key,
-                           const unsigned char *iv) {
-  if (len > RING_SIZE) {
-    DEBUG_PRINT("Error: len %zu > RING_SIZE", len);
-    return false;
-  }
-
-  // 1. Write input data
-  memcpy(inputRing.mappedUrl, in, len);
-
-  // 2. Setup params - AES-256 Extended Layout
-  // Layout: batchSize@0, numRounds@4, padding[2]@8-16, RoundKey[60]@16-256
-  // IV[4]@256-272, SBox[256]@272
-  uint32_t *ubo = (uint32_t *)paramMappedPtr;
-  ubo[0] = (len + 15) / 16; // batchSize
-  ubo[1] = 14;              // numRounds for AES-256
-
-  // AES-256 Key Expansion (60 words)
+// AES-256 Key Expansion (60 words)
+static void expandKey(const unsigned char *key, uint32_t w[60]) {
   static const uint8_t rcon[15] = {0x01, 0x02, 0x04, 0x08, 0x10,
                                    0x20, 0x40, 0x80, 0x1b, 0x36,
                                    0x6c, 0xd8, 0xab, 0x4d, 0x9a};
-  uint32_t w[60];
   memcpy(w, key, 32);
   for (int i = 8; i < 60; i++) {
     uint32_t temp = w[i - 1];
@@ -127,18 +131,213 @@ bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
     }
     w[i] = w[i - 8] ^ temp;
   }
+}
 
-  // Extended Layout offsets: RoundKey@16, IV@256, SBox@272
-  memcpy(ubo + 4, w, 240);  // RoundKey (60 words) at offset 16 bytes
-  memcpy(ubo + 64, iv, 16); // IV at offset 256 bytes
+// Helper to increment a Big-Endian 128-bit counter by 'blocks'
+static void incCounter(unsigned char *counter, size_t blocks) {
+  for (int i = 15; i >= 0 && blocks != 0; i--) {
+    size_t sum = counter[i] + (blocks & 0xFF);
+    counter[i] = sum & 0xFF;
+    blocks = (blocks >> 8) + (sum >> 8);
+  }
+}
 
-  // Upload S-Box at offset 272 bytes
-  uint32_t *dstSBox = ubo + 68;
-  for (int i = 0; i < 256; i++) {
-    dstSBox[i] = (uint32_t)SBOX[i];
+bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
+                           size_t len, const unsigned char *key,
+                           const unsigned char *iv) {
+  if (len > RING_SIZE) {
+    DEBUG_PRINT("Error: len %zu > RING_SIZE", len);
+    return false;
   }
 
-  // 3. Record and submit command buffer
+  std::lock_guard<std::mutex> lock(submitMutex);
+
+  // 1. Write input data
+  memcpy(inputRing.mappedUrl, in, len);
+
+  // 2. Setup params and dispatch
+  writeParams(len, key, iv);
+  if (!dispatch(pipeline, (len + 15) / 16))
+    return false;
+
+  // 3. Copy output
+  memcpy(out, outputRing.mappedUrl, len);
+  return true;
+}
+
+bool AES256Batcher::submitBatch(const AES256Job *jobs, size_t count) {
+  if (batchPipeline == VK_NULL_HANDLE) {
+    // No batch shader installed: fall back to one submission per job
+    for (size_t i = 0; i < count; i++) {
+      if (!submit(jobs[i].in, jobs[i].out, jobs[i].len, jobs[i].key,
+                  jobs[i].iv))
+        return false;
+    }
+    return true;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (jobs[i].len > RING_SIZE) {
+      DEBUG_PRINT("Error: job %zu len %zu > RING_SIZE", i, jobs[i].len);
+      return false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(submitMutex);
+
+  // Jobs Layout: numJobs@0, totalBlocks@4, padding[2]@8-16, Job[1024]@16
+  // (8 words each), RoundKeys[1024*60]@32784
+  uint32_t *hdr = (uint32_t *)jobMappedPtr;
+  uint32_t *jobTbl = hdr + 4;
+  uint32_t *roundKeys = jobTbl + MAX_BATCH_JOBS * 8;
+
+  size_t first = 0;
+  while (first < count) {
+    // 1. Pack as many jobs as fit into the ring and the job table
+    size_t last = first;
+    size_t ringOffset = 0;
+    uint32_t numJobs = 0;
+    uint32_t numKeys = 0;
+    const unsigned char *prevKey = nullptr;
+
+    while (last < count && numJobs < MAX_BATCH_JOBS) {
+      const AES256Job &job = jobs[last];
+      size_t slot = (job.len + 15) & ~(size_t)15;
+      if (ringOffset + slot > RING_SIZE)
+        break;
+      last++;
+      if (job.len == 0)
+        continue;
+
+      memcpy((char *)inputRing.mappedUrl + ringOffset, job.in, job.len);
+
+      // Consecutive jobs of the same session share one key schedule
+      if (!prevKey || memcmp(prevKey, job.key, 32) != 0) {
+        expandKey(job.key, roundKeys + numKeys * 60);
+        numKeys++;
+        prevKey = job.key;
+      }
+
+      uint32_t *entry = jobTbl + numJobs * 8;
+      entry[0] = (uint32_t)(ringOffset / 16); // firstBlock
+      entry[1] = numKeys - 1;                 // keyIndex
+      memcpy(entry + 4, job.iv, 16);          // IV
+
+      ringOffset += slot;
+      numJobs++;
+    }
+
+    if (numJobs > 0) {
+      hdr[0] = numJobs;
+      hdr[1] = (uint32_t)(ringOffset / 16); // totalBlocks
+
+      // 2. One dispatch for the whole chunk
+      if (!dispatch(batchPipeline, hdr[1]))
+        return false;
+
+      // 3. Scatter outputs
+      ringOffset = 0;
+      for (size_t i = first; i < last; i++) {
+        if (jobs[i].len == 0)
+          continue;
+        memcpy(jobs[i].out, (char *)outputRing.mappedUrl + ringOffset,
+               jobs[i].len);
+        ringOffset += (jobs[i].len + 15) & ~(size_t)15;
+      }
+    }
+    first = last;
+  }
+  return true;
+}
+
+bool AES256Batcher::submitIov(const struct iovec *inIov, size_t inCount,
+                              const struct iovec *outIov, size_t outCount,
+                              const unsigned char *key,
+                              const unsigned char *iv) {
+  size_t total = 0;
+  size_t outTotal = 0;
+  for (size_t i = 0; i < inCount; i++)
+    total += inIov[i].iov_len;
+  for (size_t i = 0; i < outCount; i++)
+    outTotal += outIov[i].iov_len;
+  if (outTotal < total) {
+    DEBUG_PRINT("Error: output iovec holds %zu of %zu bytes", outTotal, total);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(submitMutex);
+
+  unsigned char counter[16];
+  memcpy(counter, iv, 16);
+
+  size_t inIdx = 0, inPos = 0;
+  size_t outIdx = 0, outPos = 0;
+  while (total > 0) {
+    // Chunks other than the last are a whole number of blocks, so the
+    // keystream continues seamlessly across them
+    size_t chunk = total < (size_t)RING_SIZE ? total : (size_t)RING_SIZE;
+
+    // 1. Gather fragments into the input ring
+    size_t filled = 0;
+    while (filled < chunk) {
+      size_t n = inIov[inIdx].iov_len - inPos;
+      if (n > chunk - filled)
+        n = chunk - filled;
+      memcpy((char *)inputRing.mappedUrl + filled,
+             (const char *)inIov[inIdx].iov_base + inPos, n);
+      filled += n;
+      inPos += n;
+      if (inPos == inIov[inIdx].iov_len) {
+        inIdx++;
+        inPos = 0;
+      }
+    }
+
+    // 2. Single dispatch over the contiguous stream
+    writeParams(chunk, key, counter);
+    if (!dispatch(pipeline, (chunk + 15) / 16))
+      return false;
+
+    // 3. Scatter into the output fragments
+    size_t drained = 0;
+    while (drained < chunk) {
+      size_t n = outIov[outIdx].iov_len - outPos;
+      if (n > chunk - drained)
+        n = chunk - drained;
+      memcpy((char *)outIov[outIdx].iov_base + outPos,
+             (const char *)outputRing.mappedUrl + drained, n);
+      drained += n;
+      outPos += n;
+      if (outPos == outIov[outIdx].iov_len) {
+        outIdx++;
+        outPos = 0;
+      }
+    }
+
+    incCounter(counter, chunk / 16);
+    total -= chunk;
+  }
+  return true;
+}
+
+void AES256Batcher::writeParams(size_t len, const unsigned char *key,
+                                const unsigned char *iv) {
+  // AES-256 Extended Layout
+  // Layout: batchSize@0, numRounds@4, padding[2]@8-16, RoundKey[60]@16-256
+  // IV[4]@256-272, SBox[256]@272 (uploaded once in the constructor)
+  uint32_t *ubo = (uint32_t *)paramMappedPtr;
+  ubo[0] = (len + 15) / 16; // batchSize
+  ubo[1] = 14;              // numRounds for AES-256
+
+  uint32_t w[60];
+  expandKey(key, w);
+
+  memcpy(ubo + 4, w, 240);  // RoundKey (60 words) at offset 16 bytes
+  memcpy(ubo + 64, iv, 16); // IV at offset 256 bytes
+}
+
+bool AES256Batcher::dispatch(VkPipeline pipe, uint32_t blocks) {
+  // Record and submit command buffer
   vkResetCommandBuffer(commandBuffer, 0);
 
   VkCommandBufferBeginInfo beginInfo = {};
@@ -146,11 +345,10 @@ bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipe);
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
                           pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 
-  uint32_t blocks = (len + 15) / 16;
   uint32_t groupCount = (blocks + 255) / 256;
   if (groupCount == 0)
     groupCount = 1;
@@ -172,9 +370,6 @@ bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
   }
 
   vkWaitForFences(ctx->getDevice(), 1, &computeFence, VK_TRUE, UINT64_MAX);
-
-  // 4. Copy output
-  memcpy(out, outputRing.mappedUrl, len);
   return true;
 }
 
@@ -206,7 +401,7 @@ static VkShaderModule createShaderModule(VulkanContext *ctx,
 
 void AES256Batcher::createDescriptors() {
   // Descriptor set layout
-  VkDescriptorSetLayoutBinding bindings[3] = {};
+  VkDescriptorSetLayoutBinding bindings[4] = {};
   bindings[0].binding = 0;
   bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
   bindings[0].descriptorCount = 1;
@@ -222,9 +417,14 @@ void AES256Batcher::createDescriptors() {
   bindings[2].descriptorCount = 1;
   bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
+  bindings[3].binding = 3; // Job table (batch shader only)
+  bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[3].descriptorCount = 1;
+  bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
   VkDescriptorSetLayoutCreateInfo layoutInfo = {};
   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutInfo.bindingCount = 3;
+  layoutInfo.bindingCount = 4;
   layoutInfo.pBindings = bindings;
 
   vkCreateDescriptorSetLayout(ctx->getDevice(), &layoutInfo, nullptr,
@@ -233,7 +433,7 @@ void AES256Batcher::createDescriptors() {
   // Descriptor pool
   VkDescriptorPoolSize poolSize = {};
   poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  poolSize.descriptorCount = 3;
+  poolSize.descriptorCount = 4;
 
   VkDescriptorPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -253,7 +453,7 @@ void AES256Batcher::createDescriptors() {
   vkAllocateDescriptorSets(ctx->getDevice(), &allocInfo, &descriptorSet);
 
   // Update descriptor set
-  VkDescriptorBufferInfo bufInfo[3] = {};
+  VkDescriptorBufferInfo bufInfo[4] = {};
   bufInfo[0].buffer = inputRing.buffer;
   bufInfo[0].offset = 0;
   bufInfo[0].range = VK_WHOLE_SIZE;
@@ -263,9 +463,12 @@ void AES256Batcher::createDescriptors() {
   bufInfo[2].buffer = paramBuffer;
   bufInfo[2].offset = 0;
   bufInfo[2].range = VK_WHOLE_SIZE;
+  bufInfo[3].buffer = jobBuffer;
+  bufInfo[3].offset = 0;
+  bufInfo[3].range = VK_WHOLE_SIZE;
 
-  VkWriteDescriptorSet writes[3] = {};
-  for (int i = 0; i < 3; i++) {
+  VkWriteDescriptorSet writes[4] = {};
+  for (int i = 0; i < 4; i++) {
     writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     writes[i].dstSet = descriptorSet;
     writes[i].dstBinding = i;
@@ -274,7 +477,7 @@ void AES256Batcher::createDescriptors() {
     writes[i].pBufferInfo = &bufInfo[i];
   }
 
-  vkUpdateDescriptorSets(ctx->getDevice(), 3, writes, 0, nullptr);
+  vkUpdateDescriptorSets(ctx->getDevice(), 4, writes, 0, nullptr);
 }
 
 void AES256Batcher::createPipeline() {
@@ -305,6 +508,21 @@ void AES256Batcher::createPipeline() {
                            nullptr, &pipeline);
   vkDestroyShaderModule(ctx->getDevice(), shaderModule, nullptr);
   DEBUG_PRINT("AES-256 pipeline created");
+
+  // Batched multi-key variant (optional)
+  batchPipeline = VK_NULL_HANDLE;
+  try {
+    auto batchCode = readFile("/usr/local/lib/aes256_ctr_batch.spv");
+    VkShaderModule batchModule = createShaderModule(ctx, batchCode);
+    pipelineInfo.stage.module = batchModule;
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1,
+                             &pipelineInfo, nullptr, &batchPipeline);
+    vkDestroyShaderModule(ctx->getDevice(), batchModule, nullptr);
+    DEBUG_PRINT("AES-256 batch pipeline created");
+  } catch (...) {
+    fprintf(stderr, "[AES256] Warning: batch shader not found, batches will "
+                    "be submitted job by job.\n");
+  }
 }
 
 void AES256Batcher::createCommandBuffer() {
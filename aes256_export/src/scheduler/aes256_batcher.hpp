@@ -2,13 +2,29 @@
 
 #include "../backend/memory.hpp"
 #include "../backend/vulkan_ctx.hpp"
+#include <mutex>
+#include <sys/uio.h>
 #include <vector>
 
+// Must match MAX_BATCH_JOBS in aes256_ctr_batch.comp
+#define MAX_BATCH_JOBS 1024
+
+struct AES256Job {
+  const unsigned char *in;
+  unsigned char *out;
+  size_t len;
+  const unsigned char *key; // 32 bytes
+  const unsigned char *iv;  // 16 bytes
+};
+
 /**
  * AES256Batcher - Dedicated AES-256-CTR encryption batcher
  *
  * Completely independent implementation with its own Vulkan resources.
  * Uses Extended Layout: IV@256, SBox@272
+ *
+ * submit() is thread-safe: the rings, param buffer and command buffer are
+ * shared, so concurrent callers are serialized on submitMutex.
  */
 class AES256Batcher {
 public:
@@ -18,6 +34,15 @@ public:
   bool submit(const unsigned char *in, unsigned char *out, size_t len,
               const unsigned char *key, const unsigned char *iv);
 
+  // Independent jobs (own key/IV each) packed into one dispatch. Batches
+  // larger than the ring or MAX_BATCH_JOBS are split into several.
+  bool submitBatch(const AES256Job *jobs, size_t count);
+
+  // One key/IV stream gathered from and scattered to fragmented buffers
+  bool submitIov(const struct iovec *inIov, size_t inCount,
+                 const struct iovec *outIov, size_t outCount,
+                 const unsigned char *key, const unsigned char *iv);
+
 private:
   VulkanContext *ctx;
   RingBuffer inputRing;
@@ -25,6 +50,7 @@ private:
 
   // Vulkan Objects (dedicated to AES-256)
   VkPipeline pipeline;
+  VkPipeline batchPipeline; // aes256_ctr_batch.spv, may be VK_NULL_HANDLE
   VkPipelineLayout pipelineLayout;
   VkDescriptorSetLayout descriptorSetLayout;
   VkDescriptorPool descriptorPool;
@@ -33,11 +59,22 @@ private:
   VkCommandBuffer commandBuffer;
   VkFence computeFence;
 
+  std::mutex submitMutex;
+
   // Parameter Buffer
   VkBuffer paramBuffer;
   VkDeviceMemory paramMemory;
   void *paramMappedPtr;
 
+  // Job table for submitBatch() (binding 3)
+  VkBuffer jobBuffer;
+  VkDeviceMemory jobMemory;
+  void *jobMappedPtr;
+
+  void writeParams(size_t len, const unsigned char *key,
+                   const unsigned char *iv);
+  bool dispatch(VkPipeline pipe, uint32_t blocks);
+
   void createPipeline();
   void createDescriptors();
   void createCommandBuffer();
@@ -0,0 +1,87 @@
+// Measures EVP_CIPHER_CTX_new + EncryptInit + free latency through the
+// aes256_gpu provider. The first iteration pays for the shared GPU context;
+// every following one should only cost the context allocation.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <openssl/evp.h>
+#include <openssl/provider.h>
+#include <vector>
+
+#ifndef AES256_GPU_PROVIDER_PATH
+#define AES256_GPU_PROVIDER_PATH "aes256_gpu_provider"
+#endif
+
+int main(int argc, char **argv) {
+  const char *modulePath = argc > 1 ? argv[1] : AES256_GPU_PROVIDER_PATH;
+  long iterations = 10000;
+  if (argc > 2) {
+    char *end = NULL;
+    iterations = strtol(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || iterations <= 0 ||
+        iterations > 100000000) {
+      fprintf(stderr, "usage: %s [provider-path] [iterations > 0]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  OSSL_PROVIDER *prov = OSSL_PROVIDER_load(NULL, modulePath);
+  if (!prov) {
+    fprintf(stderr, "[Bench] Failed to load provider %s\n", modulePath);
+    return 1;
+  }
+
+  EVP_CIPHER *cipher =
+      EVP_CIPHER_fetch(NULL, "AES-256-CTR", "provider=aes256_gpu");
+  if (!cipher) {
+    fprintf(stderr, "[Bench] AES-256-CTR not available from provider\n");
+    OSSL_PROVIDER_unload(prov);
+    return 1;
+  }
+
+  unsigned char key[32] = {0};
+  unsigned char iv[16] = {0};
+  std::vector<double> samples;
+  samples.reserve(iterations);
+
+  for (long i = 0; i < iterations; i++) {
+    auto start = std::chrono::steady_clock::now();
+
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx || !EVP_EncryptInit_ex2(ctx, cipher, key, iv, NULL)) {
+      fprintf(stderr, "[Bench] Init failed at iteration %ld\n", i);
+      EVP_CIPHER_CTX_free(ctx);
+      EVP_CIPHER_free(cipher);
+      OSSL_PROVIDER_unload(prov);
+      return 1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+
+    auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::micro>(end - start).count());
+  }
+
+  double first = samples[0];
+  std::vector<double> warm(samples.begin() + 1, samples.end());
+  std::sort(warm.begin(), warm.end());
+
+  double sum = 0;
+  for (double s : warm)
+    sum += s;
+
+  printf("[Bench] EVP_CIPHER_CTX new+init+free, %ld iterations\n", iterations);
+  printf("[Bench] First (cold):  %10.1f us\n", first);
+  if (!warm.empty()) {
+    printf("[Bench] Mean (warm):   %10.3f us\n", sum / warm.size());
+    printf("[Bench] p50:           %10.3f us\n", warm[warm.size() / 2]);
+    printf("[Bench] p99:           %10.3f us\n", warm[warm.size() * 99 / 100]);
+    printf("[Bench] Max:           %10.3f us\n", warm.back());
+  }
+
+  EVP_CIPHER_free(cipher);
+  OSSL_PROVIDER_unload(prov);
+  return 0;
+}
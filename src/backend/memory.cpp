@@ -45,3 +45,142 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
 
   vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
+
+uint32_t findRingMemoryType(VkPhysicalDevice physicalDevice,
+                            uint32_t typeFilter, RingUse use) {
+  // Criteria, most important first: the bit and whether it is wanted
+  struct Rank {
+    VkMemoryPropertyFlags bit;
+    bool wanted;
+  };
+  // Uncached memory takes CPU stores write-combined without snooping or
+  // evicting the CPU caches; it is also what V3D offers for coherent memory
+  static const Rank upload[] = {{VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true},
+                                {VK_MEMORY_PROPERTY_HOST_CACHED_BIT, false}};
+  // Reads from uncached memory are an order of magnitude slower; a cached
+  // non-coherent type only costs an invalidate per dispatch
+  static const Rank readback[] = {{VK_MEMORY_PROPERTY_HOST_CACHED_BIT, true},
+                                  {VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true}};
+  const Rank *ranks = use == RingUse::Upload ? upload : readback;
+  const size_t rankCount = 2;
+
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+  int best = -1;
+  unsigned bestScore = 0;
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+    if (!(typeFilter & (1 << i)) ||
+        !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      continue;
+    unsigned score = 0;
+    for (size_t r = 0; r < rankCount; r++)
+      score = score * 2 + (((flags & ranks[r].bit) != 0) == ranks[r].wanted);
+    if (best < 0 || score > bestScore) {
+      best = (int)i;
+      bestScore = score;
+    }
+  }
+  if (best < 0)
+    throw std::runtime_error("failed to find suitable memory type!");
+  return (uint32_t)best;
+}
+
+void createRing(VkDevice device, VkPhysicalDevice physicalDevice,
+                VkDeviceSize size, VkBufferUsageFlags usage, RingUse use,
+                RingBuffer &ring) {
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &ring.buffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create buffer!");
+  }
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, ring.buffer, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = findRingMemoryType(
+      physicalDevice, memRequirements.memoryTypeBits, use);
+
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &ring.memory) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate buffer memory!");
+  }
+
+  vkBindBufferMemory(device, ring.buffer, ring.memory, 0);
+
+  if (vkMapMemory(device, ring.memory, 0, size, 0, &ring.mappedUrl) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to map buffer memory!");
+  }
+
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  ring.flags =
+      memProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags;
+  ring.atomSize = deviceProperties.limits.nonCoherentAtomSize;
+  ring.size = size;
+  ring.offset = 0;
+}
+
+VkMappedMemoryRange ringRange(const RingBuffer &ring, VkDeviceSize offset,
+                              VkDeviceSize size) {
+  VkDeviceSize atom = ring.atomSize > 0 ? ring.atomSize : 1;
+  VkDeviceSize begin = offset / atom * atom;
+  VkDeviceSize end = (offset + size + atom - 1) / atom * atom;
+  if (end == begin)
+    end = begin + atom;
+
+  VkMappedMemoryRange range = {};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = ring.memory;
+  range.offset = begin;
+  // Past the mapped size the atom rounding would be out of bounds; the
+  // rest of the mapping is always a valid range
+  range.size = end >= ring.size ? VK_WHOLE_SIZE : end - begin;
+  return range;
+}
+
+void createDeviceRing(VkDevice device, VkPhysicalDevice physicalDevice,
+                      VkDeviceSize size, VkBufferUsageFlags usage,
+                      RingBuffer &ring) {
+  createBuffer(device, physicalDevice, size, usage,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ring.buffer, ring.memory);
+  ring.mappedUrl = nullptr;
+  ring.flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  ring.size = size;
+  ring.offset = 0;
+}
+
+void cmdCopyRange(VkCommandBuffer cb, const RingBuffer &src,
+                  const RingBuffer &dst, VkDeviceSize offset,
+                  VkDeviceSize size) {
+  if (size == 0)
+    return;
+  VkBufferCopy region = {};
+  region.srcOffset = offset;
+  region.dstOffset = offset;
+  region.size = size;
+  vkCmdCopyBuffer(cb, src.buffer, dst.buffer, 1, &region);
+}
+
+void cmdBarrier(VkCommandBuffer cb, VkPipelineStageFlags srcStage,
+                VkAccessFlags srcAccess, VkPipelineStageFlags dstStage,
+                VkAccessFlags dstAccess) {
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  vkCmdPipelineBarrier(cb, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0,
+                       nullptr);
+}
@@ -13,6 +13,14 @@ struct RingBuffer {
   void *mappedUrl;
   VkDeviceSize size;
   VkDeviceSize offset; // Current write head
+  VkMemoryPropertyFlags flags = 0; // Of the memory type it was given
+  VkDeviceSize atomSize = 1;       // nonCoherentAtomSize
+
+  // Host-visible but not cached: the CPU sees a write-combined mapping,
+  // so stores should stream (vc6_stream_copy) and reads are slow
+  bool writeCombined() const {
+    return !(flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+  }
 
   // Create synchronization structures here if needed, or in the batcher
 };
@@ -21,3 +29,42 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
                   VkDeviceSize size, VkBufferUsageFlags usage,
                   VkMemoryPropertyFlags properties, VkBuffer &buffer,
                   VkDeviceMemory &bufferMemory);
+
+// Which way the data in a ring flows, and so which memory suits it
+enum class RingUse {
+  Upload,  // CPU writes, GPU reads: coherent, preferably write-combined
+  Readback // GPU writes, CPU reads: HOST_CACHED first, then coherent
+};
+
+// Host-visible memory type in 'typeFilter' ranked for 'use'; ties go to the
+// lower index (drivers list their preferred types first)
+uint32_t findRingMemoryType(VkPhysicalDevice physicalDevice,
+                            uint32_t typeFilter, RingUse use);
+
+// Buffer of 'size' bytes in memory chosen by findRingMemoryType(), mapped
+void createRing(VkDevice device, VkPhysicalDevice physicalDevice,
+                VkDeviceSize size, VkBufferUsageFlags usage, RingUse use,
+                RingBuffer &ring);
+
+// Mapped range of [offset, offset + size) in the ring for
+// vkFlushMappedMemoryRanges / vkInvalidateMappedMemoryRanges, widened to
+// whole non-coherent atoms as those require
+VkMappedMemoryRange ringRange(const RingBuffer &ring, VkDeviceSize offset,
+                              VkDeviceSize size);
+
+// Device-local, unmapped buffer of 'size' bytes: the side of a ring the
+// shaders use on non-unified memory, filled and drained by cmdCopyRange()
+void createDeviceRing(VkDevice device, VkPhysicalDevice physicalDevice,
+                      VkDeviceSize size, VkBufferUsageFlags usage,
+                      RingBuffer &ring);
+
+// Records a copy of [offset, offset + size) from 'src' to the same offset
+// in 'dst'; nothing for size 0
+void cmdCopyRange(VkCommandBuffer cb, const RingBuffer &src,
+                  const RingBuffer &dst, VkDeviceSize offset,
+                  VkDeviceSize size);
+
+// Records a global memory barrier
+void cmdBarrier(VkCommandBuffer cb, VkPipelineStageFlags srcStage,
+                VkAccessFlags srcAccess, VkPipelineStageFlags dstStage,
+                VkAccessFlags dstAccess);
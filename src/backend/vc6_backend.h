@@ -0,0 +1,286 @@
+#ifndef VC6_BACKEND_H
+#define VC6_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Algorithm IDs understood by vc6_submit_job()
+#define VC6_ALG_AES128_CTR 0
+#define VC6_ALG_AES256_CTR 1
+#define VC6_ALG_CHACHA20 2
+// AES-256 block modes: 'len' must be a multiple of 16. For CBC decrypt
+// 'iv' is the ciphertext block preceding 'in'; ECB ignores 'iv'.
+#define VC6_ALG_AES256_ECB_ENC 3
+#define VC6_ALG_AES256_ECB_DEC 4
+#define VC6_ALG_AES256_CBC_DEC 5
+// Reduced-round ChaCha (12 / 8 rounds), same key and IV layout as ChaCha20
+#define VC6_ALG_CHACHA12 10
+#define VC6_ALG_CHACHA8 11
+// Served by their own entry points below; the ids index vc6_get_stats()
+#define VC6_ALG_AES256_XTS_ENC 6
+#define VC6_ALG_AES256_XTS_DEC 7
+#define VC6_ALG_AES256_GCM_ENC 8
+#define VC6_ALG_AES256_GCM_DEC 9
+#define VC6_ALG_SHA256 12
+#define VC6_ALG_BLAKE3 13
+#define VC6_ALG_PBKDF2_SHA256 14
+#define VC6_ALG_COUNT 15
+
+// Provider parameters (OSSL_PROVIDER_get_params(), uint64): totals of
+// vc6_get_stats() over all algorithms, see VC6_STATS for their meaning
+#define VC6_PROV_PARAM_GPU_JOBS "vc6-gpu-jobs"
+#define VC6_PROV_PARAM_GPU_BYTES "vc6-gpu-bytes"
+#define VC6_PROV_PARAM_CPU_JOBS "vc6-cpu-jobs"
+#define VC6_PROV_PARAM_CPU_BYTES "vc6-cpu-bytes"
+#define VC6_PROV_PARAM_QUEUE_DEPTH "vc6-queue-depth"
+#define VC6_PROV_PARAM_QUEUE_DEPTH_MAX "vc6-queue-depth-max"
+#define VC6_PROV_PARAM_RING_HIGH_WATER "vc6-ring-high-water"
+#define VC6_PROV_PARAM_WAIT_COUNT "vc6-wait-count"
+#define VC6_PROV_PARAM_WAIT_NS "vc6-wait-ns"
+// Octet string: the whole VC6_STATS struct, per algorithm and histogram
+#define VC6_PROV_PARAM_STATS "vc6-stats"
+
+// Cipher ctx parameter (size_t, bytes): keystream-ahead window for the
+// CTR/ChaCha20 ciphers, 0 (default) disables. Settable at init or before
+// the first update.
+#define VC6_CIPHER_PARAM_KEYSTREAM_AHEAD "keystream-ahead"
+
+// AES-256-XTS ctx parameter (size_t, bytes): when non-zero, each update()
+// processes whole sectors of this size with tweaks IV, IV + 1, ... and the
+// IV advances past them. 0 (default): one data unit per update().
+#define VC6_CIPHER_PARAM_XTS_SECTOR_SIZE "xts-sector-size"
+
+// AES-256-GCM ctx parameter (int): 1 (default) sends updates of 64 KB or
+// more through the fused CTR + GHASH kernel, 0 keeps the GPU CTR / CPU
+// GHASH pipeline. Cleared by the provider if the fused kernel fails.
+#define VC6_CIPHER_PARAM_GCM_FUSED "gcm-fused"
+
+// Initialize the Vulkan context and batchers
+// Returns NULL on failure
+void *vc6_init();
+
+// Cleanup resources
+void vc6_cleanup(void *handle);
+
+// Encrypt/decrypt 'len' bytes starting at the counter held in 'iv'
+// AES-CTR: iv is a 16-byte Big-Endian counter block
+// ChaCha20: iv is [Counter 4B LE][Nonce 12B] (OpenSSL layout)
+// Returns 1 on success, 0 on failure
+int vc6_submit_job(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *iv, int alg_id);
+
+// Random-access variant: process 'len' bytes located 'offset' bytes into
+// the stream that starts at 'iv'. The starting counter is derived from the
+// offset and an unaligned start is handled by discarding the keystream
+// prefix, so any byte range of a CTR/ChaCha20 stream can be decrypted
+// independently (and concurrently from several threads).
+// Returns 1 on success, 0 on failure
+int vc6_submit_job_at(void *handle, const unsigned char *in,
+                      unsigned char *out, size_t len, const unsigned char *key,
+                      const unsigned char *iv, uint64_t offset, int alg_id);
+
+// ChaCha20/12/8 on the CPU with the same semantics as vc6_submit_job():
+// the 4-way SIMD kernel vc6_submit_job() itself uses for small jobs, when
+// the GPU is busy or refuses the job. Counts as CPU work in vc6_get_stats().
+// 'skip' (< 64) keystream bytes are discarded first; needs no handle.
+void vc6_chacha_cpu(const unsigned char *in, unsigned char *out, size_t len,
+                    const unsigned char *key, const unsigned char *iv,
+                    size_t skip, int alg_id);
+
+// AES-128/256-CTR on the CPU with vc6_submit_job()'s semantics: the
+// constant-time bitsliced kernel vc6_submit_job() uses below the GPU
+// crossover, when the GPU is busy or refuses the job. Counts as CPU work.
+// Returns 0 for any other alg_id, 1 otherwise; needs no handle.
+int vc6_aes_ctr_cpu(const unsigned char *in, unsigned char *out, size_t len,
+                    const unsigned char *key, const unsigned char *iv,
+                    size_t skip, int alg_id);
+
+// The backend's CPU task pool (TaskPool), usable without a handle or GPU:
+// runs fn(arg, i) for every i in [0, n), one share on the calling thread,
+// and returns once all of them ran. A VC6_PARALLEL_FN (src/cpu/parallel.h).
+void vc6_parallel_for(size_t n, void (*fn)(void *arg, size_t i), void *arg);
+// Starts fn(arg) on the same pool; vc6_task_wait() returns once it ran
+// (running queued tasks meanwhile) and releases the handle
+void *vc6_task_run(void (*fn)(void *arg), void *arg);
+void vc6_task_wait(void *task);
+
+// Raw keystream (no input) for a CTR/ChaCha stream: writes 'len' bytes
+// (at most 64 MB, one ring) starting at the block addressed by 'iv'. The
+// key and the output are wiped from the shared params and rings before it
+// returns. Returns 1 on success, 0 on failure
+int vc6_submit_keystream(void *handle, unsigned char *out, size_t len,
+                         const unsigned char *key, const unsigned char *iv,
+                         int alg_id);
+
+// AES-256-XTS over consecutive sectors of 'sector_size' bytes (multiple of
+// 16); 'len' must be a multiple of 16. key = K1 || K2 (64 bytes), sector i
+// uses tweak + i (16-byte little-endian). Per-sector tweaks are computed on
+// the GPU. Returns 1 on success, 0 on failure
+int vc6_submit_xts(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *tweak, size_t sector_size,
+                   int decrypt);
+
+// AES-256-GCM fused pass: CTR over 'len' bytes (multiple of 16, at most
+// VC6_GCM_FUSED_MAX) starting at counter block 'ctr' (inc32), and the GHASH
+// of the ciphertext computed in the same GPU pass, one partial per group of
+// VC6_GCM_GROUP_BLOCKS blocks: for a group of m blocks C_0 .. C_m-1,
+// partials[16 * g] = sum C_i * H^(m - i), so the caller folds them in order
+// as Y = Y * H^m ^ partial (only the last group can be short).
+// 'hpow' holds H^1 .. H^VC6_GCM_GROUP_BLOCKS (16 bytes each).
+// Returns 1 on success, 0 on failure (e.g. aes256_gcm.spv not installed)
+#define VC6_GCM_GROUP_BLOCKS 256
+#define VC6_GCM_FUSED_MAX (16 * 1024 * 1024)
+int vc6_submit_gcm(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *ctr, const unsigned char *hpow,
+                   unsigned char *partials, int decrypt);
+
+// Multi-buffer SHA-256: digests[32 * i] = SHA-256(msgs[i], lens[i]) for
+// 'count' independent messages, one GPU thread per message (sha256.comp).
+// Messages longer than VC6_SHA256_BATCH_MAX are hashed on the CPU instead:
+// one long stream is faster there than on a single GPU thread.
+// Returns 1 on success, 0 on failure (e.g. sha256.spv not installed)
+#define VC6_SHA256_BATCH_MAX (64 * 1024)
+int vc6_sha256_batch(void *handle, const unsigned char *const *msgs,
+                     const size_t *lens, size_t count,
+                     unsigned char *digests);
+
+// BLAKE3 chunk pass (blake3.comp): 'len' bytes (1 .. VC6_BLAKE3_BATCH_MAX)
+// that start at chunk index 'chunk_counter' are hashed one 1 KB chunk per
+// GPU thread and merged in shared memory to one subtree CV per
+// VC6_BLAKE3_GROUP_CHUNKS chunks. *count = ceil(chunks / 256) CVs of 32
+// bytes are written to 'cvs'; none is a root node, so the caller merges
+// them (vc6_blake3_reduce() in src/cpu/blake3.h). 'chunk_counter' must be
+// a multiple of VC6_BLAKE3_GROUP_CHUNKS for the CVs to be BLAKE3 subtrees.
+// Returns 1 on success, 0 on failure (e.g. blake3.spv not installed)
+#define VC6_BLAKE3_GROUP_CHUNKS 256
+#define VC6_BLAKE3_BATCH_MAX (16 * 1024 * 1024)
+int vc6_blake3_chunks(void *handle, const unsigned char *in, size_t len,
+                      uint64_t chunk_counter, unsigned char *cvs,
+                      size_t *count);
+
+// Batched PBKDF2-HMAC-SHA256 (pbkdf2_sha256.comp): runs 'count'
+// independent derivations at once, one GPU thread per 32-byte output block.
+// Iterations are spread over passes of VC6_PBKDF2_PASS_ITERATIONS so no
+// single dispatch runs long. A lone derivation is much faster on the CPU;
+// this pays off for many concurrent ones.
+// Returns 1 on success, 0 on failure (e.g. pbkdf2_sha256.spv not installed)
+typedef struct {
+  const unsigned char *pass;
+  size_t pass_len;
+  const unsigned char *salt;
+  size_t salt_len;
+  uint64_t iterations; // At least 1
+  unsigned char *out;
+  size_t out_len; // At least 1
+} VC6_PBKDF2_JOB;
+#define VC6_PBKDF2_PASS_ITERATIONS 8192
+int vc6_pbkdf2_sha256_batch(void *handle, const VC6_PBKDF2_JOB *jobs,
+                            size_t count);
+
+// Process-wide runtime counters, kept whether or not a GPU is present.
+// Per-algorithm arrays are indexed by VC6_ALG_*; 'cpu' counts work the
+// provider did on the CPU in place of the GPU (inputs too small to pay for
+// a dispatch, a missing shader, serial modes such as CBC encrypt).
+// batch_bytes[i] counts GPU dispatches of [2^i, 2^(i+1)) input bytes.
+#define VC6_STATS_BUCKETS 32
+typedef struct {
+  uint64_t gpu_jobs[VC6_ALG_COUNT]; // Calls (messages for batch APIs)
+  uint64_t gpu_bytes[VC6_ALG_COUNT];
+  uint64_t cpu_jobs[VC6_ALG_COUNT];
+  uint64_t cpu_bytes[VC6_ALG_COUNT];
+  uint64_t batch_bytes[VC6_STATS_BUCKETS];
+  uint64_t queue_depth;     // Submits waiting for or holding a batcher now
+  uint64_t queue_depth_max; // Since start or vc6_reset_stats()
+  uint64_t ring_high_water; // Furthest ring offset used, bytes
+  uint64_t wait_count;      // Submits that found their batcher busy
+  uint64_t wait_ns;         // Total time those spent waiting for it
+} VC6_STATS;
+
+// Copies the counters to 'out'. Counters are read one by one, so a
+// snapshot taken under load is not exactly consistent. Returns 1
+int vc6_get_stats(VC6_STATS *out);
+// Zeroes the counters (the current queue depth is kept)
+void vc6_reset_stats(void);
+// Records work done on the CPU instead of the GPU
+void vc6_stats_cpu(int alg_id, uint64_t jobs, uint64_t bytes);
+// "AES-256-CTR", ...; "unknown" outside 0 .. VC6_ALG_COUNT - 1
+const char *vc6_alg_name(int alg_id);
+
+// Scheduler tracing: with VC6_TRACE=<file> set, batcher and provider
+// events are recorded per thread and written there as Chrome trace-event
+// JSON at exit, on SIGUSR2 and on SIGINT / SIGTERM. 'name' must be a
+// string literal. vc6_trace_now() returns 0 when tracing is off, and the
+// other calls then do nothing.
+uint64_t vc6_trace_now(void);
+// Span from 'start' (a vc6_trace_now() value) to now; 'batch' 0 = none
+void vc6_trace_span(const char *name, uint64_t start, uint64_t bytes,
+                    uint64_t batch);
+void vc6_trace_instant(const char *name, uint64_t bytes, uint64_t batch);
+// New id for a batch the caller assembles itself; 0 when tracing is off
+uint64_t vc6_trace_batch_id(void);
+
+// Per-stage latency histograms of the GPU batchers. Every submit records
+// host time (steady clock) for each stage and, where the queue supports
+// timestamp queries, the device time of the dispatch as VC6_STAGE_GPU.
+// GPU time overlaps SUBMIT and WAIT. Stages a path does not have (the
+// dedicated AES-256 batcher updates no descriptors) stay empty.
+#define VC6_STAGE_COPY_IN 0
+#define VC6_STAGE_FLUSH 1
+#define VC6_STAGE_DESCRIPTORS 2
+#define VC6_STAGE_RECORD 3
+#define VC6_STAGE_SUBMIT 4
+#define VC6_STAGE_GPU 5
+#define VC6_STAGE_WAIT 6
+#define VC6_STAGE_COPY_OUT 7
+#define VC6_STAGE_COUNT 8
+
+// Which batcher to read: the shared one (AES-128-CTR, ChaCha, block modes,
+// XTS, GCM, hashes, KDF) or the dedicated AES-256-CTR one
+#define VC6_PROFILE_BATCHER 0
+#define VC6_PROFILE_AES256 1
+
+// buckets[i] counts samples in [2^i, 2^(i+1)) ns; bucket 0 also holds 0,
+// the last bucket everything above
+#define VC6_STAGE_BUCKETS 32
+typedef struct {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint64_t buckets[VC6_STAGE_BUCKETS];
+} VC6_STAGE_HISTOGRAM;
+
+// Copies VC6_STAGE_COUNT histograms, indexed by VC6_STAGE_*, to 'out'.
+// Returns 1 on success, 0 for an unknown source
+int vc6_get_stage_histograms(void *handle, int source,
+                             VC6_STAGE_HISTOGRAM *out);
+// Clears the histograms of both batchers
+void vc6_reset_stage_histograms(void *handle);
+// "copy_in", "flush", ...; "unknown" outside 0 .. VC6_STAGE_COUNT - 1
+const char *vc6_stage_name(int stage);
+
+// Keystream-ahead streams: the backend keeps the next 'window_bytes' of
+// keystream for (key, iv) generated in the background, so
+// vc6_keystream_xor() is a CPU XOR that only waits if it outruns the GPU.
+// A stream has a single position; use one per cipher context.
+// vc6_keystream_open() returns NULL on failure.
+void *vc6_keystream_open(void *handle, const unsigned char *key,
+                         const unsigned char *iv, int alg_id,
+                         size_t window_bytes);
+// Returns 1 on success, 0 on failure
+int vc6_keystream_xor(void *stream, const unsigned char *in,
+                      unsigned char *out, size_t len);
+void vc6_keystream_close(void *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_BACKEND_H
@@ -1,9 +1,11 @@
 #include "vulkan_ctx.hpp"
+#include <cstdlib>
 #include <cstring>
 
 VulkanContext::VulkanContext() {
   createInstance();
   pickPhysicalDevice();
+  detectMemoryArchitecture();
   createLogicalDevice();
 }
 
@@ -12,6 +14,12 @@ VulkanContext::~VulkanContext() {
   vkDestroyInstance(instance, nullptr);
 }
 
+VkResult VulkanContext::submitCompute(const VkSubmitInfo &info,
+                                      VkFence fence) {
+  std::lock_guard<std::mutex> lock(queueMutex);
+  return vkQueueSubmit(computeQueue, 1, &info, fence);
+}
+
 void VulkanContext::createInstance() {
   VkApplicationInfo appInfo = {};
   appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -61,6 +69,42 @@ void VulkanContext::pickPhysicalDevice() {
   }
 }
 
+void VulkanContext::detectMemoryArchitecture() {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+  // Discrete GPUs have their own VRAM; even with a host-visible window into
+  // it (resizable BAR), CPU access crosses PCIe. Elsewhere every
+  // device-local heap should be reachable through a host-visible type.
+  unifiedMemory =
+      deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+  for (uint32_t h = 0; h < memProperties.memoryHeapCount; h++) {
+    if (!(memProperties.memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+      continue;
+    bool hostVisible = false;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+      if (memProperties.memoryTypes[i].heapIndex == h &&
+          (memProperties.memoryTypes[i].propertyFlags &
+           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        hostVisible = true;
+    }
+    if (!hostVisible)
+      unifiedMemory = false;
+  }
+
+  // Forced either way: confirm which path the override selected
+  const char *env = getenv("VC6_STAGING");
+  if (env != nullptr && *env != '\0') {
+    unifiedMemory = strcmp(env, "0") == 0;
+    fprintf(stderr, "[VC6] Memory: %s (VC6_STAGING=%s)\n",
+            unifiedMemory ? "unified, zero-copy rings"
+                          : "discrete, device-local rings with staging",
+            env);
+  }
+}
+
 bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
   // Find compute queue
   uint32_t queueFamilyCount = 0;
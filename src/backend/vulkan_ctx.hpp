@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <mutex>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
@@ -15,15 +16,30 @@ public:
     uint32_t getComputeQueueFamilyIndex() const { return computeQueueFamilyIndex; }
     VkPhysicalDevice getPhysicalDevice() const { return physicalDevice; }
 
+    // True when the GPU works out of system memory (V3D, integrated GPUs,
+    // lavapipe), so host-visible rings are as fast for it as any memory.
+    // False for discrete GPUs: the batchers then compute in device-local
+    // rings and stage through the host-visible ones. VC6_STAGING=1 / 0
+    // forces staging on / off.
+    bool isUnifiedMemory() const { return unifiedMemory; }
+
+    // vkQueueSubmit on the compute queue. Both batchers share the queue,
+    // which Vulkan requires to be externally synchronized; every submit
+    // goes through here. Callers wait on their own fence.
+    VkResult submitCompute(const VkSubmitInfo &info, VkFence fence);
+
 private:
     VkInstance instance;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     VkDevice device;
     VkQueue computeQueue;
     uint32_t computeQueueFamilyIndex;
+    bool unifiedMemory = true;
+    std::mutex queueMutex; // Guards computeQueue
 
     void createInstance();
     void pickPhysicalDevice();
+    void detectMemoryArchitecture();
     void createLogicalDevice();
     bool isDeviceSuitable(VkPhysicalDevice device);
 };
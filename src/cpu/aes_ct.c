@@ -0,0 +1,382 @@
+#include "aes_ct.h"
+
+#include <string.h>
+
+// The bitsliced representation follows BearSSL's aes_ct64: four blocks are
+// spread over eight 64-bit words, word i holding bit i of every byte, and
+// the S-box is the Boyar-Peralta circuit. Here each word is a 128-bit
+// vector whose two 64-bit lanes are two independent groups of four blocks,
+// so every operation stays inside a 64-bit lane.
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+typedef uint64x2_t bs;
+#define BS_LOAD(p) vld1q_u64(p)
+#define BS_STORE(p, v) vst1q_u64(p, v)
+#define BS_XOR(a, b) veorq_u64(a, b)
+#define BS_AND(a, b) vandq_u64(a, b)
+#define BS_OR(a, b) vorrq_u64(a, b)
+#define BS_NOT(a) vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(a)))
+#define BS_SHL(a, n) vshlq_n_u64(a, n)
+#define BS_SHR(a, n) vshrq_n_u64(a, n)
+#define BS_MASK(c) vdupq_n_u64(c)
+#define BS_ROTR16(a) vsriq_n_u64(vshlq_n_u64(a, 48), a, 16)
+#define BS_ROTR32(a)                                                           \
+  vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(a)))
+#define VC6_AES_CT_IMPL "neon"
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i bs;
+#define BS_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define BS_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define BS_XOR(a, b) _mm_xor_si128(a, b)
+#define BS_AND(a, b) _mm_and_si128(a, b)
+#define BS_OR(a, b) _mm_or_si128(a, b)
+#define BS_NOT(a) _mm_xor_si128(a, _mm_set1_epi32(-1))
+#define BS_SHL(a, n) _mm_slli_epi64(a, n)
+#define BS_SHR(a, n) _mm_srli_epi64(a, n)
+#define BS_MASK(c) _mm_set1_epi64x((long long)(c))
+#define BS_ROTR16(a) _mm_or_si128(_mm_srli_epi64(a, 16), _mm_slli_epi64(a, 48))
+#define BS_ROTR32(a) _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1))
+#define VC6_AES_CT_IMPL "sse2"
+#else
+typedef struct {
+  uint64_t v[2];
+} bs;
+
+static inline bs bs_make(uint64_t lo, uint64_t hi) {
+  bs r;
+  r.v[0] = lo;
+  r.v[1] = hi;
+  return r;
+}
+
+#define BS_LOAD(p) bs_make((p)[0], (p)[1])
+#define BS_STORE(p, x) ((p)[0] = (x).v[0], (p)[1] = (x).v[1])
+#define BS_XOR(a, b) bs_make((a).v[0] ^ (b).v[0], (a).v[1] ^ (b).v[1])
+#define BS_AND(a, b) bs_make((a).v[0] & (b).v[0], (a).v[1] & (b).v[1])
+#define BS_OR(a, b) bs_make((a).v[0] | (b).v[0], (a).v[1] | (b).v[1])
+#define BS_NOT(a) bs_make(~(a).v[0], ~(a).v[1])
+#define BS_SHL(a, n) bs_make((a).v[0] << (n), (a).v[1] << (n))
+#define BS_SHR(a, n) bs_make((a).v[0] >> (n), (a).v[1] >> (n))
+#define BS_MASK(c) bs_make(c, c)
+#define BS_ROTR16(a)                                                           \
+  bs_make(((a).v[0] >> 16) | ((a).v[0] << 48),                                 \
+          ((a).v[1] >> 16) | ((a).v[1] << 48))
+#define BS_ROTR32(a)                                                           \
+  bs_make(((a).v[0] >> 32) | ((a).v[0] << 32),                                 \
+          ((a).v[1] >> 32) | ((a).v[1] << 32))
+#define VC6_AES_CT_IMPL "portable"
+#endif
+
+static uint32_t load_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+// Boyar-Peralta S-box circuit over the eight bit planes (q[7] = bit 0 of
+// the circuit's input, i.e. the most significant bit of each byte)
+static void sbox(bs *q) {
+#define X(a, b) BS_XOR(a, b)
+#define A(a, b) BS_AND(a, b)
+#define XN(a, b) BS_NOT(BS_XOR(a, b))
+  bs x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+  bs x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+  // Top linear transformation
+  bs y14 = X(x3, x5), y13 = X(x0, x6), y9 = X(x0, x3), y8 = X(x0, x5);
+  bs t0 = X(x1, x2), y1 = X(t0, x7), y4 = X(y1, x3), y12 = X(y13, y14);
+  bs y2 = X(y1, x0), y5 = X(y1, x6), y3 = X(y5, y8), t1 = X(x4, y12);
+  bs y15 = X(t1, x5), y20 = X(t1, x1), y6 = X(y15, x7), y10 = X(y15, t0);
+  bs y11 = X(y20, y9), y7 = X(x7, y11), y17 = X(y10, y11), y19 = X(y10, y8);
+  bs y16 = X(t0, y11), y21 = X(y13, y16), y18 = X(x0, y16);
+
+  // Non-linear section
+  bs t2 = A(y12, y15), t3 = A(y3, y6), t4 = X(t3, t2), t5 = A(y4, x7);
+  bs t6 = X(t5, t2), t7 = A(y13, y16), t8 = A(y5, y1), t9 = X(t8, t7);
+  bs t10 = A(y2, y7), t11 = X(t10, t7), t12 = A(y9, y11), t13 = A(y14, y17);
+  bs t14 = X(t13, t12), t15 = A(y8, y10), t16 = X(t15, t12), t17 = X(t4, t14);
+  bs t18 = X(t6, t16), t19 = X(t9, t14), t20 = X(t11, t16), t21 = X(t17, y20);
+  bs t22 = X(t18, y19), t23 = X(t19, y21), t24 = X(t20, y18);
+
+  bs t25 = X(t21, t22), t26 = A(t21, t23), t27 = X(t24, t26);
+  bs t28 = A(t25, t27), t29 = X(t28, t22), t30 = X(t23, t24);
+  bs t31 = X(t22, t26), t32 = A(t31, t30), t33 = X(t32, t24);
+  bs t34 = X(t23, t33), t35 = X(t27, t33), t36 = A(t24, t35);
+  bs t37 = X(t36, t34), t38 = X(t27, t36), t39 = A(t29, t38);
+  bs t40 = X(t25, t39);
+
+  bs t41 = X(t40, t37), t42 = X(t29, t33), t43 = X(t29, t40);
+  bs t44 = X(t33, t37), t45 = X(t42, t41);
+  bs z0 = A(t44, y15), z1 = A(t37, y6), z2 = A(t33, x7), z3 = A(t43, y16);
+  bs z4 = A(t40, y1), z5 = A(t29, y7), z6 = A(t42, y11), z7 = A(t45, y17);
+  bs z8 = A(t41, y10), z9 = A(t44, y12), z10 = A(t37, y3), z11 = A(t33, y4);
+  bs z12 = A(t43, y13), z13 = A(t40, y5), z14 = A(t29, y2);
+  bs z15 = A(t42, y9), z16 = A(t45, y14), z17 = A(t41, y8);
+
+  // Bottom linear transformation
+  bs t46 = X(z15, z16), t47 = X(z10, z11), t48 = X(z5, z13), t49 = X(z9, z10);
+  bs t50 = X(z2, z12), t51 = X(z2, z5), t52 = X(z7, z8), t53 = X(z0, z3);
+  bs t54 = X(z6, z7), t55 = X(z16, z17), t56 = X(z12, t48), t57 = X(t50, t53);
+  bs t58 = X(z4, t46), t59 = X(z3, t54), t60 = X(t46, t57), t61 = X(z14, t57);
+  bs t62 = X(t52, t58), t63 = X(t49, t58), t64 = X(z4, t59), t65 = X(t61, t62);
+  bs t66 = X(z1, t63);
+  bs s0 = X(t59, t63), s6 = XN(t56, t62), s7 = XN(t48, t60);
+  bs t67 = X(t64, t65);
+  bs s3 = X(t53, t66), s4 = X(t51, t66), s5 = X(t47, t65);
+  bs s1 = XN(t64, s3), s2 = XN(t55, t67);
+
+  q[7] = s0;
+  q[6] = s1;
+  q[5] = s2;
+  q[4] = s3;
+  q[3] = s4;
+  q[2] = s5;
+  q[1] = s6;
+  q[0] = s7;
+#undef X
+#undef A
+#undef XN
+}
+
+#define SWAPN(cl, ch, s, x, y)                                                 \
+  do {                                                                         \
+    bs a_ = (x), b_ = (y);                                                     \
+    (x) = BS_OR(BS_AND(a_, BS_MASK(cl)), BS_SHL(BS_AND(b_, BS_MASK(cl)), s));  \
+    (y) = BS_OR(BS_SHR(BS_AND(a_, BS_MASK(ch)), s), BS_AND(b_, BS_MASK(ch)));  \
+  } while (0)
+
+// Transposes between the interleaved and the bit-plane form (its own
+// inverse)
+static void ortho(bs *q) {
+  const uint64_t m1 = 0x5555555555555555ULL, h1 = 0xAAAAAAAAAAAAAAAAULL;
+  const uint64_t m2 = 0x3333333333333333ULL, h2 = 0xCCCCCCCCCCCCCCCCULL;
+  const uint64_t m4 = 0x0F0F0F0F0F0F0F0FULL, h4 = 0xF0F0F0F0F0F0F0F0ULL;
+
+  SWAPN(m1, h1, 1, q[0], q[1]);
+  SWAPN(m1, h1, 1, q[2], q[3]);
+  SWAPN(m1, h1, 1, q[4], q[5]);
+  SWAPN(m1, h1, 1, q[6], q[7]);
+  SWAPN(m2, h2, 2, q[0], q[2]);
+  SWAPN(m2, h2, 2, q[1], q[3]);
+  SWAPN(m2, h2, 2, q[4], q[6]);
+  SWAPN(m2, h2, 2, q[5], q[7]);
+  SWAPN(m4, h4, 4, q[0], q[4]);
+  SWAPN(m4, h4, 4, q[1], q[5]);
+  SWAPN(m4, h4, 4, q[2], q[6]);
+  SWAPN(m4, h4, 4, q[3], q[7]);
+}
+
+// Block words w[0..3] into the 16-bit lanes of two 64-bit words (and back)
+static void interleave_in(uint64_t *q0, uint64_t *q1, const uint32_t *w) {
+  uint64_t x0 = w[0], x1 = w[1], x2 = w[2], x3 = w[3];
+
+  x0 = (x0 | (x0 << 16)) & 0x0000FFFF0000FFFFULL;
+  x1 = (x1 | (x1 << 16)) & 0x0000FFFF0000FFFFULL;
+  x2 = (x2 | (x2 << 16)) & 0x0000FFFF0000FFFFULL;
+  x3 = (x3 | (x3 << 16)) & 0x0000FFFF0000FFFFULL;
+  x0 = (x0 | (x0 << 8)) & 0x00FF00FF00FF00FFULL;
+  x1 = (x1 | (x1 << 8)) & 0x00FF00FF00FF00FFULL;
+  x2 = (x2 | (x2 << 8)) & 0x00FF00FF00FF00FFULL;
+  x3 = (x3 | (x3 << 8)) & 0x00FF00FF00FF00FFULL;
+  *q0 = x0 | (x2 << 8);
+  *q1 = x1 | (x3 << 8);
+}
+
+static void interleave_out(uint32_t *w, uint64_t q0, uint64_t q1) {
+  uint64_t x0 = q0 & 0x00FF00FF00FF00FFULL;
+  uint64_t x1 = q1 & 0x00FF00FF00FF00FFULL;
+  uint64_t x2 = (q0 >> 8) & 0x00FF00FF00FF00FFULL;
+  uint64_t x3 = (q1 >> 8) & 0x00FF00FF00FF00FFULL;
+
+  x0 = (x0 | (x0 >> 8)) & 0x0000FFFF0000FFFFULL;
+  x1 = (x1 | (x1 >> 8)) & 0x0000FFFF0000FFFFULL;
+  x2 = (x2 | (x2 >> 8)) & 0x0000FFFF0000FFFFULL;
+  x3 = (x3 | (x3 >> 8)) & 0x0000FFFF0000FFFFULL;
+  w[0] = (uint32_t)x0 | (uint32_t)(x0 >> 16);
+  w[1] = (uint32_t)x1 | (uint32_t)(x1 >> 16);
+  w[2] = (uint32_t)x2 | (uint32_t)(x2 >> 16);
+  w[3] = (uint32_t)x3 | (uint32_t)(x3 >> 16);
+}
+
+static void shift_rows(bs *q) {
+  for (int i = 0; i < 8; i++) {
+    bs x = q[i];
+    q[i] = BS_OR(
+        BS_OR(BS_OR(BS_AND(x, BS_MASK(0x000000000000FFFFULL)),
+                    BS_SHR(BS_AND(x, BS_MASK(0x00000000FFF00000ULL)), 4)),
+              BS_OR(BS_SHL(BS_AND(x, BS_MASK(0x00000000000F0000ULL)), 12),
+                    BS_SHR(BS_AND(x, BS_MASK(0x0000FF0000000000ULL)), 8))),
+        BS_OR(BS_OR(BS_SHL(BS_AND(x, BS_MASK(0x000000FF00000000ULL)), 8),
+                    BS_SHR(BS_AND(x, BS_MASK(0xF000000000000000ULL)), 12)),
+              BS_SHL(BS_AND(x, BS_MASK(0x0FFF000000000000ULL)), 4)));
+  }
+}
+
+static void mix_columns(bs *q) {
+  bs r[8], t[8];
+
+  for (int i = 0; i < 8; i++) {
+    r[i] = BS_ROTR16(q[i]);
+    t[i] = BS_XOR(q[i], r[i]);
+  }
+  q[0] = BS_XOR(BS_XOR(t[7], r[0]), BS_ROTR32(t[0]));
+  q[1] = BS_XOR(BS_XOR(BS_XOR(t[0], t[7]), r[1]), BS_ROTR32(t[1]));
+  q[2] = BS_XOR(BS_XOR(t[1], r[2]), BS_ROTR32(t[2]));
+  q[3] = BS_XOR(BS_XOR(BS_XOR(t[2], t[7]), r[3]), BS_ROTR32(t[3]));
+  q[4] = BS_XOR(BS_XOR(BS_XOR(t[3], t[7]), r[4]), BS_ROTR32(t[4]));
+  q[5] = BS_XOR(BS_XOR(t[4], r[5]), BS_ROTR32(t[5]));
+  q[6] = BS_XOR(BS_XOR(t[5], r[6]), BS_ROTR32(t[6]));
+  q[7] = BS_XOR(BS_XOR(t[6], r[7]), BS_ROTR32(t[7]));
+}
+
+static void add_round_key(bs *q, const uint64_t rk[8][2]) {
+  for (int i = 0; i < 8; i++)
+    q[i] = BS_XOR(q[i], BS_LOAD(rk[i]));
+}
+
+// S-box of each byte of 'x' for the key schedule, through the circuit
+static uint32_t sub_word(uint32_t x) {
+  bs q[8];
+  uint64_t t[2] = {x, 0};
+
+  for (int i = 0; i < 8; i++)
+    q[i] = BS_MASK(0);
+  q[0] = BS_LOAD(t);
+  ortho(q);
+  sbox(q);
+  ortho(q);
+  BS_STORE(t, q[0]);
+  return (uint32_t)t[0];
+}
+
+int vc6_aes_ct_init(VC6_AES_CT_KEY *k, const unsigned char *key,
+                    size_t keylen) {
+  static const unsigned char rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                                         0x20, 0x40, 0x80, 0x1B, 0x36};
+  uint32_t w[60], blocks[16];
+  uint64_t lanes[8][2];
+  bs q[8];
+  int nk;
+
+  if (keylen != 16 && keylen != 32)
+    return 0;
+  nk = (int)keylen / 4;
+  k->rounds = nk + 6;
+
+  // FIPS-197 expansion on little-endian words
+  for (int i = 0; i < nk; i++)
+    w[i] = load_le32(key + 4 * i);
+  for (int i = nk, j = 0, r = 0; i < 4 * (k->rounds + 1); i++) {
+    uint32_t tmp = w[i - 1];
+    if (j == 0)
+      tmp = sub_word((tmp << 24) | (tmp >> 8)) ^ rcon[r];
+    else if (nk > 6 && j == 4)
+      tmp = sub_word(tmp);
+    w[i] = tmp ^ w[i - nk];
+    if (++j == nk) {
+      j = 0;
+      r++;
+    }
+  }
+
+  // Each round key as if it were eight identical blocks
+  for (int r = 0; r <= k->rounds; r++) {
+    for (int b = 0; b < 4; b++)
+      memcpy(blocks + 4 * b, w + 4 * r, 16);
+    for (int i = 0; i < 4; i++)
+      interleave_in(&lanes[i][0], &lanes[i + 4][0], blocks + 4 * i);
+    for (int i = 0; i < 8; i++) {
+      lanes[i][1] = lanes[i][0];
+      q[i] = BS_LOAD(lanes[i]);
+    }
+    ortho(q);
+    for (int i = 0; i < 8; i++)
+      BS_STORE(k->rk[r][i], q[i]);
+  }
+
+  memset(w, 0, sizeof(w));
+  memset(blocks, 0, sizeof(blocks));
+  memset(lanes, 0, sizeof(lanes));
+  memset(q, 0, sizeof(q));
+  return 1;
+}
+
+// Encrypts the eight blocks in w[0..31] (four LE words each) in place;
+// blocks 0-3 go in the low lanes, 4-7 in the high ones
+static void encrypt8(const VC6_AES_CT_KEY *k, uint32_t w[32]) {
+  uint64_t lanes[8][2];
+  bs q[8];
+
+  for (int i = 0; i < 4; i++) {
+    interleave_in(&lanes[i][0], &lanes[i + 4][0], w + 4 * i);
+    interleave_in(&lanes[i][1], &lanes[i + 4][1], w + 16 + 4 * i);
+  }
+  for (int i = 0; i < 8; i++)
+    q[i] = BS_LOAD(lanes[i]);
+  ortho(q);
+
+  add_round_key(q, k->rk[0]);
+  for (int r = 1; r < k->rounds; r++) {
+    sbox(q);
+    shift_rows(q);
+    mix_columns(q);
+    add_round_key(q, k->rk[r]);
+  }
+  sbox(q);
+  shift_rows(q);
+  add_round_key(q, k->rk[k->rounds]);
+
+  ortho(q);
+  for (int i = 0; i < 8; i++)
+    BS_STORE(lanes[i], q[i]);
+  for (int i = 0; i < 4; i++) {
+    interleave_out(w + 4 * i, lanes[i][0], lanes[i + 4][0]);
+    interleave_out(w + 16 + 4 * i, lanes[i][1], lanes[i + 4][1]);
+  }
+}
+
+const char *vc6_aes_ct_impl(void) { return VC6_AES_CT_IMPL; }
+
+void vc6_aes_ct_ctr(const VC6_AES_CT_KEY *k, unsigned char *out,
+                    const unsigned char *in, size_t len,
+                    const unsigned char iv[16], size_t skip) {
+  unsigned char ctr[16], ks[128];
+  uint32_t w[32];
+
+  memcpy(ctr, iv, 16);
+  while (len > 0) {
+    // Eight counter blocks; the carry runs through all 128 bits
+    for (int b = 0; b < 8; b++) {
+      for (int i = 0; i < 4; i++)
+        w[4 * b + i] = load_le32(ctr + 4 * i);
+      for (int i = 15; i >= 0 && ++ctr[i] == 0; i--)
+        ;
+    }
+    encrypt8(k, w);
+    for (int i = 0; i < 32; i++)
+      store_le32(ks + 4 * i, w[i]);
+
+    size_t n = sizeof(ks) - skip < len ? sizeof(ks) - skip : len;
+    if (in == NULL) {
+      memcpy(out, ks + skip, n);
+    } else {
+      for (size_t i = 0; i < n; i++)
+        out[i] = in[i] ^ ks[skip + i];
+      in += n;
+    }
+    out += n;
+    len -= n;
+    skip = 0;
+  }
+
+  memset(ks, 0, sizeof(ks));
+  memset(w, 0, sizeof(w));
+}
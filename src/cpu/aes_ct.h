@@ -0,0 +1,43 @@
+#ifndef VC6_CPU_AES_CT_H
+#define VC6_CPU_AES_CT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constant-time bitsliced AES-CTR for CPUs without AES instructions (the
+// Pi 4's Cortex-A72 has no ARMv8 Crypto Extensions, so OpenSSL falls back
+// to lookup tables there). No table lookups or branches depend on the key
+// or the data. Eight blocks are processed at once, bitsliced over eight
+// 128-bit words (NEON on aarch64, SSE2 on x86, a pair of uint64_t
+// otherwise).
+
+// Bitsliced round keys: round r is rk[r][0..7], each word one bit plane of
+// the round key copied to all eight block slots
+typedef struct {
+  uint64_t rk[15][8][2];
+  int rounds; // 10 (AES-128) or 14 (AES-256)
+} VC6_AES_CT_KEY;
+
+// 'keylen' is 16 or 32; returns 0 for anything else
+int vc6_aes_ct_init(VC6_AES_CT_KEY *k, const unsigned char *key,
+                    size_t keylen);
+
+// CTR over 'len' bytes from the counter block 'iv' (128-bit big-endian,
+// like aes256_ctr.comp and Batcher::advanceCounter()). The first 'skip'
+// (< 16) keystream bytes are discarded; in == NULL writes raw keystream.
+void vc6_aes_ct_ctr(const VC6_AES_CT_KEY *k, unsigned char *out,
+                    const unsigned char *in, size_t len,
+                    const unsigned char iv[16], size_t skip);
+
+// "neon", "sse2" or "portable": the path the kernel was built with
+const char *vc6_aes_ct_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_CPU_AES_CT_H
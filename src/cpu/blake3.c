@@ -0,0 +1,143 @@
+#include "blake3.h"
+
+#include <string.h>
+
+#define CHUNK_START 1
+#define CHUNK_END 2
+#define PARENT 4
+#define ROOT 8
+
+#define ROTR32(v, n) (((v) >> (n)) | ((v) << (32 - (n))))
+
+static const uint32_t IV[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372,
+                               0xA54FF53A, 0x510E527F, 0x9B05688C,
+                               0x1F83D9AB, 0x5BE0CD19};
+
+static const uint8_t MSG_PERMUTATION[16] = {2, 6,  3,  10, 7,  0,  4,  13,
+                                            1, 11, 12, 5,  9,  14, 15, 8};
+
+static uint32_t load_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+#define G(a, b, c, d, mx, my)                                                  \
+  do {                                                                         \
+    v[a] = v[a] + v[b] + (mx);                                                 \
+    v[d] = ROTR32(v[d] ^ v[a], 16);                                            \
+    v[c] = v[c] + v[d];                                                        \
+    v[b] = ROTR32(v[b] ^ v[c], 12);                                            \
+    v[a] = v[a] + v[b] + (my);                                                 \
+    v[d] = ROTR32(v[d] ^ v[a], 8);                                             \
+    v[c] = v[c] + v[d];                                                        \
+    v[b] = ROTR32(v[b] ^ v[c], 7);                                             \
+  } while (0)
+
+// First 8 words of the compression output (the new CV)
+static void compress(uint32_t cv[8], const uint32_t block[16],
+                     uint64_t counter, uint32_t block_len, uint32_t flags) {
+  uint32_t v[16], m[16], t[16];
+  memcpy(v, cv, 32);
+  memcpy(v + 8, IV, 16);
+  v[12] = (uint32_t)counter;
+  v[13] = (uint32_t)(counter >> 32);
+  v[14] = block_len;
+  v[15] = flags;
+  memcpy(m, block, 64);
+
+  for (int r = 0; r < 7; r++) {
+    G(0, 4, 8, 12, m[0], m[1]);
+    G(1, 5, 9, 13, m[2], m[3]);
+    G(2, 6, 10, 14, m[4], m[5]);
+    G(3, 7, 11, 15, m[6], m[7]);
+    G(0, 5, 10, 15, m[8], m[9]);
+    G(1, 6, 11, 12, m[10], m[11]);
+    G(2, 7, 8, 13, m[12], m[13]);
+    G(3, 4, 9, 14, m[14], m[15]);
+    for (int i = 0; i < 16; i++)
+      t[i] = m[MSG_PERMUTATION[i]];
+    memcpy(m, t, 64);
+  }
+  for (int i = 0; i < 8; i++)
+    cv[i] = v[i] ^ v[i + 8];
+}
+
+static void store_cv(unsigned char out[32], const uint32_t cv[8]) {
+  for (int i = 0; i < 8; i++)
+    store_le32(out + 4 * i, cv[i]);
+}
+
+// One chunk (up to 1024 bytes, possibly empty)
+static void chunk_cv(unsigned char out[32], const unsigned char *in,
+                     size_t len, uint64_t counter, int root) {
+  uint32_t cv[8], block[16];
+  size_t blocks = len == 0 ? 1 : (len + 63) / 64;
+  memcpy(cv, IV, 32);
+  for (size_t b = 0; b < blocks; b++) {
+    unsigned char buf[64] = {0};
+    size_t n = len - b * 64 < 64 ? len - b * 64 : 64;
+    uint32_t flags = 0;
+    if (n > 0)
+      memcpy(buf, in + b * 64, n);
+    for (int i = 0; i < 16; i++)
+      block[i] = load_le32(buf + 4 * i);
+    if (b == 0)
+      flags |= CHUNK_START;
+    if (b == blocks - 1)
+      flags |= CHUNK_END | (root ? ROOT : 0);
+    compress(cv, block, counter, (uint32_t)n, flags);
+  }
+  store_cv(out, cv);
+}
+
+void vc6_blake3_parent(unsigned char out[32], const unsigned char left[32],
+                       const unsigned char right[32], int root) {
+  uint32_t cv[8], block[16];
+  memcpy(cv, IV, 32);
+  for (int i = 0; i < 8; i++) {
+    block[i] = load_le32(left + 4 * i);
+    block[8 + i] = load_le32(right + 4 * i);
+  }
+  compress(cv, block, 0, 64, PARENT | (root ? ROOT : 0));
+  store_cv(out, cv);
+}
+
+void vc6_blake3_subtree(unsigned char out[32], const unsigned char *in,
+                        size_t len, uint64_t counter, int root) {
+  unsigned char left[32], right[32];
+  size_t left_len = VC6_BLAKE3_CHUNK_LEN;
+
+  if (len <= VC6_BLAKE3_CHUNK_LEN) {
+    chunk_cv(out, in, len, counter, root);
+    return;
+  }
+  // Left subtree: the largest power-of-two number of chunks short of 'len'
+  while (2 * left_len < len)
+    left_len *= 2;
+  vc6_blake3_subtree(left, in, left_len, counter, 0);
+  vc6_blake3_subtree(right, in + left_len, len - left_len,
+                     counter + left_len / VC6_BLAKE3_CHUNK_LEN, 0);
+  vc6_blake3_parent(out, left, right, root);
+}
+
+void vc6_blake3_reduce(unsigned char out[32], unsigned char *cvs, size_t n,
+                       int root) {
+  while (n > 2) {
+    for (size_t i = 0; i < n / 2; i++)
+      vc6_blake3_parent(cvs + 32 * i, cvs + 64 * i, cvs + 64 * i + 32, 0);
+    if (n & 1)
+      memmove(cvs + 32 * (n / 2), cvs + 32 * (n - 1), 32);
+    n = (n + 1) / 2;
+  }
+  if (n == 2)
+    vc6_blake3_parent(out, cvs, cvs + 32, root);
+  else
+    memcpy(out, cvs, 32);
+}
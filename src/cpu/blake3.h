@@ -0,0 +1,39 @@
+#ifndef VC6_BLAKE3_H
+#define VC6_BLAKE3_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// BLAKE3 (hash mode, 32-byte output) on the CPU: the tree levels above the
+// GPU chunk pass, and whole inputs too small to be worth a dispatch.
+// Chaining values (CVs) are 32 bytes, little-endian words.
+
+#define VC6_BLAKE3_CHUNK_LEN 1024
+
+// Parent node of two child CVs; 'root' marks the final node, whose output
+// is the digest
+void vc6_blake3_parent(unsigned char out[32], const unsigned char left[32],
+                       const unsigned char right[32], int root);
+
+// CV of the subtree over 'len' bytes that start at chunk index 'counter'
+// (the BLAKE3 left-balanced tree); with 'root' the output is the digest of
+// the whole input. vc6_blake3_subtree(out, in, len, 0, 1) is BLAKE3(in).
+void vc6_blake3_subtree(unsigned char out[32], const unsigned char *in,
+                        size_t len, uint64_t counter, int root);
+
+// Merges 'n' consecutive subtree CVs (all but the last complete and of the
+// same size) pairwise, carrying an odd last CV up a level, which gives the
+// same tree as vc6_blake3_subtree(). 'cvs' is overwritten. With 'root', n
+// must be at least 2.
+void vc6_blake3_reduce(unsigned char out[32], unsigned char *cvs, size_t n,
+                       int root);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_BLAKE3_H
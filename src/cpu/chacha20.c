@@ -0,0 +1,285 @@
+#include "chacha20.h"
+
+#include <string.h>
+
+// 4-block SIMD path for vc6_chacha_xor(); the word-per-lane layout below
+// assumes little-endian lanes
+#if defined(__ORDER_LITTLE_ENDIAN__) &&                                        \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VC6_CHACHA_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VC6_CHACHA_SSE2 1
+#endif
+#endif
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)                                               \
+  do {                                                                         \
+    a += b;                                                                    \
+    d = ROTL32(d ^ a, 16);                                                     \
+    c += d;                                                                    \
+    b = ROTL32(b ^ c, 12);                                                     \
+    a += b;                                                                    \
+    d = ROTL32(d ^ a, 8);                                                      \
+    c += d;                                                                    \
+    b = ROTL32(b ^ c, 7);                                                      \
+  } while (0)
+
+static uint32_t load_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+// "expand 32-byte k" and the key; the caller fills words 12-15
+static void chacha20_init_state(uint32_t s[16], const unsigned char key[32]) {
+  s[0] = 0x61707865;
+  s[1] = 0x3320646e;
+  s[2] = 0x79622d32;
+  s[3] = 0x6b206574;
+  for (int i = 0; i < 8; i++)
+    s[4 + i] = load_le32(key + 4 * i);
+}
+
+// 'rounds' rounds (even), without the final addition
+static void chacha_rounds(uint32_t x[16], int rounds) {
+  for (int i = 0; i < rounds; i += 2) {
+    QUARTERROUND(x[0], x[4], x[8], x[12]);
+    QUARTERROUND(x[1], x[5], x[9], x[13]);
+    QUARTERROUND(x[2], x[6], x[10], x[14]);
+    QUARTERROUND(x[3], x[7], x[11], x[15]);
+    QUARTERROUND(x[0], x[5], x[10], x[15]);
+    QUARTERROUND(x[1], x[6], x[11], x[12]);
+    QUARTERROUND(x[2], x[7], x[8], x[13]);
+    QUARTERROUND(x[3], x[4], x[9], x[14]);
+  }
+}
+
+static void chacha20_rounds(uint32_t x[16]) { chacha_rounds(x, 20); }
+
+void vc6_chacha20_block(unsigned char out[64], const unsigned char key[32],
+                        uint32_t counter, const unsigned char nonce[12]) {
+  uint32_t s[16], x[16];
+
+  chacha20_init_state(s, key);
+  s[12] = counter;
+  for (int i = 0; i < 3; i++)
+    s[13 + i] = load_le32(nonce + 4 * i);
+
+  memcpy(x, s, sizeof(x));
+  chacha20_rounds(x);
+  for (int i = 0; i < 16; i++)
+    store_le32(out + 4 * i, x[i] + s[i]);
+}
+
+void vc6_hchacha20(unsigned char out[32], const unsigned char key[32],
+                   const unsigned char nonce[16]) {
+  uint32_t x[16];
+
+  chacha20_init_state(x, key);
+  for (int i = 0; i < 4; i++)
+    x[12 + i] = load_le32(nonce + 4 * i);
+
+  // Rows 0 and 3 of the permuted state, no feed-forward
+  chacha20_rounds(x);
+  for (int i = 0; i < 4; i++) {
+    store_le32(out + 4 * i, x[i]);
+    store_le32(out + 16 + 4 * i, x[12 + i]);
+  }
+  memset(x, 0, sizeof(x));
+}
+
+void vc6_xchacha20_setup(unsigned char subkey[32], unsigned char nonce12[12],
+                         const unsigned char key[32],
+                         const unsigned char nonce24[24]) {
+  vc6_hchacha20(subkey, key, nonce24);
+  memset(nonce12, 0, 4);
+  memcpy(nonce12 + 4, nonce24 + 16, 8);
+}
+
+// One scalar block of the state 's' into 'ks'
+static void chacha_block(unsigned char ks[64], const uint32_t s[16],
+                         int rounds) {
+  uint32_t x[16];
+
+  memcpy(x, s, sizeof(x));
+  chacha_rounds(x, rounds);
+  for (int i = 0; i < 16; i++)
+    store_le32(ks + 4 * i, x[i] + s[i]);
+  memset(x, 0, sizeof(x));
+}
+
+static void xor_bytes(unsigned char *out, const unsigned char *in,
+                      const unsigned char *ks, size_t n) {
+  if (in == NULL) {
+    memcpy(out, ks, n);
+    return;
+  }
+  for (size_t i = 0; i < n; i++)
+    out[i] = in[i] ^ ks[i];
+}
+
+#if defined(VC6_CHACHA_NEON) || defined(VC6_CHACHA_SSE2)
+
+// Four consecutive blocks at once: vector i holds state word i of blocks
+// n .. n+3 (one block per lane), so a quarter round on vectors is four
+// independent quarter rounds. The lanes are transposed back into blocks
+// after the feed-forward.
+#if defined(VC6_CHACHA_NEON)
+typedef uint32x4_t vec;
+#define VADD(a, b) vaddq_u32(a, b)
+#define VXOR(a, b) veorq_u32(a, b)
+#define VDUP(w) vdupq_n_u32(w)
+#define VROTL(v, n) vsriq_n_u32(vshlq_n_u32(v, n), v, 32 - (n))
+#define VROTL16(v) vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(v)))
+#define VLOAD(p) vreinterpretq_u32_u8(vld1q_u8(p))
+#define VSTORE(p, v) vst1q_u8(p, vreinterpretq_u8_u32(v))
+
+static vec counters(uint32_t c) {
+  static const uint32_t lanes[4] = {0, 1, 2, 3};
+  return vaddq_u32(vdupq_n_u32(c), vld1q_u32(lanes));
+}
+
+static void transpose(vec *a, vec *b, vec *c, vec *d) {
+  uint32x4x2_t ab = vtrnq_u32(*a, *b), cd = vtrnq_u32(*c, *d);
+  *a = vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(cd.val[0]));
+  *b = vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(cd.val[1]));
+  *c = vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(cd.val[0]));
+  *d = vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(cd.val[1]));
+}
+#else
+typedef __m128i vec;
+#define VADD(a, b) _mm_add_epi32(a, b)
+#define VXOR(a, b) _mm_xor_si128(a, b)
+#define VDUP(w) _mm_set1_epi32((int)(w))
+#define VROTL(v, n)                                                            \
+  _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define VROTL16(v) VROTL(v, 16)
+#define VLOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+
+static vec counters(uint32_t c) {
+  return _mm_add_epi32(_mm_set1_epi32((int)c), _mm_set_epi32(3, 2, 1, 0));
+}
+
+static void transpose(vec *a, vec *b, vec *c, vec *d) {
+  __m128i ab0 = _mm_unpacklo_epi32(*a, *b), cd0 = _mm_unpacklo_epi32(*c, *d);
+  __m128i ab1 = _mm_unpackhi_epi32(*a, *b), cd1 = _mm_unpackhi_epi32(*c, *d);
+  *a = _mm_unpacklo_epi64(ab0, cd0);
+  *b = _mm_unpackhi_epi64(ab0, cd0);
+  *c = _mm_unpacklo_epi64(ab1, cd1);
+  *d = _mm_unpackhi_epi64(ab1, cd1);
+}
+#endif
+
+#define VQUARTERROUND(a, b, c, d)                                              \
+  do {                                                                         \
+    a = VADD(a, b);                                                            \
+    d = VROTL16(VXOR(d, a));                                                   \
+    c = VADD(c, d);                                                            \
+    b = VROTL(VXOR(b, c), 12);                                                 \
+    a = VADD(a, b);                                                            \
+    d = VROTL(VXOR(d, a), 8);                                                  \
+    c = VADD(c, d);                                                            \
+    b = VROTL(VXOR(b, c), 7);                                                  \
+  } while (0)
+
+// Blocks s[12] .. s[12]+3 (counter wrapping mod 2^32) over 256 bytes
+static void chacha_4blocks(unsigned char *out, const unsigned char *in,
+                           const uint32_t s[16], int rounds) {
+  vec v[16], x[16];
+
+  for (int i = 0; i < 16; i++)
+    v[i] = VDUP(s[i]);
+  v[12] = counters(s[12]);
+  memcpy(x, v, sizeof(x));
+
+  for (int r = 0; r < rounds; r += 2) {
+    VQUARTERROUND(x[0], x[4], x[8], x[12]);
+    VQUARTERROUND(x[1], x[5], x[9], x[13]);
+    VQUARTERROUND(x[2], x[6], x[10], x[14]);
+    VQUARTERROUND(x[3], x[7], x[11], x[15]);
+    VQUARTERROUND(x[0], x[5], x[10], x[15]);
+    VQUARTERROUND(x[1], x[6], x[11], x[12]);
+    VQUARTERROUND(x[2], x[7], x[8], x[13]);
+    VQUARTERROUND(x[3], x[4], x[9], x[14]);
+  }
+
+  // Words i..i+3 of each block: after the transpose x[i + j] is block j's
+  // 16 bytes at offset 4 * i
+  for (int i = 0; i < 16; i += 4) {
+    for (int j = 0; j < 4; j++)
+      x[i + j] = VADD(x[i + j], v[i + j]);
+    transpose(&x[i], &x[i + 1], &x[i + 2], &x[i + 3]);
+    for (int j = 0; j < 4; j++) {
+      size_t off = 64 * (size_t)j + 4 * (size_t)i;
+      VSTORE(out + off,
+             in == NULL ? x[i + j] : VXOR(VLOAD(in + off), x[i + j]));
+    }
+  }
+}
+#endif
+
+const char *vc6_chacha_cpu_impl(void) {
+#if defined(VC6_CHACHA_NEON)
+  return "neon";
+#elif defined(VC6_CHACHA_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+void vc6_chacha_xor(unsigned char *out, const unsigned char *in, size_t len,
+                    const unsigned char key[32], const unsigned char iv[16],
+                    size_t skip, int rounds) {
+  uint32_t s[16];
+  unsigned char ks[64];
+
+  chacha20_init_state(s, key);
+  for (int i = 0; i < 4; i++)
+    s[12 + i] = load_le32(iv + 4 * i);
+
+  // Rest of a block the caller is part-way into
+  if (skip > 0 && len > 0) {
+    size_t n = 64 - skip < len ? 64 - skip : len;
+    chacha_block(ks, s, rounds);
+    xor_bytes(out, in, ks + skip, n);
+    s[12]++;
+    out += n;
+    in = in ? in + n : NULL;
+    len -= n;
+  }
+
+#if defined(VC6_CHACHA_NEON) || defined(VC6_CHACHA_SSE2)
+  for (; len >= 256; len -= 256) {
+    chacha_4blocks(out, in, s, rounds);
+    s[12] += 4;
+    out += 256;
+    in = in ? in + 256 : NULL;
+  }
+#endif
+
+  while (len > 0) {
+    size_t n = len < 64 ? len : 64;
+    chacha_block(ks, s, rounds);
+    xor_bytes(out, in, ks, n);
+    s[12]++;
+    out += n;
+    in = in ? in + n : NULL;
+    len -= n;
+  }
+
+  memset(ks, 0, sizeof(ks));
+  memset(s, 0, sizeof(s));
+}
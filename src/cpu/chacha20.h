@@ -0,0 +1,48 @@
+#ifndef VC6_CPU_CHACHA20_H
+#define VC6_CPU_CHACHA20_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scalar ChaCha20 (RFC 8439) for the few blocks that are not worth a GPU
+// dispatch, e.g. the Poly1305 one-time key, and the HChaCha20 subkey
+// derivation of XChaCha20.
+
+// One 64-byte keystream block for (key, counter, 12-byte nonce)
+void vc6_chacha20_block(unsigned char out[64], const unsigned char key[32],
+                        uint32_t counter, const unsigned char nonce[12]);
+
+// HChaCha20 (draft-irtf-cfrg-xchacha): 32-byte subkey from the key and the
+// first 16 bytes of an XChaCha20 nonce
+void vc6_hchacha20(unsigned char out[32], const unsigned char key[32],
+                   const unsigned char nonce[16]);
+
+// XChaCha20 in terms of the IETF cipher: subkey = HChaCha20(key, n[0..15]),
+// 12-byte nonce = 0^4 || n[16..23]
+void vc6_xchacha20_setup(unsigned char subkey[32], unsigned char nonce12[12],
+                         const unsigned char key[32],
+                         const unsigned char nonce24[24]);
+
+// ChaCha with 'rounds' (20, 12 or 8) over 'len' bytes, the CPU engine for
+// jobs too small for (or refused by) the GPU. Bit-identical to
+// chacha20.comp: iv = [32-bit LE block counter][12-byte nonce], the
+// counter wraps mod 2^32 without carrying into the nonce. The first 'skip'
+// (< 64) keystream bytes are discarded; in == NULL writes raw keystream.
+// Four blocks at a time with NEON (aarch64) or SSE2 (x86), scalar
+// otherwise and for the tail.
+void vc6_chacha_xor(unsigned char *out, const unsigned char *in, size_t len,
+                    const unsigned char key[32], const unsigned char iv[16],
+                    size_t skip, int rounds);
+
+// "neon", "sse2" or "scalar": the path vc6_chacha_xor() was built with
+const char *vc6_chacha_cpu_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_CPU_CHACHA20_H
@@ -0,0 +1,205 @@
+#include "ghash.h"
+
+#include <string.h>
+
+// Field elements are held as two big-endian 64-bit halves of the 16-byte
+// block; bit 0 of the polynomial is the MSB of byte 0 (GCM bit order).
+
+static uint64_t load_be64(const unsigned char *p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; i++)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+static void store_be64(unsigned char *p, uint64_t v) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = (unsigned char)v;
+    v >>= 8;
+  }
+}
+
+// Multiply by x (one right shift in GCM bit order) with reduction
+#define REDUCE1BIT(hi, lo)                                                     \
+  do {                                                                         \
+    uint64_t t_ = 0xe100000000000000ULL & (0 - ((lo) & 1));                   \
+    (lo) = ((hi) << 63) | ((lo) >> 1);                                         \
+    (hi) = ((hi) >> 1) ^ t_;                                                   \
+  } while (0)
+
+void vc6_ghash_init(VC6_GHASH_KEY *key, const unsigned char H[16]) {
+  uint64_t hi = load_be64(H), lo = load_be64(H + 8);
+  memcpy(key->H, H, 16);
+
+  // Table[i] = i * H for the 4-bit value i (bit 3 = x^0)
+  key->hi[0] = key->lo[0] = 0;
+  key->hi[8] = hi;
+  key->lo[8] = lo;
+  REDUCE1BIT(hi, lo);
+  key->hi[4] = hi;
+  key->lo[4] = lo;
+  REDUCE1BIT(hi, lo);
+  key->hi[2] = hi;
+  key->lo[2] = lo;
+  REDUCE1BIT(hi, lo);
+  key->hi[1] = hi;
+  key->lo[1] = lo;
+  for (int i = 2; i < 16; i <<= 1) {
+    for (int j = 1; j < i; j++) {
+      key->hi[i + j] = key->hi[i] ^ key->hi[j];
+      key->lo[i + j] = key->lo[i] ^ key->lo[j];
+    }
+  }
+}
+
+// Reduction of the 4 bits shifted out at the bottom
+static const uint64_t rem_4bit[16] = {
+    0x0000ULL << 48, 0x1C20ULL << 48, 0x3840ULL << 48, 0x2460ULL << 48,
+    0x7080ULL << 48, 0x6CA0ULL << 48, 0x48C0ULL << 48, 0x54E0ULL << 48,
+    0xE100ULL << 48, 0xFD20ULL << 48, 0xD940ULL << 48, 0xC560ULL << 48,
+    0x9180ULL << 48, 0x8DA0ULL << 48, 0xA9C0ULL << 48, 0xB5E0ULL << 48};
+
+// X = X * H
+static void gmult_4bit(const VC6_GHASH_KEY *key, unsigned char X[16]) {
+  uint64_t zhi = 0, zlo = 0;
+
+  for (int i = 15; i >= 0; i--) {
+    unsigned int nlo = X[i] & 0xf;
+    unsigned int nhi = X[i] >> 4;
+    unsigned int rem;
+
+    if (i != 15) {
+      rem = (unsigned int)zlo & 0xf;
+      zlo = (zhi << 60) | (zlo >> 4);
+      zhi = (zhi >> 4) ^ rem_4bit[rem];
+    }
+    zhi ^= key->hi[nlo];
+    zlo ^= key->lo[nlo];
+
+    rem = (unsigned int)zlo & 0xf;
+    zlo = (zhi << 60) | (zlo >> 4);
+    zhi = (zhi >> 4) ^ rem_4bit[rem];
+    zhi ^= key->hi[nhi];
+    zlo ^= key->lo[nhi];
+  }
+
+  store_be64(X, zhi);
+  store_be64(X + 8, zlo);
+}
+
+void vc6_ghash(const VC6_GHASH_KEY *key, unsigned char Y[16],
+               const unsigned char *in, size_t len) {
+  for (size_t off = 0; off + 16 <= len; off += 16) {
+    for (int i = 0; i < 16; i++)
+      Y[i] ^= in[off + i];
+    gmult_4bit(key, Y);
+  }
+}
+
+void vc6_ghash_powers(const VC6_GHASH_KEY *key, unsigned char *out,
+                      size_t n) {
+  unsigned char X[16];
+  memcpy(X, key->H, 16);
+  for (size_t i = 0; i < n; i++) {
+    memcpy(out + 16 * i, X, 16);
+    gmult_4bit(key, X);
+  }
+}
+
+void vc6_ghash_fold(const VC6_GHASH_KEY *key, const VC6_GHASH_KEY *kgroup,
+                    unsigned char Y[16], const unsigned char *partials,
+                    size_t groups, size_t group_blocks, size_t last_blocks) {
+  for (size_t g = 0; g < groups; g++) {
+    if (g + 1 < groups || last_blocks == group_blocks) {
+      gmult_4bit(kgroup, Y);
+    } else {
+      unsigned char p[16];
+      vc6_gf128_pow(p, key->H, last_blocks);
+      vc6_gf128_mul(Y, Y, p);
+    }
+    for (int i = 0; i < 16; i++)
+      Y[i] ^= partials[16 * g + i];
+  }
+}
+
+void vc6_gf128_mul(unsigned char r[16], const unsigned char a[16],
+                   const unsigned char b[16]) {
+  uint64_t zhi = 0, zlo = 0;
+  uint64_t vhi = load_be64(b), vlo = load_be64(b + 8);
+
+  for (int i = 0; i < 128; i++) {
+    uint64_t mask = 0 - (uint64_t)((a[i >> 3] >> (7 - (i & 7))) & 1);
+    zhi ^= vhi & mask;
+    zlo ^= vlo & mask;
+    REDUCE1BIT(vhi, vlo);
+  }
+  store_be64(r, zhi);
+  store_be64(r + 8, zlo);
+}
+
+void vc6_gf128_pow(unsigned char r[16], const unsigned char h[16],
+                   uint64_t n) {
+  unsigned char acc[16] = {0x80}; // 1
+  unsigned char base[16];
+  memcpy(base, h, 16);
+  while (n != 0) {
+    if (n & 1)
+      vc6_gf128_mul(acc, acc, base);
+    vc6_gf128_mul(base, base, base);
+    n >>= 1;
+  }
+  memcpy(r, acc, 16);
+}
+
+#define GHASH_MAX_SEGMENTS 8
+#define GHASH_MIN_SEGMENT (4096 / 16) // Blocks; smaller segments don't pay
+
+typedef struct {
+  const VC6_GHASH_KEY *key;
+  const unsigned char *in;
+  size_t len;
+  unsigned char S[16];
+} GHASH_SEGMENT;
+
+static void ghash_segment(void *arg, size_t j) {
+  GHASH_SEGMENT *seg = (GHASH_SEGMENT *)arg + j;
+  memset(seg->S, 0, 16);
+  vc6_ghash(seg->key, seg->S, seg->in, seg->len);
+}
+
+void vc6_ghash_parallel(const VC6_GHASH_KEY *key, unsigned char Y[16],
+                        const unsigned char *in, size_t len, int segments,
+                        VC6_PARALLEL_FN run) {
+  size_t blocks = len / 16;
+  if (segments > GHASH_MAX_SEGMENTS)
+    segments = GHASH_MAX_SEGMENTS;
+  if (run == NULL || segments <= 1 ||
+      blocks < (size_t)segments * GHASH_MIN_SEGMENT) {
+    vc6_ghash(key, Y, in, len);
+    return;
+  }
+
+  GHASH_SEGMENT seg[GHASH_MAX_SEGMENTS];
+  size_t first = 0;
+  for (int j = 0; j < segments; j++) {
+    size_t end = blocks * (j + 1) / segments;
+    seg[j].key = key;
+    seg[j].in = in + first * 16;
+    seg[j].len = (end - first) * 16;
+    first = end;
+  }
+  run((size_t)segments, ghash_segment, seg);
+
+  // Y * H^n, then add each segment shifted by the blocks that follow it
+  unsigned char p[16];
+  vc6_gf128_pow(p, key->H, blocks);
+  vc6_gf128_mul(Y, Y, p);
+  size_t after = blocks;
+  for (int j = 0; j < segments; j++) {
+    after -= seg[j].len / 16;
+    vc6_gf128_pow(p, key->H, after);
+    vc6_gf128_mul(p, seg[j].S, p);
+    for (int i = 0; i < 16; i++)
+      Y[i] ^= p[i];
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef VC6_GHASH_H
+#define VC6_GHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parallel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// GHASH (NIST SP 800-38D) on the CPU, 4-bit table method.
+// Used next to the GPU CTR pass for AES-GCM.
+
+typedef struct {
+  uint64_t hi[16];
+  uint64_t lo[16];
+  unsigned char H[16];
+} VC6_GHASH_KEY;
+
+void vc6_ghash_init(VC6_GHASH_KEY *key, const unsigned char H[16]);
+
+// Y = (Y ^ X_i) * H for each 16-byte block of 'in' ('len' multiple of 16)
+void vc6_ghash(const VC6_GHASH_KEY *key, unsigned char Y[16],
+               const unsigned char *in, size_t len);
+
+// Same result as vc6_ghash(), with the blocks split into 'segments' run
+// through 'run' (NULL: hashed in one pass). Each segment is hashed from
+// zero and the partial results are combined with powers of H:
+// Y' = Y*H^n + sum(S_j * H^(blocks after j)).
+void vc6_ghash_parallel(const VC6_GHASH_KEY *key, unsigned char Y[16],
+                        const unsigned char *in, size_t len, int segments,
+                        VC6_PARALLEL_FN run);
+
+// out[16 * i] = H^(i + 1) for i < n (the GPU's power table)
+void vc6_ghash_powers(const VC6_GHASH_KEY *key, unsigned char *out, size_t n);
+
+// Folds per-group GHASH partials into Y in order: Y = Y * H^m ^ P for each
+// 16-byte P, where every group has 'group_blocks' blocks except the last,
+// which has 'last_blocks'. 'kgroup' is the table for H^group_blocks.
+void vc6_ghash_fold(const VC6_GHASH_KEY *key, const VC6_GHASH_KEY *kgroup,
+                    unsigned char Y[16], const unsigned char *partials,
+                    size_t groups, size_t group_blocks, size_t last_blocks);
+
+// r = a * b in GF(2^128) (bit-serial; for combining, not bulk data)
+void vc6_gf128_mul(unsigned char r[16], const unsigned char a[16],
+                   const unsigned char b[16]);
+
+// r = h^n
+void vc6_gf128_pow(unsigned char r[16], const unsigned char h[16],
+                   uint64_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_GHASH_H
@@ -0,0 +1,21 @@
+#ifndef VC6_CPU_PARALLEL_H
+#define VC6_CPU_PARALLEL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fork-join hook for the CPU kernels: runs fn(arg, i) for every i in
+// [0, n) and returns once all of them ran. The kernels start no threads
+// themselves; the provider passes vc6_parallel_for(), the backend's task
+// pool.
+typedef void (*VC6_PARALLEL_FN)(size_t n, void (*fn)(void *arg, size_t i),
+                                void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_CPU_PARALLEL_H
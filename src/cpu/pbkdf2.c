@@ -0,0 +1,126 @@
+// SHA256_Init/Update/Transform: OpenSSL's compression function without a
+// fetch from inside the provider
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "pbkdf2.h"
+
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+#include <string.h>
+
+static void store_be32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+void vc6_sha256_store(unsigned char *out, const uint32_t h[8], size_t len) {
+  unsigned char full[32];
+  for (int i = 0; i < 8; i++)
+    store_be32(full + 4 * i, h[i]);
+  memcpy(out, full, len < 32 ? len : 32);
+}
+
+// SHA-256 midstate after one 64-byte block
+static void midstate(uint32_t h[8], const unsigned char block[64]) {
+  SHA256_CTX c;
+  SHA256_Init(&c);
+  SHA256_Transform(&c, block);
+  memcpy(h, c.h, 32);
+  OPENSSL_cleanse(&c, sizeof(c));
+}
+
+void vc6_hmac_sha256_key(VC6_HMAC_SHA256_KEY *key, const unsigned char *pass,
+                         size_t pass_len) {
+  unsigned char k[64] = {0}, pad[64];
+
+  if (pass_len > 64)
+    SHA256(pass, pass_len, k);
+  else if (pass_len > 0)
+    memcpy(k, pass, pass_len);
+
+  for (int i = 0; i < 64; i++)
+    pad[i] = k[i] ^ 0x36;
+  midstate(key->inner, pad);
+  for (int i = 0; i < 64; i++)
+    pad[i] = k[i] ^ 0x5c;
+  midstate(key->outer, pad);
+  OPENSSL_cleanse(k, sizeof(k));
+  OPENSSL_cleanse(pad, sizeof(pad));
+}
+
+// h = compress(state, msg || padding) for a 32-byte message that follows
+// the 64-byte key block (total 96 bytes = 768 bits)
+static void hash32(uint32_t h[8], const uint32_t state[8],
+                   const uint32_t msg[8]) {
+  static const unsigned char tail[32] = {0x80, [30] = 0x03};
+  SHA256_CTX c;
+  unsigned char block[64];
+  for (int i = 0; i < 8; i++)
+    store_be32(block + 4 * i, msg[i]);
+  memcpy(block + 32, tail, 32);
+  memcpy(c.h, state, 32);
+  SHA256_Transform(&c, block);
+  memcpy(h, c.h, 32);
+}
+
+void vc6_pbkdf2_sha256_u1(uint32_t u[8], const VC6_HMAC_SHA256_KEY *key,
+                          const unsigned char *salt, size_t salt_len,
+                          uint32_t block) {
+  SHA256_CTX c;
+  unsigned char idx[4], inner[32];
+
+  // The key block is already in the midstates: continue after 64 bytes
+  SHA256_Init(&c);
+  memcpy(c.h, key->inner, 32);
+  c.Nl = 512;
+  SHA256_Update(&c, salt, salt_len);
+  store_be32(idx, block);
+  SHA256_Update(&c, idx, 4);
+  SHA256_Final(inner, &c);
+
+  SHA256_Init(&c);
+  memcpy(c.h, key->outer, 32);
+  c.Nl = 512;
+  SHA256_Update(&c, inner, 32);
+  SHA256_Final(inner, &c);
+  for (int i = 0; i < 8; i++)
+    u[i] = ((uint32_t)inner[4 * i] << 24) | ((uint32_t)inner[4 * i + 1] << 16) |
+           ((uint32_t)inner[4 * i + 2] << 8) | inner[4 * i + 3];
+  OPENSSL_cleanse(&c, sizeof(c));
+  OPENSSL_cleanse(inner, sizeof(inner));
+}
+
+void vc6_pbkdf2_sha256_iterate(uint32_t u[8], uint32_t t[8],
+                               const VC6_HMAC_SHA256_KEY *key, uint64_t n) {
+  uint32_t inner[8];
+  for (uint64_t it = 0; it < n; it++) {
+    hash32(inner, key->inner, u);
+    hash32(u, key->outer, inner);
+    for (int i = 0; i < 8; i++)
+      t[i] ^= u[i];
+  }
+}
+
+void vc6_pbkdf2_sha256(unsigned char *out, size_t out_len,
+                       const unsigned char *pass, size_t pass_len,
+                       const unsigned char *salt, size_t salt_len,
+                       uint64_t iterations) {
+  VC6_HMAC_SHA256_KEY key;
+  uint32_t u[8], t[8];
+
+  vc6_hmac_sha256_key(&key, pass, pass_len);
+  for (uint32_t block = 1; out_len > 0; block++) {
+    size_t n = out_len < 32 ? out_len : 32;
+    vc6_pbkdf2_sha256_u1(u, &key, salt, salt_len, block);
+    memcpy(t, u, sizeof(t));
+    vc6_pbkdf2_sha256_iterate(u, t, &key, iterations - 1);
+    vc6_sha256_store(out, t, n);
+    out += n;
+    out_len -= n;
+  }
+  OPENSSL_cleanse(&key, sizeof(key));
+  OPENSSL_cleanse(u, sizeof(u));
+  OPENSSL_cleanse(t, sizeof(t));
+}
@@ -0,0 +1,47 @@
+#ifndef VC6_PBKDF2_H
+#define VC6_PBKDF2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// PBKDF2-HMAC-SHA256 (RFC 8018) on the CPU: the per-password setup for the
+// GPU kernel, and whole derivations when a batch is too small for the GPU.
+// Hash values are SHA-256 state words (big-endian message order).
+
+// HMAC key: SHA-256 midstates after the (key ^ ipad) and (key ^ opad)
+// blocks, so each HMAC of a 32-byte message costs two compressions
+typedef struct {
+  uint32_t inner[8];
+  uint32_t outer[8];
+} VC6_HMAC_SHA256_KEY;
+
+void vc6_hmac_sha256_key(VC6_HMAC_SHA256_KEY *key, const unsigned char *pass,
+                         size_t pass_len);
+
+// U_1 = HMAC(P, S || INT(block)) for output block 'block' (from 1)
+void vc6_pbkdf2_sha256_u1(uint32_t u[8], const VC6_HMAC_SHA256_KEY *key,
+                          const unsigned char *salt, size_t salt_len,
+                          uint32_t block);
+
+// 'n' more iterations: U = HMAC(P, U), T ^= U
+void vc6_pbkdf2_sha256_iterate(uint32_t u[8], uint32_t t[8],
+                               const VC6_HMAC_SHA256_KEY *key, uint64_t n);
+
+// Whole derivation of 'out_len' bytes; 'iterations' at least 1
+void vc6_pbkdf2_sha256(unsigned char *out, size_t out_len,
+                       const unsigned char *pass, size_t pass_len,
+                       const unsigned char *salt, size_t salt_len,
+                       uint64_t iterations);
+
+// Writes state words as the big-endian digest bytes
+void vc6_sha256_store(unsigned char *out, const uint32_t h[8], size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_PBKDF2_H
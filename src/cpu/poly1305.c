@@ -0,0 +1,215 @@
+#include "poly1305.h"
+
+#include <string.h>
+
+#define MASK26 0x3ffffff
+
+static uint32_t load_le32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+void vc6_poly1305_init(VC6_POLY1305_KEY *key, const unsigned char otk[32]) {
+  // r &= 0x0ffffffc0ffffffc0ffffffc0fffffff, split into 26-bit limbs
+  key->r[0] = (load_le32(otk + 0)) & 0x3ffffff;
+  key->r[1] = (load_le32(otk + 3) >> 2) & 0x3ffff03;
+  key->r[2] = (load_le32(otk + 6) >> 4) & 0x3ffc0ff;
+  key->r[3] = (load_le32(otk + 9) >> 6) & 0x3f03fff;
+  key->r[4] = (load_le32(otk + 12) >> 8) & 0x00fffff;
+  for (int i = 0; i < 4; i++)
+    key->pad[i] = load_le32(otk + 16 + 4 * i);
+}
+
+// h = h * r mod 2^130 - 5, partially reduced (limbs ~26 bits). h limbs up
+// to 2^28 and r limbs up to 2^26 keep every sum below 2^64.
+static void poly_mul(uint32_t h[5], const uint32_t r[5]) {
+  uint64_t s1 = r[1] * 5ULL, s2 = r[2] * 5ULL, s3 = r[3] * 5ULL,
+           s4 = r[4] * 5ULL;
+  uint64_t d0, d1, d2, d3, d4, c;
+
+  d0 = (uint64_t)h[0] * r[0] + h[1] * s4 + h[2] * s3 + h[3] * s2 + h[4] * s1;
+  d1 = (uint64_t)h[0] * r[1] + (uint64_t)h[1] * r[0] + h[2] * s4 +
+       h[3] * s3 + h[4] * s2;
+  d2 = (uint64_t)h[0] * r[2] + (uint64_t)h[1] * r[1] +
+       (uint64_t)h[2] * r[0] + h[3] * s4 + h[4] * s3;
+  d3 = (uint64_t)h[0] * r[3] + (uint64_t)h[1] * r[2] +
+       (uint64_t)h[2] * r[1] + (uint64_t)h[3] * r[0] + h[4] * s4;
+  d4 = (uint64_t)h[0] * r[4] + (uint64_t)h[1] * r[3] +
+       (uint64_t)h[2] * r[2] + (uint64_t)h[3] * r[1] +
+       (uint64_t)h[4] * r[0];
+
+  c = d0 >> 26;
+  h[0] = (uint32_t)d0 & MASK26;
+  d1 += c;
+  c = d1 >> 26;
+  h[1] = (uint32_t)d1 & MASK26;
+  d2 += c;
+  c = d2 >> 26;
+  h[2] = (uint32_t)d2 & MASK26;
+  d3 += c;
+  c = d3 >> 26;
+  h[3] = (uint32_t)d3 & MASK26;
+  d4 += c;
+  c = d4 >> 26;
+  h[4] = (uint32_t)d4 & MASK26;
+  h[0] += (uint32_t)c * 5;
+  c = h[0] >> 26;
+  h[0] &= MASK26;
+  h[1] += (uint32_t)c;
+}
+
+// Carries every limb back to 26 bits (after adding partial sums)
+static void poly_carry(uint32_t h[5]) {
+  uint32_t c = 0;
+  for (int i = 0; i < 5; i++) {
+    h[i] += c;
+    c = h[i] >> 26;
+    h[i] &= MASK26;
+  }
+  h[0] += c * 5;
+  c = h[0] >> 26;
+  h[0] &= MASK26;
+  h[1] += c;
+}
+
+void vc6_poly1305_blocks(const VC6_POLY1305_KEY *key, uint32_t h[5],
+                         const unsigned char *in, size_t len) {
+  for (size_t off = 0; off + 16 <= len; off += 16) {
+    const unsigned char *m = in + off;
+    h[0] += (load_le32(m + 0)) & MASK26;
+    h[1] += (load_le32(m + 3) >> 2) & MASK26;
+    h[2] += (load_le32(m + 6) >> 4) & MASK26;
+    h[3] += (load_le32(m + 9) >> 6) & MASK26;
+    h[4] += (load_le32(m + 12) >> 8) | (1 << 24); // 2^128 pad bit
+    poly_mul(h, key->r);
+  }
+}
+
+// r^n by square-and-multiply
+static void poly_pow(uint32_t out[5], const uint32_t r[5], uint64_t n) {
+  uint32_t acc[5] = {1, 0, 0, 0, 0}, base[5];
+  memcpy(base, r, sizeof(base));
+  while (n != 0) {
+    if (n & 1)
+      poly_mul(acc, base);
+    uint32_t sq[5];
+    memcpy(sq, base, sizeof(sq));
+    poly_mul(base, sq);
+    n >>= 1;
+  }
+  memcpy(out, acc, sizeof(acc));
+}
+
+#define POLY_MAX_SEGMENTS 8
+#define POLY_MIN_SEGMENT (4096 / 16) // Blocks; smaller segments don't pay
+
+typedef struct {
+  const VC6_POLY1305_KEY *key;
+  const unsigned char *in;
+  size_t len;
+  uint32_t S[5];
+} POLY_SEGMENT;
+
+static void poly_segment(void *arg, size_t j) {
+  POLY_SEGMENT *seg = (POLY_SEGMENT *)arg + j;
+  memset(seg->S, 0, sizeof(seg->S));
+  vc6_poly1305_blocks(seg->key, seg->S, seg->in, seg->len);
+}
+
+void vc6_poly1305_parallel(const VC6_POLY1305_KEY *key, uint32_t h[5],
+                           const unsigned char *in, size_t len, int segments,
+                           VC6_PARALLEL_FN run) {
+  size_t blocks = len / 16;
+  if (segments > POLY_MAX_SEGMENTS)
+    segments = POLY_MAX_SEGMENTS;
+  if (run == NULL || segments <= 1 ||
+      blocks < (size_t)segments * POLY_MIN_SEGMENT) {
+    vc6_poly1305_blocks(key, h, in, len);
+    return;
+  }
+
+  POLY_SEGMENT seg[POLY_MAX_SEGMENTS];
+  size_t first = 0;
+  for (int j = 0; j < segments; j++) {
+    size_t end = blocks * (j + 1) / segments;
+    seg[j].key = key;
+    seg[j].in = in + first * 16;
+    seg[j].len = (end - first) * 16;
+    first = end;
+  }
+  run((size_t)segments, poly_segment, seg);
+
+  // h * r^n, then add each segment shifted by the blocks that follow it
+  uint32_t p[5];
+  poly_pow(p, key->r, blocks);
+  poly_mul(h, p);
+  size_t after = blocks;
+  for (int j = 0; j < segments; j++) {
+    after -= seg[j].len / 16;
+    poly_pow(p, key->r, after);
+    poly_mul(seg[j].S, p);
+    for (int i = 0; i < 5; i++)
+      h[i] += seg[j].S[i];
+    poly_carry(h);
+  }
+}
+
+void vc6_poly1305_finish(const VC6_POLY1305_KEY *key, const uint32_t h[5],
+                         unsigned char tag[16]) {
+  uint32_t h0, h1, h2, h3, h4, g0, g1, g2, g3, g4, c, mask;
+  uint64_t f;
+  uint32_t t[5];
+
+  memcpy(t, h, sizeof(t));
+  poly_carry(t);
+  poly_carry(t);
+  h0 = t[0];
+  h1 = t[1];
+  h2 = t[2];
+  h3 = t[3];
+  h4 = t[4];
+
+  // g = h + 5 - 2^130; use it if h >= p
+  g0 = h0 + 5;
+  c = g0 >> 26;
+  g0 &= MASK26;
+  g1 = h1 + c;
+  c = g1 >> 26;
+  g1 &= MASK26;
+  g2 = h2 + c;
+  c = g2 >> 26;
+  g2 &= MASK26;
+  g3 = h3 + c;
+  c = g3 >> 26;
+  g3 &= MASK26;
+  g4 = h4 + c - (1UL << 26);
+
+  mask = (g4 >> 31) - 1; // All ones if h >= p
+  h0 = (h0 & ~mask) | (g0 & mask);
+  h1 = (h1 & ~mask) | (g1 & mask);
+  h2 = (h2 & ~mask) | (g2 & mask);
+  h3 = (h3 & ~mask) | (g3 & mask);
+  h4 = (h4 & ~mask) | (g4 & mask);
+
+  // h %= 2^128, then + s
+  h0 = (h0) | (h1 << 26);
+  h1 = (h1 >> 6) | (h2 << 20);
+  h2 = (h2 >> 12) | (h3 << 14);
+  h3 = (h3 >> 18) | (h4 << 8);
+
+  f = (uint64_t)h0 + key->pad[0];
+  store_le32(tag + 0, (uint32_t)f);
+  f = (uint64_t)h1 + key->pad[1] + (f >> 32);
+  store_le32(tag + 4, (uint32_t)f);
+  f = (uint64_t)h2 + key->pad[2] + (f >> 32);
+  store_le32(tag + 8, (uint32_t)f);
+  f = (uint64_t)h3 + key->pad[3] + (f >> 32);
+  store_le32(tag + 12, (uint32_t)f);
+}
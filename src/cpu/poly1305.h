@@ -0,0 +1,45 @@
+#ifndef VC6_POLY1305_H
+#define VC6_POLY1305_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parallel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Poly1305 (RFC 8439) on the CPU, 26-bit limbs (32-bit multiplies only,
+// so it runs on armhf as well as aarch64).
+// Used next to the GPU ChaCha20 pass for ChaCha20-Poly1305.
+
+typedef struct {
+  uint32_t r[5];   // Clamped r
+  uint32_t pad[4]; // s, added at the end
+} VC6_POLY1305_KEY;
+
+void vc6_poly1305_init(VC6_POLY1305_KEY *key, const unsigned char otk[32]);
+
+// h = (h + m_i) * r for each full 16-byte block m_i of 'in' ('len' multiple
+// of 16); h starts at zero
+void vc6_poly1305_blocks(const VC6_POLY1305_KEY *key, uint32_t h[5],
+                         const unsigned char *in, size_t len);
+
+// Same result as vc6_poly1305_blocks(), with the blocks split into
+// 'segments' run through 'run' (NULL: evaluated in one pass). Each segment
+// is evaluated from zero and the partial sums are combined with powers of
+// r: h' = h*r^n + sum(S_j * r^(blocks after j)).
+void vc6_poly1305_parallel(const VC6_POLY1305_KEY *key, uint32_t h[5],
+                           const unsigned char *in, size_t len, int segments,
+                           VC6_PARALLEL_FN run);
+
+// tag = (h mod 2^130 - 5) + s mod 2^128
+void vc6_poly1305_finish(const VC6_POLY1305_KEY *key, const uint32_t h[5],
+                         unsigned char tag[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_POLY1305_H
@@ -0,0 +1,81 @@
+#include "stream_copy.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// 32-bit ARM NEON has no non-temporal store, so only aarch64 gets one
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VC6_STREAM_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VC6_STREAM_SSE2 1
+#endif
+
+#define LINE 64
+
+const char *vc6_stream_copy_impl(void) {
+#if defined(VC6_STREAM_NEON)
+  return "neon";
+#elif defined(VC6_STREAM_SSE2)
+  return "sse2";
+#else
+  return "memcpy";
+#endif
+}
+
+#if defined(VC6_STREAM_NEON) || defined(VC6_STREAM_SSE2)
+// 'dst' is 64-byte aligned; 'src' may be anything
+static void stream_lines(unsigned char *dst, const unsigned char *src,
+                         size_t lines) {
+  for (size_t i = 0; i < lines; i++, dst += LINE, src += LINE) {
+#if defined(VC6_STREAM_NEON)
+    uint8x16_t a = vld1q_u8(src), b = vld1q_u8(src + 16);
+    uint8x16_t c = vld1q_u8(src + 32), d = vld1q_u8(src + 48);
+    __asm__ volatile("stnp %q0, %q1, [%2]\n\t"
+                     "stnp %q3, %q4, [%2, #32]"
+                     :
+                     : "w"(a), "w"(b), "r"(dst), "w"(c), "w"(d)
+                     : "memory");
+#else
+    __m128i a = _mm_loadu_si128((const __m128i *)src);
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+    __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+    _mm_stream_si128((__m128i *)dst, a);
+    _mm_stream_si128((__m128i *)(dst + 16), b);
+    _mm_stream_si128((__m128i *)(dst + 32), c);
+    _mm_stream_si128((__m128i *)(dst + 48), d);
+#endif
+  }
+  // Non-temporal stores are weakly ordered; complete them before whatever
+  // hands the buffer to the GPU
+#if defined(VC6_STREAM_NEON)
+  __asm__ volatile("dmb st" ::: "memory");
+#else
+  _mm_sfence();
+#endif
+}
+#endif
+
+void vc6_stream_copy(void *dst, const void *src, size_t len) {
+#if defined(VC6_STREAM_NEON) || defined(VC6_STREAM_SSE2)
+  unsigned char *d = (unsigned char *)dst;
+  const unsigned char *s = (const unsigned char *)src;
+  // Up to the first line boundary of 'dst'; small copies stay memcpy
+  size_t head = (LINE - ((uintptr_t)d & (LINE - 1))) & (LINE - 1);
+  if (len < head + 4 * LINE) {
+    memcpy(d, s, len);
+    return;
+  }
+  memcpy(d, s, head);
+  d += head;
+  s += head;
+  len -= head;
+  stream_lines(d, s, len / LINE);
+  memcpy(d + (len & ~(size_t)(LINE - 1)), s + (len & ~(size_t)(LINE - 1)),
+         len & (LINE - 1));
+#else
+  memcpy(dst, src, len);
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef VC6_CPU_STREAM_COPY_H
+#define VC6_CPU_STREAM_COPY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// memcpy with non-temporal stores, for filling write-combined (host-visible,
+// uncached) mappings such as the input ring: the data goes out in whole
+// 64-byte lines without being read into or kept in the CPU caches. STNP on
+// aarch64, MOVNTDQ on x86 (SSE2), plain memcpy elsewhere. The stores are
+// fenced before returning, so a following queue submit sees them.
+void vc6_stream_copy(void *dst, const void *src, size_t len);
+
+// "neon", "sse2" or "memcpy": the path the copy was built with
+const char *vc6_stream_copy_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VC6_CPU_STREAM_COPY_H
@@ -0,0 +1,121 @@
+// Chunked GPU-cipher / CPU-MAC pipeline shared by the AEAD ciphers.
+// Large updates are cut into chunks and the two overlap: when encrypting,
+// chunk k is MACed while the GPU encrypts chunk k + 1; when decrypting,
+// chunk k + 1 is MACed while the GPU decrypts chunk k (so in-place
+// operation stays correct). The MAC of a chunk runs as a task on the
+// backend's CPU pool.
+
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "vc6_prov.h"
+
+#define AEAD_BLK 16
+#define AEAD_CHUNK (1024 * 1024)  // Pipeline granularity
+#define AEAD_PIPELINE_MIN (16384) // Smaller chunks are MACed inline
+
+void vc6_aead_absorb(const VC6_AEAD_PIPE *pipe, const unsigned char *p,
+                     size_t n) {
+  if (*pipe->buf_len > 0) {
+    size_t take = AEAD_BLK - *pipe->buf_len;
+    if (take > n)
+      take = n;
+    memcpy(pipe->buf + *pipe->buf_len, p, take);
+    *pipe->buf_len += take;
+    p += take;
+    n -= take;
+    if (*pipe->buf_len < AEAD_BLK)
+      return;
+    pipe->mac(pipe->ctx, pipe->buf, AEAD_BLK);
+    *pipe->buf_len = 0;
+  }
+  size_t whole = n & ~(size_t)(AEAD_BLK - 1);
+  pipe->mac(pipe->ctx, p, whole);
+  memcpy(pipe->buf, p + whole, n - whole);
+  *pipe->buf_len = n - whole;
+}
+
+void vc6_aead_pad(const VC6_AEAD_PIPE *pipe) {
+  if (*pipe->buf_len == 0)
+    return;
+  memset(pipe->buf + *pipe->buf_len, 0, AEAD_BLK - *pipe->buf_len);
+  pipe->mac(pipe->ctx, pipe->buf, AEAD_BLK);
+  *pipe->buf_len = 0;
+}
+
+typedef struct {
+  const VC6_AEAD_PIPE *pipe;
+  const unsigned char *in;
+  size_t len;
+} AEAD_MAC_JOB;
+
+static void aead_mac_main(void *arg) {
+  AEAD_MAC_JOB *job = (AEAD_MAC_JOB *)arg;
+  job->pipe->mac(job->pipe->ctx, job->in, job->len);
+}
+
+// Chunk k covers [s, e); chunk 0 also carries the 'head' bytes that
+// complete a pending MAC block, so later chunks are block-aligned
+static void aead_chunk(size_t k, size_t head, size_t len, size_t *s,
+                       size_t *e) {
+  *s = k == 0 ? 0 : head + k * AEAD_CHUNK;
+  *e = head + (k + 1) * AEAD_CHUNK;
+  if (*e > len)
+    *e = len;
+}
+
+int vc6_aead_crypt(const VC6_AEAD_PIPE *pipe, const unsigned char *in,
+                   unsigned char *out, size_t len, uint64_t pos, int enc) {
+  if (len == 0)
+    return 1;
+
+  // The MAC covers the ciphertext: the output when encrypting
+  const unsigned char *mdata = enc ? out : in;
+  size_t head = (AEAD_BLK - *pipe->buf_len) % AEAD_BLK;
+  if (head > len)
+    head = len;
+  size_t body_end = head + ((len - head) & ~(size_t)(AEAD_BLK - 1));
+  size_t nchunks =
+      len <= head ? 1 : (len - head + AEAD_CHUNK - 1) / AEAD_CHUNK;
+  int ok = 1;
+
+  // Step i runs GPU chunk g alongside MAC chunk h
+  for (size_t i = 0; i <= nchunks && ok; i++) {
+    int has_g = enc ? i < nchunks : i >= 1;
+    int has_h = enc ? i >= 1 : i < nchunks;
+    size_t g = enc ? i : i - 1;
+    size_t h = enc ? i - 1 : i;
+    void *task = NULL;
+    AEAD_MAC_JOB job = {pipe, NULL, 0};
+    size_t s, e;
+
+    if (has_h) {
+      aead_chunk(h, head, len, &s, &e);
+      if (h == 0)
+        vc6_aead_absorb(pipe, mdata, head);
+      if (s < head)
+        s = head;
+      if (e > body_end)
+        e = body_end;
+      job.in = mdata + s;
+      job.len = e > s ? e - s : 0;
+      if (h == nchunks - 1 && len > body_end) {
+        // Trailing partial block waits in buf (empty: head completed it)
+        memcpy(pipe->buf, mdata + body_end, len - body_end);
+        *pipe->buf_len = len - body_end;
+      }
+      // Inline unless there is GPU work to hide it behind
+      if (has_g && job.len >= AEAD_PIPELINE_MIN)
+        task = vc6_task_run(aead_mac_main, &job);
+      else
+        aead_mac_main(&job);
+    }
+    if (has_g) {
+      aead_chunk(g, head, len, &s, &e);
+      ok = pipe->crypt(pipe->ctx, in + s, out + s, e - s, pos + s);
+    }
+    if (task != NULL)
+      vc6_task_wait(task);
+  }
+  return ok;
+}
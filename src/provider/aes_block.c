@@ -0,0 +1,365 @@
+// AES-256-ECB and AES-256-CBC
+// ECB (both directions) and CBC decryption run on the GPU; CBC encryption
+// is inherently serial and uses OpenSSL's CPU implementation, as do the
+// other modes when there is no GPU or it refuses a job.
+
+// AES_cbc_encrypt / AES_ecb_encrypt are the CPU paths
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/aes.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "vc6_prov.h"
+
+#define AES_BLK 16
+// Largest GPU job: one backend ring (Batcher::run() rejects more)
+#define AES_BLOCK_CHUNK (64 * 1024 * 1024)
+
+typedef struct {
+  unsigned char key[32];
+  unsigned char iv[16]; // CBC: previous ciphertext block
+  int set_key;
+  int enc;
+  int cbc;
+  unsigned int pad; // PKCS#7 padding, on by default like OpenSSL
+  AES_KEY cpu_enc;  // CBC encrypt, ECB encrypt without a GPU
+  AES_KEY cpu_dec;  // Decrypt without a GPU
+  // Partial block; when decrypting with padding the last full block is
+  // also held back here until final()
+  unsigned char buf[AES_BLK];
+  size_t buf_len;
+} VC6_AES_BLOCK_CTX;
+
+static void *vc6_aes_block_newctx(int cbc) {
+  VC6_AES_BLOCK_CTX *ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx != NULL) {
+    ctx->cbc = cbc;
+    ctx->pad = 1;
+  }
+  return ctx;
+}
+
+static void *vc6_aes256ecb_newctx(void *provctx) {
+  (void)provctx;
+  return vc6_aes_block_newctx(0);
+}
+
+static void *vc6_aes256cbc_newctx(void *provctx) {
+  (void)provctx;
+  return vc6_aes_block_newctx(1);
+}
+
+static void vc6_aes_block_freectx(void *vctx) {
+  OPENSSL_clear_free(vctx, sizeof(VC6_AES_BLOCK_CTX));
+}
+
+static int vc6_aes_block_set_ctx_params(void *vctx, const OSSL_PARAM params[]);
+
+static int vc6_aes_block_init(VC6_AES_BLOCK_CTX *ctx, const unsigned char *key,
+                              size_t keylen, const unsigned char *iv,
+                              size_t ivlen, const OSSL_PARAM params[],
+                              int enc) {
+  ctx->enc = enc;
+  ctx->buf_len = 0;
+  if (key != NULL) {
+    if (keylen != 32)
+      return 0;
+    memcpy(ctx->key, key, 32);
+    ctx->set_key = 1;
+  }
+  if (ctx->cbc && iv != NULL) {
+    if (ivlen != AES_BLK)
+      return 0;
+    memcpy(ctx->iv, iv, AES_BLK);
+  }
+  if (key != NULL && (AES_set_encrypt_key(ctx->key, 256, &ctx->cpu_enc) != 0 ||
+                      AES_set_decrypt_key(ctx->key, 256, &ctx->cpu_dec) != 0))
+    return 0;
+  return vc6_aes_block_set_ctx_params(ctx, params);
+}
+
+static int vc6_aes_block_einit(void *vctx, const unsigned char *key,
+                               size_t keylen, const unsigned char *iv,
+                               size_t ivlen, const OSSL_PARAM params[]) {
+  return vc6_aes_block_init(vctx, key, keylen, iv, ivlen, params, 1);
+}
+
+static int vc6_aes_block_dinit(void *vctx, const unsigned char *key,
+                               size_t keylen, const unsigned char *iv,
+                               size_t ivlen, const OSSL_PARAM params[]) {
+  return vc6_aes_block_init(vctx, key, keylen, iv, ivlen, params, 0);
+}
+
+// ECB or CBC decryption of one chunk on the CPU; CBC updates ctx->iv
+static void vc6_aes_block_cpu(VC6_AES_BLOCK_CTX *ctx, const unsigned char *in,
+                              unsigned char *out, size_t len) {
+  if (ctx->cbc) {
+    AES_cbc_encrypt(in, out, len, &ctx->cpu_dec, ctx->iv, AES_DECRYPT);
+    vc6_stats_cpu(VC6_ALG_AES256_CBC_DEC, 1, len);
+    return;
+  }
+  for (size_t i = 0; i < len; i += AES_BLK)
+    AES_ecb_encrypt(in + i, out + i, ctx->enc ? &ctx->cpu_enc : &ctx->cpu_dec,
+                    ctx->enc ? AES_ENCRYPT : AES_DECRYPT);
+  vc6_stats_cpu(ctx->enc ? VC6_ALG_AES256_ECB_ENC : VC6_ALG_AES256_ECB_DEC, 1,
+                len);
+}
+
+// Process 'len' bytes (multiple of 16) of whole blocks
+static int vc6_aes_block_process(VC6_AES_BLOCK_CTX *ctx,
+                                 const unsigned char *in, unsigned char *out,
+                                 size_t len) {
+  if (ctx->cbc && ctx->enc) {
+    // Serial chain: CPU fallback (updates ctx->iv)
+    AES_cbc_encrypt(in, out, len, &ctx->cpu_enc, ctx->iv, AES_ENCRYPT);
+    // Counted in the "AES-256-CBC" slot next to the GPU decrypts
+    vc6_stats_cpu(VC6_ALG_AES256_CBC_DEC, 1, len);
+    return 1;
+  }
+
+  void *backend = vc6_get_backend();
+  int alg = ctx->cbc  ? VC6_ALG_AES256_CBC_DEC
+            : ctx->enc ? VC6_ALG_AES256_ECB_ENC
+                       : VC6_ALG_AES256_ECB_DEC;
+  while (len > 0) {
+    size_t n = len < AES_BLOCK_CHUNK ? len : AES_BLOCK_CHUNK;
+    // CBC: the next chunk chains off this one's last ciphertext block;
+    // save it before an in-place call overwrites it
+    unsigned char next_iv[AES_BLK];
+    if (ctx->cbc)
+      memcpy(next_iv, in + n - AES_BLK, AES_BLK);
+    if (backend != NULL && vc6_submit_job(backend, in, out, n, ctx->key,
+                                          ctx->cbc ? ctx->iv : NULL, alg)) {
+      if (ctx->cbc)
+        memcpy(ctx->iv, next_iv, AES_BLK);
+    } else {
+      vc6_aes_block_cpu(ctx, in, out, n);
+    }
+    in += n;
+    out += n;
+    len -= n;
+  }
+  return 1;
+}
+
+static int vc6_aes_block_update(void *vctx, unsigned char *out, size_t *outl,
+                                size_t outsize, const unsigned char *in,
+                                size_t inl) {
+  VC6_AES_BLOCK_CTX *ctx = (VC6_AES_BLOCK_CTX *)vctx;
+  *outl = 0;
+  if (!ctx->set_key)
+    return 0;
+
+  // Bytes we can emit now: whole blocks, minus the last one when
+  // decrypting with padding (final() needs it to strip the pad)
+  size_t total = ctx->buf_len + inl;
+  size_t avail = total & ~(size_t)(AES_BLK - 1);
+  if (!ctx->enc && ctx->pad && avail == total && avail > 0)
+    avail -= AES_BLK;
+
+  if (avail == 0) {
+    memcpy(ctx->buf + ctx->buf_len, in, inl);
+    ctx->buf_len += inl;
+    return 1;
+  }
+  if (outsize < avail)
+    return 0;
+
+  size_t done = 0;
+  if (ctx->buf_len > 0) {
+    // Complete and flush the buffered block first
+    size_t fill = AES_BLK - ctx->buf_len;
+    memcpy(ctx->buf + ctx->buf_len, in, fill);
+    in += fill;
+    inl -= fill;
+    if (!vc6_aes_block_process(ctx, ctx->buf, out, AES_BLK))
+      return 0;
+    ctx->buf_len = 0;
+    done = AES_BLK;
+  }
+
+  size_t direct = avail - done;
+  if (!vc6_aes_block_process(ctx, in, out + done, direct))
+    return 0;
+  in += direct;
+  inl -= direct;
+
+  memcpy(ctx->buf, in, inl);
+  ctx->buf_len = inl;
+  *outl = avail;
+  return 1;
+}
+
+static int vc6_aes_block_final(void *vctx, unsigned char *out, size_t *outl,
+                               size_t outsize) {
+  VC6_AES_BLOCK_CTX *ctx = (VC6_AES_BLOCK_CTX *)vctx;
+  *outl = 0;
+
+  if (!ctx->pad)
+    return ctx->buf_len == 0;
+
+  if (ctx->enc) {
+    // PKCS#7: always emit one more block
+    unsigned char n = (unsigned char)(AES_BLK - ctx->buf_len);
+    memset(ctx->buf + ctx->buf_len, n, n);
+    if (outsize < AES_BLK || !vc6_aes_block_process(ctx, ctx->buf, out,
+                                                    AES_BLK))
+      return 0;
+    ctx->buf_len = 0;
+    *outl = AES_BLK;
+    return 1;
+  }
+
+  if (ctx->buf_len != AES_BLK)
+    return 0;
+  unsigned char block[AES_BLK];
+  if (!vc6_aes_block_process(ctx, ctx->buf, block, AES_BLK))
+    return 0;
+  ctx->buf_len = 0;
+
+  unsigned char n = block[AES_BLK - 1];
+  if (n == 0 || n > AES_BLK)
+    return 0;
+  for (size_t i = AES_BLK - n; i < AES_BLK; i++) {
+    if (block[i] != n)
+      return 0;
+  }
+  if (outsize < (size_t)(AES_BLK - n))
+    return 0;
+  memcpy(out, block, AES_BLK - n);
+  *outl = AES_BLK - n;
+  OPENSSL_cleanse(block, sizeof(block));
+  return 1;
+}
+
+static int vc6_aes_block_get_params(OSSL_PARAM params[], unsigned int mode,
+                                    size_t ivlen) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_MODE);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, mode))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, AES_BLK))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ivlen))
+    return 0;
+  return 1;
+}
+
+static int vc6_aes256ecb_get_params(OSSL_PARAM params[]) {
+  return vc6_aes_block_get_params(params, EVP_CIPH_ECB_MODE, 0);
+}
+
+static int vc6_aes256cbc_get_params(OSSL_PARAM params[]) {
+  return vc6_aes_block_get_params(params, EVP_CIPH_CBC_MODE, AES_BLK);
+}
+
+static int vc6_aes_block_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_AES_BLOCK_CTX *ctx = (VC6_AES_BLOCK_CTX *)vctx;
+  OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->cbc ? AES_BLK : 0))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_PADDING);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, ctx->pad))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_UPDATED_IV);
+  if (p != NULL && ctx->cbc &&
+      !OSSL_PARAM_set_octet_string(p, ctx->iv, AES_BLK))
+    return 0;
+  return 1;
+}
+
+static int vc6_aes_block_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
+  VC6_AES_BLOCK_CTX *ctx = (VC6_AES_BLOCK_CTX *)vctx;
+  const OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_PADDING);
+  if (p != NULL && !OSSL_PARAM_get_uint(p, &ctx->pad))
+    return 0;
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL) {
+    size_t keylen;
+    if (!OSSL_PARAM_get_size_t(p, &keylen) || keylen != 32)
+      return 0;
+  }
+  return 1;
+}
+
+static const OSSL_PARAM vc6_aes_block_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_PADDING, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_UPDATED_IV, NULL, 0),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_aes_block_gettable_ctx_params(void *cctx,
+                                                           void *provctx) {
+  return vc6_aes_block_known_gettable_params;
+}
+
+static const OSSL_PARAM vc6_aes_block_known_settable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_PADDING, NULL), OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_aes_block_settable_ctx_params(void *cctx,
+                                                           void *provctx) {
+  return vc6_aes_block_known_settable_params;
+}
+
+static int vc6_aes_block_traced(void *vctx, unsigned char *out, size_t *outl,
+                                size_t outsize, const unsigned char *in,
+                                size_t inl) {
+  return vc6_trace_update("AES-256 block update", vc6_aes_block_update, vctx,
+                          out, outl, outsize, in, inl);
+}
+
+const OSSL_DISPATCH vc6_aes256ecb_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_aes256ecb_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_aes_block_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_aes_block_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_aes_block_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_block_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_aes_block_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_aes256ecb_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_settable_ctx_params},
+    {0, NULL}};
+
+const OSSL_DISPATCH vc6_aes256cbc_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_aes256cbc_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_aes_block_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_aes_block_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_aes_block_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_block_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_aes_block_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_aes256cbc_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_aes_block_settable_ctx_params},
+    {0, NULL}};
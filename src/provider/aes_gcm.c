@@ -0,0 +1,669 @@
+// AES-256-GCM
+// The CTR keystream runs on the GPU (the AES-256-CTR pipeline, started at
+// J0 + 1) while GHASH runs on the CPU task pool, overlapped chunk by
+// chunk through the AEAD pipeline in aead.c.
+// Large updates instead go through the fused kernel (aes256_gcm.comp),
+// which encrypts and computes per-workgroup GHASH partials in one pass over
+// the data; the CPU only folds the partials.
+// H, E_K(J0) and the TLS 1.2 record path are done on the CPU.
+
+// AES_encrypt for H and E_K(J0)
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/aes.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "../cpu/ghash.h"
+#include "vc6_prov.h"
+
+#define GCM_BLK 16
+#define GCM_IV_MAX 64
+#define GCM_IV_DEFAULT 12
+#define GCM_TLS_FIXED_IV_LEN 4
+#define GCM_TLS_EXPLICIT_IV_LEN 8
+#define GCM_TLS_AAD_LEN 13
+
+#define GCM_GHASH_SEGMENTS 3 // Leaves one core for the GPU submit
+#define GCM_FUSED_MIN (64 * 1024)         // Smaller updates: the pipeline
+#define GCM_FUSED_CHUNK (4 * 1024 * 1024) // Per fused dispatch
+#define GCM_GROUP_BYTES (VC6_GCM_GROUP_BLOCKS * GCM_BLK)
+#define GCM_MAX_DATA ((((uint64_t)1 << 32) - 2) * GCM_BLK)
+
+// IV lifecycle, as in OpenSSL: an IV is used for exactly one message
+#define GCM_IV_UNSET 0
+#define GCM_IV_BUFFERED 1 // Set, message not started
+#define GCM_IV_STARTED 2
+#define GCM_IV_FINISHED 3 // final() done, a new IV is required
+
+typedef struct {
+  unsigned char key[32];
+  AES_KEY ks;
+  VC6_GHASH_KEY gkey;
+  unsigned char iv[GCM_IV_MAX];
+  size_t ivlen;
+  int iv_state;
+  int iv_gen; // TLS fixed IV set, invocation field managed here
+  int set_key;
+  int enc;
+
+  // Fused CTR + GHASH kernel (VC6_CIPHER_PARAM_GCM_FUSED)
+  int fused;
+  int hpow_set; // hpow/kgroup built on first use
+  unsigned char hpow[VC6_GCM_GROUP_BLOCKS * GCM_BLK]; // H^1 .. H^256
+  VC6_GHASH_KEY kgroup;                               // Table for H^256
+
+  // Per-message state
+  unsigned char ctr[GCM_BLK];  // Counter block of the first data byte
+  unsigned char ekj0[GCM_BLK]; // E_K(J0), masks the tag
+  unsigned char Y[GCM_BLK];    // GHASH accumulator
+  unsigned char buf[GCM_BLK];  // GHASH input short of a block
+  size_t buf_len;
+  uint64_t aad_len;
+  uint64_t data_len;
+  int in_data; // AAD closed (padded) once data starts
+
+  unsigned char tag[GCM_BLK];
+  size_t taglen;
+  int tag_set; // Expected tag given since init (decrypt)
+
+  // TLS 1.2 record mode (OSSL_CIPHER_PARAM_AEAD_TLS1_AAD), 0 = off
+  unsigned char tls_aad[GCM_TLS_AAD_LEN];
+  size_t tls_aad_len;
+  size_t tls_aad_pad;
+} VC6_GCM_CTX;
+
+static void *vc6_gcm_newctx(void *provctx) {
+  (void)provctx;
+  if (!vc6_get_backend())
+    return NULL;
+  VC6_GCM_CTX *ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx != NULL) {
+    ctx->ivlen = GCM_IV_DEFAULT;
+    ctx->taglen = GCM_BLK;
+    ctx->fused = 1;
+  }
+  return ctx;
+}
+
+static void vc6_gcm_freectx(void *vctx) {
+  OPENSSL_clear_free(vctx, sizeof(VC6_GCM_CTX));
+}
+
+static void gcm_mac(void *vctx, const unsigned char *in, size_t len) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  vc6_ghash_parallel(&ctx->gkey, ctx->Y, in, len, GCM_GHASH_SEGMENTS,
+                     vc6_parallel_for);
+}
+
+static int gcm_ctr(void *vctx, const unsigned char *in, unsigned char *out,
+                   size_t len, uint64_t pos);
+
+static void gcm_pipe(VC6_GCM_CTX *ctx, VC6_AEAD_PIPE *pipe) {
+  pipe->ctx = ctx;
+  pipe->crypt = gcm_ctr;
+  pipe->mac = gcm_mac;
+  pipe->buf = ctx->buf;
+  pipe->buf_len = &ctx->buf_len;
+}
+
+// Starts a message under ctx->iv: J0, the data counter and E_K(J0)
+static void gcm_start(VC6_GCM_CTX *ctx) {
+  unsigned char j0[GCM_BLK];
+  VC6_AEAD_PIPE pipe;
+
+  if (ctx->ivlen == GCM_IV_DEFAULT) {
+    memcpy(j0, ctx->iv, GCM_IV_DEFAULT);
+    memset(j0 + GCM_IV_DEFAULT, 0, 3);
+    j0[15] = 1;
+  } else {
+    // J0 = GHASH(IV || 0-pad || 0^64 || [len(IV)]_64)
+    unsigned char lenblk[GCM_BLK] = {0};
+    uint64_t bits = (uint64_t)ctx->ivlen * 8;
+    for (int i = 0; i < 8; i++)
+      lenblk[15 - i] = (unsigned char)(bits >> (8 * i));
+    memset(ctx->Y, 0, GCM_BLK);
+    ctx->buf_len = 0;
+    gcm_pipe(ctx, &pipe);
+    vc6_aead_absorb(&pipe, ctx->iv, ctx->ivlen);
+    vc6_aead_pad(&pipe);
+    vc6_ghash(&ctx->gkey, ctx->Y, lenblk, GCM_BLK);
+    memcpy(j0, ctx->Y, GCM_BLK);
+  }
+
+  AES_encrypt(j0, ctx->ekj0, &ctx->ks);
+  memcpy(ctx->ctr, j0, GCM_BLK);
+  // inc32
+  for (int i = 15; i >= 12; i--)
+    if (++ctx->ctr[i] != 0)
+      break;
+
+  memset(ctx->Y, 0, GCM_BLK);
+  ctx->buf_len = 0;
+  ctx->aad_len = 0;
+  ctx->data_len = 0;
+  ctx->in_data = 0;
+  ctx->iv_state = GCM_IV_STARTED;
+  OPENSSL_cleanse(j0, sizeof(j0));
+}
+
+// Message bytes [pos, pos + len) through the GPU CTR pipeline. GCM's
+// counter is inc32 but the shader carries into the next word, so a range
+// crossing the 32-bit wrap is split in two.
+static int gcm_ctr(void *vctx, const unsigned char *in, unsigned char *out,
+                   size_t len, uint64_t pos) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  uint32_t c = ((uint32_t)ctx->ctr[12] << 24) | ((uint32_t)ctx->ctr[13] << 16) |
+               ((uint32_t)ctx->ctr[14] << 8) | ctx->ctr[15];
+  uint64_t wrap = ((((uint64_t)1) << 32) - c) * GCM_BLK;
+
+  if (pos < wrap) {
+    size_t n = len;
+    if (pos + n > wrap)
+      n = (size_t)(wrap - pos);
+    if (!vc6_submit_job_at(vc6_get_backend(), in, out, n, ctx->key, ctx->ctr,
+                           pos, VC6_ALG_AES256_CTR))
+      return 0;
+    in += n;
+    out += n;
+    len -= n;
+    pos += n;
+  }
+  if (len > 0) {
+    unsigned char c0[GCM_BLK];
+    memcpy(c0, ctx->ctr, 12);
+    memset(c0 + 12, 0, 4);
+    return vc6_submit_job_at(vc6_get_backend(), in, out, len, ctx->key, c0,
+                             pos - wrap, VC6_ALG_AES256_CTR);
+  }
+  return 1;
+}
+
+// Whole blocks at message offset 'pos' through the fused kernel; GHASH
+// state must be block-aligned. Returns the bytes processed, short of 'len'
+// if the kernel fails (the fused path is then turned off for this ctx).
+static size_t gcm_fused(VC6_GCM_CTX *ctx, const unsigned char *in,
+                        unsigned char *out, size_t len, uint64_t pos) {
+  unsigned char partials[GCM_FUSED_CHUNK / GCM_GROUP_BYTES * GCM_BLK];
+  unsigned char c0[GCM_BLK];
+  size_t done = 0;
+
+  if (!ctx->hpow_set) {
+    vc6_ghash_powers(&ctx->gkey, ctx->hpow, VC6_GCM_GROUP_BLOCKS);
+    vc6_ghash_init(&ctx->kgroup,
+                   ctx->hpow + (VC6_GCM_GROUP_BLOCKS - 1) * GCM_BLK);
+    ctx->hpow_set = 1;
+  }
+
+  memcpy(c0, ctx->ctr, GCM_BLK);
+  while (done < len) {
+    size_t n = len - done;
+    if (n > GCM_FUSED_CHUNK)
+      n = GCM_FUSED_CHUNK;
+    // inc32 by the blocks before this dispatch
+    uint32_t c = ((uint32_t)ctx->ctr[12] << 24) |
+                 ((uint32_t)ctx->ctr[13] << 16) |
+                 ((uint32_t)ctx->ctr[14] << 8) | ctx->ctr[15];
+    c += (uint32_t)((pos + done) / GCM_BLK);
+    for (int i = 0; i < 4; i++)
+      c0[15 - i] = (unsigned char)(c >> (8 * i));
+
+    if (!vc6_submit_gcm(vc6_get_backend(), in + done, out + done, n,
+                        ctx->key, c0, ctx->hpow, partials, !ctx->enc)) {
+      ctx->fused = 0;
+      break;
+    }
+    size_t blocks = n / GCM_BLK;
+    size_t groups = (blocks + VC6_GCM_GROUP_BLOCKS - 1) / VC6_GCM_GROUP_BLOCKS;
+    vc6_ghash_fold(&ctx->gkey, &ctx->kgroup, ctx->Y, partials, groups,
+                   VC6_GCM_GROUP_BLOCKS,
+                   blocks - (groups - 1) * VC6_GCM_GROUP_BLOCKS);
+    done += n;
+  }
+  return done;
+}
+
+// Encrypt/decrypt 'len' message bytes, GPU CTR and CPU GHASH pipelined, or
+// fused on the GPU for large updates
+static int gcm_crypt(VC6_GCM_CTX *ctx, const unsigned char *in,
+                     unsigned char *out, size_t len) {
+  VC6_AEAD_PIPE pipe;
+  uint64_t pos = ctx->data_len;
+  if (len > GCM_MAX_DATA - ctx->data_len)
+    return 0;
+  gcm_pipe(ctx, &pipe);
+  if (!ctx->in_data) {
+    vc6_aead_pad(&pipe); // End of AAD
+    ctx->in_data = 1;
+  }
+  if (ctx->fused && len >= GCM_FUSED_MIN) {
+    // Complete a pending GHASH block first so the fused part is aligned
+    size_t head = (GCM_BLK - ctx->buf_len) % GCM_BLK;
+    if (!vc6_aead_crypt(&pipe, in, out, head, pos, ctx->enc))
+      return 0;
+    size_t done = head + gcm_fused(ctx, in + head, out + head,
+                                   (len - head) & ~(size_t)(GCM_BLK - 1),
+                                   pos + head);
+    in += done;
+    out += done;
+    pos += done;
+    len -= done;
+  }
+  if (!vc6_aead_crypt(&pipe, in, out, len, pos, ctx->enc))
+    return 0;
+  ctx->data_len = pos + len;
+  return 1;
+}
+
+static int gcm_aad(VC6_GCM_CTX *ctx, const unsigned char *aad, size_t len) {
+  VC6_AEAD_PIPE pipe;
+  if (ctx->in_data)
+    return 0; // AAD must precede the data
+  gcm_pipe(ctx, &pipe);
+  vc6_aead_absorb(&pipe, aad, len);
+  ctx->aad_len += len;
+  return 1;
+}
+
+// Tag = E_K(J0) ^ GHASH(A || C || [len(A)]_64 || [len(C)]_64)
+static void gcm_tag(VC6_GCM_CTX *ctx, unsigned char tag[GCM_BLK]) {
+  unsigned char lenblk[GCM_BLK];
+  uint64_t abits = ctx->aad_len * 8, cbits = ctx->data_len * 8;
+  VC6_AEAD_PIPE pipe;
+
+  gcm_pipe(ctx, &pipe);
+  vc6_aead_pad(&pipe);
+  for (int i = 0; i < 8; i++) {
+    lenblk[7 - i] = (unsigned char)(abits >> (8 * i));
+    lenblk[15 - i] = (unsigned char)(cbits >> (8 * i));
+  }
+  vc6_ghash(&ctx->gkey, ctx->Y, lenblk, GCM_BLK);
+  for (int i = 0; i < GCM_BLK; i++)
+    tag[i] = ctx->Y[i] ^ ctx->ekj0[i];
+}
+
+static int vc6_gcm_set_ctx_params(void *vctx, const OSSL_PARAM params[]);
+
+static int vc6_gcm_init(VC6_GCM_CTX *ctx, const unsigned char *key,
+                        size_t keylen, const unsigned char *iv, size_t ivlen,
+                        const OSSL_PARAM params[], int enc) {
+  ctx->enc = enc;
+  ctx->tls_aad_len = 0;
+  ctx->tag_set = 0;
+  if (iv != NULL) {
+    if (ivlen == 0 || ivlen > GCM_IV_MAX)
+      return 0;
+    ctx->ivlen = ivlen;
+    memcpy(ctx->iv, iv, ivlen);
+    ctx->iv_state = GCM_IV_BUFFERED;
+  }
+  if (key != NULL) {
+    unsigned char H[GCM_BLK] = {0};
+    if (keylen != 32)
+      return 0;
+    memcpy(ctx->key, key, 32);
+    AES_set_encrypt_key(key, 256, &ctx->ks);
+    AES_encrypt(H, H, &ctx->ks);
+    vc6_ghash_init(&ctx->gkey, H);
+    ctx->hpow_set = 0;
+    OPENSSL_cleanse(H, sizeof(H));
+    ctx->set_key = 1;
+    // A message in progress restarts under the new key. A finished one
+    // keeps its IV spent: re-arming it would reuse the nonce
+    if (ctx->iv_state == GCM_IV_STARTED)
+      ctx->iv_state = GCM_IV_BUFFERED;
+  }
+  return vc6_gcm_set_ctx_params(ctx, params);
+}
+
+static int vc6_gcm_einit(void *vctx, const unsigned char *key, size_t keylen,
+                         const unsigned char *iv, size_t ivlen,
+                         const OSSL_PARAM params[]) {
+  return vc6_gcm_init(vctx, key, keylen, iv, ivlen, params, 1);
+}
+
+static int vc6_gcm_dinit(void *vctx, const unsigned char *key, size_t keylen,
+                         const unsigned char *iv, size_t ivlen,
+                         const OSSL_PARAM params[]) {
+  return vc6_gcm_init(vctx, key, keylen, iv, ivlen, params, 0);
+}
+
+// Starts the message on first use of a freshly set IV
+static int gcm_ready(VC6_GCM_CTX *ctx) {
+  if (!ctx->set_key)
+    return 0;
+  if (ctx->iv_state == GCM_IV_BUFFERED)
+    gcm_start(ctx);
+  return ctx->iv_state == GCM_IV_STARTED;
+}
+
+static int gcm_tls_cipher(VC6_GCM_CTX *ctx, unsigned char *out,
+                          size_t *outl, const unsigned char *in, size_t len);
+
+// EVP_CipherUpdate() entry; libssl sends TLS 1.2 records through here too
+static int vc6_gcm_update(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  *outl = 0;
+  if (ctx->tls_aad_len != 0)
+    return outsize >= inl && gcm_tls_cipher(ctx, out, outl, in, inl);
+  if (!gcm_ready(ctx))
+    return 0;
+  if (inl == 0)
+    return 1;
+
+  if (out == NULL) {
+    if (!gcm_aad(ctx, in, inl))
+      return 0;
+  } else {
+    if (outsize < inl || !gcm_crypt(ctx, in, out, inl))
+      return 0;
+  }
+  *outl = inl;
+  return 1;
+}
+
+static int vc6_gcm_final(void *vctx, unsigned char *out, size_t *outl,
+                         size_t outsize) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  unsigned char tag[GCM_BLK];
+  int ok = 1;
+
+  *outl = 0;
+  if (ctx->tls_aad_len != 0 || !gcm_ready(ctx))
+    return 0;
+  gcm_tag(ctx, tag);
+  if (ctx->enc) {
+    memcpy(ctx->tag, tag, GCM_BLK);
+  } else {
+    // No expected tag, no verification: never accept
+    ok = ctx->tag_set && ctx->taglen <= GCM_BLK &&
+         CRYPTO_memcmp(tag, ctx->tag, ctx->taglen) == 0;
+  }
+  ctx->iv_state = GCM_IV_FINISHED;
+  OPENSSL_cleanse(tag, sizeof(tag));
+  return ok;
+}
+
+// One TLS 1.2 record, in place: explicit IV (8) || payload || tag (16).
+// *outl is the whole record when encrypting and the payload when
+// decrypting, as libssl expects
+static int gcm_tls_cipher(VC6_GCM_CTX *ctx, unsigned char *out,
+                          size_t *outl, const unsigned char *in, size_t len) {
+  size_t fixed = ctx->ivlen - GCM_TLS_EXPLICIT_IV_LEN;
+  unsigned char tag[GCM_BLK];
+  int ok = 0;
+
+  *outl = 0;
+  if (out != in || len < GCM_TLS_EXPLICIT_IV_LEN + GCM_BLK ||
+      !ctx->set_key || !ctx->iv_gen)
+    goto err;
+
+  if (ctx->enc) {
+    // Send the invocation field, then advance it for the next record
+    memcpy(out, ctx->iv + fixed, GCM_TLS_EXPLICIT_IV_LEN);
+    gcm_start(ctx);
+    for (int i = (int)ctx->ivlen - 1; i >= (int)fixed; i--)
+      if (++ctx->iv[i] != 0)
+        break;
+  } else {
+    memcpy(ctx->iv + fixed, in, GCM_TLS_EXPLICIT_IV_LEN);
+    gcm_start(ctx);
+  }
+
+  in += GCM_TLS_EXPLICIT_IV_LEN;
+  out += GCM_TLS_EXPLICIT_IV_LEN;
+  len -= GCM_TLS_EXPLICIT_IV_LEN + GCM_BLK;
+
+  gcm_aad(ctx, ctx->tls_aad, ctx->tls_aad_len);
+  if (!gcm_crypt(ctx, in, out, len))
+    goto err;
+  gcm_tag(ctx, tag);
+  if (ctx->enc) {
+    memcpy(out + len, tag, GCM_BLK);
+    *outl = GCM_TLS_EXPLICIT_IV_LEN + len + GCM_BLK;
+    ok = 1;
+  } else {
+    ok = CRYPTO_memcmp(tag, in + len, GCM_BLK) == 0;
+    if (ok)
+      *outl = len;
+    else
+      OPENSSL_cleanse(out, len);
+  }
+
+err:
+  ctx->iv_state = GCM_IV_FINISHED;
+  ctx->tls_aad_len = 0;
+  OPENSSL_cleanse(tag, sizeof(tag));
+  return ok;
+}
+
+// EVP_Cipher() entry: TLS records when a TLS AAD is set, otherwise
+// AAD (out == NULL), data, or final (in == NULL)
+static int vc6_gcm_cipher(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  size_t dummy;
+
+  *outl = 0;
+  if (outsize < inl)
+    return 0;
+  if (ctx->tls_aad_len != 0) {
+    if (!gcm_tls_cipher(ctx, out, &dummy, in, inl))
+      return 0;
+  } else if (in != NULL) {
+    if (!vc6_gcm_update(vctx, out, outl, outsize, in, inl))
+      return 0;
+  } else if (!vc6_gcm_final(vctx, out, &dummy, outsize)) {
+    return 0;
+  }
+  *outl = inl;
+  return 1;
+}
+
+// OSSL_CIPHER_PARAM_AEAD_TLS1_AAD: the record length in the AAD excludes
+// the explicit IV (and tag when decrypting)
+static int gcm_tls_init(VC6_GCM_CTX *ctx, const unsigned char *aad,
+                        size_t len) {
+  if (len != GCM_TLS_AAD_LEN)
+    return 0;
+  memcpy(ctx->tls_aad, aad, len);
+  size_t rec = ((size_t)aad[len - 2] << 8) | aad[len - 1];
+  if (rec < GCM_TLS_EXPLICIT_IV_LEN)
+    return 0;
+  rec -= GCM_TLS_EXPLICIT_IV_LEN;
+  if (!ctx->enc) {
+    if (rec < GCM_BLK)
+      return 0;
+    rec -= GCM_BLK;
+  }
+  ctx->tls_aad[len - 2] = (unsigned char)(rec >> 8);
+  ctx->tls_aad[len - 1] = (unsigned char)rec;
+  ctx->tls_aad_len = len;
+  ctx->tls_aad_pad = GCM_BLK; // The record carries the tag
+  return 1;
+}
+
+// OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED: fixed field (the encrypting side
+// draws a random invocation field), or (size_t)-1 for the whole IV
+static int gcm_tls_iv_fixed(VC6_GCM_CTX *ctx, const unsigned char *iv,
+                            size_t len) {
+  if (len == (size_t)-1) {
+    memcpy(ctx->iv, iv, ctx->ivlen);
+  } else {
+    if (len < GCM_TLS_FIXED_IV_LEN ||
+        ctx->ivlen < len + GCM_TLS_EXPLICIT_IV_LEN)
+      return 0;
+    memcpy(ctx->iv, iv, len);
+    if (ctx->enc && RAND_bytes(ctx->iv + len, (int)(ctx->ivlen - len)) <= 0)
+      return 0;
+  }
+  ctx->iv_gen = 1;
+  ctx->iv_state = GCM_IV_BUFFERED;
+  return 1;
+}
+
+static int vc6_gcm_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_MODE);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, EVP_CIPH_GCM_MODE))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_CUSTOM_IV);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, GCM_IV_DEFAULT))
+    return 0;
+  return 1;
+}
+
+static int vc6_gcm_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->ivlen))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAGLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->taglen))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+  if (p != NULL) {
+    // Only after an encrypting final()
+    if (!ctx->enc || ctx->iv_state != GCM_IV_FINISHED ||
+        p->data_type != OSSL_PARAM_OCTET_STRING || p->data_size == 0 ||
+        p->data_size > GCM_BLK ||
+        !OSSL_PARAM_set_octet_string(p, ctx->tag, p->data_size))
+      return 0;
+  }
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TLS1_AAD_PAD);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->tls_aad_pad))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_CIPHER_PARAM_GCM_FUSED);
+  if (p != NULL && !OSSL_PARAM_set_int(p, ctx->fused))
+    return 0;
+  return 1;
+}
+
+static int vc6_gcm_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
+  VC6_GCM_CTX *ctx = (VC6_GCM_CTX *)vctx;
+  const OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+  if (p != NULL) {
+    // Expected tag, decrypt only
+    if (ctx->enc || p->data_type != OSSL_PARAM_OCTET_STRING ||
+        p->data_size == 0 || p->data_size > GCM_BLK)
+      return 0;
+    if (p->data != NULL) {
+      memcpy(ctx->tag, p->data, p->data_size);
+      ctx->tag_set = 1;
+    }
+    ctx->taglen = p->data_size;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_IVLEN);
+  if (p != NULL) {
+    size_t ivlen;
+    if (!OSSL_PARAM_get_size_t(p, &ivlen) || ivlen == 0 ||
+        ivlen > GCM_IV_MAX)
+      return 0;
+    if (ivlen != ctx->ivlen) {
+      ctx->ivlen = ivlen;
+      ctx->iv_state = GCM_IV_UNSET;
+    }
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TLS1_AAD);
+  if (p != NULL) {
+    if (p->data_type != OSSL_PARAM_OCTET_STRING ||
+        !gcm_tls_init(ctx, p->data, p->data_size))
+      return 0;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED);
+  if (p != NULL) {
+    if (p->data == NULL || p->data_type != OSSL_PARAM_OCTET_STRING ||
+        !gcm_tls_iv_fixed(ctx, p->data, p->data_size))
+      return 0;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL) {
+    size_t keylen;
+    if (!OSSL_PARAM_get_size_t(p, &keylen) || keylen != 32)
+      return 0;
+  }
+  p = OSSL_PARAM_locate_const(params, VC6_CIPHER_PARAM_GCM_FUSED);
+  if (p != NULL && !OSSL_PARAM_get_int(p, &ctx->fused))
+    return 0;
+  return 1;
+}
+
+static const OSSL_PARAM vc6_gcm_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_TAGLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_TLS1_AAD_PAD, NULL),
+    OSSL_PARAM_int(VC6_CIPHER_PARAM_GCM_FUSED, NULL),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_gcm_gettable_ctx_params(void *cctx,
+                                                     void *provctx) {
+  return vc6_gcm_known_gettable_params;
+}
+
+static const OSSL_PARAM vc6_gcm_known_settable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_IVLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_AAD, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED, NULL, 0),
+    OSSL_PARAM_int(VC6_CIPHER_PARAM_GCM_FUSED, NULL),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_gcm_settable_ctx_params(void *cctx,
+                                                     void *provctx) {
+  return vc6_gcm_known_settable_params;
+}
+
+static int vc6_gcm_traced(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  return vc6_trace_update("AES-256-GCM update", vc6_gcm_update, vctx,
+                          out, outl, outsize, in, inl);
+}
+
+const OSSL_DISPATCH vc6_aes256gcm_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_gcm_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_gcm_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_gcm_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_gcm_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_gcm_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_gcm_final},
+    {OSSL_FUNC_CIPHER_CIPHER, (void (*)(void))vc6_gcm_cipher},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_gcm_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_gcm_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS, (void (*)(void))vc6_gcm_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_gcm_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_gcm_settable_ctx_params},
+    {0, NULL}};
@@ -0,0 +1,290 @@
+// AES-256-XTS
+// Every update() is one data unit encrypted under the ctx IV (OpenSSL
+// semantics); whole blocks run on the GPU and ciphertext stealing for a
+// trailing partial block is done on the CPU.
+// With VC6_CIPHER_PARAM_XTS_SECTOR_SIZE set, one update() instead covers
+// many consecutive sectors: sector i uses IV + i and the IV advances past
+// them, so an image can be streamed through one context.
+
+// AES_encrypt/AES_decrypt for the ciphertext-stealing tail
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/aes.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "vc6_prov.h"
+
+#define XTS_BLK 16
+
+typedef struct {
+  unsigned char key[64]; // K1 || K2
+  unsigned char iv[16];  // Tweak of the next data unit
+  int set_key;
+  int enc;
+  size_t sector_size; // 0 = one data unit per update()
+  AES_KEY k1;         // CPU tail: K1 in the current direction
+  AES_KEY k2;         // CPU tail: K2 (always encrypt)
+} VC6_XTS_CTX;
+
+static void *vc6_xts_newctx(void *provctx) {
+  (void)provctx;
+  if (!vc6_get_backend())
+    return NULL;
+  return OPENSSL_zalloc(sizeof(VC6_XTS_CTX));
+}
+
+static void vc6_xts_freectx(void *vctx) {
+  OPENSSL_clear_free(vctx, sizeof(VC6_XTS_CTX));
+}
+
+static int vc6_xts_set_ctx_params(void *vctx, const OSSL_PARAM params[]);
+
+static int vc6_xts_init(VC6_XTS_CTX *ctx, const unsigned char *key,
+                        size_t keylen, const unsigned char *iv, size_t ivlen,
+                        const OSSL_PARAM params[], int enc) {
+  ctx->enc = enc;
+  if (key != NULL) {
+    if (keylen != 64)
+      return 0;
+    // IEEE 1619: K1 == K2 defeats the tweak
+    if (enc && CRYPTO_memcmp(key, key + 32, 32) == 0)
+      return 0;
+    memcpy(ctx->key, key, 64);
+    ctx->set_key = 1;
+  }
+  if (iv != NULL) {
+    if (ivlen != XTS_BLK)
+      return 0;
+    memcpy(ctx->iv, iv, XTS_BLK);
+  }
+  if (ctx->set_key) {
+    if (enc)
+      AES_set_encrypt_key(ctx->key, 256, &ctx->k1);
+    else
+      AES_set_decrypt_key(ctx->key, 256, &ctx->k1);
+    AES_set_encrypt_key(ctx->key + 32, 256, &ctx->k2);
+  }
+  return vc6_xts_set_ctx_params(ctx, params);
+}
+
+static int vc6_xts_einit(void *vctx, const unsigned char *key, size_t keylen,
+                         const unsigned char *iv, size_t ivlen,
+                         const OSSL_PARAM params[]) {
+  return vc6_xts_init(vctx, key, keylen, iv, ivlen, params, 1);
+}
+
+static int vc6_xts_dinit(void *vctx, const unsigned char *key, size_t keylen,
+                         const unsigned char *iv, size_t ivlen,
+                         const OSSL_PARAM params[]) {
+  return vc6_xts_init(vctx, key, keylen, iv, ivlen, params, 0);
+}
+
+// Multiply the tweak by alpha in GF(2^128) (little-endian convention)
+static void xts_double(unsigned char *t) {
+  unsigned char carry = 0;
+  for (int i = 0; i < XTS_BLK; i++) {
+    unsigned char next = t[i] >> 7;
+    t[i] = (unsigned char)((t[i] << 1) | carry);
+    carry = next;
+  }
+  if (carry)
+    t[0] ^= 0x87;
+}
+
+// One block on the CPU: out = E/D_K1(in ^ t) ^ t
+static void xts_block(VC6_XTS_CTX *ctx, const unsigned char *in,
+                      unsigned char *out, const unsigned char *t) {
+  unsigned char x[XTS_BLK];
+  for (int i = 0; i < XTS_BLK; i++)
+    x[i] = in[i] ^ t[i];
+  if (ctx->enc)
+    AES_encrypt(x, x, &ctx->k1);
+  else
+    AES_decrypt(x, x, &ctx->k1);
+  for (int i = 0; i < XTS_BLK; i++)
+    out[i] = x[i] ^ t[i];
+}
+
+// One data unit of 'len' >= 16 bytes under tweak ctx->iv
+static int vc6_xts_unit(VC6_XTS_CTX *ctx, const unsigned char *in,
+                        unsigned char *out, size_t len) {
+  size_t full = len & ~(size_t)(XTS_BLK - 1);
+  size_t r = len - full;
+
+  if (r == 0)
+    return vc6_submit_xts(vc6_get_backend(), in, out, len, ctx->key, ctx->iv,
+                          len, !ctx->enc);
+
+  // Ciphertext stealing: blocks 0..m-2 on the GPU, the last full block
+  // and the partial one on the CPU
+  size_t m = full / XTS_BLK;
+  size_t gpu_len = full - XTS_BLK;
+  if (gpu_len > 0 &&
+      !vc6_submit_xts(vc6_get_backend(), in, out, gpu_len, ctx->key, ctx->iv,
+                      full, !ctx->enc))
+    return 0;
+
+  unsigned char t_prev[XTS_BLK], t_last[XTS_BLK];
+  AES_encrypt(ctx->iv, t_prev, &ctx->k2);
+  for (size_t i = 0; i < m - 1; i++)
+    xts_double(t_prev);
+  memcpy(t_last, t_prev, XTS_BLK);
+  xts_double(t_last);
+
+  // Copy the tail first: 'out' may alias 'in'
+  unsigned char blk[XTS_BLK], tail[XTS_BLK], cc[XTS_BLK];
+  memcpy(blk, in + gpu_len, XTS_BLK);
+  memcpy(tail, in + full, r);
+
+  // Encrypt uses T_{m-1} then T_m; decrypt swaps them
+  xts_block(ctx, blk, cc, ctx->enc ? t_prev : t_last);
+  memcpy(out + full, cc, r);
+  memcpy(cc, tail, r);
+  xts_block(ctx, cc, out + gpu_len, ctx->enc ? t_last : t_prev);
+
+  OPENSSL_cleanse(cc, sizeof(cc));
+  OPENSSL_cleanse(blk, sizeof(blk));
+  return 1;
+}
+
+// iv += n (128-bit little-endian)
+static void xts_advance(unsigned char *iv, uint64_t n) {
+  for (int i = 0; i < XTS_BLK && n != 0; i++) {
+    uint64_t sum = iv[i] + (n & 0xFF);
+    iv[i] = sum & 0xFF;
+    n = (n >> 8) + (sum >> 8);
+  }
+}
+
+static int vc6_xts_update(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  VC6_XTS_CTX *ctx = (VC6_XTS_CTX *)vctx;
+  *outl = 0;
+  if (!ctx->set_key || inl < XTS_BLK || outsize < inl)
+    return 0;
+
+  if (ctx->sector_size == 0) {
+    if (!vc6_xts_unit(ctx, in, out, inl))
+      return 0;
+  } else {
+    // Sector mode: whole sectors only, tweaks computed on the GPU
+    if (inl % ctx->sector_size != 0)
+      return 0;
+    if (!vc6_submit_xts(vc6_get_backend(), in, out, inl, ctx->key, ctx->iv,
+                        ctx->sector_size, !ctx->enc))
+      return 0;
+    xts_advance(ctx->iv, inl / ctx->sector_size);
+  }
+  *outl = inl;
+  return 1;
+}
+
+static int vc6_xts_final(void *vctx, unsigned char *out, size_t *outl,
+                         size_t outsize) {
+  *outl = 0;
+  return 1;
+}
+
+static int vc6_xts_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_MODE);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, EVP_CIPH_XTS_MODE))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 64))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, XTS_BLK))
+    return 0;
+  return 1;
+}
+
+static int vc6_xts_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_XTS_CTX *ctx = (VC6_XTS_CTX *)vctx;
+  OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 64))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, XTS_BLK))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_CIPHER_PARAM_XTS_SECTOR_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->sector_size))
+    return 0;
+  return 1;
+}
+
+static int vc6_xts_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
+  VC6_XTS_CTX *ctx = (VC6_XTS_CTX *)vctx;
+  const OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate_const(params, VC6_CIPHER_PARAM_XTS_SECTOR_SIZE);
+  if (p != NULL) {
+    size_t sector;
+    if (!OSSL_PARAM_get_size_t(p, &sector) || sector % XTS_BLK != 0)
+      return 0;
+    ctx->sector_size = sector;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL) {
+    size_t keylen;
+    if (!OSSL_PARAM_get_size_t(p, &keylen) || keylen != 64)
+      return 0;
+  }
+  return 1;
+}
+
+static const OSSL_PARAM vc6_xts_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_XTS_SECTOR_SIZE, NULL),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_xts_gettable_ctx_params(void *cctx,
+                                                     void *provctx) {
+  return vc6_xts_known_gettable_params;
+}
+
+static const OSSL_PARAM vc6_xts_known_settable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_XTS_SECTOR_SIZE, NULL),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_xts_settable_ctx_params(void *cctx,
+                                                     void *provctx) {
+  return vc6_xts_known_settable_params;
+}
+
+static int vc6_xts_traced(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  return vc6_trace_update("AES-256-XTS update", vc6_xts_update, vctx,
+                          out, outl, outsize, in, inl);
+}
+
+const OSSL_DISPATCH vc6_aes256xts_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_xts_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_xts_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_xts_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_xts_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_xts_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_xts_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_xts_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_xts_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS, (void (*)(void))vc6_xts_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_xts_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_xts_settable_ctx_params},
+    {0, NULL}};
@@ -0,0 +1,247 @@
+// BLAKE3 digest (hash mode, 32-byte output)
+// Input is buffered into batches of VC6_BLAKE3_BATCH_MAX bytes. Each batch
+// is a complete BLAKE3 subtree: the GPU hashes its chunks and merges them
+// per workgroup (blake3.comp), the CPU folds the workgroup CVs into the
+// batch CV. Batch CVs are kept on a stack and merged as in the BLAKE3
+// reference; final() adds the tail and merges to the root on the CPU.
+// Small inputs, and any input when the GPU is unavailable, are hashed on
+// the CPU.
+
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "../cpu/blake3.h"
+#include "vc6_prov.h"
+
+#define VC6_B3_DIGEST_LEN 32
+#define VC6_B3_BLOCK_LEN 64
+#define VC6_B3_BATCH VC6_BLAKE3_BATCH_MAX
+#define VC6_B3_BATCH_CHUNKS (VC6_B3_BATCH / VC6_BLAKE3_CHUNK_LEN)
+// Below one full workgroup of chunks a dispatch costs more than it saves
+#define VC6_B3_GPU_MIN (VC6_BLAKE3_GROUP_CHUNKS * VC6_BLAKE3_CHUNK_LEN)
+// One CV per level; 2^54 batches is far beyond a 64-bit length
+#define VC6_B3_MAX_DEPTH 54
+
+typedef struct {
+  unsigned char *buf; // Input not yet hashed, at most one batch
+  size_t buf_len;
+  size_t buf_cap;
+  uint64_t batches; // Batches hashed so far
+  unsigned char stack[VC6_B3_MAX_DEPTH][32];
+  size_t depth;
+} VC6_BLAKE3_CTX;
+
+// CV of 'len' bytes (1 .. VC6_B3_BATCH) starting at chunk 'counter'
+static void vc6_blake3_cv(unsigned char out[32], const unsigned char *in,
+                          size_t len, uint64_t counter, int root) {
+  unsigned char cvs[32 * (VC6_B3_BATCH_CHUNKS / VC6_BLAKE3_GROUP_CHUNKS)];
+  size_t n = 0;
+  void *backend;
+
+  if (len > VC6_B3_GPU_MIN && (backend = vc6_get_backend()) != NULL &&
+      vc6_blake3_chunks(backend, in, len, counter, cvs, &n)) {
+    // len > one workgroup, so n >= 2 as the root reduce requires
+    vc6_blake3_reduce(out, cvs, n, root);
+    return;
+  }
+  vc6_blake3_subtree(out, in, len, counter, root);
+  vc6_stats_cpu(VC6_ALG_BLAKE3, 1, len);
+}
+
+// Hashes one full batch and pushes its CV. Only called when more input
+// follows, so neither the batch nor any merge below can be the root.
+static void vc6_blake3_push_batch(VC6_BLAKE3_CTX *ctx,
+                                  const unsigned char *in) {
+  unsigned char cv[32];
+  uint64_t total;
+
+  vc6_blake3_cv(cv, in, VC6_B3_BATCH, ctx->batches * VC6_B3_BATCH_CHUNKS, 0);
+  ctx->batches++;
+  // Each trailing zero bit of the batch count completes a subtree
+  for (total = ctx->batches; (total & 1) == 0; total >>= 1)
+    vc6_blake3_parent(cv, ctx->stack[--ctx->depth], cv, 0);
+  memcpy(ctx->stack[ctx->depth++], cv, 32);
+}
+
+// Grows the buffer to hold 'need' bytes, keeping its contents; grown on
+// demand so small hashes do not allocate a whole batch
+static int vc6_blake3_reserve(VC6_BLAKE3_CTX *ctx, size_t need) {
+  size_t cap = ctx->buf_cap > 0 ? ctx->buf_cap : 4096;
+  unsigned char *buf;
+
+  if (ctx->buf_cap >= need)
+    return 1;
+  while (cap < need)
+    cap *= 2;
+  if (cap > VC6_B3_BATCH)
+    cap = VC6_B3_BATCH;
+  buf = OPENSSL_malloc(cap);
+  if (buf == NULL)
+    return 0;
+  if (ctx->buf_len > 0)
+    memcpy(buf, ctx->buf, ctx->buf_len);
+  OPENSSL_clear_free(ctx->buf, ctx->buf_cap);
+  ctx->buf = buf;
+  ctx->buf_cap = cap;
+  return 1;
+}
+
+static void *vc6_blake3_newctx(void *provctx) {
+  (void)provctx;
+  return OPENSSL_zalloc(sizeof(VC6_BLAKE3_CTX));
+}
+
+static void vc6_blake3_freectx(void *vctx) {
+  VC6_BLAKE3_CTX *ctx = (VC6_BLAKE3_CTX *)vctx;
+  if (ctx == NULL)
+    return;
+  OPENSSL_clear_free(ctx->buf, ctx->buf_cap);
+  OPENSSL_clear_free(ctx, sizeof(*ctx));
+}
+
+static void *vc6_blake3_dupctx(void *vctx) {
+  VC6_BLAKE3_CTX *src = (VC6_BLAKE3_CTX *)vctx;
+  VC6_BLAKE3_CTX *dup = OPENSSL_malloc(sizeof(*dup));
+  if (dup == NULL)
+    return NULL;
+  memcpy(dup, src, sizeof(*dup));
+  if (src->buf != NULL) {
+    dup->buf = OPENSSL_malloc(src->buf_cap);
+    if (dup->buf == NULL) {
+      OPENSSL_free(dup);
+      return NULL;
+    }
+    memcpy(dup->buf, src->buf, src->buf_len);
+  }
+  return dup;
+}
+
+static int vc6_blake3_init(void *vctx, const OSSL_PARAM params[]) {
+  VC6_BLAKE3_CTX *ctx = (VC6_BLAKE3_CTX *)vctx;
+  (void)params;
+  ctx->buf_len = 0;
+  ctx->batches = 0;
+  ctx->depth = 0;
+  return 1;
+}
+
+static int vc6_blake3_update(void *vctx, const unsigned char *in,
+                             size_t inl) {
+  VC6_BLAKE3_CTX *ctx = (VC6_BLAKE3_CTX *)vctx;
+
+  // A full buffer is hashed only once more input is known to follow
+  if (ctx->buf_len == VC6_B3_BATCH && inl > 0) {
+    vc6_blake3_push_batch(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  // Top up a partial buffer first
+  if (ctx->buf_len > 0) {
+    size_t n = VC6_B3_BATCH - ctx->buf_len;
+    if (n > inl)
+      n = inl;
+    if (!vc6_blake3_reserve(ctx, ctx->buf_len + n))
+      return 0;
+    memcpy(ctx->buf + ctx->buf_len, in, n);
+    ctx->buf_len += n;
+    in += n;
+    inl -= n;
+    if (inl == 0)
+      return 1;
+    vc6_blake3_push_batch(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  // Whole batches straight from the caller's buffer, keeping the last one
+  while (inl > VC6_B3_BATCH) {
+    vc6_blake3_push_batch(ctx, in);
+    in += VC6_B3_BATCH;
+    inl -= VC6_B3_BATCH;
+  }
+  if (inl == 0)
+    return 1;
+
+  if (!vc6_blake3_reserve(ctx, inl))
+    return 0;
+  memcpy(ctx->buf, in, inl);
+  ctx->buf_len = inl;
+  return 1;
+}
+
+static int vc6_blake3_traced(void *vctx, const unsigned char *in,
+                             size_t inl) {
+  uint64_t start = vc6_trace_now();
+  int ok = vc6_blake3_update(vctx, in, inl);
+  vc6_trace_span("BLAKE3 update", start, inl, 0);
+  return ok;
+}
+
+static int vc6_blake3_final(void *vctx, unsigned char *out, size_t *outl,
+                            size_t outsz) {
+  VC6_BLAKE3_CTX *ctx = (VC6_BLAKE3_CTX *)vctx;
+  unsigned char cv[32];
+  size_t i;
+
+  if (outsz < VC6_B3_DIGEST_LEN)
+    return 0;
+
+  if (ctx->batches == 0) {
+    if (ctx->buf_len == 0)
+      vc6_blake3_subtree(out, NULL, 0, 0, 1);
+    else
+      vc6_blake3_cv(out, ctx->buf, ctx->buf_len, 0, 1);
+  } else {
+    // The tail is never empty here: a full buffer is kept until more input
+    vc6_blake3_cv(cv, ctx->buf, ctx->buf_len,
+                  ctx->batches * VC6_B3_BATCH_CHUNKS, 0);
+    for (i = ctx->depth; i > 0; i--)
+      vc6_blake3_parent(cv, ctx->stack[i - 1], cv, i == 1);
+    memcpy(out, cv, VC6_B3_DIGEST_LEN);
+    OPENSSL_cleanse(cv, sizeof(cv));
+  }
+  *outl = VC6_B3_DIGEST_LEN;
+  return 1;
+}
+
+static int vc6_blake3_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, VC6_B3_BLOCK_LEN))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, VC6_B3_DIGEST_LEN))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_XOF);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 0))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_ALGID_ABSENT);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  return 1;
+}
+
+static const OSSL_PARAM vc6_blake3_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_SIZE, NULL),
+    OSSL_PARAM_int(OSSL_DIGEST_PARAM_XOF, NULL),
+    OSSL_PARAM_int(OSSL_DIGEST_PARAM_ALGID_ABSENT, NULL), OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_blake3_gettable_params(void *provctx) {
+  return vc6_blake3_known_gettable_params;
+}
+
+const OSSL_DISPATCH vc6_blake3_functions[] = {
+    {OSSL_FUNC_DIGEST_NEWCTX, (void (*)(void))vc6_blake3_newctx},
+    {OSSL_FUNC_DIGEST_FREECTX, (void (*)(void))vc6_blake3_freectx},
+    {OSSL_FUNC_DIGEST_DUPCTX, (void (*)(void))vc6_blake3_dupctx},
+    {OSSL_FUNC_DIGEST_INIT, (void (*)(void))vc6_blake3_init},
+    {OSSL_FUNC_DIGEST_UPDATE, (void (*)(void))vc6_blake3_traced},
+    {OSSL_FUNC_DIGEST_FINAL, (void (*)(void))vc6_blake3_final},
+    {OSSL_FUNC_DIGEST_GET_PARAMS, (void (*)(void))vc6_blake3_get_params},
+    {OSSL_FUNC_DIGEST_GETTABLE_PARAMS,
+     (void (*)(void))vc6_blake3_gettable_params},
+    {0, NULL}};
@@ -0,0 +1,537 @@
+// ChaCha20-Poly1305 (RFC 8439)
+// The keystream comes from chacha20.comp (block counter 1 onwards) while
+// Poly1305 runs on the CPU task pool: the message is split into segments
+// evaluated independently and combined with powers of r. The two overlap
+// chunk by chunk through the AEAD pipeline in aead.c.
+// The one-time Poly1305 key (block 0) and the TLS record path are done on
+// the CPU.
+// XChaCha20-Poly1305 (draft-irtf-cfrg-xchacha) is the same construction
+// under the HChaCha20 subkey with a 24-byte nonce; it has no TLS mode.
+
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <string.h>
+
+#include "../backend/vc6_backend.h"
+#include "../cpu/chacha20.h"
+#include "../cpu/poly1305.h"
+#include "vc6_prov.h"
+
+#define CP_BLK 16
+#define CP_NONCE_LEN 12
+#define CP_XNONCE_LEN 24
+#define CP_TLS_AAD_LEN 13
+#define CP_POLY_SEGMENTS 3 // Leaves one core for the GPU submit
+#define CP_MAX_DATA ((((uint64_t)1 << 32) - 1) * 64)
+
+// IV lifecycle, as in aes_gcm.c
+#define CP_IV_UNSET 0
+#define CP_IV_BUFFERED 1 // Set, message not started
+#define CP_IV_STARTED 2
+#define CP_IV_FINISHED 3 // final() done, a new IV is required
+
+typedef struct {
+  unsigned char key[32];
+  unsigned char nonce[CP_XNONCE_LEN];
+  int xchacha; // 24-byte nonces, subkey per message
+  int iv_state;
+  int set_key;
+  int enc;
+
+  // Per-message state
+  unsigned char mkey[32]; // ChaCha20 key: key, or the HChaCha20 subkey
+  unsigned char ctr[16];  // Backend IV: counter 1 || nonce
+  VC6_POLY1305_KEY pkey;
+  uint32_t h[5];
+  unsigned char buf[CP_BLK]; // MAC input short of a block
+  size_t buf_len;
+  uint64_t aad_len;
+  uint64_t data_len;
+  int in_data; // AAD closed (padded) once data starts
+
+  unsigned char tag[CP_BLK];
+  size_t taglen;
+  int tag_set; // Expected tag given since init (decrypt)
+
+  // TLS 1.2 (RFC 7905): nonce = fixed IV ^ record sequence number
+  unsigned char tls_fixed[CP_NONCE_LEN];
+  unsigned char tls_aad[CP_TLS_AAD_LEN];
+  size_t tls_aad_len; // 0 = not in TLS record mode
+  size_t tls_payload;
+} VC6_CP_CTX;
+
+static void *vc6_cp_newctx(void *provctx) {
+  (void)provctx;
+  if (!vc6_get_backend())
+    return NULL;
+  VC6_CP_CTX *ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx != NULL)
+    ctx->taglen = CP_BLK;
+  return ctx;
+}
+
+static void *vc6_xcp_newctx(void *provctx) {
+  VC6_CP_CTX *ctx = vc6_cp_newctx(provctx);
+  if (ctx != NULL)
+    ctx->xchacha = 1;
+  return ctx;
+}
+
+static size_t cp_nonce_len(const VC6_CP_CTX *ctx) {
+  return ctx->xchacha ? CP_XNONCE_LEN : CP_NONCE_LEN;
+}
+
+static void vc6_cp_freectx(void *vctx) {
+  OPENSSL_clear_free(vctx, sizeof(VC6_CP_CTX));
+}
+
+static void cp_mac(void *vctx, const unsigned char *in, size_t len) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  vc6_poly1305_parallel(&ctx->pkey, ctx->h, in, len, CP_POLY_SEGMENTS,
+                        vc6_parallel_for);
+}
+
+// Message bytes [pos, pos + len) through chacha20.comp
+static int cp_chacha(void *vctx, const unsigned char *in, unsigned char *out,
+                     size_t len, uint64_t pos) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  return vc6_submit_job_at(vc6_get_backend(), in, out, len, ctx->mkey,
+                           ctx->ctr, pos, VC6_ALG_CHACHA20);
+}
+
+static void cp_pipe(VC6_CP_CTX *ctx, VC6_AEAD_PIPE *pipe) {
+  pipe->ctx = ctx;
+  pipe->crypt = cp_chacha;
+  pipe->mac = cp_mac;
+  pipe->buf = ctx->buf;
+  pipe->buf_len = &ctx->buf_len;
+}
+
+// Starts a message under ctx->nonce: Poly1305 key from block 0, data
+// from block 1
+static void cp_start(VC6_CP_CTX *ctx) {
+  unsigned char otk[64];
+  unsigned char nonce[CP_NONCE_LEN];
+
+  if (ctx->xchacha) {
+    vc6_xchacha20_setup(ctx->mkey, nonce, ctx->key, ctx->nonce);
+  } else {
+    memcpy(ctx->mkey, ctx->key, 32);
+    memcpy(nonce, ctx->nonce, CP_NONCE_LEN);
+  }
+
+  vc6_chacha20_block(otk, ctx->mkey, 0, nonce);
+  vc6_poly1305_init(&ctx->pkey, otk);
+  OPENSSL_cleanse(otk, sizeof(otk));
+
+  memset(ctx->ctr, 0, 4);
+  ctx->ctr[0] = 1; // 32-bit little-endian block counter
+  memcpy(ctx->ctr + 4, nonce, CP_NONCE_LEN);
+
+  memset(ctx->h, 0, sizeof(ctx->h));
+  ctx->buf_len = 0;
+  ctx->aad_len = 0;
+  ctx->data_len = 0;
+  ctx->in_data = 0;
+  ctx->iv_state = CP_IV_STARTED;
+}
+
+static int cp_crypt(VC6_CP_CTX *ctx, const unsigned char *in,
+                    unsigned char *out, size_t len) {
+  VC6_AEAD_PIPE pipe;
+  if (len > CP_MAX_DATA - ctx->data_len)
+    return 0;
+  cp_pipe(ctx, &pipe);
+  if (!ctx->in_data) {
+    vc6_aead_pad(&pipe); // End of AAD
+    ctx->in_data = 1;
+  }
+  if (!vc6_aead_crypt(&pipe, in, out, len, ctx->data_len, ctx->enc))
+    return 0;
+  ctx->data_len += len;
+  return 1;
+}
+
+static int cp_aad(VC6_CP_CTX *ctx, const unsigned char *aad, size_t len) {
+  VC6_AEAD_PIPE pipe;
+  if (ctx->in_data)
+    return 0; // AAD must precede the data
+  cp_pipe(ctx, &pipe);
+  vc6_aead_absorb(&pipe, aad, len);
+  ctx->aad_len += len;
+  return 1;
+}
+
+// Tag = Poly1305(AAD || pad || C || pad || [len(AAD)]_64 || [len(C)]_64),
+// lengths little-endian
+static void cp_tag(VC6_CP_CTX *ctx, unsigned char tag[CP_BLK]) {
+  unsigned char lenblk[CP_BLK];
+  VC6_AEAD_PIPE pipe;
+
+  cp_pipe(ctx, &pipe);
+  vc6_aead_pad(&pipe);
+  for (int i = 0; i < 8; i++) {
+    lenblk[i] = (unsigned char)(ctx->aad_len >> (8 * i));
+    lenblk[8 + i] = (unsigned char)(ctx->data_len >> (8 * i));
+  }
+  vc6_poly1305_blocks(&ctx->pkey, ctx->h, lenblk, CP_BLK);
+  vc6_poly1305_finish(&ctx->pkey, ctx->h, tag);
+}
+
+static int vc6_cp_set_ctx_params(void *vctx, const OSSL_PARAM params[]);
+
+static int vc6_cp_init(VC6_CP_CTX *ctx, const unsigned char *key,
+                       size_t keylen, const unsigned char *iv, size_t ivlen,
+                       const OSSL_PARAM params[], int enc) {
+  ctx->enc = enc;
+  ctx->tls_aad_len = 0;
+  ctx->tag_set = 0;
+  if (key != NULL) {
+    if (keylen != 32)
+      return 0;
+    memcpy(ctx->key, key, 32);
+    ctx->set_key = 1;
+  }
+  if (iv != NULL) {
+    if (ivlen != cp_nonce_len(ctx))
+      return 0;
+    memcpy(ctx->nonce, iv, ivlen);
+    ctx->iv_state = CP_IV_BUFFERED;
+  }
+  // A message in progress restarts under the new key. A finished one
+  // keeps its nonce spent: re-arming it would reuse (key, nonce) and the
+  // one-time Poly1305 key
+  if (key != NULL && ctx->iv_state == CP_IV_STARTED)
+    ctx->iv_state = CP_IV_BUFFERED;
+  return vc6_cp_set_ctx_params(ctx, params);
+}
+
+static int vc6_cp_einit(void *vctx, const unsigned char *key, size_t keylen,
+                        const unsigned char *iv, size_t ivlen,
+                        const OSSL_PARAM params[]) {
+  return vc6_cp_init(vctx, key, keylen, iv, ivlen, params, 1);
+}
+
+static int vc6_cp_dinit(void *vctx, const unsigned char *key, size_t keylen,
+                        const unsigned char *iv, size_t ivlen,
+                        const OSSL_PARAM params[]) {
+  return vc6_cp_init(vctx, key, keylen, iv, ivlen, params, 0);
+}
+
+// Starts the message on first use of a freshly set IV
+static int cp_ready(VC6_CP_CTX *ctx) {
+  if (!ctx->set_key)
+    return 0;
+  if (ctx->iv_state == CP_IV_BUFFERED)
+    cp_start(ctx);
+  return ctx->iv_state == CP_IV_STARTED;
+}
+
+static int cp_tls_cipher(VC6_CP_CTX *ctx, unsigned char *out, size_t *outl,
+                         const unsigned char *in, size_t len);
+
+// EVP_CipherUpdate() entry; libssl sends TLS 1.2 records through here too
+static int vc6_cp_update(void *vctx, unsigned char *out, size_t *outl,
+                         size_t outsize, const unsigned char *in, size_t inl) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  *outl = 0;
+  if (ctx->tls_aad_len != 0)
+    return outsize >= inl && cp_tls_cipher(ctx, out, outl, in, inl);
+  if (!cp_ready(ctx))
+    return 0;
+  if (inl == 0)
+    return 1;
+
+  if (out == NULL) {
+    if (!cp_aad(ctx, in, inl))
+      return 0;
+  } else {
+    if (outsize < inl || !cp_crypt(ctx, in, out, inl))
+      return 0;
+  }
+  *outl = inl;
+  return 1;
+}
+
+static int vc6_cp_final(void *vctx, unsigned char *out, size_t *outl,
+                        size_t outsize) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  unsigned char tag[CP_BLK];
+  int ok = 1;
+
+  *outl = 0;
+  if (ctx->tls_aad_len != 0 || !cp_ready(ctx))
+    return 0;
+  cp_tag(ctx, tag);
+  if (ctx->enc)
+    memcpy(ctx->tag, tag, CP_BLK);
+  else // No expected tag, no verification: never accept
+    ok = ctx->tag_set && CRYPTO_memcmp(tag, ctx->tag, ctx->taglen) == 0;
+  ctx->iv_state = CP_IV_FINISHED;
+  OPENSSL_cleanse(tag, sizeof(tag));
+  return ok;
+}
+
+// One TLS 1.2 record, in place: payload || tag (16), no explicit IV.
+// *outl is the whole record when encrypting and the payload when
+// decrypting, as libssl expects
+static int cp_tls_cipher(VC6_CP_CTX *ctx, unsigned char *out, size_t *outl,
+                         const unsigned char *in, size_t len) {
+  size_t plen = ctx->tls_payload;
+  unsigned char tag[CP_BLK];
+  int ok = 0;
+
+  *outl = 0;
+  if (out != in || len != plen + CP_BLK || !ctx->set_key || ctx->xchacha)
+    goto err;
+
+  cp_start(ctx);
+  cp_aad(ctx, ctx->tls_aad, ctx->tls_aad_len);
+  if (!cp_crypt(ctx, in, out, plen))
+    goto err;
+  cp_tag(ctx, tag);
+  if (ctx->enc) {
+    memcpy(out + plen, tag, CP_BLK);
+    *outl = len;
+    ok = 1;
+  } else {
+    ok = CRYPTO_memcmp(tag, in + plen, CP_BLK) == 0;
+    if (ok)
+      *outl = plen;
+    else
+      OPENSSL_cleanse(out, plen);
+  }
+
+err:
+  ctx->iv_state = CP_IV_FINISHED;
+  ctx->tls_aad_len = 0;
+  OPENSSL_cleanse(tag, sizeof(tag));
+  return ok;
+}
+
+// EVP_Cipher() entry: TLS records when a TLS AAD is set, otherwise
+// AAD (out == NULL), data, or final (in == NULL)
+static int vc6_cp_cipher(void *vctx, unsigned char *out, size_t *outl,
+                         size_t outsize, const unsigned char *in, size_t inl) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  size_t dummy;
+
+  *outl = 0;
+  if (outsize < inl)
+    return 0;
+  if (ctx->tls_aad_len != 0) {
+    if (!cp_tls_cipher(ctx, out, &dummy, in, inl))
+      return 0;
+  } else if (in != NULL) {
+    if (!vc6_cp_update(vctx, out, outl, outsize, in, inl))
+      return 0;
+  } else if (!vc6_cp_final(vctx, out, &dummy, outsize)) {
+    return 0;
+  }
+  *outl = inl;
+  return 1;
+}
+
+// OSSL_CIPHER_PARAM_AEAD_TLS1_AAD: sets the record nonce and the payload
+// length (the record carries the tag when decrypting)
+static int cp_tls_init(VC6_CP_CTX *ctx, const unsigned char *aad,
+                       size_t len) {
+  if (len != CP_TLS_AAD_LEN)
+    return 0;
+  memcpy(ctx->tls_aad, aad, len);
+  size_t rec = ((size_t)aad[len - 2] << 8) | aad[len - 1];
+  if (!ctx->enc) {
+    if (rec < CP_BLK)
+      return 0;
+    rec -= CP_BLK;
+    ctx->tls_aad[len - 2] = (unsigned char)(rec >> 8);
+    ctx->tls_aad[len - 1] = (unsigned char)rec;
+  }
+  ctx->tls_payload = rec;
+
+  // RFC 7905: the sequence number (first 8 AAD bytes) is XORed into the
+  // last 8 bytes of the fixed IV
+  memcpy(ctx->nonce, ctx->tls_fixed, CP_NONCE_LEN);
+  for (int i = 0; i < 8; i++)
+    ctx->nonce[4 + i] ^= aad[i];
+  ctx->iv_state = CP_IV_BUFFERED;
+  ctx->tls_aad_len = len;
+  return 1;
+}
+
+static int vc6_cp_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_MODE);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, 0))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_CUSTOM_IV);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, CP_NONCE_LEN))
+    return 0;
+  return 1;
+}
+
+static int vc6_xcp_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  if (!vc6_cp_get_params(params))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, CP_XNONCE_LEN))
+    return 0;
+  return 1;
+}
+
+static int vc6_cp_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, cp_nonce_len(ctx)))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAGLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->taglen))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+  if (p != NULL) {
+    // Only after an encrypting final()
+    if (!ctx->enc || ctx->iv_state != CP_IV_FINISHED ||
+        p->data_type != OSSL_PARAM_OCTET_STRING || p->data_size == 0 ||
+        p->data_size > CP_BLK ||
+        !OSSL_PARAM_set_octet_string(p, ctx->tag, p->data_size))
+      return 0;
+  }
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_AEAD_TLS1_AAD_PAD);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, CP_BLK))
+    return 0;
+  return 1;
+}
+
+static int vc6_cp_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
+  VC6_CP_CTX *ctx = (VC6_CP_CTX *)vctx;
+  const OSSL_PARAM *p;
+
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TAG);
+  if (p != NULL) {
+    // Expected tag, decrypt only
+    if (ctx->enc || p->data_type != OSSL_PARAM_OCTET_STRING ||
+        p->data_size == 0 || p->data_size > CP_BLK)
+      return 0;
+    if (p->data != NULL) {
+      memcpy(ctx->tag, p->data, p->data_size);
+      ctx->tag_set = 1;
+    }
+    ctx->taglen = p->data_size;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_IVLEN);
+  if (p != NULL) {
+    // Fixed nonce sizes only
+    size_t ivlen;
+    if (!OSSL_PARAM_get_size_t(p, &ivlen) || ivlen != cp_nonce_len(ctx))
+      return 0;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TLS1_AAD);
+  if (p != NULL) {
+    if (ctx->xchacha || p->data_type != OSSL_PARAM_OCTET_STRING ||
+        !cp_tls_init(ctx, p->data, p->data_size))
+      return 0;
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED);
+  if (p != NULL) {
+    if (ctx->xchacha || p->data == NULL ||
+        p->data_type != OSSL_PARAM_OCTET_STRING ||
+        p->data_size != CP_NONCE_LEN)
+      return 0;
+    memcpy(ctx->tls_fixed, p->data, CP_NONCE_LEN);
+  }
+  p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_KEYLEN);
+  if (p != NULL) {
+    size_t keylen;
+    if (!OSSL_PARAM_get_size_t(p, &keylen) || keylen != 32)
+      return 0;
+  }
+  return 1;
+}
+
+static const OSSL_PARAM vc6_cp_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_TAGLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_TLS1_AAD_PAD, NULL),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_cp_gettable_ctx_params(void *cctx,
+                                                    void *provctx) {
+  return vc6_cp_known_gettable_params;
+}
+
+static const OSSL_PARAM vc6_cp_known_settable_params[] = {
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_AEAD_IVLEN, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TAG, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_AAD, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED, NULL, 0),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_cp_settable_ctx_params(void *cctx,
+                                                    void *provctx) {
+  return vc6_cp_known_settable_params;
+}
+
+static int vc6_cp_traced(void *vctx, unsigned char *out, size_t *outl,
+                         size_t outsize, const unsigned char *in,
+                         size_t inl) {
+  return vc6_trace_update("ChaCha20-Poly1305 update", vc6_cp_update, vctx,
+                          out, outl, outsize, in, inl);
+}
+
+const OSSL_DISPATCH vc6_chacha20poly1305_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_cp_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_cp_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_cp_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_cp_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_cp_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_cp_final},
+    {OSSL_FUNC_CIPHER_CIPHER, (void (*)(void))vc6_cp_cipher},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_cp_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_cp_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS, (void (*)(void))vc6_cp_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_cp_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_cp_settable_ctx_params},
+    {0, NULL}};
+
+const OSSL_DISPATCH vc6_xchacha20poly1305_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_xcp_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_cp_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_cp_einit},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_cp_dinit},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_cp_traced},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_cp_final},
+    {OSSL_FUNC_CIPHER_CIPHER, (void (*)(void))vc6_cp_cipher},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_xcp_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_cp_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS, (void (*)(void))vc6_cp_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_cp_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_cp_settable_ctx_params},
+    {0, NULL}};
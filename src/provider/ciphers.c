@@ -1,18 +1,62 @@
 #include <openssl/core_dispatch.h>
 #include <openssl/core_names.h>
 #include <openssl/evp.h>
+#include <pthread.h>
 #include <string.h>
 
 // External C-API from backend
-extern void *vc6_init();
-extern void vc6_cleanup(void *handle);
-extern int vc6_submit_job(void *handle, const unsigned char *in,
-                          unsigned char *out, size_t len,
-                          const unsigned char *key, const unsigned char *iv,
-                          int alg_id);
-
-// Global backend handle for this provider instance
+#include "../backend/vc6_backend.h"
+#include "../cpu/chacha20.h"
+#include "vc6_prov.h"
+
+// Global backend handle for this provider instance, created once by the
+// first caller; NULL if vc6_init() failed (no GPU, not retried)
 static void *inner_backend = NULL;
+static pthread_once_t backend_once = PTHREAD_ONCE_INIT;
+
+static void vc6_backend_init(void) { inner_backend = vc6_init(); }
+
+void *vc6_get_backend(void) {
+  pthread_once(&backend_once, vc6_backend_init);
+  return inner_backend;
+}
+
+int vc6_trace_update(const char *name, VC6_CIPHER_UPDATE_FN fn, void *vctx,
+                     unsigned char *out, size_t *outl, size_t outsize,
+                     const unsigned char *in, size_t inl) {
+  uint64_t start = vc6_trace_now();
+  int ok = fn(vctx, out, outl, outsize, in, inl);
+  vc6_trace_span(name, start, inl, 0);
+  return ok;
+}
+
+// --- Keystream-ahead mode (shared by AES-CTR and ChaCha20) ---
+// With VC6_CIPHER_PARAM_KEYSTREAM_AHEAD set, the backend precomputes the
+// stream's keystream in the background and update() is a CPU XOR.
+
+// Reads the window size from 'params' if present; 0 on a malformed value
+static int vc6_ks_get_param(const OSSL_PARAM params[], size_t *window) {
+  const OSSL_PARAM *p =
+      OSSL_PARAM_locate_const(params, VC6_CIPHER_PARAM_KEYSTREAM_AHEAD);
+  if (p != NULL && !OSSL_PARAM_get_size_t(p, window))
+    return 0;
+  return 1;
+}
+
+// (Re)open the keystream window at the current stream position (key, iv)
+static int vc6_ks_restart(void **ks, size_t window, const unsigned char *key,
+                          const unsigned char *iv, int alg_id) {
+  if (*ks != NULL) {
+    vc6_keystream_close(*ks);
+    *ks = NULL;
+  }
+  if (window == 0)
+    return 1;
+  if (!inner_backend)
+    return 0;
+  *ks = vc6_keystream_open(inner_backend, key, iv, alg_id, window);
+  return *ks != NULL;
+}
 
 typedef struct {
   unsigned char key[32];
@@ -23,12 +67,15 @@ typedef struct {
   // Partial block buffering for stream continuity
   unsigned char partial_buf[16];
   size_t partial_len;
+  // Keystream-ahead mode
+  size_t ks_window;
+  void *ks;
+  int started; // update() called since init
 } VC6_AES_CTX;
 
 static void *vc6_aes_newctx(void *provctx) {
   (void)provctx; // Unused
-  if (!inner_backend)
-    inner_backend = vc6_init();
+  vc6_get_backend();
 
   VC6_AES_CTX *ctx = (VC6_AES_CTX *)OPENSSL_zalloc(sizeof(*ctx));
   return ctx;
@@ -36,6 +83,8 @@ static void *vc6_aes_newctx(void *provctx) {
 
 static void vc6_aes_freectx(void *vctx) {
   VC6_AES_CTX *ctx = (VC6_AES_CTX *)vctx;
+  if (ctx->ks)
+    vc6_keystream_close(ctx->ks);
   OPENSSL_free(ctx);
 }
 
@@ -45,6 +94,8 @@ static int vc6_aes_init(void *vctx, const unsigned char *key, size_t keylen,
                         const unsigned char *iv, size_t ivlen,
                         const OSSL_PARAM param[]) {
   VC6_AES_CTX *ctx = (VC6_AES_CTX *)vctx;
+  if (!vc6_ks_get_param(param, &ctx->ks_window))
+    return 0;
   if (key != NULL) {
     if (keylen != 16 && keylen != 32) {
       return 0;
@@ -58,6 +109,12 @@ static int vc6_aes_init(void *vctx, const unsigned char *key, size_t keylen,
     ctx->set_iv = 1;
   }
   ctx->partial_len = 0;
+  ctx->started = 0;
+  if (ctx->set_key && ctx->set_iv) {
+    int alg_id =
+        (ctx->key_len == 32) ? VC6_ALG_AES256_CTR : VC6_ALG_AES128_CTR;
+    return vc6_ks_restart(&ctx->ks, ctx->ks_window, ctx->key, ctx->iv, alg_id);
+  }
   return 1;
 }
 
@@ -66,28 +123,19 @@ static int vc6_aes_final(void *vctx, unsigned char *out, size_t *outl,
   VC6_AES_CTX *ctx = (VC6_AES_CTX *)vctx;
   *outl = 0;
 
-  if (ctx->partial_len > 0) {
-    if (!inner_backend)
-      return 0;
+  // Keystream-ahead mode never buffers
+  if (ctx->ks)
+    return 1;
 
-    // Zero pad the rest of the block
-    for (size_t i = ctx->partial_len; i < 16; i++) {
-      ctx->partial_buf[i] = 0;
-    }
-
-    // Encrypt 1 block in-place (in partial_buf)
-    // Note: We use the current IV.
-    int alg_id = (ctx->key_len == 32) ? 1 : 0;
-    int res = vc6_submit_job(inner_backend, ctx->partial_buf, ctx->partial_buf,
-                             16, ctx->key, ctx->iv, alg_id);
-    if (!res)
-      return 0;
-
-    // Copy only the valid bytes to 'out'
+  if (ctx->partial_len > 0) {
     if (outsize < ctx->partial_len)
       return 0; // Error: output buffer too small
 
-    memcpy(out, ctx->partial_buf, ctx->partial_len);
+    // The tail of the stream at the current IV, on the CPU
+    int alg_id =
+        (ctx->key_len == 32) ? VC6_ALG_AES256_CTR : VC6_ALG_AES128_CTR;
+    vc6_aes_ctr_cpu(ctx->partial_buf, out, ctx->partial_len, ctx->key,
+                    ctx->iv, 0, alg_id);
     *outl = ctx->partial_len;
   }
   return 1;
@@ -114,11 +162,17 @@ static void inc_128_counter(unsigned char *counter, size_t blocks) {
 static int vc6_aes_cipher(void *vctx, unsigned char *out, size_t *outl,
                           size_t outsize, const unsigned char *in, size_t inl) {
   VC6_AES_CTX *ctx = (VC6_AES_CTX *)vctx;
-  if (!inner_backend)
-    return 0;
-
   *outl = 0;
   size_t total_written = 0;
+  ctx->started = 1;
+
+  // Keystream-ahead mode: byte-granular XOR against ready keystream
+  if (ctx->ks) {
+    if (outsize < inl || !vc6_keystream_xor(ctx->ks, in, out, inl))
+      return 0;
+    *outl = inl;
+    return 1;
+  }
 
   // 1. Handle existing partial buffer
   if (ctx->partial_len > 0) {
@@ -129,12 +183,11 @@ static int vc6_aes_cipher(void *vctx, unsigned char *out, size_t *outl,
 
     // If full, encrypt it
     if (ctx->partial_len == 16) {
-      // Encrypt 1 block (alg: 0=AES-128, 1=AES-256)
-      int alg_id = (ctx->key_len == 32) ? 1 : 0;
-      int res = vc6_submit_job(inner_backend, ctx->partial_buf, out, 16,
-                               ctx->key, ctx->iv, alg_id);
-      if (!res)
-        return 0;
+      // Encrypt 1 block (never worth a dispatch)
+      int alg_id =
+          (ctx->key_len == 32) ? VC6_ALG_AES256_CTR : VC6_ALG_AES128_CTR;
+      vc6_aes_ctr_cpu(ctx->partial_buf, out, 16, ctx->key, ctx->iv, 0,
+                      alg_id);
 
       out += 16;
       total_written += 16;
@@ -148,10 +201,17 @@ static int vc6_aes_cipher(void *vctx, unsigned char *out, size_t *outl,
   // 2. Process Full Blocks from Input
   if (inl >= 16) {
     size_t full_blocks_len = inl & ~0xF; // Multiple of 16
-    int alg_id = (ctx->key_len == 32) ? 1 : 0;
-
-    int res = vc6_submit_job(inner_backend, in, out, full_blocks_len, ctx->key,
-                             ctx->iv, alg_id);
+    int alg_id =
+        (ctx->key_len == 32) ? VC6_ALG_AES256_CTR : VC6_ALG_AES128_CTR;
+
+    // The backend picks GPU or CPU; without a GPU it is CPU only
+    int res;
+    if (inner_backend)
+      res = vc6_submit_job(inner_backend, in, out, full_blocks_len, ctx->key,
+                           ctx->iv, alg_id);
+    else
+      res = vc6_aes_ctr_cpu(in, out, full_blocks_len, ctx->key, ctx->iv, 0,
+                            alg_id);
     if (!res)
       return 0;
 
@@ -187,6 +247,10 @@ static int vc6_aes_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
   if (p != NULL && !OSSL_PARAM_set_size_t(p, 16))
     return 0;
 
+  p = OSSL_PARAM_locate(params, VC6_CIPHER_PARAM_KEYSTREAM_AHEAD);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->ks_window))
+    return 0;
+
   return 1;
 }
 
@@ -230,13 +294,30 @@ static int vc6_aes_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
     if (keylen != 16 && keylen != 32)
       return 0;
   }
+
+  // Changing the window restarts it at the current counter, which is only
+  // exact while no data has gone through the context.
+  size_t window = ctx->ks_window;
+  if (!vc6_ks_get_param(params, &window))
+    return 0;
+  if (window != ctx->ks_window) {
+    if (ctx->started)
+      return 0;
+    ctx->ks_window = window;
+    if (ctx->set_key && ctx->set_iv) {
+      int alg_id =
+          (ctx->key_len == 32) ? VC6_ALG_AES256_CTR : VC6_ALG_AES128_CTR;
+      return vc6_ks_restart(&ctx->ks, window, ctx->key, ctx->iv, alg_id);
+    }
+  }
   return 1;
 }
 
 static const OSSL_PARAM vc6_aes_known_gettable_params[] = {
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
-    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_BLOCK_SIZE, NULL), OSSL_PARAM_END};
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_KEYSTREAM_AHEAD, NULL), OSSL_PARAM_END};
 
 static const OSSL_PARAM *vc6_aes_gettable_ctx_params(void *cctx,
                                                      void *provctx) {
@@ -245,19 +326,27 @@ static const OSSL_PARAM *vc6_aes_gettable_ctx_params(void *cctx,
 
 static const OSSL_PARAM vc6_aes_known_settable_params[] = {
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
-    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL), OSSL_PARAM_END};
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_KEYSTREAM_AHEAD, NULL), OSSL_PARAM_END};
 
 static const OSSL_PARAM *vc6_aes_settable_ctx_params(void *cctx,
                                                      void *provctx) {
   return vc6_aes_known_settable_params;
 }
 
+static int vc6_aes_update(void *vctx, unsigned char *out, size_t *outl,
+                          size_t outsize, const unsigned char *in,
+                          size_t inl) {
+  return vc6_trace_update("AES-CTR update", vc6_aes_cipher, vctx,
+                          out, outl, outsize, in, inl);
+}
+
 const OSSL_DISPATCH vc6_aes128ctr_functions[] = {
     {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_aes_newctx},
     {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_aes_freectx},
     {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_aes_init},
     {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_aes_init},
-    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_cipher},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_update},
     {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_aes_final},
     {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_aes128_get_params},
     {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_aes_get_ctx_params},
@@ -273,7 +362,7 @@ const OSSL_DISPATCH vc6_aes256ctr_functions[] = {
     {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_aes_freectx},
     {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_aes_init},
     {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_aes_init},
-    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_cipher},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_aes_update},
     {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_aes_final},
     {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_aes256_get_params},
     {OSSL_FUNC_CIPHER_GET_CTX_PARAMS, (void (*)(void))vc6_aes_get_ctx_params},
@@ -285,30 +374,66 @@ const OSSL_DISPATCH vc6_aes256ctr_functions[] = {
     {0, NULL}};
 
 // --- ChaCha20 Implementation ---
+// ChaCha12 / ChaCha8 share everything but the backend pipeline (alg_id).
 
 typedef struct {
+  int alg_id; // VC6_ALG_CHACHA20 / 12 / 8
   unsigned char key[32];
   unsigned char iv[16];
   int set_key;
   int set_iv;
-  // Partial block buffering for stream continuity
-  unsigned char partial_buf[64];
+  // Keystream bytes of the block at iv already used by earlier updates;
+  // update() is byte-granular (block size 1, so final() gets no room)
   size_t partial_len;
+  // Keystream-ahead mode
+  size_t ks_window;
+  void *ks;
+  int started; // update() called since init
+  // XChaCha20: the caller's key and 24-byte nonce; key/iv above hold the
+  // HChaCha20 subkey and the derived IETF IV (counter 0)
+  unsigned char xkey[32];
+  unsigned char xnonce[24];
+  int set_xkey;
+  int set_xnonce;
 } VC6_CHACHA_CTX;
 
+static void *vc6_chacha_newctx(int alg_id) {
+  VC6_CHACHA_CTX *ctx;
+  vc6_get_backend();
+  ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx != NULL)
+    ctx->alg_id = alg_id;
+  return ctx;
+}
+
 static void *vc6_chacha20_newctx(void *provctx) {
   (void)provctx;
-  if (!inner_backend)
-    inner_backend = vc6_init();
-  return OPENSSL_zalloc(sizeof(VC6_CHACHA_CTX));
+  return vc6_chacha_newctx(VC6_ALG_CHACHA20);
 }
 
-static void vc6_chacha20_freectx(void *vctx) { OPENSSL_free(vctx); }
+static void *vc6_chacha12_newctx(void *provctx) {
+  (void)provctx;
+  return vc6_chacha_newctx(VC6_ALG_CHACHA12);
+}
+
+static void *vc6_chacha8_newctx(void *provctx) {
+  (void)provctx;
+  return vc6_chacha_newctx(VC6_ALG_CHACHA8);
+}
+
+static void vc6_chacha20_freectx(void *vctx) {
+  VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
+  if (ctx->ks)
+    vc6_keystream_close(ctx->ks);
+  OPENSSL_clear_free(ctx, sizeof(*ctx));
+}
 
 static int vc6_chacha20_init(void *vctx, const unsigned char *key,
                              size_t keylen, const unsigned char *iv,
                              size_t ivlen, const OSSL_PARAM params[]) {
   VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
+  if (!vc6_ks_get_param(params, &ctx->ks_window))
+    return 0;
   if (key != NULL) {
     if (keylen != 32)
       return 0;
@@ -322,32 +447,75 @@ static int vc6_chacha20_init(void *vctx, const unsigned char *key,
     ctx->set_iv = 1;
   }
   ctx->partial_len = 0;
+  ctx->started = 0;
+  if (ctx->set_key && ctx->set_iv)
+    return vc6_ks_restart(&ctx->ks, ctx->ks_window, ctx->key, ctx->iv,
+                          ctx->alg_id);
   return 1;
 }
 
+// XChaCha20 (libsodium's crypto_stream_xchacha20: 24-byte nonce, block
+// counter from 0). The subkey is derived on the CPU; the data then takes
+// the ChaCha20 path above.
+static int vc6_xchacha20_init(void *vctx, const unsigned char *key,
+                              size_t keylen, const unsigned char *iv,
+                              size_t ivlen, const OSSL_PARAM params[]) {
+  VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
+  unsigned char subkey[32], ietf_iv[16];
+  int ok;
+
+  if (key != NULL) {
+    if (keylen != 32)
+      return 0;
+    memcpy(ctx->xkey, key, 32);
+    ctx->set_xkey = 1;
+  }
+  if (iv != NULL) {
+    if (ivlen != 24)
+      return 0;
+    memcpy(ctx->xnonce, iv, 24);
+    ctx->set_xnonce = 1;
+  }
+  if ((key == NULL && iv == NULL) || !ctx->set_xkey || !ctx->set_xnonce)
+    return vc6_chacha20_init(vctx, NULL, 0, NULL, 0, params);
+
+  memset(ietf_iv, 0, 4);
+  vc6_xchacha20_setup(subkey, ietf_iv + 4, ctx->xkey, ctx->xnonce);
+  ok = vc6_chacha20_init(vctx, subkey, 32, ietf_iv, 16, params);
+  OPENSSL_cleanse(subkey, sizeof(subkey));
+  return ok;
+}
+
 static int vc6_chacha20_cipher(void *vctx, unsigned char *out, size_t *outl,
                                size_t outsize, const unsigned char *in,
                                size_t inl) {
   VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
-  if (!inner_backend)
-    return 0;
-
   *outl = 0;
   size_t total_written = 0;
+  ctx->started = 1;
 
-  // 1. Handle existing partial buffer
-  if (ctx->partial_len > 0) {
-    while (inl > 0 && ctx->partial_len < 64) {
-      ctx->partial_buf[ctx->partial_len++] = *in++;
-      inl--;
-    }
+  // Keystream-ahead mode: byte-granular XOR against ready keystream
+  if (ctx->ks) {
+    if (outsize < inl || !vc6_keystream_xor(ctx->ks, in, out, inl))
+      return 0;
+    *outl = inl;
+    return 1;
+  }
+
+  // 1. Finish the block an earlier update() stopped in (never worth a
+  // dispatch)
+  if (ctx->partial_len > 0 && inl > 0) {
+    size_t n = 64 - ctx->partial_len;
+    if (n > inl)
+      n = inl;
+    vc6_chacha_cpu(in, out, n, ctx->key, ctx->iv, ctx->partial_len,
+                   ctx->alg_id);
+    in += n;
+    out += n;
+    inl -= n;
+    total_written += n;
+    ctx->partial_len += n;
     if (ctx->partial_len == 64) {
-      int res = vc6_submit_job(inner_backend, ctx->partial_buf, out, 64,
-                               ctx->key, ctx->iv, 2);
-      if (!res)
-        return 0;
-      out += 64;
-      total_written += 64;
       ctx->partial_len = 0;
       // Increment counter by 1 block
       uint32_t counter;
@@ -360,8 +528,14 @@ static int vc6_chacha20_cipher(void *vctx, unsigned char *out, size_t *outl,
   // 2. Process full 64-byte blocks
   if (inl >= 64) {
     size_t full_blocks_len = inl & ~0x3F; // Multiple of 64
-    int res = vc6_submit_job(inner_backend, in, out, full_blocks_len, ctx->key,
-                             ctx->iv, 2);
+    // The backend picks GPU or CPU; without a GPU it is CPU only
+    int res = 1;
+    if (inner_backend)
+      res = vc6_submit_job(inner_backend, in, out, full_blocks_len, ctx->key,
+                           ctx->iv, ctx->alg_id);
+    else
+      vc6_chacha_cpu(in, out, full_blocks_len, ctx->key, ctx->iv, 0,
+                     ctx->alg_id);
     if (!res)
       return 0;
     out += full_blocks_len;
@@ -375,11 +549,11 @@ static int vc6_chacha20_cipher(void *vctx, unsigned char *out, size_t *outl,
     memcpy(ctx->iv, &counter, 4);
   }
 
-  // 3. Buffer remaining bytes
+  // 3. Start the next block with the rest; the counter stays on it
   if (inl > 0) {
-    for (size_t i = 0; i < inl; i++) {
-      ctx->partial_buf[ctx->partial_len++] = in[i];
-    }
+    vc6_chacha_cpu(in, out, inl, ctx->key, ctx->iv, 0, ctx->alg_id);
+    total_written += inl;
+    ctx->partial_len = inl;
   }
 
   *outl = total_written;
@@ -388,25 +562,11 @@ static int vc6_chacha20_cipher(void *vctx, unsigned char *out, size_t *outl,
 
 static int vc6_chacha20_final(void *vctx, unsigned char *out, size_t *outl,
                               size_t outsize) {
-  VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
+  (void)vctx;
+  (void)out;
+  (void)outsize;
+  // update() already wrote every byte, keystream-ahead mode included
   *outl = 0;
-
-  if (ctx->partial_len > 0) {
-    if (!inner_backend)
-      return 0;
-    // Zero pad to 64 bytes
-    for (size_t i = ctx->partial_len; i < 64; i++) {
-      ctx->partial_buf[i] = 0;
-    }
-    int res = vc6_submit_job(inner_backend, ctx->partial_buf, ctx->partial_buf,
-                             64, ctx->key, ctx->iv, 2);
-    if (!res)
-      return 0;
-    if (outsize < ctx->partial_len)
-      return 0;
-    memcpy(out, ctx->partial_buf, ctx->partial_len);
-    *outl = ctx->partial_len;
-  }
   return 1;
 }
 
@@ -424,10 +584,21 @@ static int vc6_chacha20_get_params(OSSL_PARAM params[]) {
   return 1;
 }
 
+static int vc6_xchacha20_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  if (!vc6_chacha20_get_params(params))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 24))
+    return 0;
+  return 1;
+}
+
 static const OSSL_PARAM vc6_chacha20_known_gettable_params[] = {
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
-    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_BLOCK_SIZE, NULL), OSSL_PARAM_END};
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_KEYSTREAM_AHEAD, NULL), OSSL_PARAM_END};
 
 static const OSSL_PARAM *vc6_chacha20_gettable_ctx_params(void *cctx,
                                                           void *provctx) {
@@ -435,6 +606,7 @@ static const OSSL_PARAM *vc6_chacha20_gettable_ctx_params(void *cctx,
 }
 
 static int vc6_chacha20_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
   OSSL_PARAM *p;
   p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_KEYLEN);
   if (p != NULL && !OSSL_PARAM_set_size_t(p, 32))
@@ -442,28 +614,81 @@ static int vc6_chacha20_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
   p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
   if (p != NULL && !OSSL_PARAM_set_size_t(p, 16))
     return 0;
+  p = OSSL_PARAM_locate(params, VC6_CIPHER_PARAM_KEYSTREAM_AHEAD);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, ctx->ks_window))
+    return 0;
+  return 1;
+}
+
+static int vc6_xchacha20_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  if (!vc6_chacha20_get_ctx_params(vctx, params))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_IVLEN);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, 24))
+    return 0;
   return 1;
 }
 
 static int vc6_chacha20_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
-  return 1; // Stub
+  VC6_CHACHA_CTX *ctx = (VC6_CHACHA_CTX *)vctx;
+
+  // See vc6_aes_set_ctx_params()
+  size_t window = ctx->ks_window;
+  if (!vc6_ks_get_param(params, &window))
+    return 0;
+  if (window != ctx->ks_window) {
+    if (ctx->started)
+      return 0;
+    ctx->ks_window = window;
+    if (ctx->set_key && ctx->set_iv)
+      return vc6_ks_restart(&ctx->ks, window, ctx->key, ctx->iv,
+                            ctx->alg_id);
+  }
+  return 1;
 }
 
 static const OSSL_PARAM vc6_chacha_known_settable_params[] = {
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
-    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL), OSSL_PARAM_END};
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_IVLEN, NULL),
+    OSSL_PARAM_size_t(VC6_CIPHER_PARAM_KEYSTREAM_AHEAD, NULL), OSSL_PARAM_END};
 
 static const OSSL_PARAM *vc6_chacha20_settable_ctx_params(void *cctx,
                                                           void *provctx) {
   return vc6_chacha_known_settable_params;
 }
 
+static int vc6_chacha20_update(void *vctx, unsigned char *out, size_t *outl,
+                               size_t outsize, const unsigned char *in,
+                               size_t inl) {
+  return vc6_trace_update("ChaCha20 update", vc6_chacha20_cipher, vctx,
+                          out, outl, outsize, in, inl);
+}
+
 const OSSL_DISPATCH vc6_chacha20_functions[] = {
     {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_chacha20_newctx},
     {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_chacha20_freectx},
     {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_chacha20_init},
     {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_chacha20_init},
-    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_chacha20_cipher},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_chacha20_update},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_chacha20_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_chacha20_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_settable_ctx_params},
+    {0, NULL}};
+
+const OSSL_DISPATCH vc6_chacha12_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_chacha12_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_chacha20_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_chacha20_init},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_chacha20_init},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_chacha20_update},
     {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_chacha20_final},
     {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_chacha20_get_params},
     {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
@@ -475,3 +700,39 @@ const OSSL_DISPATCH vc6_chacha20_functions[] = {
     {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
      (void (*)(void))vc6_chacha20_settable_ctx_params},
     {0, NULL}};
+
+const OSSL_DISPATCH vc6_chacha8_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_chacha8_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_chacha20_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_chacha20_init},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_chacha20_init},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_chacha20_update},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_chacha20_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_chacha20_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_settable_ctx_params},
+    {0, NULL}};
+
+const OSSL_DISPATCH vc6_xchacha20_functions[] = {
+    {OSSL_FUNC_CIPHER_NEWCTX, (void (*)(void))vc6_chacha20_newctx},
+    {OSSL_FUNC_CIPHER_FREECTX, (void (*)(void))vc6_chacha20_freectx},
+    {OSSL_FUNC_CIPHER_ENCRYPT_INIT, (void (*)(void))vc6_xchacha20_init},
+    {OSSL_FUNC_CIPHER_DECRYPT_INIT, (void (*)(void))vc6_xchacha20_init},
+    {OSSL_FUNC_CIPHER_UPDATE, (void (*)(void))vc6_chacha20_update},
+    {OSSL_FUNC_CIPHER_FINAL, (void (*)(void))vc6_chacha20_final},
+    {OSSL_FUNC_CIPHER_GET_PARAMS, (void (*)(void))vc6_xchacha20_get_params},
+    {OSSL_FUNC_CIPHER_GET_CTX_PARAMS,
+     (void (*)(void))vc6_xchacha20_get_ctx_params},
+    {OSSL_FUNC_CIPHER_SET_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_set_ctx_params},
+    {OSSL_FUNC_CIPHER_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_gettable_ctx_params},
+    {OSSL_FUNC_CIPHER_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_chacha20_settable_ctx_params},
+    {0, NULL}};
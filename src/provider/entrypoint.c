@@ -1,19 +1,56 @@
 #include <openssl/core.h>
 #include <openssl/core_dispatch.h>
 #include <openssl/core_names.h>
+#include <openssl/params.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "../backend/vc6_backend.h"
+
 extern const OSSL_DISPATCH vc6_aes128ctr_functions[];
 extern const OSSL_DISPATCH vc6_aes256ctr_functions[];
 extern const OSSL_DISPATCH vc6_chacha20_functions[];
+extern const OSSL_DISPATCH vc6_chacha12_functions[];
+extern const OSSL_DISPATCH vc6_chacha8_functions[];
+extern const OSSL_DISPATCH vc6_aes256ecb_functions[];
+extern const OSSL_DISPATCH vc6_aes256cbc_functions[];
+extern const OSSL_DISPATCH vc6_aes256xts_functions[];
+extern const OSSL_DISPATCH vc6_aes256gcm_functions[];
+extern const OSSL_DISPATCH vc6_chacha20poly1305_functions[];
+extern const OSSL_DISPATCH vc6_xchacha20_functions[];
+extern const OSSL_DISPATCH vc6_xchacha20poly1305_functions[];
+extern const OSSL_DISPATCH vc6_chacha20_drbg_functions[];
+extern const OSSL_DISPATCH vc6_sha256_functions[];
+extern const OSSL_DISPATCH vc6_blake3_functions[];
+extern const OSSL_DISPATCH vc6_pbkdf2_sha256_functions[];
 
 static const OSSL_ALGORITHM vc6_ciphers[] = {
     {"AES-128-CTR", "provider=vc6", vc6_aes128ctr_functions},
     {"AES-256-CTR", "provider=vc6", vc6_aes256ctr_functions},
     {"ChaCha20", "provider=vc6", vc6_chacha20_functions},
+    {"ChaCha12", "provider=vc6", vc6_chacha12_functions},
+    {"ChaCha8", "provider=vc6", vc6_chacha8_functions},
+    {"AES-256-ECB", "provider=vc6", vc6_aes256ecb_functions},
+    {"AES-256-CBC", "provider=vc6", vc6_aes256cbc_functions},
+    {"AES-256-XTS", "provider=vc6", vc6_aes256xts_functions},
+    {"AES-256-GCM", "provider=vc6", vc6_aes256gcm_functions},
+    {"ChaCha20-Poly1305", "provider=vc6", vc6_chacha20poly1305_functions},
+    {"XChaCha20", "provider=vc6", vc6_xchacha20_functions},
+    {"XChaCha20-Poly1305", "provider=vc6", vc6_xchacha20poly1305_functions},
+    {NULL, NULL, NULL}};
+
+static const OSSL_ALGORITHM vc6_digests[] = {
+    {"VC6-SHA2-256", "provider=vc6", vc6_sha256_functions},
+    {"BLAKE3", "provider=vc6", vc6_blake3_functions},
+    {NULL, NULL, NULL}};
+
+static const OSSL_ALGORITHM vc6_kdfs[] = {
+    {"PBKDF2-SHA256", "provider=vc6", vc6_pbkdf2_sha256_functions},
     {NULL, NULL, NULL}};
 
+static const OSSL_ALGORITHM vc6_rands[] = {
+    {"CHACHA20-DRBG", "provider=vc6", vc6_chacha20_drbg_functions},
+    {NULL, NULL, NULL}};
 
 static const OSSL_DISPATCH vc6_query_operation[] = {
     {OSSL_FUNC_PROVIDER_QUERY_OPERATION, (void (*)(void))NULL}, {0, NULL}};
@@ -24,10 +61,89 @@ static const OSSL_ALGORITHM *vc6_query(void *provctx, int operation_id,
   switch (operation_id) {
   case OSSL_OP_CIPHER:
     return vc6_ciphers;
+  case OSSL_OP_DIGEST:
+    return vc6_digests;
+  case OSSL_OP_KDF:
+    return vc6_kdfs;
+  case OSSL_OP_RAND:
+    return vc6_rands;
   }
   return NULL;
 }
 
+static const OSSL_PARAM vc6_param_types[] = {
+    OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_NAME, NULL, 0),
+    OSSL_PARAM_int(OSSL_PROV_PARAM_STATUS, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_GPU_JOBS, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_GPU_BYTES, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_CPU_JOBS, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_CPU_BYTES, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_QUEUE_DEPTH, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_QUEUE_DEPTH_MAX, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_RING_HIGH_WATER, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_WAIT_COUNT, NULL),
+    OSSL_PARAM_uint64(VC6_PROV_PARAM_WAIT_NS, NULL),
+    OSSL_PARAM_octet_string(VC6_PROV_PARAM_STATS, NULL, 0),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_gettable_params(void *provctx) {
+  return vc6_param_types;
+}
+
+// Runtime counters for monitoring, read with OSSL_PROVIDER_get_params()
+static int vc6_get_params(void *provctx, OSSL_PARAM params[]) {
+  VC6_STATS st;
+  uint64_t totals[4] = {0, 0, 0, 0};
+  OSSL_PARAM *p;
+  int i;
+
+  vc6_get_stats(&st);
+  for (i = 0; i < VC6_ALG_COUNT; i++) {
+    totals[0] += st.gpu_jobs[i];
+    totals[1] += st.gpu_bytes[i];
+    totals[2] += st.cpu_jobs[i];
+    totals[3] += st.cpu_bytes[i];
+  }
+
+  p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_NAME);
+  if (p != NULL && !OSSL_PARAM_set_utf8_ptr(p, "VC6 GPU crypto provider"))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_STATUS);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_GPU_JOBS);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, totals[0]))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_GPU_BYTES);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, totals[1]))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_CPU_JOBS);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, totals[2]))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_CPU_BYTES);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, totals[3]))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_QUEUE_DEPTH);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, st.queue_depth))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_QUEUE_DEPTH_MAX);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, st.queue_depth_max))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_RING_HIGH_WATER);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, st.ring_high_water))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_WAIT_COUNT);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, st.wait_count))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_WAIT_NS);
+  if (p != NULL && !OSSL_PARAM_set_uint64(p, st.wait_ns))
+    return 0;
+  p = OSSL_PARAM_locate(params, VC6_PROV_PARAM_STATS);
+  if (p != NULL && !OSSL_PARAM_set_octet_string(p, &st, sizeof(st)))
+    return 0;
+  return 1;
+}
+
 static void vc6_teardown(void *provctx) {
   // Cleanup global handle if initialized
 }
@@ -36,6 +152,8 @@ static void vc6_teardown(void *provctx) {
 static const OSSL_DISPATCH vc6_dispatch_table[] = {
     {OSSL_FUNC_PROVIDER_TEARDOWN, (void (*)(void))vc6_teardown},
     {OSSL_FUNC_PROVIDER_QUERY_OPERATION, (void (*)(void))vc6_query},
+    {OSSL_FUNC_PROVIDER_GETTABLE_PARAMS, (void (*)(void))vc6_gettable_params},
+    {OSSL_FUNC_PROVIDER_GET_PARAMS, (void (*)(void))vc6_get_params},
     {0, NULL}};
 
 /* The entry point */
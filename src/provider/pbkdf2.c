@@ -0,0 +1,306 @@
+// PBKDF2-SHA256 KDF: PBKDF2-HMAC-SHA256 (RFC 8018) with concurrent
+// derivations batched onto the GPU.
+// One derivation is serial and far faster on a CPU core than on one GPU
+// thread, but a burst of them (e.g. logins) is independent work. The first
+// derive() to arrive waits VC6_PBKDF2_WINDOW_US for others, then runs the
+// whole batch through vc6_pbkdf2_sha256_batch() (pbkdf2_sha256.comp) while
+// the other callers sleep. A derive with no other one in flight skips the
+// window and goes straight to the CPU. Batches below VC6_PBKDF2_GPU_MIN jobs, low
+// iteration counts and GPU failures fall back to the CPU in each caller's
+// own thread.
+// Registered as "PBKDF2-SHA256" rather than "PBKDF2": it only implements
+// SHA-256 and must not take over PBKDF2 fetches for other digests.
+// Usage: EVP_KDF_fetch(NULL, "PBKDF2-SHA256", "provider=vc6") with the
+// "pass", "salt" and "iter" params ("digest" may be set to SHA2-256).
+
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "../backend/vc6_backend.h"
+#include "../cpu/pbkdf2.h"
+#include "vc6_prov.h"
+
+#define VC6_PBKDF2_WINDOW_US 2000 // How long a batch collects requests
+#define VC6_PBKDF2_GPU_MIN 8      // Smaller batches run on the CPU
+#define VC6_PBKDF2_GPU_MIN_ITER 4096
+
+typedef struct {
+  unsigned char *pass;
+  size_t pass_len;
+  unsigned char *salt;
+  size_t salt_len;
+  uint64_t iter;
+} VC6_PBKDF2_CTX;
+
+// --- Batch collection (shared by all contexts) ---
+
+enum { VC6_REQ_QUEUED, VC6_REQ_DONE, VC6_REQ_CPU };
+
+typedef struct vc6_pbkdf2_req {
+  VC6_PBKDF2_JOB job;
+  int state;
+  uint64_t batch; // Trace id of the batch it ran in, 0 if none
+  struct vc6_pbkdf2_req *next;
+} VC6_PBKDF2_REQ;
+
+static pthread_mutex_t vc6_pbkdf2_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t vc6_pbkdf2_cond = PTHREAD_COND_INITIALIZER;
+static VC6_PBKDF2_REQ *vc6_pbkdf2_queue; // Batch being collected
+static VC6_PBKDF2_REQ **vc6_pbkdf2_tail = &vc6_pbkdf2_queue;
+static size_t vc6_pbkdf2_queued;
+static size_t vc6_pbkdf2_active; // Submitted derives not yet finished
+
+// Runs a collected batch on the GPU and marks each request done, or for
+// the CPU if the batch is too small or the GPU fails
+static void vc6_pbkdf2_run_batch(VC6_PBKDF2_REQ *batch, size_t count) {
+  VC6_PBKDF2_JOB *jobs = NULL;
+  VC6_PBKDF2_REQ *r;
+  void *backend;
+  int ok = 0;
+  size_t i = 0, bytes = 0;
+  uint64_t id = vc6_trace_batch_id(), start = vc6_trace_now();
+
+  if (count >= VC6_PBKDF2_GPU_MIN && (backend = vc6_get_backend()) != NULL &&
+      (jobs = OPENSSL_malloc(count * sizeof(*jobs))) != NULL) {
+    for (r = batch; r != NULL; r = r->next)
+      jobs[i++] = r->job;
+    ok = vc6_pbkdf2_sha256_batch(backend, jobs, count);
+    OPENSSL_free(jobs);
+  }
+
+  pthread_mutex_lock(&vc6_pbkdf2_lock);
+  for (r = batch; r != NULL; r = r->next) {
+    r->state = ok ? VC6_REQ_DONE : VC6_REQ_CPU;
+    r->batch = id;
+    bytes += r->job.out_len;
+  }
+  pthread_cond_broadcast(&vc6_pbkdf2_cond);
+  pthread_mutex_unlock(&vc6_pbkdf2_lock);
+  vc6_trace_span("PBKDF2 batch", start, bytes, id);
+}
+
+// Queues 'req' and returns once it is done (VC6_REQ_DONE) or handed back
+// for the CPU (VC6_REQ_CPU). The caller ends it with vc6_pbkdf2_finish().
+static int vc6_pbkdf2_submit(VC6_PBKDF2_REQ *req) {
+  VC6_PBKDF2_REQ *batch;
+  size_t count;
+  int leader;
+
+  req->state = VC6_REQ_QUEUED;
+  req->batch = 0;
+  req->next = NULL;
+
+  pthread_mutex_lock(&vc6_pbkdf2_lock);
+  if (vc6_pbkdf2_active++ == 0) {
+    // Nothing else in flight: a lone derive would only wait out the window
+    // to end up on the CPU anyway. It still counts as active, so a second
+    // one arriving meanwhile collects a batch.
+    pthread_mutex_unlock(&vc6_pbkdf2_lock);
+    return VC6_REQ_CPU;
+  }
+  leader = vc6_pbkdf2_queue == NULL;
+  *vc6_pbkdf2_tail = req;
+  vc6_pbkdf2_tail = &req->next;
+  vc6_pbkdf2_queued++;
+  pthread_mutex_unlock(&vc6_pbkdf2_lock);
+  vc6_trace_instant("PBKDF2 enqueue", req->job.out_len, 0);
+
+  if (leader) {
+    // The first request collects the batch; later arrivals start the next
+    usleep(VC6_PBKDF2_WINDOW_US);
+    pthread_mutex_lock(&vc6_pbkdf2_lock);
+    batch = vc6_pbkdf2_queue;
+    count = vc6_pbkdf2_queued;
+    vc6_pbkdf2_queue = NULL;
+    vc6_pbkdf2_tail = &vc6_pbkdf2_queue;
+    vc6_pbkdf2_queued = 0;
+    pthread_mutex_unlock(&vc6_pbkdf2_lock);
+    vc6_pbkdf2_run_batch(batch, count);
+  }
+
+  pthread_mutex_lock(&vc6_pbkdf2_lock);
+  while (req->state == VC6_REQ_QUEUED)
+    pthread_cond_wait(&vc6_pbkdf2_cond, &vc6_pbkdf2_lock);
+  pthread_mutex_unlock(&vc6_pbkdf2_lock);
+  vc6_trace_instant("PBKDF2 wake", req->job.out_len, req->batch);
+  return req->state;
+}
+
+// After the key of a submitted request is written
+static void vc6_pbkdf2_finish(void) {
+  pthread_mutex_lock(&vc6_pbkdf2_lock);
+  vc6_pbkdf2_active--;
+  pthread_mutex_unlock(&vc6_pbkdf2_lock);
+}
+
+// --- KDF dispatch ---
+
+static void *vc6_pbkdf2_newctx(void *provctx) {
+  VC6_PBKDF2_CTX *ctx;
+  (void)provctx;
+  ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx != NULL)
+    ctx->iter = 2048; // Same default as OpenSSL's PBKDF2
+  return ctx;
+}
+
+static void vc6_pbkdf2_reset(void *vctx) {
+  VC6_PBKDF2_CTX *ctx = (VC6_PBKDF2_CTX *)vctx;
+  OPENSSL_clear_free(ctx->pass, ctx->pass_len);
+  OPENSSL_clear_free(ctx->salt, ctx->salt_len);
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->iter = 2048;
+}
+
+static void vc6_pbkdf2_freectx(void *vctx) {
+  if (vctx == NULL)
+    return;
+  vc6_pbkdf2_reset(vctx);
+  OPENSSL_free(vctx);
+}
+
+static int vc6_pbkdf2_dup_buf(unsigned char **dst, const unsigned char *src,
+                              size_t len) {
+  *dst = NULL;
+  if (src == NULL)
+    return 1;
+  // One spare byte so empty buffers still allocate
+  *dst = OPENSSL_malloc(len + 1);
+  if (*dst == NULL)
+    return 0;
+  memcpy(*dst, src, len);
+  return 1;
+}
+
+static void *vc6_pbkdf2_dupctx(void *vctx) {
+  VC6_PBKDF2_CTX *src = (VC6_PBKDF2_CTX *)vctx;
+  VC6_PBKDF2_CTX *dup = OPENSSL_zalloc(sizeof(*dup));
+  if (dup == NULL)
+    return NULL;
+  dup->pass_len = src->pass_len;
+  dup->salt_len = src->salt_len;
+  dup->iter = src->iter;
+  if (!vc6_pbkdf2_dup_buf(&dup->pass, src->pass, src->pass_len) ||
+      !vc6_pbkdf2_dup_buf(&dup->salt, src->salt, src->salt_len)) {
+    vc6_pbkdf2_freectx(dup);
+    return NULL;
+  }
+  return dup;
+}
+
+static int vc6_pbkdf2_set_buf(unsigned char **buf, size_t *len,
+                              const OSSL_PARAM *p) {
+  OPENSSL_clear_free(*buf, *len);
+  *buf = NULL;
+  *len = 0;
+  // OSSL_PARAM_get_octet_string() allocates even for empty strings
+  return OSSL_PARAM_get_octet_string(p, (void **)buf, 0, len);
+}
+
+static int vc6_pbkdf2_set_ctx_params(void *vctx, const OSSL_PARAM params[]) {
+  VC6_PBKDF2_CTX *ctx = (VC6_PBKDF2_CTX *)vctx;
+  const OSSL_PARAM *p;
+
+  if (params == NULL)
+    return 1;
+  p = OSSL_PARAM_locate_const(params, OSSL_KDF_PARAM_PASSWORD);
+  if (p != NULL && !vc6_pbkdf2_set_buf(&ctx->pass, &ctx->pass_len, p))
+    return 0;
+  p = OSSL_PARAM_locate_const(params, OSSL_KDF_PARAM_SALT);
+  if (p != NULL && !vc6_pbkdf2_set_buf(&ctx->salt, &ctx->salt_len, p))
+    return 0;
+  p = OSSL_PARAM_locate_const(params, OSSL_KDF_PARAM_ITER);
+  if (p != NULL && (!OSSL_PARAM_get_uint64(p, &ctx->iter) || ctx->iter == 0))
+    return 0;
+  p = OSSL_PARAM_locate_const(params, OSSL_KDF_PARAM_DIGEST);
+  if (p != NULL) {
+    const char *md;
+    if (!OSSL_PARAM_get_utf8_string_ptr(p, &md) ||
+        (strcasecmp(md, "SHA2-256") != 0 && strcasecmp(md, "SHA256") != 0 &&
+         strcasecmp(md, "SHA-256") != 0))
+      return 0;
+  }
+  return 1;
+}
+
+static int vc6_pbkdf2_derive(void *vctx, unsigned char *key, size_t keylen,
+                             const OSSL_PARAM params[]) {
+  VC6_PBKDF2_CTX *ctx = (VC6_PBKDF2_CTX *)vctx;
+  VC6_PBKDF2_REQ req;
+  int submitted;
+  uint64_t start = vc6_trace_now();
+
+  if (!vc6_pbkdf2_set_ctx_params(ctx, params))
+    return 0;
+  if (ctx->pass == NULL || ctx->salt == NULL || keylen == 0)
+    return 0;
+
+  req.job.pass = ctx->pass;
+  req.job.pass_len = ctx->pass_len;
+  req.job.salt = ctx->salt;
+  req.job.salt_len = ctx->salt_len;
+  req.job.iterations = ctx->iter;
+  req.job.out = key;
+  req.job.out_len = keylen;
+  req.batch = 0;
+  submitted = ctx->iter >= VC6_PBKDF2_GPU_MIN_ITER;
+
+  if (!submitted || vc6_pbkdf2_submit(&req) != VC6_REQ_DONE) {
+    vc6_pbkdf2_sha256(key, keylen, ctx->pass, ctx->pass_len, ctx->salt,
+                      ctx->salt_len, ctx->iter);
+    vc6_stats_cpu(VC6_ALG_PBKDF2_SHA256, 1, keylen);
+  }
+  if (submitted)
+    vc6_pbkdf2_finish();
+  vc6_trace_span("PBKDF2 derive", start, keylen, req.batch);
+  return 1;
+}
+
+static const OSSL_PARAM vc6_pbkdf2_known_settable_ctx_params[] = {
+    OSSL_PARAM_octet_string(OSSL_KDF_PARAM_PASSWORD, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_KDF_PARAM_SALT, NULL, 0),
+    OSSL_PARAM_uint64(OSSL_KDF_PARAM_ITER, NULL),
+    OSSL_PARAM_utf8_string(OSSL_KDF_PARAM_DIGEST, NULL, 0),
+    OSSL_PARAM_utf8_string(OSSL_KDF_PARAM_PROPERTIES, NULL, 0),
+    OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_pbkdf2_settable_ctx_params(void *vctx,
+                                                        void *provctx) {
+  return vc6_pbkdf2_known_settable_ctx_params;
+}
+
+static int vc6_pbkdf2_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  OSSL_PARAM *p = OSSL_PARAM_locate(params, OSSL_KDF_PARAM_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, SIZE_MAX))
+    return 0;
+  return 1;
+}
+
+static const OSSL_PARAM vc6_pbkdf2_known_gettable_ctx_params[] = {
+    OSSL_PARAM_size_t(OSSL_KDF_PARAM_SIZE, NULL), OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_pbkdf2_gettable_ctx_params(void *vctx,
+                                                        void *provctx) {
+  return vc6_pbkdf2_known_gettable_ctx_params;
+}
+
+const OSSL_DISPATCH vc6_pbkdf2_sha256_functions[] = {
+    {OSSL_FUNC_KDF_NEWCTX, (void (*)(void))vc6_pbkdf2_newctx},
+    {OSSL_FUNC_KDF_DUPCTX, (void (*)(void))vc6_pbkdf2_dupctx},
+    {OSSL_FUNC_KDF_FREECTX, (void (*)(void))vc6_pbkdf2_freectx},
+    {OSSL_FUNC_KDF_RESET, (void (*)(void))vc6_pbkdf2_reset},
+    {OSSL_FUNC_KDF_DERIVE, (void (*)(void))vc6_pbkdf2_derive},
+    {OSSL_FUNC_KDF_SETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_pbkdf2_settable_ctx_params},
+    {OSSL_FUNC_KDF_SET_CTX_PARAMS, (void (*)(void))vc6_pbkdf2_set_ctx_params},
+    {OSSL_FUNC_KDF_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_pbkdf2_gettable_ctx_params},
+    {OSSL_FUNC_KDF_GET_CTX_PARAMS, (void (*)(void))vc6_pbkdf2_get_ctx_params},
+    {0, NULL}};
@@ -0,0 +1,389 @@
+// CHACHA20-DRBG: a ChaCha20 DRBG whose output is generated on the GPU in
+// large batches.
+// The state is a 32-byte key. Each refill runs chacha20.comp from block 1
+// into a pool of VC6_DRBG_POOL bytes; block 0 (computed on the CPU) becomes
+// the next key ("fast key erasure"). Served pool bytes are wiped at once,
+// so the state never holds anything that reproduces earlier output. The
+// backend wipes the key and the batch from its shared params slots and
+// rings after each refill; without a GPU the pool is filled by the CPU
+// ChaCha20 kernel instead.
+// Seed material comes from the parent DRBG and is mixed into the key with
+// SHA-256: K = SHA-256(K || seed || additional input).
+// A forked child inherits the key and the unserved pool, so generate()
+// compares getpid() with the pid of the last parent seeding and, in a new
+// process, drops the pool and reseeds before serving anything.
+// Usage: RAND_set_DRBG_type(libctx, "CHACHA20-DRBG", "provider=vc6", NULL,
+// NULL), or "random = CHACHA20-DRBG" in the [random] section of the config.
+
+// SHA256_Init/Update/Final for the seed mix (no fetch from inside a RAND)
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/sha.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../backend/vc6_backend.h"
+#include "../cpu/chacha20.h"
+#include "vc6_prov.h"
+
+#define VC6_DRBG_STRENGTH 256
+#define VC6_DRBG_SEED_LEN 48        // 384 bits from the parent per (re)seed
+#define VC6_DRBG_POOL (1024 * 1024) // Bytes per GPU refill
+#define VC6_DRBG_MAX_REQUEST VC6_DRBG_POOL
+#define VC6_DRBG_RESEED_INTERVAL (1 << 16) // generate() calls
+
+typedef struct {
+  void *parent;
+  OSSL_FUNC_rand_get_seed_fn *parent_get_seed;
+  OSSL_FUNC_rand_clear_seed_fn *parent_clear_seed;
+  OSSL_FUNC_rand_generate_fn *parent_generate;
+  OSSL_FUNC_rand_lock_fn *parent_lock;
+  OSSL_FUNC_rand_unlock_fn *parent_unlock;
+
+  CRYPTO_RWLOCK *lock;
+  int state; // EVP_RAND_STATE_*
+  unsigned char key[32];
+  unsigned char *pool; // Unserved output is pool[pos, VC6_DRBG_POOL)
+  size_t pos;
+  unsigned int generate_count; // Since the last (re)seed
+  pid_t pid;                   // Process of the last seeding from the parent
+} VC6_DRBG;
+
+static void *vc6_drbg_newctx(void *provctx, void *parent,
+                             const OSSL_DISPATCH *parent_calls) {
+  VC6_DRBG *ctx;
+  (void)provctx;
+
+  ctx = OPENSSL_zalloc(sizeof(*ctx));
+  if (ctx == NULL)
+    return NULL;
+  ctx->pool = OPENSSL_secure_malloc(VC6_DRBG_POOL);
+  if (ctx->pool == NULL) {
+    OPENSSL_free(ctx);
+    return NULL;
+  }
+  ctx->pos = VC6_DRBG_POOL;
+  ctx->state = EVP_RAND_STATE_UNINITIALISED;
+
+  ctx->parent = parent;
+  for (; parent_calls != NULL && parent_calls->function_id != 0;
+       parent_calls++) {
+    switch (parent_calls->function_id) {
+    case OSSL_FUNC_RAND_GET_SEED:
+      ctx->parent_get_seed = OSSL_FUNC_rand_get_seed(parent_calls);
+      break;
+    case OSSL_FUNC_RAND_CLEAR_SEED:
+      ctx->parent_clear_seed = OSSL_FUNC_rand_clear_seed(parent_calls);
+      break;
+    case OSSL_FUNC_RAND_GENERATE:
+      ctx->parent_generate = OSSL_FUNC_rand_generate(parent_calls);
+      break;
+    case OSSL_FUNC_RAND_LOCK:
+      ctx->parent_lock = OSSL_FUNC_rand_lock(parent_calls);
+      break;
+    case OSSL_FUNC_RAND_UNLOCK:
+      ctx->parent_unlock = OSSL_FUNC_rand_unlock(parent_calls);
+      break;
+    }
+  }
+  return ctx;
+}
+
+static void vc6_drbg_wipe(VC6_DRBG *ctx) {
+  OPENSSL_cleanse(ctx->key, sizeof(ctx->key));
+  OPENSSL_cleanse(ctx->pool, VC6_DRBG_POOL);
+  ctx->pos = VC6_DRBG_POOL;
+}
+
+static void vc6_drbg_freectx(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  if (ctx == NULL)
+    return;
+  vc6_drbg_wipe(ctx);
+  OPENSSL_secure_free(ctx->pool);
+  CRYPTO_THREAD_lock_free(ctx->lock);
+  OPENSSL_clear_free(ctx, sizeof(*ctx));
+}
+
+// VC6_DRBG_SEED_LEN bytes of seed from the parent; 1 on success
+static int vc6_drbg_get_seed(VC6_DRBG *ctx, unsigned char *seed,
+                             int prediction_resistance,
+                             const unsigned char *adin, size_t adin_len) {
+  int ok = 0;
+
+  if (ctx->parent == NULL)
+    return 0;
+  if (ctx->parent_lock != NULL && !ctx->parent_lock(ctx->parent))
+    return 0;
+
+  if (ctx->parent_get_seed != NULL) {
+    unsigned char *p = NULL;
+    size_t n = ctx->parent_get_seed(ctx->parent, &p, VC6_DRBG_STRENGTH,
+                                    VC6_DRBG_SEED_LEN, VC6_DRBG_SEED_LEN,
+                                    prediction_resistance, adin, adin_len);
+    if (n == VC6_DRBG_SEED_LEN) {
+      memcpy(seed, p, n);
+      ok = 1;
+    }
+    if (p != NULL && ctx->parent_clear_seed != NULL)
+      ctx->parent_clear_seed(ctx->parent, p, n);
+  } else if (ctx->parent_generate != NULL) {
+    ok = ctx->parent_generate(ctx->parent, seed, VC6_DRBG_SEED_LEN,
+                              VC6_DRBG_STRENGTH, prediction_resistance, adin,
+                              adin_len);
+  }
+
+  if (ctx->parent_unlock != NULL)
+    ctx->parent_unlock(ctx->parent);
+  return ok;
+}
+
+// K = SHA-256(K || a || b); unserved output from the old key is dropped
+static void vc6_drbg_mix(VC6_DRBG *ctx, const unsigned char *a, size_t a_len,
+                         const unsigned char *b, size_t b_len) {
+  SHA256_CTX sha;
+  SHA256_Init(&sha);
+  SHA256_Update(&sha, ctx->key, sizeof(ctx->key));
+  if (a_len > 0)
+    SHA256_Update(&sha, a, a_len);
+  if (b_len > 0)
+    SHA256_Update(&sha, b, b_len);
+  SHA256_Final(ctx->key, &sha);
+  OPENSSL_cleanse(&sha, sizeof(sha));
+
+  OPENSSL_cleanse(ctx->pool, VC6_DRBG_POOL);
+  ctx->pos = VC6_DRBG_POOL;
+}
+
+// Next batch: pool = ChaCha20(K) blocks 1 .. on the GPU, K = block 0.
+// Without a GPU (or when it refuses the job) the same stream comes from
+// the CPU kernel.
+static int vc6_drbg_refill(VC6_DRBG *ctx) {
+  static const unsigned char nonce[12] = {0};
+  unsigned char iv[16] = {1, 0, 0, 0}; // Counter 1 || nonce 0
+  unsigned char block0[64];
+  void *backend = vc6_get_backend();
+  uint64_t start = vc6_trace_now();
+
+  if (backend == NULL ||
+      !vc6_submit_keystream(backend, ctx->pool, VC6_DRBG_POOL, ctx->key, iv,
+                            VC6_ALG_CHACHA20))
+    vc6_chacha_cpu(NULL, ctx->pool, VC6_DRBG_POOL, ctx->key, iv, 0,
+                   VC6_ALG_CHACHA20);
+  vc6_trace_span("DRBG refill", start, VC6_DRBG_POOL, 0);
+  vc6_chacha20_block(block0, ctx->key, 0, nonce);
+  memcpy(ctx->key, block0, sizeof(ctx->key));
+  OPENSSL_cleanse(block0, sizeof(block0));
+  ctx->pos = 0;
+  return 1;
+}
+
+static int vc6_drbg_reseed(void *vctx, int prediction_resistance,
+                           const unsigned char *ent, size_t ent_len,
+                           const unsigned char *addin, size_t addin_len) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  unsigned char seed[VC6_DRBG_SEED_LEN];
+
+  if (ctx->state == EVP_RAND_STATE_UNINITIALISED)
+    return 0;
+  if (ent != NULL) {
+    // Caller-supplied entropy (e.g. RAND_add()) replaces the parent's
+    vc6_drbg_mix(ctx, ent, ent_len, addin, addin_len);
+  } else {
+    if (!vc6_drbg_get_seed(ctx, seed, prediction_resistance, addin,
+                           addin_len)) {
+      ctx->state = EVP_RAND_STATE_ERROR;
+      return 0;
+    }
+    vc6_drbg_mix(ctx, seed, sizeof(seed), addin, addin_len);
+    OPENSSL_cleanse(seed, sizeof(seed));
+    ctx->pid = getpid();
+  }
+  ctx->generate_count = 0;
+  ctx->state = EVP_RAND_STATE_READY;
+  return 1;
+}
+
+static int vc6_drbg_instantiate(void *vctx, unsigned int strength,
+                                int prediction_resistance,
+                                const unsigned char *pstr, size_t pstr_len,
+                                const OSSL_PARAM params[]) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  unsigned char seed[VC6_DRBG_SEED_LEN];
+  (void)params;
+
+  if (strength > VC6_DRBG_STRENGTH)
+    return 0;
+  vc6_drbg_wipe(ctx);
+  if (!vc6_drbg_get_seed(ctx, seed, prediction_resistance, pstr, pstr_len)) {
+    ctx->state = EVP_RAND_STATE_ERROR;
+    return 0;
+  }
+  vc6_drbg_mix(ctx, seed, sizeof(seed), pstr, pstr_len);
+  OPENSSL_cleanse(seed, sizeof(seed));
+  ctx->pid = getpid();
+  ctx->generate_count = 0;
+  ctx->state = EVP_RAND_STATE_READY;
+  return 1;
+}
+
+static int vc6_drbg_uninstantiate(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  vc6_drbg_wipe(ctx);
+  ctx->state = EVP_RAND_STATE_UNINITIALISED;
+  return 1;
+}
+
+static int vc6_drbg_generate(void *vctx, unsigned char *out, size_t outlen,
+                             unsigned int strength, int prediction_resistance,
+                             const unsigned char *addin, size_t addin_len) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  int forked;
+
+  if (ctx->state != EVP_RAND_STATE_READY || strength > VC6_DRBG_STRENGTH ||
+      outlen > VC6_DRBG_MAX_REQUEST)
+    return 0;
+
+  // Forked: the parent may serve the same pool and key, so neither is used
+  forked = ctx->pid != getpid();
+  if (forked) {
+    OPENSSL_cleanse(ctx->pool, VC6_DRBG_POOL);
+    ctx->pos = VC6_DRBG_POOL;
+  }
+  if (forked || prediction_resistance ||
+      ctx->generate_count >= VC6_DRBG_RESEED_INTERVAL) {
+    if (!vc6_drbg_reseed(ctx, prediction_resistance, NULL, 0, addin,
+                         addin_len))
+      return 0;
+  } else if (addin_len > 0) {
+    vc6_drbg_mix(ctx, addin, addin_len, NULL, 0);
+  }
+  ctx->generate_count++;
+
+  while (outlen > 0) {
+    size_t n = VC6_DRBG_POOL - ctx->pos;
+    if (n == 0) {
+      if (!vc6_drbg_refill(ctx)) {
+        ctx->state = EVP_RAND_STATE_ERROR;
+        return 0;
+      }
+      n = VC6_DRBG_POOL;
+    }
+    if (n > outlen)
+      n = outlen;
+    memcpy(out, ctx->pool + ctx->pos, n);
+    OPENSSL_cleanse(ctx->pool + ctx->pos, n);
+    ctx->pos += n;
+    out += n;
+    outlen -= n;
+  }
+  return 1;
+}
+
+// Lets other DRBGs use this one as their parent
+static size_t vc6_drbg_get_seed_out(void *vctx, unsigned char **buffer,
+                                    int entropy, size_t min_len,
+                                    size_t max_len, int prediction_resistance,
+                                    const unsigned char *adin,
+                                    size_t adin_len) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  unsigned char *p;
+  (void)max_len;
+
+  if (entropy > VC6_DRBG_STRENGTH || min_len > VC6_DRBG_MAX_REQUEST)
+    return 0;
+  p = OPENSSL_secure_malloc(min_len);
+  if (p == NULL)
+    return 0;
+  if (!vc6_drbg_generate(ctx, p, min_len, (unsigned int)entropy,
+                         prediction_resistance, adin, adin_len)) {
+    OPENSSL_secure_clear_free(p, min_len);
+    return 0;
+  }
+  *buffer = p;
+  return min_len;
+}
+
+static void vc6_drbg_clear_seed(void *vctx, unsigned char *buffer,
+                                size_t b_len) {
+  (void)vctx;
+  OPENSSL_secure_clear_free(buffer, b_len);
+}
+
+static int vc6_drbg_enable_locking(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  if (ctx->lock == NULL)
+    ctx->lock = CRYPTO_THREAD_lock_new();
+  return ctx->lock != NULL;
+}
+
+static int vc6_drbg_lock(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  return ctx->lock == NULL || CRYPTO_THREAD_write_lock(ctx->lock);
+}
+
+static void vc6_drbg_unlock(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  if (ctx->lock != NULL)
+    CRYPTO_THREAD_unlock(ctx->lock);
+}
+
+static int vc6_drbg_get_ctx_params(void *vctx, OSSL_PARAM params[]) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_RAND_PARAM_STATE);
+  if (p != NULL && !OSSL_PARAM_set_int(p, ctx->state))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_RAND_PARAM_STRENGTH);
+  if (p != NULL && !OSSL_PARAM_set_uint(p, VC6_DRBG_STRENGTH))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_RAND_PARAM_MAX_REQUEST);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, VC6_DRBG_MAX_REQUEST))
+    return 0;
+  return 1;
+}
+
+static const OSSL_PARAM vc6_drbg_known_gettable_ctx_params[] = {
+    OSSL_PARAM_int(OSSL_RAND_PARAM_STATE, NULL),
+    OSSL_PARAM_uint(OSSL_RAND_PARAM_STRENGTH, NULL),
+    OSSL_PARAM_size_t(OSSL_RAND_PARAM_MAX_REQUEST, NULL), OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_drbg_gettable_ctx_params(void *vctx,
+                                                      void *provctx) {
+  return vc6_drbg_known_gettable_ctx_params;
+}
+
+static int vc6_drbg_verify_zeroization(void *vctx) {
+  VC6_DRBG *ctx = (VC6_DRBG *)vctx;
+  size_t i;
+  if (ctx->state != EVP_RAND_STATE_UNINITIALISED)
+    return 0;
+  for (i = 0; i < sizeof(ctx->key); i++)
+    if (ctx->key[i] != 0)
+      return 0;
+  return 1;
+}
+
+const OSSL_DISPATCH vc6_chacha20_drbg_functions[] = {
+    {OSSL_FUNC_RAND_NEWCTX, (void (*)(void))vc6_drbg_newctx},
+    {OSSL_FUNC_RAND_FREECTX, (void (*)(void))vc6_drbg_freectx},
+    {OSSL_FUNC_RAND_INSTANTIATE, (void (*)(void))vc6_drbg_instantiate},
+    {OSSL_FUNC_RAND_UNINSTANTIATE, (void (*)(void))vc6_drbg_uninstantiate},
+    {OSSL_FUNC_RAND_GENERATE, (void (*)(void))vc6_drbg_generate},
+    {OSSL_FUNC_RAND_RESEED, (void (*)(void))vc6_drbg_reseed},
+    {OSSL_FUNC_RAND_ENABLE_LOCKING, (void (*)(void))vc6_drbg_enable_locking},
+    {OSSL_FUNC_RAND_LOCK, (void (*)(void))vc6_drbg_lock},
+    {OSSL_FUNC_RAND_UNLOCK, (void (*)(void))vc6_drbg_unlock},
+    {OSSL_FUNC_RAND_GET_SEED, (void (*)(void))vc6_drbg_get_seed_out},
+    {OSSL_FUNC_RAND_CLEAR_SEED, (void (*)(void))vc6_drbg_clear_seed},
+    {OSSL_FUNC_RAND_GET_CTX_PARAMS, (void (*)(void))vc6_drbg_get_ctx_params},
+    {OSSL_FUNC_RAND_GETTABLE_CTX_PARAMS,
+     (void (*)(void))vc6_drbg_gettable_ctx_params},
+    {OSSL_FUNC_RAND_VERIFY_ZEROIZATION,
+     (void (*)(void))vc6_drbg_verify_zeroization},
+    {0, NULL}};
@@ -0,0 +1,92 @@
+// SHA2-256 digest
+// A single stream is hashed on the CPU: SHA-256 is sequential within a
+// message and one GPU thread is far slower than a CPU core. The GPU is used
+// for many independent messages at once through the backend's
+// vc6_sha256_batch() (sha256.comp).
+// Registered as VC6-SHA2-256 only: it adds nothing over the default
+// provider's SHA2-256 for one stream, so it must not answer fetches for the
+// standard names or the OID.
+
+// SHA256_Init/Update/Final: no fetch from inside the provider
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+#include <openssl/sha.h>
+#include <string.h>
+
+static void *vc6_sha256_newctx(void *provctx) {
+  (void)provctx;
+  return OPENSSL_zalloc(sizeof(SHA256_CTX));
+}
+
+static void vc6_sha256_freectx(void *vctx) {
+  OPENSSL_clear_free(vctx, sizeof(SHA256_CTX));
+}
+
+static void *vc6_sha256_dupctx(void *vctx) {
+  SHA256_CTX *dup = OPENSSL_malloc(sizeof(*dup));
+  if (dup != NULL)
+    memcpy(dup, vctx, sizeof(*dup));
+  return dup;
+}
+
+static int vc6_sha256_init(void *vctx, const OSSL_PARAM params[]) {
+  (void)params;
+  return SHA256_Init((SHA256_CTX *)vctx);
+}
+
+static int vc6_sha256_update(void *vctx, const unsigned char *in,
+                             size_t inl) {
+  return SHA256_Update((SHA256_CTX *)vctx, in, inl);
+}
+
+static int vc6_sha256_final(void *vctx, unsigned char *out, size_t *outl,
+                            size_t outsz) {
+  if (outsz < SHA256_DIGEST_LENGTH ||
+      !SHA256_Final(out, (SHA256_CTX *)vctx))
+    return 0;
+  *outl = SHA256_DIGEST_LENGTH;
+  return 1;
+}
+
+static int vc6_sha256_get_params(OSSL_PARAM params[]) {
+  OSSL_PARAM *p;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_BLOCK_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, SHA256_CBLOCK))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_SIZE);
+  if (p != NULL && !OSSL_PARAM_set_size_t(p, SHA256_DIGEST_LENGTH))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_XOF);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 0))
+    return 0;
+  p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_ALGID_ABSENT);
+  if (p != NULL && !OSSL_PARAM_set_int(p, 1))
+    return 0;
+  return 1;
+}
+
+static const OSSL_PARAM vc6_sha256_known_gettable_params[] = {
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_BLOCK_SIZE, NULL),
+    OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_SIZE, NULL),
+    OSSL_PARAM_int(OSSL_DIGEST_PARAM_XOF, NULL),
+    OSSL_PARAM_int(OSSL_DIGEST_PARAM_ALGID_ABSENT, NULL), OSSL_PARAM_END};
+
+static const OSSL_PARAM *vc6_sha256_gettable_params(void *provctx) {
+  return vc6_sha256_known_gettable_params;
+}
+
+const OSSL_DISPATCH vc6_sha256_functions[] = {
+    {OSSL_FUNC_DIGEST_NEWCTX, (void (*)(void))vc6_sha256_newctx},
+    {OSSL_FUNC_DIGEST_FREECTX, (void (*)(void))vc6_sha256_freectx},
+    {OSSL_FUNC_DIGEST_DUPCTX, (void (*)(void))vc6_sha256_dupctx},
+    {OSSL_FUNC_DIGEST_INIT, (void (*)(void))vc6_sha256_init},
+    {OSSL_FUNC_DIGEST_UPDATE, (void (*)(void))vc6_sha256_update},
+    {OSSL_FUNC_DIGEST_FINAL, (void (*)(void))vc6_sha256_final},
+    {OSSL_FUNC_DIGEST_GET_PARAMS, (void (*)(void))vc6_sha256_get_params},
+    {OSSL_FUNC_DIGEST_GETTABLE_PARAMS,
+     (void (*)(void))vc6_sha256_gettable_params},
+    {0, NULL}};
@@ -0,0 +1,47 @@
+#ifndef VC6_PROV_H
+#define VC6_PROV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Internal helpers shared by the provider's algorithm files
+
+// Provider-wide backend handle, created on first use (defined in ciphers.c)
+void *vc6_get_backend(void);
+
+// Runs the cipher update 'fn' inside a trace span 'name' (a literal) when
+// VC6_TRACE is set (defined in ciphers.c)
+typedef int (*VC6_CIPHER_UPDATE_FN)(void *vctx, unsigned char *out,
+                                    size_t *outl, size_t outsize,
+                                    const unsigned char *in, size_t inl);
+int vc6_trace_update(const char *name, VC6_CIPHER_UPDATE_FN fn, void *vctx,
+                     unsigned char *out, size_t *outl, size_t outsize,
+                     const unsigned char *in, size_t inl);
+
+// --- AEAD pipeline (aead.c) ---
+// A GPU stream-cipher pass overlapped chunk by chunk with a CPU MAC over
+// the ciphertext; the MAC consumes 16-byte blocks.
+typedef struct {
+  void *ctx;
+  // Cipher pass over message bytes [pos, pos + len); 1 on success
+  int (*crypt)(void *ctx, const unsigned char *in, unsigned char *out,
+               size_t len, uint64_t pos);
+  // MAC over whole 16-byte blocks; may run on a worker thread
+  void (*mac)(void *ctx, const unsigned char *in, size_t len);
+  unsigned char *buf; // MAC input short of a block
+  size_t *buf_len;
+} VC6_AEAD_PIPE;
+
+// Streams 'n' bytes into the MAC through the partial block buffer
+void vc6_aead_absorb(const VC6_AEAD_PIPE *pipe, const unsigned char *p,
+                     size_t n);
+
+// Zero-pads and MACs a pending partial block
+void vc6_aead_pad(const VC6_AEAD_PIPE *pipe);
+
+// Encrypts/decrypts 'len' bytes at message offset 'pos' and MACs the
+// ciphertext. Returns 1 on success, 0 on failure
+int vc6_aead_crypt(const VC6_AEAD_PIPE *pipe, const unsigned char *in,
+                   unsigned char *out, size_t len, uint64_t pos, int enc);
+
+#endif // VC6_PROV_H
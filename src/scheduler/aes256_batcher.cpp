@@ -1,4 +1,6 @@
 #include "aes256_batcher.hpp"
+#include "runtime_stats.hpp"
+#include "trace.hpp"
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -8,6 +10,7 @@
   fprintf(stderr, "[AES256] " fmt "\n", ##__VA_ARGS__)
 
 #define RING_SIZE 1024 * 1024 * 64 // 64MB Ring Buffer
+#define SETUP_OVERLAP_MIN (64 * 1024) // Params on a worker from this size
 
 // Standard AES S-Box
 static const uint8_t SBOX[256] = {
@@ -34,26 +37,31 @@ static const uint8_t SBOX[256] = {
     0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
     0xb0, 0x54, 0xbb, 0x16};
 
-AES256Batcher::AES256Batcher(VulkanContext *ctx) : ctx(ctx) {
+AES256Batcher::AES256Batcher(VulkanContext *ctx)
+    : ctx(ctx), staging(!ctx->isUnifiedMemory()),
+      gpuTimer(ctx->getDevice(), ctx->getPhysicalDevice(),
+                         ctx->getComputeQueueFamilyIndex()) {
   DEBUG_PRINT("Initializing AES-256 Batcher...");
 
-  // Create dedicated ring buffers
-  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
-               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               inputRing.buffer, inputRing.memory);
-
-  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
-               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               outputRing.buffer, outputRing.memory);
-
-  vkMapMemory(ctx->getDevice(), inputRing.memory, 0, RING_SIZE, 0,
-              &inputRing.mappedUrl);
-  vkMapMemory(ctx->getDevice(), outputRing.memory, 0, RING_SIZE, 0,
-              &outputRing.mappedUrl);
+  // Create dedicated ring buffers, ranked like the Batcher's
+  createRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 (staging ? VK_BUFFER_USAGE_TRANSFER_SRC_BIT : 0),
+             RingUse::Upload, inputRing);
+  createRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 (staging ? VK_BUFFER_USAGE_TRANSFER_DST_BIT : 0),
+             RingUse::Readback, outputRing);
+  if (staging) {
+    createDeviceRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     deviceInput);
+    createDeviceRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     deviceOutput);
+  }
 
   // Create dedicated param buffer (4KB for params)
   createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), 4096,
@@ -85,24 +93,28 @@ AES256Batcher::~AES256Batcher() {
   vkFreeMemory(ctx->getDevice(), inputRing.memory, nullptr);
   vkDestroyBuffer(ctx->getDevice(), outputRing.buffer, nullptr);
   vkFreeMemory(ctx->getDevice(), outputRing.memory, nullptr);
+  vkDestroyBuffer(ctx->getDevice(), deviceInput.buffer, nullptr);
+  vkFreeMemory(ctx->getDevice(), deviceInput.memory, nullptr);
+  vkDestroyBuffer(ctx->getDevice(), deviceOutput.buffer, nullptr);
+  vkFreeMemory(ctx->getDevice(), deviceOutput.memory, nullptr);
 }
 
-bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
-                           size_t len, const unsigned char *key,
-                           const unsigned char *iv) {
-  if (len > RING_SIZE) {
-    DEBUG_PRINT("Error: len %zu > RING_SIZE", len);
-    return false;
-  }
-
-  // 1. Write input data
-  memcpy(inputRing.mappedUrl, in, len);
+bool AES256Batcher::busy() {
+  if (!submitMutex.try_lock())
+    return true;
+  submitMutex.unlock();
+  return false;
+}
 
-  // 2. Setup params - AES-256 Extended Layout
+// Caller holds submitMutex
+void AES256Batcher::writeParams(const unsigned char *key,
+                                const unsigned char *iv, size_t skip,
+                                size_t len) {
+  // AES-256 Extended Layout
   // Layout: batchSize@0, numRounds@4, padding[2]@8-16, RoundKey[60]@16-256
   // IV[4]@256-272, SBox[256]@272
   uint32_t *ubo = (uint32_t *)paramMappedPtr;
-  ubo[0] = (len + 15) / 16; // batchSize
+  ubo[0] = (skip + len + 15) / 16; // batchSize
   ubo[1] = 14;              // numRounds for AES-256
 
   // AES-256 Key Expansion (60 words)
@@ -137,6 +149,38 @@ bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
   for (int i = 0; i < 256; i++) {
     dstSBox[i] = (uint32_t)SBOX[i];
   }
+}
+
+bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
+                           size_t len, const unsigned char *key,
+                           const unsigned char *iv, size_t skip) {
+  if (skip >= 16 || skip + len > RING_SIZE) {
+    DEBUG_PRINT("Error: skip %zu + len %zu > RING_SIZE", skip, len);
+    return false;
+  }
+
+  StatsLock lock(submitMutex, len);
+  StageProfile::Clock::time_point t = StageProfile::Clock::now();
+
+  // 1. Input (after the discarded keystream prefix) and 2. params; the key
+  // expansion runs on a pool worker while a large input is copied
+  TaskPool &pool = TaskPool::instance();
+  TaskGroup setup;
+  if (len >= SETUP_OVERLAP_MIN)
+    pool.run(setup, [&] { writeParams(key, iv, skip, len); });
+  else
+    writeParams(key, iv, skip, len);
+  pool.copy((char *)inputRing.mappedUrl + skip, in, len,
+            inputRing.writeCombined());
+  setup.wait();
+  // Params are part of the upload: this path has no descriptors
+  profile.mark(StageProfile::COPY_IN, t);
+
+  VkMappedMemoryRange inRange = ringRange(inputRing, skip, len);
+  vkFlushMappedMemoryRanges(ctx->getDevice(), 1, &inRange);
+  profile.mark(StageProfile::FLUSH, t);
+
+  RuntimeStats::instance().dispatch(skip + len, skip + len);
 
   // 3. Record and submit command buffer
   vkResetCommandBuffer(commandBuffer, 0);
@@ -146,35 +190,72 @@ bool AES256Batcher::submit(const unsigned char *in, unsigned char *out,
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
+  gpuTimer.begin(commandBuffer);
+  if (staging) {
+    cmdCopyRange(commandBuffer, inputRing, deviceInput, 0, skip + len);
+    cmdBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_ACCESS_SHADER_READ_BIT);
+  }
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
                           pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 
-  uint32_t blocks = (len + 15) / 16;
+  uint32_t blocks = (skip + len + 15) / 16;
   uint32_t groupCount = (blocks + 255) / 256;
   if (groupCount == 0)
     groupCount = 1;
 
   vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+  if (staging) {
+    cmdBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_READ_BIT);
+    cmdCopyRange(commandBuffer, deviceOutput, outputRing, 0, skip + len);
+    cmdBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+               VK_ACCESS_HOST_READ_BIT);
+  }
+  gpuTimer.end(commandBuffer);
   vkEndCommandBuffer(commandBuffer);
+  profile.mark(StageProfile::RECORD, t);
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
+  uint64_t batch = Trace::nextBatch();
+  uint64_t submitted = Trace::now();
   vkResetFences(ctx->getDevice(), 1, &computeFence);
-  VkResult res =
-      vkQueueSubmit(ctx->getComputeQueue(), 1, &submitInfo, computeFence);
+  VkResult res = ctx->submitCompute(submitInfo, computeFence);
   if (res != VK_SUCCESS) {
     DEBUG_PRINT("vkQueueSubmit failed: %d", res);
     return false;
   }
+  profile.mark(StageProfile::SUBMIT, t);
+
+  res = vkWaitForFences(ctx->getDevice(), 1, &computeFence, VK_TRUE,
+                        UINT64_MAX);
+  if (res != VK_SUCCESS) {
+    DEBUG_PRINT("vkWaitForFences failed: %d", res);
+    return false;
+  }
+  VkMappedMemoryRange outRange = ringRange(outputRing, skip, len);
+  vkInvalidateMappedMemoryRanges(ctx->getDevice(), 1, &outRange);
+  profile.mark(StageProfile::WAIT, t);
+  Trace::span("aes256", "dispatch", submitted, skip + len, batch);
 
-  vkWaitForFences(ctx->getDevice(), 1, &computeFence, UINT64_MAX, UINT64_MAX);
+  uint64_t gpuNs;
+  if (gpuTimer.read(&gpuNs))
+    profile.record(StageProfile::GPU, gpuNs);
 
   // 4. Copy output
-  memcpy(out, outputRing.mappedUrl, len);
+  t = StageProfile::Clock::now();
+  pool.copy(out, (char *)outputRing.mappedUrl + skip, len);
+  profile.mark(StageProfile::COPY_OUT, t);
+  RuntimeStats::instance().gpu(VC6_ALG_AES256_CTR, 1, len);
   return true;
 }
 
@@ -254,10 +335,10 @@ void AES256Batcher::createDescriptors() {
 
   // Update descriptor set
   VkDescriptorBufferInfo bufInfo[3] = {};
-  bufInfo[0].buffer = inputRing.buffer;
+  bufInfo[0].buffer = staging ? deviceInput.buffer : inputRing.buffer;
   bufInfo[0].offset = 0;
   bufInfo[0].range = VK_WHOLE_SIZE;
-  bufInfo[1].buffer = outputRing.buffer;
+  bufInfo[1].buffer = staging ? deviceOutput.buffer : outputRing.buffer;
   bufInfo[1].offset = 0;
   bufInfo[1].range = VK_WHOLE_SIZE;
   bufInfo[2].buffer = paramBuffer;
@@ -2,6 +2,9 @@
 
 #include "../backend/memory.hpp"
 #include "../backend/vulkan_ctx.hpp"
+#include "stage_profile.hpp"
+#include "task_pool.hpp"
+#include <mutex>
 #include <vector>
 
 /**
@@ -9,20 +12,36 @@
  *
  * Completely independent implementation with its own Vulkan resources.
  * Uses Extended Layout: IV@256, SBox@272
+ *
+ * submit() is thread-safe: concurrent callers are serialized on submitMutex.
  */
 class AES256Batcher {
 public:
   AES256Batcher(VulkanContext *ctx);
   ~AES256Batcher();
 
+  // 'skip' keystream bytes (< 16) are discarded before 'in'
   bool submit(const unsigned char *in, unsigned char *out, size_t len,
-              const unsigned char *key, const unsigned char *iv);
+              const unsigned char *key, const unsigned char *iv,
+              size_t skip = 0);
+
+  // True while another submit holds the rings (a routing hint only)
+  bool busy();
+
+  // Per-stage latency of every submit since construction or reset()
+  StageProfile &stageProfile() { return profile; }
 
 private:
   VulkanContext *ctx;
   RingBuffer inputRing;
   RingBuffer outputRing;
 
+  // Non-unified memory: the shader runs on these device-local copies and
+  // the rings above stage (see Batcher)
+  bool staging;
+  RingBuffer deviceInput{};
+  RingBuffer deviceOutput{};
+
   // Vulkan Objects (dedicated to AES-256)
   VkPipeline pipeline;
   VkPipelineLayout pipelineLayout;
@@ -33,11 +52,20 @@ private:
   VkCommandBuffer commandBuffer;
   VkFence computeFence;
 
+  std::mutex submitMutex;
+
+  StageProfile profile;
+  GpuTimer gpuTimer;
+
   // Parameter Buffer
   VkBuffer paramBuffer;
   VkDeviceMemory paramMemory;
   void *paramMappedPtr;
 
+  // Key expansion and the params buffer for one submit()
+  void writeParams(const unsigned char *key, const unsigned char *iv,
+                   size_t skip, size_t len);
+
   void createPipeline();
   void createDescriptors();
   void createCommandBuffer();
@@ -1,43 +1,60 @@
 #include "batcher.hpp"
+#include "runtime_stats.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <openssl/aes.h>
 #include <vector>
 
 #define DEBUG_PRINT(fmt, ...) fprintf(stderr, "[VC6] " fmt "\n", ##__VA_ARGS__)
 
 #define RING_SIZE 1024 * 1024 * 64 // 64MB Ring Buffer (Total = 128MB allocated)
-
-Batcher::Batcher(VulkanContext *ctx) : ctx(ctx), running(true) {
-  // 1. Create Ring Buffers (Zero Copy)
-  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
-               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               inputRing.buffer, inputRing.memory);
-
-  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
-               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               outputRing.buffer, outputRing.memory);
-
-  // Map memory
-  vkMapMemory(ctx->getDevice(), inputRing.memory, 0, RING_SIZE, 0,
-              &inputRing.mappedUrl);
-  vkMapMemory(ctx->getDevice(), outputRing.memory, 0, RING_SIZE, 0,
-              &outputRing.mappedUrl);
+#define PARAM_SIZE 8192 // Largest layout: AES-256-GCM with H powers (5392)
+#define SETUP_OVERLAP_MIN (64 * 1024) // Params on a worker from this size
+// Staged jobs are pipelined in slices of this size (whole ChaCha blocks)
+#define STAGING_SLICE (4 * 1024 * 1024)
+#define STAGING_SLICES (RING_SIZE / STAGING_SLICE) // Also params slots
+
+Batcher::Batcher(VulkanContext *ctx)
+    : ctx(ctx), staging(!ctx->isUnifiedMemory()),
+      gpuTimer(ctx->getDevice(), ctx->getPhysicalDevice(),
+               ctx->getComputeQueueFamilyIndex()) {
+  // 1. Create Ring Buffers (Zero Copy), mapped; the input ring in coherent
+  // write-combined memory, the output ring in cached memory if there is any
+  createRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 (staging ? VK_BUFFER_USAGE_TRANSFER_SRC_BIT : 0),
+             RingUse::Upload, inputRing);
+  createRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 (staging ? VK_BUFFER_USAGE_TRANSFER_DST_BIT : 0),
+             RingUse::Readback, outputRing);
+  DEBUG_PRINT("Ring memory: input 0x%x, output 0x%x", inputRing.flags,
+              outputRing.flags);
+  if (staging) {
+    // Discrete GPU: compute in VRAM, the mapped rings stage
+    createDeviceRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     deviceInput);
+    createDeviceRing(ctx->getDevice(), ctx->getPhysicalDevice(), RING_SIZE,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     deviceOutput);
+  }
 
   // 2. Setup Pipeline Params BUFFER (SSBO)
-  // Usage: STORAGE_BUFFER
-  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), 4096,
+  // Usage: STORAGE_BUFFER. One slot per slice of a staged job.
+  size_t paramBytes = PARAM_SIZE * (staging ? STAGING_SLICES : 1);
+  createBuffer(ctx->getDevice(), ctx->getPhysicalDevice(), paramBytes,
                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                paramBuffer, paramMemory);
   DEBUG_PRINT("Mapping Memory...");
-  vkMapMemory(ctx->getDevice(), paramMemory, 0, 4096, 0, &paramMappedUrl);
+  vkMapMemory(ctx->getDevice(), paramMemory, 0, paramBytes, 0,
+              &paramMappedUrl);
 
   // Upload S-Box (Standard FIPS 197) to Offset 256 (64 uints)
   static const uint32_t sboxTbl[256] = {
@@ -83,16 +100,16 @@ Batcher::Batcher(VulkanContext *ctx) : ctx(ctx), running(true) {
 }
 
 Batcher::~Batcher() {
-  running = false;
-  if (workerThread.joinable())
-    workerThread.join();
-
   vkDestroyFence(ctx->getDevice(), computeFence, nullptr);
 
   for (auto p : pipelines) {
     if (p != VK_NULL_HANDLE)
       vkDestroyPipeline(ctx->getDevice(), p, nullptr);
   }
+  for (auto p : keystreamPipelines) {
+    if (p != VK_NULL_HANDLE)
+      vkDestroyPipeline(ctx->getDevice(), p, nullptr);
+  }
 
   vkDestroyPipelineLayout(ctx->getDevice(), pipelineLayout, nullptr);
   vkDestroyDescriptorPool(ctx->getDevice(), descriptorPool, nullptr);
@@ -105,89 +122,224 @@ Batcher::~Batcher() {
   vkFreeMemory(ctx->getDevice(), inputRing.memory, nullptr);
   vkDestroyBuffer(ctx->getDevice(), outputRing.buffer, nullptr);
   vkFreeMemory(ctx->getDevice(), outputRing.memory, nullptr);
+  vkDestroyBuffer(ctx->getDevice(), deviceInput.buffer, nullptr);
+  vkFreeMemory(ctx->getDevice(), deviceInput.memory, nullptr);
+  vkDestroyBuffer(ctx->getDevice(), deviceOutput.buffer, nullptr);
+  vkFreeMemory(ctx->getDevice(), deviceOutput.memory, nullptr);
+}
+
+// AES S-Box (FIPS 197), used for host-side key expansion
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16};
+
+// AES key expansion in the shader's word layout (little-endian words of
+// the key bytes). nk = key length in words (4 or 8); w gets 4 * (nk + 7).
+static void expandKey(const unsigned char *key, int nk, const uint8_t *sbox,
+                      uint32_t *w) {
+  static const uint8_t rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                                   0x20, 0x40, 0x80, 0x1b, 0x36};
+  int total = 4 * (nk + 7);
+  memcpy(w, key, nk * 4);
+  for (int i = nk; i < total; i++) {
+    uint32_t temp = w[i - 1];
+    if (i % nk == 0) {
+      temp = ((temp >> 8) | (temp << 24));
+      temp = (sbox[temp & 0xFF]) | (sbox[(temp >> 8) & 0xFF] << 8) |
+             (sbox[(temp >> 16) & 0xFF] << 16) |
+             (sbox[(temp >> 24) & 0xFF] << 24);
+      temp ^= rcon[(i / nk) - 1];
+    } else if (nk == 8 && i % 8 == 4) {
+      // AES-256 extra SubWord step
+      temp = (sbox[temp & 0xFF]) | (sbox[(temp >> 8) & 0xFF] << 8) |
+             (sbox[(temp >> 16) & 0xFF] << 16) |
+             (sbox[(temp >> 24) & 0xFF] << 24);
+    }
+    w[i] = w[i - nk] ^ temp;
+  }
+}
+
+static uint8_t xtime8(uint8_t x) {
+  return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+// InvMixColumns on one little-endian column word (decryption key schedule)
+static uint32_t invMixColumn(uint32_t c) {
+  uint8_t b[4] = {(uint8_t)c, (uint8_t)(c >> 8), (uint8_t)(c >> 16),
+                  (uint8_t)(c >> 24)};
+  uint8_t d[4];
+  for (int i = 0; i < 4; i++) {
+    // 14*b[i] ^ 11*b[i+1] ^ 13*b[i+2] ^ 9*b[i+3]
+    uint8_t a0 = b[i], a1 = b[(i + 1) & 3], a2 = b[(i + 2) & 3],
+            a3 = b[(i + 3) & 3];
+    uint8_t a0x2 = xtime8(a0), a0x4 = xtime8(a0x2), a0x8 = xtime8(a0x4);
+    uint8_t a1x2 = xtime8(a1), a1x4 = xtime8(a1x2), a1x8 = xtime8(a1x4);
+    uint8_t a2x2 = xtime8(a2), a2x4 = xtime8(a2x2), a2x8 = xtime8(a2x4);
+    uint8_t a3x2 = xtime8(a3), a3x4 = xtime8(a3x2), a3x8 = xtime8(a3x4);
+    d[i] = (a0x8 ^ a0x4 ^ a0x2) ^ (a1x8 ^ a1x2 ^ a1) ^ (a2x8 ^ a2x4 ^ a2) ^
+           (a3x8 ^ a3);
+  }
+  return d[0] | (d[1] << 8) | (d[2] << 16) | ((uint32_t)d[3] << 24);
 }
 
 bool Batcher::submit(const unsigned char *in, unsigned char *out, size_t len,
                      const unsigned char *key, const unsigned char *iv,
-                     Algorithm alg) {
+                     Algorithm alg, size_t skip) {
+  return run(in, out, len, key, iv, alg, skip, pipelines, false);
+}
 
-  if (len > RING_SIZE) {
-    DEBUG_PRINT("Error: len %zu > RING_SIZE", len);
-    return false;
+bool Batcher::busy() {
+  if (!submitMutex.try_lock())
+    return true;
+  submitMutex.unlock();
+  return false;
+}
+
+bool Batcher::keystream(unsigned char *out, size_t len,
+                        const unsigned char *key, const unsigned char *iv,
+                        Algorithm alg) {
+  return run(nullptr, out, len, key, iv, alg, 0, keystreamPipelines, true);
+}
+
+// Equivalent inverse cipher schedule for AES-256: reverse round order and
+// apply InvMixColumns to the inner round keys
+static void decryptionKeys(const uint32_t *w, uint32_t *dk) {
+  for (int r = 0; r <= 14; r++) {
+    for (int j = 0; j < 4; j++) {
+      uint32_t k = w[4 * (14 - r) + j];
+      dk[4 * r + j] = (r == 0 || r == 14) ? k : invMixColumn(k);
+    }
   }
+}
+
+bool Batcher::run(const unsigned char *in, unsigned char *out, size_t len,
+                  const unsigned char *key, const unsigned char *iv,
+                  Algorithm alg, size_t skip,
+                  const std::vector<VkPipeline> &pipelineSet, bool scrub) {
 
   // Each algorithm uses its own dedicated pipeline
   int pipelineIdx = alg;
 
-  if (alg >= ALG_COUNT || pipelines[pipelineIdx] == VK_NULL_HANDLE) {
+  if (alg >= ALG_COUNT || pipelineSet[pipelineIdx] == VK_NULL_HANDLE) {
     DEBUG_PRINT("Error: Invalid or uninitialized algorithm %d (pipeline %d)",
                 alg, pipelineIdx);
     return false;
   }
 
-  // 1. Write Input
-  static VkDeviceSize offset = 0;
-  if (offset + len > RING_SIZE) {
-    offset = 0;
-  }
+  // Bytes covered by the dispatch: whole blocks from the keystream start
+  size_t blockSize = isChacha(alg) ? 64 : 16;
+  size_t span = (skip + len + blockSize - 1) / blockSize * blockSize;
 
-  VkDeviceSize currentInfoOffset = offset;
-  memcpy((char *)inputRing.mappedUrl + currentInfoOffset, in, len);
+  if (skip >= blockSize || span > RING_SIZE) {
+    DEBUG_PRINT("Error: skip %zu + len %zu > RING_SIZE", skip, len);
+    return false;
+  }
 
-  // 2. Update params
-  uint32_t *ubo = (uint32_t *)paramMappedUrl;
+  if (alg == ALG_AES256_XTS_ENC || alg == ALG_AES256_XTS_DEC) {
+    DEBUG_PRINT("Error: XTS goes through submitXts()");
+    return false;
+  }
 
-  static const uint8_t sbox[256] = {
-      0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
-      0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
-      0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
-      0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-      0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
-      0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
-      0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
-      0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-      0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
-      0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
-      0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
-      0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-      0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
-      0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
-      0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
-      0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-      0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
-      0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
-      0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
-      0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-      0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
-      0xb0, 0x54, 0xbb, 0x16};
+  bool blockMode = alg == ALG_AES256_ECB_ENC || alg == ALG_AES256_ECB_DEC ||
+                   alg == ALG_AES256_CBC_DEC;
+  if (blockMode && (skip != 0 || len % 16 != 0)) {
+    DEBUG_PRINT("Error: block mode needs whole blocks (len %zu)", len);
+    return false;
+  }
 
-  if (alg == ALG_AES_CTR) {
-    // AES-128-CTR: Original working layout
-    // Layout: batchSize, padding[3], RoundKey[44], IV[4], padding2[12],
-    // SBox[256]
-    ubo[0] = (len + 15) / 16;
-
-    static const uint8_t rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
-                                     0x20, 0x40, 0x80, 0x1b, 0x36};
-
-    // AES-128 Key Expansion using OpenSSL (Guarantee correctness)
-    DEBUG_PRINT("AES-128 Input Key: %02x %02x %02x %02x ...", key[0], key[1],
-                key[2], key[3]);
-    AES_KEY aes_key;
-    if (AES_set_encrypt_key(key, 128, &aes_key) < 0) {
-      DEBUG_PRINT("AES-128 Key Expansion Failed");
-      return false;
+  StatsLock lock(submitMutex, len);
+
+  // A staged job runs in slices, each with its own params slot: it starts
+  // at its own counter block (CBC: after the ciphertext block before it)
+  size_t slices = staging ? (span + STAGING_SLICE - 1) / STAGING_SLICE : 1;
+  auto params = [&] {
+    for (size_t j = 0; j < slices; j++) {
+      size_t first = j * STAGING_SLICE;
+      const unsigned char *sliceIv = iv;
+      unsigned char counter[16];
+      if (j > 0 && alg == ALG_AES256_CBC_DEC) {
+        sliceIv = in + first - 16;
+      } else if (j > 0 && !blockMode) {
+        memcpy(counter, iv, 16);
+        advanceCounter(counter, first / blockSize, alg);
+        sliceIv = counter;
+      }
+      size_t sliceSpan =
+          slices > 1 ? std::min<size_t>(STAGING_SLICE, span - first) : span;
+      writeParams(key, sliceIv, alg, sliceSpan, blockMode, j);
     }
-    DEBUG_PRINT("AES-128 Generated RoundKey[0]: %08x", aes_key.rd_key[0]);
+  };
+
+  // Params (key expansion for AES) on a pool worker while a large input is
+  // copied into the ring; for small ones the hand-off costs more
+  TaskGroup setup;
+  if (len >= SETUP_OVERLAP_MIN)
+    TaskPool::instance().run(setup, params);
+  else
+    params();
+  bool ok = execute(in, out, len, skip, span, blockSize, commandBuffers[alg],
+                    pipelineSet[pipelineIdx], nullptr, 0, &setup, slices,
+                    scrub);
+  if (scrub) {
+    // Key, round keys and counter block sit below the S-box (272 bytes);
+    // wipe them before the next submit can map the slots
+    for (size_t j = 0; j < slices; j++)
+      memset((char *)paramMappedUrl + j * PARAM_SIZE, 0, 272);
+    VkMappedMemoryRange wiped = {};
+    wiped.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    wiped.memory = paramMemory;
+    wiped.offset = 0;
+    wiped.size = VK_WHOLE_SIZE;
+    vkFlushMappedMemoryRanges(ctx->getDevice(), 1, &wiped);
+  }
+  if (!ok)
+    return false;
+  RuntimeStats::instance().gpu(alg, 1, len);
+  return true;
+}
+
+// Caller holds submitMutex
+void Batcher::writeParams(const unsigned char *key, const unsigned char *iv,
+                          Algorithm alg, size_t span, bool blockMode,
+                          size_t slot) {
+  uint32_t *ubo = (uint32_t *)((char *)paramMappedUrl + slot * PARAM_SIZE);
+
+  if (alg == ALG_AES128_CTR) {
+    // AES-128-CTR: Shares aes256_ctr.comp with numRounds = 10
+    // Layout: batchSize, numRounds, padding[2], RoundKey[44], IV[4], SBox[256]
+    ubo[0] = span / 16;
+
+    // AES-128 Key Expansion (44 words), same word layout as AES-256.
+    // (OpenSSL's AES_KEY schedule is stored in its own word order, which is
+    // not what the shader expects.)
+    uint32_t w[44];
+    expandKey(key, 4, sbox, w);
 
-    // OpenSSL stores round keys in rd_key[4 * (rounds + 1)]
-    // For 128-bit, 10 rounds -> 44 words.
-    // CAST to uint32_t* is safe here as rd_key is aligned.
     // AES-128 offsets (Matching AES-256 Layout): RoundKey at 16, IV at 256,
     // SBox at 272
-    ubo[1] = 10;                          // numRounds=10 for AES-128
-    memcpy(ubo + 4, aes_key.rd_key, 176); // RoundKey at offset 16 bytes
-    memcpy(ubo + 64, iv, 16);             // IV at offset 256 bytes
+    ubo[1] = 10;              // numRounds=10 for AES-128
+    memcpy(ubo + 4, w, 176);  // RoundKey at offset 16 bytes
+    memcpy(ubo + 64, iv, 16); // IV at offset 256 bytes
 
     // Upload S-Box at offset 272 bytes
     uint32_t *dstSBox = ubo + 68;
@@ -197,32 +349,12 @@ bool Batcher::submit(const unsigned char *in, unsigned char *out, size_t len,
   } else if (alg == ALG_AES256_CTR) {
     // AES-256-CTR: Extended layout for 14 rounds
     // Layout: batchSize, numRounds, padding[2], RoundKey[60], IV[4], SBox[256]
-    ubo[0] = (len + 15) / 16;
+    ubo[0] = span / 16;
     ubo[1] = 14; // numRounds for AES-256
 
-    static const uint8_t rcon[15] = {0x01, 0x02, 0x04, 0x08, 0x10,
-                                     0x20, 0x40, 0x80, 0x1b, 0x36,
-                                     0x6c, 0xd8, 0xab, 0x4d, 0x9a};
-
     // AES-256 Key Expansion (60 words)
     uint32_t w[60];
-    memcpy(w, key, 32);
-    for (int i = 8; i < 60; i++) {
-      uint32_t temp = w[i - 1];
-      if (i % 8 == 0) {
-        temp = ((temp >> 8) | (temp << 24));
-        temp = (sbox[temp & 0xFF]) | (sbox[(temp >> 8) & 0xFF] << 8) |
-               (sbox[(temp >> 16) & 0xFF] << 16) |
-               (sbox[(temp >> 24) & 0xFF] << 24);
-        temp ^= rcon[(i / 8) - 1];
-      } else if (i % 8 == 4) {
-        // AES-256 extra SubWord step
-        temp = (sbox[temp & 0xFF]) | (sbox[(temp >> 8) & 0xFF] << 8) |
-               (sbox[(temp >> 16) & 0xFF] << 16) |
-               (sbox[(temp >> 24) & 0xFF] << 24);
-      }
-      w[i] = w[i - 8] ^ temp;
-    }
+    expandKey(key, 8, sbox, w);
 
     // AES-256 offsets: RoundKey at 16, IV at 256, SBox at 272
     memcpy(ubo + 4, w, 240);  // RoundKey (60 words) at offset 16 bytes
@@ -233,9 +365,36 @@ bool Batcher::submit(const unsigned char *in, unsigned char *out, size_t len,
     for (int i = 0; i < 256; i++) {
       dstSBox[i] = (uint32_t)sbox[i];
     }
-  } else if (alg == ALG_CHACHA20) {
-    // ChaCha 64-byte blocks
-    ubo[0] = (len + 63) / 64;
+  } else if (blockMode) {
+    // AES-256 ECB/CBC (aes256_block.comp)
+    // Layout: batchSize, numRounds, mode, padding, RoundKey[60], IV[4],
+    // SBox[256], InvSBox[256]
+    ubo[0] = span / 16;
+    ubo[1] = 14;
+    ubo[2] = (alg == ALG_AES256_ECB_ENC) ? 0 : (alg == ALG_AES256_ECB_DEC) ? 1
+                                                                          : 2;
+
+    uint32_t w[60];
+    expandKey(key, 8, sbox, w);
+    if (alg != ALG_AES256_ECB_ENC) {
+      uint32_t dk[60];
+      decryptionKeys(w, dk);
+      memcpy(w, dk, sizeof(w));
+    }
+    memcpy(ubo + 4, w, 240);
+    if (iv)
+      memcpy(ubo + 64, iv, 16);
+
+    // S-Box at 272 bytes, inverse S-Box right after it (1296 bytes)
+    uint32_t *dstSBox = ubo + 68;
+    uint32_t *dstInvSBox = ubo + 68 + 256;
+    for (int i = 0; i < 256; i++) {
+      dstSBox[i] = (uint32_t)sbox[i];
+      dstInvSBox[sbox[i]] = (uint32_t)i;
+    }
+  } else if (isChacha(alg)) {
+    // ChaCha 64-byte blocks (the round count is baked into the pipeline)
+    ubo[0] = span / 64;
     memcpy(ubo + 4, key, 32);
 
     // CRITICAL FIX: OpenSSL ChaCha20 IV format is [Counter 4B][Nonce 12B]
@@ -245,58 +404,386 @@ bool Batcher::submit(const unsigned char *in, unsigned char *out, size_t len,
     memcpy(ubo + 12, iv + 4, 12); // Copy Nonce (IV bytes 4-15) to ubo[12..14]
     memcpy(&ubo[15], iv, 4);      // Copy Counter (IV bytes 0-3) to ubo[15]
   }
+}
 
-  // FORCE FLUSH (Even if Coherent, to be safe on RPi4)
-  VkMappedMemoryRange ranges[2] = {};
-  ranges[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  ranges[0].memory = inputRing.memory;
-  ranges[0].offset = currentInfoOffset; // Or minimal aligned offset
-  ranges[0].size = VK_WHOLE_SIZE;       // Flush all for safety/simplicity
+bool Batcher::submitXts(const unsigned char *in, unsigned char *out,
+                        size_t len, const unsigned char *key,
+                        const unsigned char *tweak, size_t sectorSize,
+                        size_t firstBlock, bool decrypt) {
+  Algorithm alg = decrypt ? ALG_AES256_XTS_DEC : ALG_AES256_XTS_ENC;
+  if (pipelines[alg] == VK_NULL_HANDLE) {
+    DEBUG_PRINT("Error: XTS pipeline not loaded");
+    return false;
+  }
+  if (len == 0 || len % 16 != 0 || len > RING_SIZE || sectorSize == 0 ||
+      sectorSize % 16 != 0 || firstBlock >= sectorSize / 16) {
+    DEBUG_PRINT("Error: bad XTS job (len %zu, sector %zu)", len, sectorSize);
+    return false;
+  }
 
-  ranges[1].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  ranges[1].memory = paramMemory;
-  ranges[1].offset = 0;
-  ranges[1].size = VK_WHOLE_SIZE;
+  StatsLock lock(submitMutex, len);
 
-  vkFlushMappedMemoryRanges(ctx->getDevice(), 2, ranges);
+  // Layout: batchSize, numRounds, decrypt, sectorBlocks, RoundKey[60],
+  // IV[4], SBox[256], InvSBox[256], TweakKey[60], blockOffset
+  uint32_t *ubo = (uint32_t *)paramMappedUrl;
+  ubo[0] = len / 16;
+  ubo[1] = 14;
+  ubo[2] = decrypt ? 1 : 0;
+  ubo[3] = sectorSize / 16;
+
+  uint32_t w[60];
+  expandKey(key, 8, sbox, w);
+  if (decrypt) {
+    uint32_t dk[60];
+    decryptionKeys(w, dk);
+    memcpy(w, dk, sizeof(w));
+  }
+  memcpy(ubo + 4, w, 240);
+  memcpy(ubo + 64, tweak, 16);
+
+  uint32_t *dstSBox = ubo + 68;
+  uint32_t *dstInvSBox = ubo + 68 + 256;
+  for (int i = 0; i < 256; i++) {
+    dstSBox[i] = (uint32_t)sbox[i];
+    dstInvSBox[sbox[i]] = (uint32_t)i;
+  }
+
+  expandKey(key + 32, 8, sbox, w);
+  memcpy(ubo + 580, w, 240); // TweakKey at 2320 bytes
+  ubo[640] = (uint32_t)firstBlock;
+
+  if (!execute(in, out, len, 0, len, 16, commandBuffers[alg], pipelines[alg]))
+    return false;
+  RuntimeStats::instance().gpu(alg, 1, len);
+  return true;
+}
+
+bool Batcher::submitGcm(const unsigned char *in, unsigned char *out,
+                        size_t len, const unsigned char *key,
+                        const unsigned char *ctr, const unsigned char *hpow,
+                        unsigned char *partials, bool decrypt) {
+  Algorithm alg = decrypt ? ALG_AES256_GCM_DEC : ALG_AES256_GCM_ENC;
+  if (pipelines[alg] == VK_NULL_HANDLE) {
+    DEBUG_PRINT("Error: GCM pipeline not loaded");
+    return false;
+  }
+  size_t blocks = len / 16;
+  size_t partialLen = (blocks + 255) / 256 * 16;
+  if (len == 0 || len % 16 != 0 || len + partialLen > RING_SIZE) {
+    DEBUG_PRINT("Error: bad GCM job (len %zu)", len);
+    return false;
+  }
+
+  StatsLock lock(submitMutex, len);
+
+  // Layout: batchSize, numRounds, decrypt, padding, RoundKey[60], IV[4],
+  // SBox[256], HPow[1024]
+  uint32_t *ubo = (uint32_t *)paramMappedUrl;
+  ubo[0] = blocks;
+  ubo[1] = 14;
+  ubo[2] = decrypt ? 1 : 0;
+
+  uint32_t w[60];
+  expandKey(key, 8, sbox, w);
+  memcpy(ubo + 4, w, 240);
+  memcpy(ubo + 64, ctr, 16);
+
+  uint32_t *dstSBox = ubo + 68;
+  for (int i = 0; i < 256; i++)
+    dstSBox[i] = (uint32_t)sbox[i];
+  memcpy(ubo + 324, hpow, 4096); // HPow at 1296 bytes
+
+  if (!execute(in, out, len, 0, len, 16, commandBuffers[alg], pipelines[alg],
+               partials, partialLen))
+    return false;
+  RuntimeStats::instance().gpu(alg, 1, len);
+  return true;
+}
+
+// SHA-256 padding of 'len' message bytes: 0x80, zeros, 64-bit BE length
+static size_t sha256Blocks(size_t len) { return (len + 9 + 63) / 64; }
+
+bool Batcher::submitSha256(const unsigned char *const *msgs,
+                           const size_t *lens, size_t count,
+                           unsigned char *digests) {
+  if (pipelines[ALG_SHA256] == VK_NULL_HANDLE) {
+    DEBUG_PRINT("Error: SHA-256 pipeline not loaded");
+    return false;
+  }
+
+  // Shortest first: threads of a workgroup then hash similar lengths
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [lens](size_t a, size_t b) { return lens[a] < lens[b]; });
+
+  StatsLock lock(submitMutex);
+
+  size_t first = 0;
+  while (first < count) {
+    // As many messages as fit one ring: entry table, then padded blocks
+    size_t n = 0, dataBytes = 0;
+    while (first + n < count) {
+      size_t bytes = sha256Blocks(lens[order[first + n]]) * 64;
+      size_t table = ((n + 1) * 8 + 63) & ~(size_t)63;
+      if (table + dataBytes + bytes > RING_SIZE)
+        break;
+      dataBytes += bytes;
+      n++;
+    }
+    if (n == 0) {
+      DEBUG_PRINT("Error: SHA-256 message too large (%zu bytes)",
+                  lens[order[first]]);
+      return false;
+    }
+
+    // Layout: { first word, block count } per message, messages at 64-byte
+    // boundaries; padded in place in the ring
+    size_t table = (n * 8 + 63) & ~(size_t)63;
+    VkDeviceSize offset = reserveRing(table + dataBytes);
+    unsigned char *ring = (unsigned char *)inputRing.mappedUrl + offset;
+    uint32_t *entries = (uint32_t *)ring;
+    size_t pos = table;
+    for (size_t i = 0; i < n; i++) {
+      size_t m = order[first + i];
+      size_t blocks = sha256Blocks(lens[m]);
+      unsigned char *dst = ring + pos;
+      entries[2 * i] = (uint32_t)(pos / 4);
+      entries[2 * i + 1] = (uint32_t)blocks;
+      if (lens[m] > 0)
+        memcpy(dst, msgs[m], lens[m]);
+      dst[lens[m]] = 0x80;
+      memset(dst + lens[m] + 1, 0, blocks * 64 - lens[m] - 9);
+      uint64_t bits = (uint64_t)lens[m] * 8;
+      for (int b = 0; b < 8; b++)
+        dst[blocks * 64 - 1 - b] = (unsigned char)(bits >> (8 * b));
+      pos += blocks * 64;
+    }
+
+    uint32_t *ubo = (uint32_t *)paramMappedUrl;
+    ubo[0] = (uint32_t)n;
+    if (!dispatch(offset, table + dataBytes, n * 32, (uint32_t)n,
+                  commandBuffers[ALG_SHA256], pipelines[ALG_SHA256]))
+      return false;
+
+    const unsigned char *res =
+        (const unsigned char *)outputRing.mappedUrl + offset;
+    for (size_t i = 0; i < n; i++)
+      memcpy(digests + 32 * order[first + i], res + 32 * i, 32);
+    RuntimeStats::instance().gpu(ALG_SHA256, n, dataBytes);
+    first += n;
+  }
+  return true;
+}
+
+bool Batcher::submitBlake3(const unsigned char *in, size_t len,
+                           uint64_t chunkCounter, unsigned char *cvs,
+                           size_t *count) {
+  if (pipelines[ALG_BLAKE3] == VK_NULL_HANDLE) {
+    DEBUG_PRINT("Error: BLAKE3 pipeline not loaded");
+    return false;
+  }
+  // Padded to a whole block so every thread reads full 64-byte blocks
+  size_t padded = (len + 63) & ~(size_t)63;
+  if (len == 0 || padded > RING_SIZE)
+    return false;
 
-  // 3. Update Descriptors
-  VkDescriptorBufferInfo bufInfo[3] = {};
-  bufInfo[0].buffer = inputRing.buffer;
-  bufInfo[0].offset = currentInfoOffset;
-  bufInfo[0].range = len;
+  size_t chunks = (len + 1023) / 1024;
+  size_t groups = (chunks + 255) / 256;
 
-  bufInfo[1].buffer = outputRing.buffer;
-  bufInfo[1].offset = currentInfoOffset;
-  bufInfo[1].range = len;
+  StatsLock lock(submitMutex, len);
 
-  bufInfo[2].buffer = paramBuffer;
-  bufInfo[2].offset = 0;
-  bufInfo[2].range = VK_WHOLE_SIZE;
+  VkDeviceSize offset = reserveRing(padded);
+  unsigned char *ring = (unsigned char *)inputRing.mappedUrl + offset;
+  TaskPool::instance().copy(ring, in, len, inputRing.writeCombined());
+  memset(ring + len, 0, padded - len);
+
+  uint32_t *ubo = (uint32_t *)paramMappedUrl;
+  ubo[0] = (uint32_t)chunks;
+  ubo[1] = (uint32_t)(len - (chunks - 1) * 1024);
+  ubo[2] = (uint32_t)chunkCounter;
+  ubo[3] = (uint32_t)(chunkCounter >> 32);
+  if (!dispatch(offset, padded, groups * 32, (uint32_t)(groups * 256),
+                commandBuffers[ALG_BLAKE3], pipelines[ALG_BLAKE3]))
+    return false;
+
+  memcpy(cvs, (const unsigned char *)outputRing.mappedUrl + offset,
+         groups * 32);
+  *count = groups;
+  RuntimeStats::instance().gpu(ALG_BLAKE3, 1, len);
+  return true;
+}
+
+bool Batcher::submitPbkdf2(uint32_t *entries, size_t count) {
+  if (pipelines[ALG_PBKDF2_SHA256] == VK_NULL_HANDLE) {
+    DEBUG_PRINT("Error: PBKDF2 pipeline not loaded");
+    return false;
+  }
+  const size_t entryBytes = PBKDF2_ENTRY_WORDS * 4;
+  const size_t perRing = RING_SIZE / entryBytes;
+
+  StatsLock lock(submitMutex);
+
+  for (size_t first = 0; first < count; first += perRing) {
+    size_t n = std::min(perRing, count - first);
+    uint32_t *batch = entries + first * PBKDF2_ENTRY_WORDS;
+    VkDeviceSize offset = reserveRing(n * entryBytes);
+    memcpy((unsigned char *)inputRing.mappedUrl + offset, batch,
+           n * entryBytes);
+
+    uint32_t *ubo = (uint32_t *)paramMappedUrl;
+    ubo[0] = (uint32_t)n;
+    bool ok = dispatch(offset, n * entryBytes, n * 64, (uint32_t)n,
+                       commandBuffers[ALG_PBKDF2_SHA256],
+                       pipelines[ALG_PBKDF2_SHA256]);
+    // Key midstates were staged in the shared ring; do not leave them there
+    memset((unsigned char *)inputRing.mappedUrl + offset, 0, n * entryBytes);
+    if (!ok)
+      return false;
 
-  VkWriteDescriptorSet writes[2] = {};
-  writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writes[0].dstSet = descriptorSet;
-  writes[0].dstBinding = 0;
-  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  writes[0].descriptorCount = 1;
-  writes[0].pBufferInfo = &bufInfo[0];
+    const uint32_t *res =
+        (const uint32_t *)((unsigned char *)outputRing.mappedUrl + offset);
+    for (size_t i = 0; i < n; i++)
+      memcpy(batch + i * PBKDF2_ENTRY_WORDS + 16, res + 16 * i, 64);
+    memset((unsigned char *)outputRing.mappedUrl + offset, 0, n * 64);
+    // Written back now: a cached output ring could otherwise write the
+    // zeros over a later dispatch's results
+    VkMappedMemoryRange scrubbed[2] = {
+        ringRange(inputRing, offset, n * entryBytes),
+        ringRange(outputRing, offset, n * 64)};
+    vkFlushMappedMemoryRanges(ctx->getDevice(), 2, scrubbed);
+  }
+  return true;
+}
 
-  writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writes[1].dstSet = descriptorSet;
-  writes[1].dstBinding = 1;
-  writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  writes[1].descriptorCount = 1;
-  writes[1].pBufferInfo = &bufInfo[1];
+// Copy input into the ring, dispatch one thread per block over 'span'
+// bytes and copy the result back. Params must already be written; caller
+// holds submitMutex.
+bool Batcher::execute(const unsigned char *in, unsigned char *out,
+                      size_t len, size_t skip, size_t span, size_t blockSize,
+                      VkCommandBuffer cb, VkPipeline pipeline,
+                      unsigned char *extra, size_t extraLen,
+                      TaskGroup *setup, size_t slices, bool scrub) {
+  // 1. Write Input (split across the pool when large, streaming stores
+  // into a write-combined ring)
+  StageProfile::Clock::time_point t = StageProfile::Clock::now();
+  TaskPool &pool = TaskPool::instance();
+  VkDeviceSize currentInfoOffset = reserveRing(span + extraLen);
+  if (in)
+    pool.copy((char *)inputRing.mappedUrl + currentInfoOffset + skip, in, len,
+              inputRing.writeCombined());
+  if (setup)
+    setup->wait();
+  profile.mark(StageProfile::COPY_IN, t);
+
+  // AES: each thread processes ONE 16-byte block.
+  // ChaCha: each thread processes ONE 64-byte block.
+  uint32_t blocks = span / blockSize;
+  bool ok = dispatch(currentInfoOffset, span, span + extraLen, blocks, cb,
+                     pipeline, slices);
 
-  vkUpdateDescriptorSets(ctx->getDevice(), 2, writes, 0, nullptr);
+  // 7. Read Output
+  // DEBUG_PRINT("Reading Output...");
+  t = StageProfile::Clock::now();
+  if (ok) {
+    pool.copy(out, (char *)outputRing.mappedUrl + currentInfoOffset + skip,
+              len);
+    if (extra)
+      memcpy(extra, (char *)outputRing.mappedUrl + currentInfoOffset + span,
+             extraLen);
+  }
+  profile.mark(StageProfile::COPY_OUT, t);
+
+  if (scrub) {
+    // Same as submitPbkdf2: nothing of this job stays in the shared rings,
+    // and the zeros are written back before a later dispatch can land
+    memset((char *)inputRing.mappedUrl + currentInfoOffset, 0,
+           span + extraLen);
+    memset((char *)outputRing.mappedUrl + currentInfoOffset, 0,
+           span + extraLen);
+    VkMappedMemoryRange scrubbed[2] = {
+        ringRange(inputRing, currentInfoOffset, span + extraLen),
+        ringRange(outputRing, currentInfoOffset, span + extraLen)};
+    vkFlushMappedMemoryRanges(ctx->getDevice(), 2, scrubbed);
+  }
 
-  offset += len;
+  return ok;
+}
+
+// Ring space for one job; offsets stay 256-byte aligned to satisfy
+// minStorageBufferOffsetAlignment. Caller holds submitMutex.
+VkDeviceSize Batcher::reserveRing(size_t bytes) {
+  if (ringOffset + bytes > RING_SIZE) {
+    ringOffset = 0;
+  }
+  VkDeviceSize offset = ringOffset;
+  ringOffset += (bytes + 255) & ~(VkDeviceSize)255;
+  return offset;
+}
+
+// Bind [offset, offset + inBytes) of the input ring and [offset, offset +
+// outBytes) of the output ring, run 'threads' invocations and wait. When
+// staging, the ranges are copied to and from the device-local rings around
+// the dispatch; with 'slices' > 1 (inBytes == outBytes, params slot j
+// written for each) the job is split into STAGING_SLICE pieces so the
+// copies overlap the compute. Caller holds submitMutex.
+bool Batcher::dispatch(VkDeviceSize offset, size_t inBytes, size_t outBytes,
+                       uint32_t threads, VkCommandBuffer cb,
+                       VkPipeline pipeline, size_t slices) {
+  StageProfile::Clock::time_point t = StageProfile::Clock::now();
+
+  RuntimeStats::instance().dispatch(inBytes,
+                                    offset + std::max(inBytes, outBytes));
+
+  // 2. FORCE FLUSH (Even if Coherent, to be safe on RPi4), only the input
+  // bytes of this job
+  VkMappedMemoryRange ranges[2] = {};
+  ranges[0] = ringRange(inputRing, offset, inBytes);
+
+  ranges[1].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  ranges[1].memory = paramMemory;
+  ranges[1].offset = 0;
+  ranges[1].size = VK_WHOLE_SIZE;
+
+  vkFlushMappedMemoryRanges(ctx->getDevice(), 2, ranges);
+  profile.mark(StageProfile::FLUSH, t);
+
+  // 3. Update Descriptors: set j binds slice j of the job, in the
+  // device-local rings when staging
+  size_t sliceSize = slices > 1 ? STAGING_SLICE : std::max(inBytes, outBytes);
+  auto part = [&](size_t total, size_t j) -> size_t {
+    size_t first = j * sliceSize;
+    return first < total ? std::min(sliceSize, total - first) : 0;
+  };
+  VkDescriptorBufferInfo bufInfo[2 * STAGING_SLICES] = {};
+  VkWriteDescriptorSet writes[2 * STAGING_SLICES] = {};
+  for (size_t j = 0; j < slices; j++) {
+    bufInfo[2 * j].buffer = shaderInput().buffer;
+    bufInfo[2 * j].offset = offset + j * sliceSize;
+    bufInfo[2 * j].range = slices > 1 ? part(inBytes, j) : inBytes;
+
+    bufInfo[2 * j + 1].buffer = shaderOutput().buffer;
+    bufInfo[2 * j + 1].offset = offset + j * sliceSize;
+    bufInfo[2 * j + 1].range = slices > 1 ? part(outBytes, j) : outBytes;
+
+    for (int b = 0; b < 2; b++) {
+      VkWriteDescriptorSet &w = writes[2 * j + b];
+      w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      w.dstSet = descriptorSets[j];
+      w.dstBinding = b;
+      w.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      w.descriptorCount = 1;
+      w.pBufferInfo = &bufInfo[2 * j + b];
+    }
+  }
+
+  vkUpdateDescriptorSets(ctx->getDevice(), 2 * slices, writes, 0, nullptr);
+  profile.mark(StageProfile::DESCRIPTORS, t);
 
   // 4. Record Command Buffer (Dynamic Dispatch)
   // We record every time to ensure Dispatch Size matches workload exactly.
   // This avoids launching 65k groups for small payloads which might choke V3D.
-  VkCommandBuffer cb = commandBuffers[alg];
   vkResetCommandBuffer(cb, 0);
 
   VkCommandBufferBeginInfo beginInfo = {};
@@ -304,73 +791,121 @@ bool Batcher::submit(const unsigned char *in, unsigned char *out, size_t len,
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   vkBeginCommandBuffer(cb, &beginInfo);
 
-  // pipelineIdx was already computed at start of submit()
-  vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[pipelineIdx]);
-  vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0,
-                          1, &descriptorSet, 0, nullptr);
-
-  // Calculate generic group count
-  uint32_t groupCount = 1;
-  if (alg == ALG_AES_CTR || alg == ALG_AES256_CTR) {
-    // AES: 256 threads per group (V3D SSBO workaround).
-    // Each thread processes ONE 16-byte block.
-    uint32_t blocks = (len + 15) / 16;
-    groupCount = (blocks + 255) / 256;
-  } else {
-    // ChaCha: 256 threads per group (workaround for V3D SSBO bug).
-    // Each thread processes ONE 64-byte block.
-    // Total blocks = (len + 63) / 64.
-    // Groups = (Blocks + 255) / 256.
-    uint32_t blocks = (len + 63) / 64;
-    groupCount = (blocks + 255) / 256;
-  }
+  gpuTimer.begin(cb);
+  vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 
-  // Safety clamp
-  if (groupCount == 0)
-    groupCount = 1;
+  // 256 threads per group (workaround for V3D SSBO bug).
+  // Safety clamp: at least one group
+  auto groups = [](size_t n) {
+    return (uint32_t)std::max<size_t>((n + 255) / 256, 1);
+  };
 
-  // DEBUG_PRINT("Dispatching %d groups for len %zu", groupCount, len);
-  vkCmdDispatch(cb, groupCount, 1, 1);
+  if (!staging) {
+    vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout, 0, 1, &descriptorSets[0], 0,
+                            nullptr);
+    vkCmdDispatch(cb, groups(threads), 1, 1);
+  } else {
+    // Three-stage pipeline over the slices: step j dispatches slice j,
+    // uploads slice j + 1 and reads back slice j - 1. They touch disjoint
+    // ranges, so only the barrier between steps orders them and the GPU
+    // can overlap the copies with the compute.
+    const VkPipelineStageFlags both = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT;
+    size_t perThread = slices > 1 ? inBytes / threads : 0;
+    cmdCopyRange(cb, inputRing, deviceInput, offset, part(inBytes, 0));
+    cmdBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT,
+               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+               VK_ACCESS_SHADER_READ_BIT);
+    for (size_t j = 0; j <= slices; j++) {
+      if (j < slices) {
+        vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                pipelineLayout, 0, 1, &descriptorSets[j], 0,
+                                nullptr);
+        vkCmdDispatch(
+            cb, groups(slices > 1 ? part(inBytes, j) / perThread : threads),
+            1, 1);
+      }
+      if (j + 1 < slices)
+        cmdCopyRange(cb, inputRing, deviceInput, offset + (j + 1) * sliceSize,
+                     part(inBytes, j + 1));
+      if (j > 0)
+        cmdCopyRange(cb, deviceOutput, outputRing,
+                     offset + (j - 1) * sliceSize, part(outBytes, j - 1));
+      if (j < slices)
+        cmdBarrier(cb, both,
+                   VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                   both,
+                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+    }
+    cmdBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+               VK_ACCESS_HOST_READ_BIT);
+  }
+  gpuTimer.end(cb);
   vkEndCommandBuffer(cb);
+  profile.mark(StageProfile::RECORD, t);
 
   // 5. Submit
+  uint64_t batch = Trace::nextBatch();
+  uint64_t submitted = Trace::now();
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &cb;
 
   // DEBUG_PRINT("Submitting Batch...");
-  VkResult res =
-      vkQueueSubmit(ctx->getComputeQueue(), 1, &submitInfo, computeFence);
+  vkResetFences(ctx->getDevice(), 1, &computeFence);
+  VkResult res = ctx->submitCompute(submitInfo, computeFence);
   if (res != VK_SUCCESS) {
     DEBUG_PRINT("vkQueueSubmit failed: %d", res);
     return false;
   }
+  profile.mark(StageProfile::SUBMIT, t);
 
-  // 6. Wait
-  // DEBUG_PRINT("Waiting for Idle...");
-  // Fences seem to hang on V3D with high load. Trying QueueWaitIdle.
-  res = vkQueueWaitIdle(ctx->getComputeQueue());
+  // 6. Wait for this submit only: the queue is shared with the AES-256
+  // batcher, whose work vkQueueWaitIdle would wait for as well
+  res = vkWaitForFences(ctx->getDevice(), 1, &computeFence, VK_TRUE,
+                        UINT64_MAX);
   if (res != VK_SUCCESS) {
-    DEBUG_PRINT("vkQueueWaitIdle failed: %d", res);
+    DEBUG_PRINT("vkWaitForFences failed: %d", res);
     return false;
   }
 
-  // FORCE INVALIDATE OUTPUT (Ensure CPU sees GPU writes)
-  VkMappedMemoryRange outRange = {};
-  outRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  outRange.memory = outputRing.memory;
-  outRange.offset = currentInfoOffset;
-  outRange.size = VK_WHOLE_SIZE; // Invalidate all for safety
+  // FORCE INVALIDATE OUTPUT (Ensure CPU sees GPU writes) over the bytes
+  // the dispatch wrote
+  VkMappedMemoryRange outRange = ringRange(outputRing, offset, outBytes);
   vkInvalidateMappedMemoryRanges(ctx->getDevice(), 1, &outRange);
+  profile.mark(StageProfile::WAIT, t);
+  // Submit to completion; the caller wakes at the end of the span
+  Trace::span("batcher", "dispatch", submitted, inBytes, batch);
 
-  // 7. Read Output
-  // DEBUG_PRINT("Reading Output...");
-  memcpy(out, (char *)outputRing.mappedUrl + currentInfoOffset, len);
+  uint64_t gpuNs;
+  if (gpuTimer.read(&gpuNs))
+    profile.record(StageProfile::GPU, gpuNs);
 
   return true;
 }
 
+void Batcher::advanceCounter(unsigned char *iv, uint64_t blocks,
+                             Algorithm alg) {
+  if (isChacha(alg)) {
+    // 32-bit Little-Endian block counter in IV bytes 0-3
+    uint32_t counter;
+    memcpy(&counter, iv, 4);
+    counter += (uint32_t)blocks;
+    memcpy(iv, &counter, 4);
+    return;
+  }
+  // AES-CTR: Big-Endian 128-bit counter
+  for (int i = 15; i >= 0 && blocks != 0; i--) {
+    uint64_t sum = iv[i] + (blocks & 0xFF);
+    iv[i] = sum & 0xFF;
+    blocks = (blocks >> 8) + (sum >> 8);
+  }
+}
+
 // ... helper methods ...
 
 void Batcher::createDescriptors() {
@@ -398,56 +933,54 @@ void Batcher::createDescriptors() {
   vkCreateDescriptorSetLayout(ctx->getDevice(), &layoutInfo, nullptr,
                               &descriptorSetLayout);
 
+  size_t slots = staging ? STAGING_SLICES : 1;
   VkDescriptorPoolSize poolSizes[1] = {};
   poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  poolSizes[0].descriptorCount = 3; // 3 SSBOs
+  poolSizes[0].descriptorCount = 3 * slots; // 3 SSBOs per set
 
   VkDescriptorPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = 1;
   poolInfo.pPoolSizes = poolSizes;
-  poolInfo.maxSets = 1;
+  poolInfo.maxSets = slots;
 
   vkCreateDescriptorPool(ctx->getDevice(), &poolInfo, nullptr, &descriptorPool);
 
+  std::vector<VkDescriptorSetLayout> layouts(slots, descriptorSetLayout);
+  descriptorSets.resize(slots);
   VkDescriptorSetAllocateInfo allocInfo = {};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = 1;
-  allocInfo.pSetLayouts = &descriptorSetLayout;
-
-  vkAllocateDescriptorSets(ctx->getDevice(), &allocInfo, &descriptorSet);
-
-  // Initial write (will be updated per frame anyway)
-  VkDescriptorBufferInfo bufInfo[3] = {};
-  bufInfo[0].buffer = inputRing.buffer;
-  bufInfo[0].range = VK_WHOLE_SIZE;
-  bufInfo[1].buffer = outputRing.buffer;
-  bufInfo[1].range = VK_WHOLE_SIZE;
-  bufInfo[2].buffer = paramBuffer;
-  bufInfo[2].range = VK_WHOLE_SIZE;
-
-  VkWriteDescriptorSet writes[3] = {};
-  writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writes[0].dstSet = descriptorSet;
-  writes[0].dstBinding = 0;
-  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  writes[0].descriptorCount = 1;
-  writes[0].pBufferInfo = &bufInfo[0];
-  writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writes[1].dstSet = descriptorSet;
-  writes[1].dstBinding = 1;
-  writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  writes[1].descriptorCount = 1;
-  writes[1].pBufferInfo = &bufInfo[1];
-  writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-  writes[2].dstSet = descriptorSet;
-  writes[2].dstBinding = 2;
-  writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-  writes[2].descriptorCount = 1;
-  writes[2].pBufferInfo = &bufInfo[2];
-
-  vkUpdateDescriptorSets(ctx->getDevice(), 3, writes, 0, nullptr);
+  allocInfo.descriptorSetCount = slots;
+  allocInfo.pSetLayouts = layouts.data();
+
+  vkAllocateDescriptorSets(ctx->getDevice(), &allocInfo,
+                           descriptorSets.data());
+
+  // Initial write (will be updated per frame anyway); the params binding
+  // stays: set j sees slot j
+  for (size_t j = 0; j < slots; j++) {
+    VkDescriptorBufferInfo bufInfo[3] = {};
+    bufInfo[0].buffer = shaderInput().buffer;
+    bufInfo[0].range = VK_WHOLE_SIZE;
+    bufInfo[1].buffer = shaderOutput().buffer;
+    bufInfo[1].range = VK_WHOLE_SIZE;
+    bufInfo[2].buffer = paramBuffer;
+    bufInfo[2].offset = j * PARAM_SIZE;
+    bufInfo[2].range = slots > 1 ? PARAM_SIZE : VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3] = {};
+    for (int b = 0; b < 3; b++) {
+      writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[b].dstSet = descriptorSets[j];
+      writes[b].dstBinding = b;
+      writes[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[b].descriptorCount = 1;
+      writes[b].pBufferInfo = &bufInfo[b];
+    }
+
+    vkUpdateDescriptorSets(ctx->getDevice(), 3, writes, 0, nullptr);
+  }
 }
 
 static std::vector<char> readFile(const std::string &filename) {
@@ -478,16 +1011,11 @@ static VkShaderModule createShaderModule(VulkanContext *ctx,
 void Batcher::createPipeline() {
   pipelines.resize(ALG_COUNT);
 
-  // 1. AES-128-CTR (uses its own shader with original layout)
-  DEBUG_PRINT("Loading AES-128 Shader...");
-  auto aes128Code = readFile("/usr/local/lib/aes128_ctr.spv");
-  VkShaderModule aes128Module = createShaderModule(ctx, aes128Code);
-  DEBUG_PRINT("Creating AES-128 Pipeline...");
-
+  // 1. AES-128-CTR and 2. AES-256-CTR share aes256_ctr.comp (numRounds is a
+  // parameter), so one module backs both pipelines.
   VkPipelineShaderStageCreateInfo shaderStageInfo = {};
   shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-  shaderStageInfo.module = aes128Module;
   shaderStageInfo.pName = "main";
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
@@ -500,45 +1028,178 @@ void Batcher::createPipeline() {
 
   VkComputePipelineCreateInfo pipelineInfo = {};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-  pipelineInfo.stage = shaderStageInfo;
   pipelineInfo.layout = pipelineLayout;
 
-  vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
-                           nullptr, &pipelines[ALG_AES_CTR]);
-  vkDestroyShaderModule(ctx->getDevice(), aes128Module, nullptr);
-  DEBUG_PRINT("AES-128 Pipeline Created.");
-
-  // 2. AES-256-CTR
-  DEBUG_PRINT("Loading AES-256 Shader...");
+  DEBUG_PRINT("Loading AES Shader...");
   try {
-    auto aes256Code = readFile("/usr/local/lib/aes256_ctr.spv");
-    VkShaderModule aes256Module = createShaderModule(ctx, aes256Code);
-    shaderStageInfo.module = aes256Module;
+    auto aesCode = readFile("/usr/local/lib/aes256_ctr.spv");
+    VkShaderModule aesModule = createShaderModule(ctx, aesCode);
+    shaderStageInfo.module = aesModule;
     pipelineInfo.stage = shaderStageInfo;
-    DEBUG_PRINT("Creating AES-256 Pipeline...");
+    DEBUG_PRINT("Creating AES-128/AES-256 Pipelines...");
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &pipelines[ALG_AES128_CTR]);
     vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
                              nullptr, &pipelines[ALG_AES256_CTR]);
-    vkDestroyShaderModule(ctx->getDevice(), aes256Module, nullptr);
-    DEBUG_PRINT("AES-256 Pipeline Created.");
+    vkDestroyShaderModule(ctx->getDevice(), aesModule, nullptr);
+    DEBUG_PRINT("AES Pipelines Created.");
   } catch (...) {
-    fprintf(stderr, "[VC6] Warning: AES-256 shader not found.\n");
+    fprintf(stderr, "[VC6] Warning: AES shader not found.\n");
   }
 
-  // 3. ChaCha20
+  // 3. ChaCha20 / ChaCha12 / ChaCha8: one module, the round count is
+  // specialization constant 0 so each variant gets its own unrolled pipeline
+  static const struct {
+    Algorithm alg;
+    uint32_t rounds;
+  } chachaVariants[] = {
+      {ALG_CHACHA20, 20}, {ALG_CHACHA12, 12}, {ALG_CHACHA8, 8}};
+  VkSpecializationMapEntry roundsEntry = {0, 0, sizeof(uint32_t)};
+  VkSpecializationInfo roundsInfo = {};
+  roundsInfo.mapEntryCount = 1;
+  roundsInfo.pMapEntries = &roundsEntry;
+  roundsInfo.dataSize = sizeof(uint32_t);
+  auto createChachaPipelines = [&](VkShaderModule module,
+                                   std::vector<VkPipeline> &set) {
+    for (const auto &v : chachaVariants) {
+      roundsInfo.pData = &v.rounds;
+      shaderStageInfo.module = module;
+      shaderStageInfo.pSpecializationInfo = &roundsInfo;
+      pipelineInfo.stage = shaderStageInfo;
+      vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1,
+                               &pipelineInfo, nullptr, &set[v.alg]);
+    }
+    shaderStageInfo.pSpecializationInfo = nullptr;
+  };
+
   DEBUG_PRINT("Loading ChaCha20 Shader...");
   try {
     auto chachaCode = readFile("/usr/local/lib/chacha20.spv");
     VkShaderModule chachaModule = createShaderModule(ctx, chachaCode);
-    shaderStageInfo.module = chachaModule;
-    pipelineInfo.stage = shaderStageInfo;
-    DEBUG_PRINT("Creating ChaCha20 Pipeline...");
-    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
-                             nullptr, &pipelines[ALG_CHACHA20]);
+    DEBUG_PRINT("Creating ChaCha20/12/8 Pipelines...");
+    createChachaPipelines(chachaModule, pipelines);
     vkDestroyShaderModule(ctx->getDevice(), chachaModule, nullptr);
-    DEBUG_PRINT("ChaCha20 Pipeline Created.");
+    DEBUG_PRINT("ChaCha Pipelines Created.");
   } catch (...) {
     fprintf(stderr, "[VC6] Warning: ChaCha20 shader not found.\n");
   }
+
+  // 4. AES-256 ECB / CBC-decrypt (one module, mode is a parameter)
+  DEBUG_PRINT("Loading AES Block Shader...");
+  try {
+    auto blockCode = readFile("/usr/local/lib/aes256_block.spv");
+    VkShaderModule blockModule = createShaderModule(ctx, blockCode);
+    shaderStageInfo.module = blockModule;
+    pipelineInfo.stage = shaderStageInfo;
+    for (int a : {ALG_AES256_ECB_ENC, ALG_AES256_ECB_DEC, ALG_AES256_CBC_DEC})
+      vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1,
+                               &pipelineInfo, nullptr, &pipelines[a]);
+    vkDestroyShaderModule(ctx->getDevice(), blockModule, nullptr);
+    DEBUG_PRINT("AES Block Pipelines Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: AES block shader not found.\n");
+  }
+
+  // 5. AES-256-XTS
+  DEBUG_PRINT("Loading AES-XTS Shader...");
+  try {
+    auto xtsCode = readFile("/usr/local/lib/aes256_xts.spv");
+    VkShaderModule xtsModule = createShaderModule(ctx, xtsCode);
+    shaderStageInfo.module = xtsModule;
+    pipelineInfo.stage = shaderStageInfo;
+    for (int a : {ALG_AES256_XTS_ENC, ALG_AES256_XTS_DEC})
+      vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1,
+                               &pipelineInfo, nullptr, &pipelines[a]);
+    vkDestroyShaderModule(ctx->getDevice(), xtsModule, nullptr);
+    DEBUG_PRINT("AES-XTS Pipelines Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: AES-XTS shader not found.\n");
+  }
+
+  // 6. AES-256-GCM fused CTR + GHASH partials
+  DEBUG_PRINT("Loading AES-GCM Shader...");
+  try {
+    auto gcmCode = readFile("/usr/local/lib/aes256_gcm.spv");
+    VkShaderModule gcmModule = createShaderModule(ctx, gcmCode);
+    shaderStageInfo.module = gcmModule;
+    pipelineInfo.stage = shaderStageInfo;
+    for (int a : {ALG_AES256_GCM_ENC, ALG_AES256_GCM_DEC})
+      vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1,
+                               &pipelineInfo, nullptr, &pipelines[a]);
+    vkDestroyShaderModule(ctx->getDevice(), gcmModule, nullptr);
+    DEBUG_PRINT("AES-GCM Pipelines Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: AES-GCM shader not found.\n");
+  }
+
+  // 7. Multi-buffer SHA-256
+  DEBUG_PRINT("Loading SHA-256 Shader...");
+  try {
+    auto shaCode = readFile("/usr/local/lib/sha256.spv");
+    VkShaderModule shaModule = createShaderModule(ctx, shaCode);
+    shaderStageInfo.module = shaModule;
+    pipelineInfo.stage = shaderStageInfo;
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &pipelines[ALG_SHA256]);
+    vkDestroyShaderModule(ctx->getDevice(), shaModule, nullptr);
+    DEBUG_PRINT("SHA-256 Pipeline Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: SHA-256 shader not found.\n");
+  }
+
+  // 8. BLAKE3 chunk pass + in-workgroup tree reduction
+  DEBUG_PRINT("Loading BLAKE3 Shader...");
+  try {
+    auto b3Code = readFile("/usr/local/lib/blake3.spv");
+    VkShaderModule b3Module = createShaderModule(ctx, b3Code);
+    shaderStageInfo.module = b3Module;
+    pipelineInfo.stage = shaderStageInfo;
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &pipelines[ALG_BLAKE3]);
+    vkDestroyShaderModule(ctx->getDevice(), b3Module, nullptr);
+    DEBUG_PRINT("BLAKE3 Pipeline Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: BLAKE3 shader not found.\n");
+  }
+
+  // 9. Batched PBKDF2-HMAC-SHA256
+  DEBUG_PRINT("Loading PBKDF2 Shader...");
+  try {
+    auto pbkdf2Code = readFile("/usr/local/lib/pbkdf2_sha256.spv");
+    VkShaderModule pbkdf2Module = createShaderModule(ctx, pbkdf2Code);
+    shaderStageInfo.module = pbkdf2Module;
+    pipelineInfo.stage = shaderStageInfo;
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &pipelines[ALG_PBKDF2_SHA256]);
+    vkDestroyShaderModule(ctx->getDevice(), pbkdf2Module, nullptr);
+    DEBUG_PRINT("PBKDF2 Pipeline Created.");
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: PBKDF2 shader not found.\n");
+  }
+
+  // 10. Keystream-only variants (optional, used by the keystream pool)
+  keystreamPipelines.resize(ALG_COUNT, VK_NULL_HANDLE);
+  try {
+    auto aesKsCode = readFile("/usr/local/lib/aes256_ctr_ks.spv");
+    VkShaderModule aesKsModule = createShaderModule(ctx, aesKsCode);
+    shaderStageInfo.module = aesKsModule;
+    pipelineInfo.stage = shaderStageInfo;
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &keystreamPipelines[ALG_AES128_CTR]);
+    vkCreateComputePipelines(ctx->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo,
+                             nullptr, &keystreamPipelines[ALG_AES256_CTR]);
+    vkDestroyShaderModule(ctx->getDevice(), aesKsModule, nullptr);
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: AES keystream shader not found.\n");
+  }
+  try {
+    auto chachaKsCode = readFile("/usr/local/lib/chacha20_ks.spv");
+    VkShaderModule chachaKsModule = createShaderModule(ctx, chachaKsCode);
+    createChachaPipelines(chachaKsModule, keystreamPipelines);
+    vkDestroyShaderModule(ctx->getDevice(), chachaKsModule, nullptr);
+  } catch (...) {
+    fprintf(stderr, "[VC6] Warning: ChaCha20 keystream shader not found.\n");
+  }
 }
 
 void Batcher::createCommandBuffers() {
@@ -570,7 +1231,7 @@ void Batcher::createCommandBuffers() {
     // vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[i]);
     // vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE,
     // pipelineLayout,
-    //                        0, 1, &descriptorSet, 0, nullptr);
+    //                        0, 1, &descriptorSets[0], 0, nullptr);
     // Dispatch
     // vkCmdDispatch(cb, 65536, 1, 1);
     // vkEndCommandBuffer(cb);
@@ -584,12 +1245,15 @@ void Batcher::createSyncObjects() {
   vkCreateFence(ctx->getDevice(), &fenceInfo, nullptr, &computeFence);
 }
 
-void Batcher::workerLoop() {}
-void Batcher::dispatchBatch() {}
-
 // Include dedicated AES batchers
-#include "aes128_batcher.hpp"
+#include "../backend/vc6_backend.h"
+#include "../cpu/aes_ct.h"
+#include "../cpu/chacha20.h"
+#include "../cpu/pbkdf2.h"
 #include "aes256_batcher.hpp"
+#include "keystream_pool.hpp"
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
 
 // Backend handle structure
 struct VC6Backend {
@@ -601,10 +1265,23 @@ struct VC6Backend {
 // Extern C Interface (Updated with dedicated batchers)
 extern "C" {
 void *vc6_init() {
-  VC6Backend *backend = new VC6Backend();
-  backend->ctx = new VulkanContext();
-  backend->aes256 = new AES256Batcher(backend->ctx);
-  backend->chacha = new Batcher(backend->ctx);
+  VC6Backend *backend = nullptr;
+  try {
+    backend = new VC6Backend();
+    backend->ctx = new VulkanContext();
+    backend->aes256 = new AES256Batcher(backend->ctx);
+    backend->chacha = new Batcher(backend->ctx);
+  } catch (const std::exception &e) {
+    // No usable GPU (or a batcher failed to build its pipelines and
+    // rings): the provider keeps its CPU paths
+    DEBUG_PRINT("vc6_init failed: %s", e.what());
+    if (backend != nullptr) {
+      delete backend->aes256;
+      delete backend->ctx;
+      delete backend;
+    }
+    return nullptr;
+  }
   return (void *)backend;
 }
 
@@ -616,21 +1293,447 @@ void vc6_cleanup(void *handle) {
   delete backend;
 }
 
-int vc6_submit_job(void *handle, const unsigned char *in, unsigned char *out,
-                   size_t len, const unsigned char *key,
-                   const unsigned char *iv, int alg_id) {
-  VC6Backend *backend = (VC6Backend *)handle;
+// ChaCha jobs up to CHACHA_CPU_MAX bytes run on the CPU (vc6_chacha_xor()):
+// below that a dispatch's fixed cost dominates. Jobs up to
+// CHACHA_CPU_BUSY_MAX also stay on the CPU while the batcher is busy, and
+// any job the GPU refuses falls back to it. Both limits are starting
+// points for the bench suite's "cpu" ChaCha targets to tune.
+static const size_t CHACHA_CPU_MAX = 4096;
+static const size_t CHACHA_CPU_BUSY_MAX = 64 * 1024;
+
+static int chachaRounds(int alg_id) {
+  return alg_id == VC6_ALG_CHACHA12 ? 12 : alg_id == VC6_ALG_CHACHA8 ? 8 : 20;
+}
+
+// CPU stream jobs from this size are split across the task pool, in
+// slices of at least CPU_SLICE_MIN bytes
+static const size_t CPU_PARALLEL_MIN = 256 * 1024;
+static const size_t CPU_SLICE_MIN = 64 * 1024;
+
+// Runs fn(in, out, n, counter, skip) over block-aligned slices of the
+// stream [skip, skip + len) from 'iv', each with its own starting counter
+static void cpuStream(
+    const unsigned char *in, unsigned char *out, size_t len,
+    const unsigned char *iv, size_t skip, Batcher::Algorithm alg,
+    const std::function<void(const unsigned char *, unsigned char *, size_t,
+                             const unsigned char *, size_t)> &fn) {
+  if (len < CPU_PARALLEL_MIN) {
+    fn(in, out, len, iv, skip);
+    return;
+  }
+  size_t blockSize = Batcher::isChacha(alg) ? 64 : 16;
+  size_t blocks = (skip + len + blockSize - 1) / blockSize;
+  TaskPool::instance().parallelFor(
+      blocks, CPU_SLICE_MIN / blockSize, [&](size_t begin, size_t end) {
+        // Stream offsets of the slice, clipped to the data
+        size_t from = std::max(begin * blockSize, skip);
+        size_t to = std::min(end * blockSize, skip + len);
+        unsigned char counter[16];
+        memcpy(counter, iv, 16);
+        Batcher::advanceCounter(counter, begin, alg);
+        fn(in ? in + from - skip : nullptr, out + from - skip, to - from,
+           counter, from - begin * blockSize);
+      });
+}
 
+void vc6_chacha_cpu(const unsigned char *in, unsigned char *out, size_t len,
+                    const unsigned char *key, const unsigned char *iv,
+                    size_t skip, int alg_id) {
+  int rounds = chachaRounds(alg_id);
+  cpuStream(in, out, len, iv, skip, (Batcher::Algorithm)alg_id,
+            [&](const unsigned char *i, unsigned char *o, size_t n,
+                const unsigned char *ctr, size_t s) {
+              vc6_chacha_xor(o, i, n, key, ctr, s, rounds);
+            });
+  RuntimeStats::instance().cpu(alg_id, 1, len);
+}
+
+// Same for AES-CTR and the bitsliced kernel (vc6_aes_ct_ctr()), which
+// costs a key schedule per job and is slower per byte than ChaCha
+static const size_t AES_CPU_MAX = 2048;
+static const size_t AES_CPU_BUSY_MAX = 16 * 1024;
+
+int vc6_aes_ctr_cpu(const unsigned char *in, unsigned char *out, size_t len,
+                    const unsigned char *key, const unsigned char *iv,
+                    size_t skip, int alg_id) {
+  VC6_AES_CT_KEY k;
+  if (alg_id != VC6_ALG_AES128_CTR && alg_id != VC6_ALG_AES256_CTR)
+    return 0;
+  vc6_aes_ct_init(&k, key, alg_id == VC6_ALG_AES256_CTR ? 32 : 16);
+  cpuStream(in, out, len, iv, skip, (Batcher::Algorithm)alg_id,
+            [&](const unsigned char *i, unsigned char *o, size_t n,
+                const unsigned char *ctr, size_t s) {
+              vc6_aes_ct_ctr(&k, o, i, n, ctr, s);
+            });
+  OPENSSL_cleanse(&k, sizeof(k));
+  RuntimeStats::instance().cpu(alg_id, 1, len);
+  return 1;
+}
+
+void vc6_parallel_for(size_t n, void (*fn)(void *arg, size_t i), void *arg) {
+  TaskPool::instance().parallelFor(n, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      fn(arg, i);
+  });
+}
+
+void *vc6_task_run(void (*fn)(void *arg), void *arg) {
+  TaskGroup *group = new TaskGroup();
+  TaskPool::instance().run(*group, [fn, arg] { fn(arg); });
+  return group;
+}
+
+// ~TaskGroup() waits
+void vc6_task_wait(void *task) { delete (TaskGroup *)task; }
+
+static int submitJob(VC6Backend *backend, const unsigned char *in,
+                     unsigned char *out, size_t len, const unsigned char *key,
+                     const unsigned char *iv, int alg_id, size_t skip) {
   switch (alg_id) {
-  case 0: // ALG_AES256_CTR
-    return backend->aes256->submit(in, out, len, key, iv) ? 1 : 0;
-  case 1: // ALG_CHACHA20
+  case VC6_ALG_AES256_CTR:
+    if (len > AES_CPU_MAX &&
+        (len > AES_CPU_BUSY_MAX || !backend->aes256->busy()) &&
+        backend->aes256->submit(in, out, len, key, iv, skip))
+      return 1;
+    return vc6_aes_ctr_cpu(in, out, len, key, iv, skip, alg_id);
+  case VC6_ALG_AES128_CTR:
+    if (len > AES_CPU_MAX &&
+        (len > AES_CPU_BUSY_MAX || !backend->chacha->busy()) &&
+        backend->chacha->submit(in, out, len, key, iv,
+                                (Batcher::Algorithm)alg_id, skip))
+      return 1;
+    return vc6_aes_ctr_cpu(in, out, len, key, iv, skip, alg_id);
+  case VC6_ALG_CHACHA20:
+  case VC6_ALG_CHACHA12:
+  case VC6_ALG_CHACHA8:
+    if (len > CHACHA_CPU_MAX &&
+        (len > CHACHA_CPU_BUSY_MAX || !backend->chacha->busy()) &&
+        backend->chacha->submit(in, out, len, key, iv,
+                                (Batcher::Algorithm)alg_id, skip))
+      return 1;
+    vc6_chacha_cpu(in, out, len, key, iv, skip, alg_id);
+    return 1;
+  case VC6_ALG_AES256_ECB_ENC:
+  case VC6_ALG_AES256_ECB_DEC:
+  case VC6_ALG_AES256_CBC_DEC:
     return backend->chacha->submit(in, out, len, key, iv,
-                                   (Batcher::Algorithm)alg_id)
+                                   (Batcher::Algorithm)alg_id, skip)
                ? 1
                : 0;
   default:
     return 0;
   }
 }
+
+int vc6_submit_job(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *iv, int alg_id) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  return submitJob(backend, in, out, len, key, iv, alg_id, 0);
+}
+
+int vc6_submit_job_at(void *handle, const unsigned char *in,
+                      unsigned char *out, size_t len, const unsigned char *key,
+                      const unsigned char *iv, uint64_t offset, int alg_id) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  if (alg_id != VC6_ALG_AES128_CTR && alg_id != VC6_ALG_AES256_CTR &&
+      !Batcher::isChacha((Batcher::Algorithm)alg_id))
+    return 0;
+
+  size_t blockSize = Batcher::isChacha((Batcher::Algorithm)alg_id) ? 64 : 16;
+
+  // Starting counter = base IV + whole blocks before 'offset'
+  unsigned char counter[16];
+  memcpy(counter, iv, 16);
+  Batcher::advanceCounter(counter, offset / blockSize,
+                          (Batcher::Algorithm)alg_id);
+  size_t skip = offset % blockSize;
+
+  // Ranges larger than a ring are split; every chunk after the first one
+  // starts block-aligned.
+  while (len > 0) {
+    size_t chunk = RING_SIZE - skip;
+    if (chunk > len)
+      chunk = len;
+    if (!submitJob(backend, in, out, chunk, key, counter, alg_id, skip))
+      return 0;
+    Batcher::advanceCounter(counter, (skip + chunk) / blockSize,
+                            (Batcher::Algorithm)alg_id);
+    in += chunk;
+    out += chunk;
+    len -= chunk;
+    skip = 0;
+  }
+  return 1;
+}
+
+int vc6_submit_keystream(void *handle, unsigned char *out, size_t len,
+                         const unsigned char *key, const unsigned char *iv,
+                         int alg_id) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  if (alg_id != VC6_ALG_AES128_CTR && alg_id != VC6_ALG_AES256_CTR &&
+      !Batcher::isChacha((Batcher::Algorithm)alg_id))
+    return 0;
+  return backend->chacha->keystream(out, len, key, iv,
+                                    (Batcher::Algorithm)alg_id)
+             ? 1
+             : 0;
+}
+
+void *vc6_keystream_open(void *handle, const unsigned char *key,
+                         const unsigned char *iv, int alg_id,
+                         size_t window_bytes) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  try {
+    // AES-256 also runs on the generic batcher: the dedicated one has no
+    // keystream-only pipeline.
+    return new KeystreamPool(backend->chacha, (Batcher::Algorithm)alg_id, key,
+                             iv, window_bytes);
+  } catch (const std::exception &e) {
+    DEBUG_PRINT("vc6_keystream_open failed: %s", e.what());
+    return nullptr;
+  }
+}
+
+int vc6_keystream_xor(void *stream, const unsigned char *in,
+                      unsigned char *out, size_t len) {
+  return ((KeystreamPool *)stream)->xorInto(in, out, len) ? 1 : 0;
+}
+
+void vc6_keystream_close(void *stream) { delete (KeystreamPool *)stream; }
+
+int vc6_submit_gcm(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *ctr, const unsigned char *hpow,
+                   unsigned char *partials, int decrypt) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  if (len > VC6_GCM_FUSED_MAX)
+    return 0;
+  return backend->chacha->submitGcm(in, out, len, key, ctr, hpow, partials,
+                                    decrypt != 0)
+             ? 1
+             : 0;
+}
+
+int vc6_sha256_batch(void *handle, const unsigned char *const *msgs,
+                     const size_t *lens, size_t count,
+                     unsigned char *digests) {
+  VC6Backend *backend = (VC6Backend *)handle;
+
+  // Long messages would serialize a whole GPU thread; hash them here
+  std::vector<const unsigned char *> gpuMsgs;
+  std::vector<size_t> gpuLens, gpuIdx;
+  for (size_t i = 0; i < count; i++) {
+    if (lens[i] > VC6_SHA256_BATCH_MAX) {
+      SHA256(msgs[i], lens[i], digests + 32 * i);
+      RuntimeStats::instance().cpu(VC6_ALG_SHA256, 1, lens[i]);
+      continue;
+    }
+    gpuMsgs.push_back(msgs[i]);
+    gpuLens.push_back(lens[i]);
+    gpuIdx.push_back(i);
+  }
+  if (gpuMsgs.empty())
+    return 1;
+
+  std::vector<unsigned char> gpuDigests(32 * gpuMsgs.size());
+  if (!backend->chacha->submitSha256(gpuMsgs.data(), gpuLens.data(),
+                                     gpuMsgs.size(), gpuDigests.data()))
+    return 0;
+  for (size_t i = 0; i < gpuIdx.size(); i++)
+    memcpy(digests + 32 * gpuIdx[i], gpuDigests.data() + 32 * i, 32);
+  return 1;
+}
+
+int vc6_blake3_chunks(void *handle, const unsigned char *in, size_t len,
+                      uint64_t chunk_counter, unsigned char *cvs,
+                      size_t *count) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  if (len == 0 || len > VC6_BLAKE3_BATCH_MAX)
+    return 0;
+  return backend->chacha->submitBlake3(in, len, chunk_counter, cvs, count)
+             ? 1
+             : 0;
+}
+
+int vc6_pbkdf2_sha256_batch(void *handle, const VC6_PBKDF2_JOB *jobs,
+                            size_t count) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  const size_t W = Batcher::PBKDF2_ENTRY_WORDS;
+
+  // One entry per 32-byte output block, U_1 computed here
+  std::vector<uint32_t> entries;
+  std::vector<uint64_t> remaining;
+  for (size_t j = 0; j < count; j++) {
+    if (jobs[j].iterations == 0 || jobs[j].out_len == 0)
+      return 0;
+    VC6_HMAC_SHA256_KEY key;
+    vc6_hmac_sha256_key(&key, jobs[j].pass, jobs[j].pass_len);
+    size_t blocks = (jobs[j].out_len + 31) / 32;
+    for (size_t b = 0; b < blocks; b++) {
+      size_t e = entries.size();
+      entries.resize(e + W, 0);
+      memcpy(&entries[e], key.inner, 32);
+      memcpy(&entries[e + 8], key.outer, 32);
+      vc6_pbkdf2_sha256_u1(&entries[e + 16], &key, jobs[j].salt,
+                           jobs[j].salt_len, (uint32_t)(b + 1));
+      memcpy(&entries[e + 24], &entries[e + 16], 32);
+      remaining.push_back(jobs[j].iterations - 1);
+    }
+    OPENSSL_cleanse(&key, sizeof(key));
+  }
+
+  // Passes of at most VC6_PBKDF2_PASS_ITERATIONS keep each dispatch short
+  // and let other jobs use the GPU in between; finished entries drop out
+  std::vector<uint32_t> active;
+  std::vector<size_t> index;
+  int ok = 1;
+  for (;;) {
+    active.clear();
+    index.clear();
+    for (size_t i = 0; i < remaining.size(); i++) {
+      if (remaining[i] == 0)
+        continue;
+      uint64_t n = std::min<uint64_t>(remaining[i], VC6_PBKDF2_PASS_ITERATIONS);
+      entries[i * W + 32] = (uint32_t)n;
+      active.insert(active.end(), &entries[i * W], &entries[i * W] + W);
+      index.push_back(i);
+    }
+    if (index.empty())
+      break;
+    if (!backend->chacha->submitPbkdf2(active.data(), index.size())) {
+      ok = 0;
+      break;
+    }
+    for (size_t k = 0; k < index.size(); k++) {
+      size_t i = index[k];
+      memcpy(&entries[i * W + 16], &active[k * W + 16], 64);
+      remaining[i] -= entries[i * W + 32];
+    }
+  }
+
+  if (ok) {
+    size_t e = 0;
+    for (size_t j = 0; j < count; j++) {
+      for (size_t off = 0; off < jobs[j].out_len; off += 32, e++)
+        vc6_sha256_store(jobs[j].out + off, &entries[e * W + 24],
+                         std::min<size_t>(32, jobs[j].out_len - off));
+      // Counted per derivation here: submitPbkdf2() only runs passes
+      RuntimeStats::instance().gpu(VC6_ALG_PBKDF2_SHA256, 1, jobs[j].out_len);
+    }
+  }
+  OPENSSL_cleanse(entries.data(), entries.size() * 4);
+  OPENSSL_cleanse(active.data(), active.size() * 4);
+  return ok;
+}
+
+static_assert(VC6_ALG_COUNT == Batcher::ALG_COUNT,
+              "vc6_backend.h algorithm ids out of sync");
+
+int vc6_get_stats(VC6_STATS *out) {
+  RuntimeStats::instance().snapshot(out);
+  return 1;
+}
+
+void vc6_reset_stats(void) { RuntimeStats::instance().reset(); }
+
+void vc6_stats_cpu(int alg_id, uint64_t jobs, uint64_t bytes) {
+  RuntimeStats::instance().cpu(alg_id, jobs, bytes);
+}
+
+const char *vc6_alg_name(int alg_id) {
+  static const char *const names[VC6_ALG_COUNT] = {
+      "AES-128-CTR",     "AES-256-CTR",     "ChaCha20",
+      "AES-256-ECB-ENC", "AES-256-ECB-DEC", "AES-256-CBC",
+      "AES-256-XTS-ENC", "AES-256-XTS-DEC", "AES-256-GCM-ENC",
+      "AES-256-GCM-DEC", "ChaCha12",        "ChaCha8",
+      "SHA2-256",        "BLAKE3",          "PBKDF2-SHA256"};
+  return alg_id >= 0 && alg_id < VC6_ALG_COUNT ? names[alg_id] : "unknown";
+}
+
+uint64_t vc6_trace_now(void) { return Trace::now(); }
+
+void vc6_trace_span(const char *name, uint64_t start, uint64_t bytes,
+                    uint64_t batch) {
+  Trace::span("provider", name, start, bytes, batch);
+}
+
+void vc6_trace_instant(const char *name, uint64_t bytes, uint64_t batch) {
+  Trace::instant("provider", name, bytes, batch);
+}
+
+uint64_t vc6_trace_batch_id(void) { return Trace::nextBatch(); }
+
+static_assert(VC6_STAGE_COUNT == StageProfile::STAGE_COUNT &&
+                  VC6_STAGE_BUCKETS == StageProfile::BUCKETS,
+              "vc6_backend.h stage constants out of sync");
+static_assert(sizeof(VC6_STAGE_HISTOGRAM) == sizeof(StageProfile::Histogram),
+              "VC6_STAGE_HISTOGRAM layout out of sync");
+
+int vc6_get_stage_histograms(void *handle, int source,
+                             VC6_STAGE_HISTOGRAM *out) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  StageProfile::Histogram h[StageProfile::STAGE_COUNT];
+  switch (source) {
+  case VC6_PROFILE_BATCHER:
+    backend->chacha->stageProfile().snapshot(h);
+    break;
+  case VC6_PROFILE_AES256:
+    backend->aes256->stageProfile().snapshot(h);
+    break;
+  default:
+    return 0;
+  }
+  for (int i = 0; i < StageProfile::STAGE_COUNT; i++) {
+    out[i].count = h[i].count;
+    out[i].total_ns = h[i].totalNs;
+    out[i].min_ns = h[i].minNs;
+    out[i].max_ns = h[i].maxNs;
+    memcpy(out[i].buckets, h[i].buckets, sizeof(out[i].buckets));
+  }
+  return 1;
+}
+
+void vc6_reset_stage_histograms(void *handle) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  backend->chacha->stageProfile().reset();
+  backend->aes256->stageProfile().reset();
+}
+
+const char *vc6_stage_name(int stage) {
+  return StageProfile::stageName((StageProfile::Stage)stage);
+}
+
+int vc6_submit_xts(void *handle, const unsigned char *in, unsigned char *out,
+                   size_t len, const unsigned char *key,
+                   const unsigned char *tweak, size_t sector_size,
+                   int decrypt) {
+  VC6Backend *backend = (VC6Backend *)handle;
+  if (sector_size == 0 || sector_size % 16 != 0 || len % 16 != 0)
+    return 0;
+
+  // Split at ring size; a chunk may start inside a sector (firstBlock)
+  uint64_t sectorBlocks = sector_size / 16;
+  uint64_t block = 0;
+  while (len > 0) {
+    size_t chunk = len < RING_SIZE ? len : RING_SIZE;
+    unsigned char t[16];
+    memcpy(t, tweak, 16);
+    // t += block / sectorBlocks (128-bit LE)
+    uint64_t add = block / sectorBlocks;
+    for (int i = 0; i < 16 && add != 0; i++) {
+      uint64_t sum = t[i] + (add & 0xFF);
+      t[i] = sum & 0xFF;
+      add = (add >> 8) + (sum >> 8);
+    }
+    if (!backend->chacha->submitXts(in, out, chunk, key, t, sector_size,
+                                    block % sectorBlocks, decrypt != 0))
+      return 0;
+    block += chunk / 16;
+    in += chunk;
+    out += chunk;
+    len -= chunk;
+  }
+  return 1;
+}
 }
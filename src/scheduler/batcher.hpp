@@ -2,10 +2,9 @@
 
 #include "../backend/memory.hpp"
 #include "../backend/vulkan_ctx.hpp"
-#include <atomic>
-#include <condition_variable>
+#include "stage_profile.hpp"
+#include "task_pool.hpp"
 #include <mutex>
-#include <thread>
 #include <vector>
 
 class Batcher {
@@ -13,44 +12,158 @@ public:
   Batcher(VulkanContext *ctx);
   ~Batcher();
 
-  // Algorithm IDs for OpenSSL Provider
-  enum Algorithm { ALG_AES256_CTR = 0, ALG_CHACHA20 = 1, ALG_COUNT = 2 };
+  // Algorithm IDs for OpenSSL Provider (match VC6_ALG_* in vc6_backend.h)
+  enum Algorithm {
+    ALG_AES128_CTR = 0,
+    ALG_AES256_CTR = 1,
+    ALG_CHACHA20 = 2,
+    ALG_AES256_ECB_ENC = 3,
+    ALG_AES256_ECB_DEC = 4,
+    ALG_AES256_CBC_DEC = 5, // iv = previous ciphertext block
+    ALG_AES256_XTS_ENC = 6, // submitXts() only
+    ALG_AES256_XTS_DEC = 7,
+    ALG_AES256_GCM_ENC = 8, // submitGcm() only
+    ALG_AES256_GCM_DEC = 9,
+    ALG_CHACHA12 = 10, // chacha20.comp specialized to 12 / 8 rounds
+    ALG_CHACHA8 = 11,
+    ALG_SHA256 = 12, // submitSha256() only
+    ALG_BLAKE3 = 13, // submitBlake3() only
+    ALG_PBKDF2_SHA256 = 14, // submitPbkdf2() only
+    ALG_COUNT = 15
+  };
+
+  // ChaCha20 and its reduced-round variants: 64-byte blocks, same IV layout
+  static bool isChacha(Algorithm alg) {
+    return alg == ALG_CHACHA20 || alg == ALG_CHACHA12 || alg == ALG_CHACHA8;
+  }
 
   // Returns true on success, false on error
+  // Block modes (ECB/CBC) need 'len' to be a multiple of 16 and skip == 0.
+  // 'skip' bytes of keystream are discarded before 'in' (0 <= skip < block
+  // size), i.e. the data starts part-way into the block addressed by 'iv'.
   bool submit(const unsigned char *in, unsigned char *out, size_t len,
-              const unsigned char *key, const unsigned char *iv, Algorithm alg);
+              const unsigned char *key, const unsigned char *iv, Algorithm alg,
+              size_t skip = 0);
+
+  // Writes 'len' bytes of raw keystream (no input) starting at the block
+  // addressed by 'iv'. Uses the *_ks.spv pipelines; false if unavailable.
+  bool keystream(unsigned char *out, size_t len, const unsigned char *key,
+                 const unsigned char *iv, Algorithm alg);
+
+  // AES-256-XTS over consecutive sectors of 'sectorSize' bytes (multiple of
+  // 16). key = K1 || K2 (64 bytes); sector i uses tweak + i (128-bit LE).
+  // 'firstBlock' is the block index inside the first sector where 'in'
+  // starts, so one large sector can be split over several calls.
+  // 'len' must be whole blocks; ciphertext stealing is up to the caller.
+  bool submitXts(const unsigned char *in, unsigned char *out, size_t len,
+                 const unsigned char *key, const unsigned char *tweak,
+                 size_t sectorSize, size_t firstBlock, bool decrypt);
+
+  // AES-256-GCM fused pass (aes256_gcm.comp): CTR from the counter block
+  // 'ctr' (inc32) over 'len' bytes (whole blocks) plus one GHASH partial of
+  // the ciphertext per 256-block workgroup, written to 'partials' (16 bytes
+  // each). 'hpow' = H^1 .. H^256 (4096 bytes, GCM byte order).
+  bool submitGcm(const unsigned char *in, unsigned char *out, size_t len,
+                 const unsigned char *key, const unsigned char *ctr,
+                 const unsigned char *hpow, unsigned char *partials,
+                 bool decrypt);
+
+  // Multi-buffer SHA-256 (sha256.comp): hashes 'count' independent
+  // messages, one GPU thread each, into 'digests' (32 bytes per message).
+  // Batches larger than a ring are split into several dispatches; false if
+  // the pipeline is missing or a single message does not fit a ring.
+  bool submitSha256(const unsigned char *const *msgs, const size_t *lens,
+                    size_t count, unsigned char *digests);
+
+  // BLAKE3 chunk pass (blake3.comp): hashes 'len' bytes (1 .. ring size)
+  // starting at chunk index 'chunkCounter' into one subtree CV per 256
+  // chunks, written to 'cvs' (32 bytes each, *count of them). The CVs are
+  // never root nodes; the caller merges them.
+  bool submitBlake3(const unsigned char *in, size_t len, uint64_t chunkCounter,
+                    unsigned char *cvs, size_t *count);
+
+  // One pass of PBKDF2-HMAC-SHA256 (pbkdf2_sha256.comp) over 'count'
+  // entries of PBKDF2_ENTRY_WORDS words: { inner[8], outer[8], U[8], T[8],
+  // iterations, pad[3] }. Runs each entry's iterations and writes U and T
+  // back in place; batches larger than a ring are split.
+  static constexpr size_t PBKDF2_ENTRY_WORDS = 36;
+  bool submitPbkdf2(uint32_t *entries, size_t count);
+
+  // Advance the stream position held in 'iv' by 'blocks' cipher blocks
+  // (AES: 128-bit Big-Endian counter, ChaCha: 32-bit LE counter word)
+  static void advanceCounter(unsigned char *iv, uint64_t blocks,
+                             Algorithm alg);
+
+  // True while another submit holds the rings. A routing hint only: it can
+  // change right after the call returns.
+  bool busy();
+
+  // Per-stage latency of every dispatch since construction or reset()
+  StageProfile &stageProfile() { return profile; }
 
 private:
   VulkanContext *ctx;
   RingBuffer inputRing;
   RingBuffer outputRing;
 
-  std::thread workerThread;
-  std::atomic<bool> running;
+  // Non-unified memory (VulkanContext::isUnifiedMemory()): the shaders use
+  // these device-local rings, at the same offsets; the mapped rings above
+  // become their staging buffers
+  bool staging;
+  RingBuffer deviceInput{};
+  RingBuffer deviceOutput{};
+  const RingBuffer &shaderInput() const {
+    return staging ? deviceInput : inputRing;
+  }
+  const RingBuffer &shaderOutput() const {
+    return staging ? deviceOutput : outputRing;
+  }
 
-  std::mutex queueMutex;
-  std::condition_variable queueCv;
+  // Serializes submit(): rings, params and descriptors are shared
+  std::mutex submitMutex;
+  VkDeviceSize ringOffset = 0;
 
-  // Simple job tracking for this MVP
-  struct PendingJob {
-    const unsigned char *in;
-    unsigned char *out;
-    size_t len;
-  };
-
-  void workerLoop();
-  void dispatchBatch();
+  // Shared body of submit()/keystream(); 'in' may be nullptr for keystream.
+  // 'scrub' wipes the key from the params slots and the job from the rings
+  // before submitMutex is released.
+  bool run(const unsigned char *in, unsigned char *out, size_t len,
+           const unsigned char *key, const unsigned char *iv, Algorithm alg,
+           size_t skip, const std::vector<VkPipeline> &pipelineSet,
+           bool scrub);
+  // Fills params slot 'slot' for run(); on a pool worker, next to the copy
+  void writeParams(const unsigned char *key, const unsigned char *iv,
+                   Algorithm alg, size_t span, bool blockMode,
+                   size_t slot = 0);
+  // 'extra' receives 'extraLen' bytes the shader writes after the data.
+  // 'setup' (tasks filling the params) is waited for after the input copy.
+  // 'slices' > 1 splits a staged job as described at dispatch(). 'scrub'
+  // zeroes the job's ring ranges once the output is copied.
+  bool execute(const unsigned char *in, unsigned char *out, size_t len,
+               size_t skip, size_t span, size_t blockSize, VkCommandBuffer cb,
+               VkPipeline pipeline, unsigned char *extra = nullptr,
+               size_t extraLen = 0, TaskGroup *setup = nullptr,
+               size_t slices = 1, bool scrub = false);
+  // Building blocks of execute() for jobs that stage their own input
+  VkDeviceSize reserveRing(size_t bytes);
+  bool dispatch(VkDeviceSize offset, size_t inBytes, size_t outBytes,
+                uint32_t threads, VkCommandBuffer cb, VkPipeline pipeline,
+                size_t slices = 1);
 
   // Vulkan Objects
   std::vector<VkPipeline> pipelines; // Indexed by Algorithm enum
+  std::vector<VkPipeline> keystreamPipelines; // Same, KEYSTREAM_ONLY shaders
   VkPipelineLayout pipelineLayout;
   VkDescriptorSetLayout descriptorSetLayout;
   VkDescriptorPool descriptorPool;
-  VkDescriptorSet descriptorSet;
+  // One per params slot; slice j of a staged job uses set and slot j
+  std::vector<VkDescriptorSet> descriptorSets;
   VkCommandPool commandPool;
   std::vector<VkCommandBuffer> commandBuffers;
   VkFence computeFence;
 
+  StageProfile profile;
+  GpuTimer gpuTimer;
+
   // Parameter Buffer (UBO)
   VkBuffer paramBuffer;
   VkDeviceMemory paramMemory;
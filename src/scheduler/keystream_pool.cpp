@@ -0,0 +1,129 @@
+#include "keystream_pool.hpp"
+#include <cstring>
+#include <openssl/crypto.h>
+#include <stdexcept>
+
+#define DEBUG_PRINT(fmt, ...) fprintf(stderr, "[VC6] " fmt "\n", ##__VA_ARGS__)
+
+// Refill granularity: one dispatch per chunk, 4 chunks per window so the
+// GPU refills one quarter while the CPU drains the rest.
+#define KS_CHUNKS_PER_WINDOW 4
+#define KS_MIN_CHUNK (64 * 256)       // One full workgroup of ChaCha blocks
+#define KS_MAX_CHUNK (4 * 1024 * 1024) // Keeps a single dispatch short
+
+KeystreamPool::KeystreamPool(Batcher *batcher, Batcher::Algorithm alg,
+                             const unsigned char *key, const unsigned char *iv,
+                             size_t windowBytes)
+    : batcher(batcher), alg(alg) {
+  if (alg != Batcher::ALG_AES128_CTR && alg != Batcher::ALG_AES256_CTR &&
+      !Batcher::isChacha(alg))
+    throw std::runtime_error("keystream pool: not a stream cipher");
+
+  memset(this->key, 0, sizeof(this->key));
+  memcpy(this->key, key, alg == Batcher::ALG_AES128_CTR ? 16 : 32);
+  memcpy(counter, iv, 16);
+
+  // Chunks are a multiple of 64 bytes, i.e. whole AES and ChaCha blocks
+  chunkSize = windowBytes / KS_CHUNKS_PER_WINDOW;
+  if (chunkSize < KS_MIN_CHUNK)
+    chunkSize = KS_MIN_CHUNK;
+  if (chunkSize > KS_MAX_CHUNK)
+    chunkSize = KS_MAX_CHUNK;
+  chunkSize &= ~(size_t)63;
+
+  size_t chunks = (windowBytes + chunkSize - 1) / chunkSize;
+  if (chunks < 2)
+    chunks = 2;
+  window.resize(chunks * chunkSize);
+
+  producer = std::thread(&KeystreamPool::producerLoop, this);
+}
+
+KeystreamPool::~KeystreamPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  cv.notify_all();
+  if (producer.joinable())
+    producer.join();
+
+  // Unserved keystream is as sensitive as the key itself
+  OPENSSL_cleanse(window.data(), window.size());
+  OPENSSL_cleanse(key, sizeof(key));
+}
+
+void KeystreamPool::producerLoop() {
+  size_t blockSize = Batcher::isChacha(alg) ? 64 : 16;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (running) {
+    cv.wait(lock, [this] {
+      return !running || produced - consumed + chunkSize <= window.size();
+    });
+    if (!running)
+      break;
+
+    // The consumer never touches [produced, produced + chunkSize) until
+    // 'produced' is advanced, so the GPU write can run unlocked.
+    size_t pos = produced % window.size();
+    lock.unlock();
+    bool ok =
+        batcher->keystream(window.data() + pos, chunkSize, key, counter, alg);
+    lock.lock();
+
+    if (!ok) {
+      DEBUG_PRINT("Keystream pool: generation failed");
+      failed = true;
+      cv.notify_all();
+      break;
+    }
+
+    Batcher::advanceCounter(counter, chunkSize / blockSize, alg);
+    produced += chunkSize;
+    cv.notify_all();
+  }
+}
+
+bool KeystreamPool::xorInto(const unsigned char *in, unsigned char *out,
+                            size_t len) {
+  while (len > 0) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return failed || produced > consumed; });
+    if (produced == consumed)
+      return false;
+
+    size_t pos = consumed % window.size();
+    size_t n = produced - consumed;
+    if (n > window.size() - pos)
+      n = window.size() - pos;
+    if (n > len)
+      n = len;
+    lock.unlock();
+
+    const unsigned char *ks = window.data() + pos;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      uint64_t a, b;
+      memcpy(&a, in + i, 8);
+      memcpy(&b, ks + i, 8);
+      a ^= b;
+      memcpy(out + i, &a, 8);
+    }
+    for (; i < n; i++)
+      out[i] = in[i] ^ ks[i];
+    // Served keystream would give away the plaintext of this range; the
+    // producer does not reuse it before 'consumed' moves past it
+    OPENSSL_cleanse(window.data() + pos, n);
+
+    lock.lock();
+    consumed += n;
+    lock.unlock();
+    cv.notify_all();
+
+    in += n;
+    out += n;
+    len -= n;
+  }
+  return true;
+}
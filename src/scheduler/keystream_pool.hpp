@@ -0,0 +1,53 @@
+#pragma once
+
+#include "batcher.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Keystream-ahead window for one CTR/ChaCha20 stream.
+//
+// The keystream only depends on key and counter, so a background thread
+// keeps the next 'windowBytes' of it generated on the GPU (KEYSTREAM_ONLY
+// shaders) while the caller is busy elsewhere, e.g. waiting on the network.
+// xorInto() then only XORs against ready keystream on the CPU and only
+// blocks when the consumer has caught up with the producer.
+//
+// Keystream is wiped as it is served. One consumer per pool: the stream
+// position is shared state.
+class KeystreamPool {
+public:
+  // 'key'/'iv' follow vc6_submit_job(); the window is rounded to whole
+  // refill chunks. Throws std::runtime_error if the algorithm is not a
+  // stream mode.
+  KeystreamPool(Batcher *batcher, Batcher::Algorithm alg,
+                const unsigned char *key, const unsigned char *iv,
+                size_t windowBytes);
+  ~KeystreamPool();
+
+  // out = in ^ next 'len' bytes of keystream. Returns false if keystream
+  // generation failed (the stream is unusable afterwards).
+  bool xorInto(const unsigned char *in, unsigned char *out, size_t len);
+
+private:
+  Batcher *batcher;
+  Batcher::Algorithm alg;
+  unsigned char key[32];
+  unsigned char counter[16]; // Next block the producer will generate
+
+  std::vector<unsigned char> window;
+  size_t chunkSize;
+
+  // Absolute stream positions in bytes; [consumed, produced) is ready
+  uint64_t produced = 0;
+  uint64_t consumed = 0;
+  bool running = true;
+  bool failed = false;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread producer;
+
+  void producerLoop();
+};
@@ -0,0 +1,99 @@
+#include "runtime_stats.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <cstring>
+
+// Raises 'a' to at least 'v'
+static void atomicMax(std::atomic<uint64_t> &a, uint64_t v) {
+  uint64_t cur = a.load(std::memory_order_relaxed);
+  while (cur < v &&
+         !a.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+    ;
+}
+
+RuntimeStats &RuntimeStats::instance() {
+  static RuntimeStats stats;
+  return stats;
+}
+
+void RuntimeStats::gpu(int alg, uint64_t jobs, uint64_t bytes) {
+  if (alg < 0 || alg >= VC6_ALG_COUNT)
+    return;
+  gpuCounters[alg].jobs.fetch_add(jobs, std::memory_order_relaxed);
+  gpuCounters[alg].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RuntimeStats::cpu(int alg, uint64_t jobs, uint64_t bytes) {
+  if (alg < 0 || alg >= VC6_ALG_COUNT)
+    return;
+  cpuCounters[alg].jobs.fetch_add(jobs, std::memory_order_relaxed);
+  cpuCounters[alg].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RuntimeStats::dispatch(uint64_t bytes, uint64_t ringEnd) {
+  int bucket = bytes == 0 ? 0 : 63 - __builtin_clzll(bytes);
+  if (bucket >= VC6_STATS_BUCKETS)
+    bucket = VC6_STATS_BUCKETS - 1;
+  batchBytes[bucket].fetch_add(1, std::memory_order_relaxed);
+  atomicMax(ringHighWater, ringEnd);
+}
+
+void RuntimeStats::snapshot(VC6_STATS *out) {
+  memset(out, 0, sizeof(*out));
+  for (int i = 0; i < VC6_ALG_COUNT; i++) {
+    out->gpu_jobs[i] = gpuCounters[i].jobs.load(std::memory_order_relaxed);
+    out->gpu_bytes[i] = gpuCounters[i].bytes.load(std::memory_order_relaxed);
+    out->cpu_jobs[i] = cpuCounters[i].jobs.load(std::memory_order_relaxed);
+    out->cpu_bytes[i] = cpuCounters[i].bytes.load(std::memory_order_relaxed);
+  }
+  for (int i = 0; i < VC6_STATS_BUCKETS; i++)
+    out->batch_bytes[i] = batchBytes[i].load(std::memory_order_relaxed);
+  out->queue_depth = queueDepth.load(std::memory_order_relaxed);
+  out->queue_depth_max = queueDepthMax.load(std::memory_order_relaxed);
+  out->ring_high_water = ringHighWater.load(std::memory_order_relaxed);
+  out->wait_count = waitCount.load(std::memory_order_relaxed);
+  out->wait_ns = waitNs.load(std::memory_order_relaxed);
+}
+
+// The current queue depth is live state and survives a reset
+void RuntimeStats::reset() {
+  for (int i = 0; i < VC6_ALG_COUNT; i++) {
+    gpuCounters[i].jobs = 0;
+    gpuCounters[i].bytes = 0;
+    cpuCounters[i].jobs = 0;
+    cpuCounters[i].bytes = 0;
+  }
+  for (int i = 0; i < VC6_STATS_BUCKETS; i++)
+    batchBytes[i] = 0;
+  queueDepthMax = queueDepth.load();
+  ringHighWater = 0;
+  waitCount = 0;
+  waitNs = 0;
+}
+
+StatsLock::StatsLock(std::mutex &m, uint64_t bytes)
+    : lock(m, std::defer_lock), bytes(bytes), enqueued(Trace::now()),
+      lastBatch(Trace::currentBatch()) {
+  RuntimeStats &s = RuntimeStats::instance();
+  atomicMax(s.queueDepthMax,
+            s.queueDepth.fetch_add(1, std::memory_order_relaxed) + 1);
+  if (!lock.try_lock()) {
+    auto t = std::chrono::steady_clock::now();
+    lock.lock();
+    s.waitCount.fetch_add(1, std::memory_order_relaxed);
+    s.waitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - t)
+                           .count(),
+                       std::memory_order_relaxed);
+  }
+  Trace::span("batcher", "queue", enqueued, bytes);
+}
+
+StatsLock::~StatsLock() {
+  lock.unlock();
+  RuntimeStats::instance().queueDepth.fetch_sub(1, std::memory_order_relaxed);
+  // The job's (last) dispatch, if it got that far
+  uint64_t batch = Trace::currentBatch();
+  Trace::span("batcher", "job", enqueued, bytes,
+              batch != lastBatch ? batch : 0);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../backend/vc6_backend.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Process-wide counters behind vc6_get_stats(). Updated with relaxed
+// atomics from the batchers (GPU work, dispatch sizes, queueing) and from
+// the provider through vc6_stats_cpu() (work done on the CPU instead);
+// a snapshot is not atomic across counters.
+class RuntimeStats {
+public:
+  static RuntimeStats &instance();
+
+  // 'alg' is a VC6_ALG_* id; 'jobs' API calls (or messages for batch APIs)
+  void gpu(int alg, uint64_t jobs, uint64_t bytes);
+  void cpu(int alg, uint64_t jobs, uint64_t bytes);
+
+  // One GPU dispatch of 'bytes' input, ending at ring offset 'ringEnd'
+  void dispatch(uint64_t bytes, uint64_t ringEnd);
+
+  void snapshot(VC6_STATS *out);
+  void reset();
+
+private:
+  friend class StatsLock;
+
+  struct Counter {
+    std::atomic<uint64_t> jobs{0};
+    std::atomic<uint64_t> bytes{0};
+  };
+  Counter gpuCounters[VC6_ALG_COUNT];
+  Counter cpuCounters[VC6_ALG_COUNT];
+  std::atomic<uint64_t> batchBytes[VC6_STATS_BUCKETS] = {};
+  std::atomic<uint64_t> queueDepth{0};
+  std::atomic<uint64_t> queueDepthMax{0};
+  std::atomic<uint64_t> ringHighWater{0};
+  std::atomic<uint64_t> waitCount{0};
+  std::atomic<uint64_t> waitNs{0};
+};
+
+// Takes a batcher's submit mutex for one job of 'bytes' bytes, counting the
+// caller in the queue depth until it is released and the time spent
+// blocked in the wait counters. With tracing on, also records the job's
+// "queue" (waiting for the mutex) and "job" (whole submit) spans.
+class StatsLock {
+public:
+  explicit StatsLock(std::mutex &m, uint64_t bytes = 0);
+  ~StatsLock();
+  StatsLock(const StatsLock &) = delete;
+  StatsLock &operator=(const StatsLock &) = delete;
+
+private:
+  std::unique_lock<std::mutex> lock;
+  uint64_t bytes;
+  uint64_t enqueued;  // Trace clock, 0 when tracing is off
+  uint64_t lastBatch; // Thread's batch id before this job
+};
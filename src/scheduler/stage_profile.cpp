@@ -0,0 +1,102 @@
+#include "stage_profile.hpp"
+#include <cstring>
+#include <vector>
+
+#define DEBUG_PRINT(fmt, ...) fprintf(stderr, "[VC6] " fmt "\n", ##__VA_ARGS__)
+
+const char *StageProfile::stageName(Stage stage) {
+  static const char *const names[STAGE_COUNT] = {
+      "copy_in", "flush", "descriptors", "record",
+      "submit",  "gpu",   "wait",        "copy_out"};
+  return stage >= 0 && stage < STAGE_COUNT ? names[stage] : "unknown";
+}
+
+void StageProfile::record(Stage stage, uint64_t ns) {
+  int bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+  if (bucket >= BUCKETS)
+    bucket = BUCKETS - 1;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Histogram &h = stages[stage];
+  if (h.count == 0 || ns < h.minNs)
+    h.minNs = ns;
+  if (ns > h.maxNs)
+    h.maxNs = ns;
+  h.count++;
+  h.totalNs += ns;
+  h.buckets[bucket]++;
+}
+
+void StageProfile::snapshot(Histogram *out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  memcpy(out, stages, sizeof(stages));
+}
+
+void StageProfile::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  memset(stages, 0, sizeof(stages));
+}
+
+GpuTimer::GpuTimer(VkDevice device, VkPhysicalDevice physicalDevice,
+                   uint32_t queueFamilyIndex)
+    : device(device) {
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount,
+                                           nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount,
+                                           families.data());
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+  uint32_t validBits = queueFamilyIndex < familyCount
+                           ? families[queueFamilyIndex].timestampValidBits
+                           : 0;
+  if (validBits == 0 || props.limits.timestampPeriod <= 0.0f) {
+    DEBUG_PRINT("GPU timestamps not supported; no gpu stage in profiles");
+    return;
+  }
+  mask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+  period = props.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = 2;
+  if (vkCreateQueryPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    pool = VK_NULL_HANDLE;
+}
+
+GpuTimer::~GpuTimer() {
+  if (pool != VK_NULL_HANDLE)
+    vkDestroyQueryPool(device, pool, nullptr);
+}
+
+void GpuTimer::begin(VkCommandBuffer cb) {
+  recorded = false;
+  if (pool == VK_NULL_HANDLE)
+    return;
+  vkCmdResetQueryPool(cb, pool, 0, 2);
+  vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 0);
+}
+
+void GpuTimer::end(VkCommandBuffer cb) {
+  if (pool == VK_NULL_HANDLE)
+    return;
+  vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, 1);
+  recorded = true;
+}
+
+bool GpuTimer::read(uint64_t *ns) {
+  if (!recorded)
+    return false;
+  recorded = false;
+  uint64_t ticks[2];
+  if (vkGetQueryPoolResults(device, pool, 0, 2, sizeof(ticks), ticks,
+                            sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    return false;
+  // Masked difference survives a counter wrap between the two stamps
+  *ns = (uint64_t)((double)((ticks[1] - ticks[0]) & mask) * period);
+  return true;
+}
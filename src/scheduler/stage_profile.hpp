@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+// Per-stage latency histograms for one batcher.
+//
+// Each submit is split into the stages below; host stages are timed with
+// steady_clock, GPU is the device time between the two timestamps written
+// around the dispatch (GpuTimer). GPU overlaps SUBMIT and WAIT, so stages
+// do not add up to the wall time of a submit.
+class StageProfile {
+public:
+  enum Stage {
+    COPY_IN,     // Input (and params) into the mapped rings
+    FLUSH,       // vkFlushMappedMemoryRanges
+    DESCRIPTORS, // vkUpdateDescriptorSets
+    RECORD,      // Command buffer recording
+    SUBMIT,      // vkQueueSubmit
+    GPU,         // Device time of the dispatch (timestamp queries)
+    WAIT,        // Wait for completion and invalidate
+    COPY_OUT,    // Output out of the mapped ring
+    STAGE_COUNT
+  };
+
+  // Bucket i counts samples in [2^i, 2^(i+1)) ns; bucket 0 also takes 0 and
+  // the last one everything from 2^31 ns (~2 s) up
+  static constexpr int BUCKETS = 32;
+
+  struct Histogram {
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint64_t buckets[BUCKETS];
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  StageProfile() { reset(); }
+
+  static const char *stageName(Stage stage);
+
+  void record(Stage stage, uint64_t ns);
+
+  // Records the time since 'since' and restarts it, so consecutive stages
+  // can share one time point
+  void mark(Stage stage, Clock::time_point &since) {
+    Clock::time_point now = Clock::now();
+    record(stage, (uint64_t)std::chrono::duration_cast<
+                      std::chrono::nanoseconds>(now - since)
+                      .count());
+    since = now;
+  }
+
+  // Copies all STAGE_COUNT histograms to 'out'
+  void snapshot(Histogram *out);
+  void reset();
+
+private:
+  std::mutex mutex;
+  Histogram stages[STAGE_COUNT];
+};
+
+// Two-entry timestamp query pool bracketing one dispatch. Not thread-safe:
+// used under the owning batcher's submit mutex. If the compute queue has no
+// timestamp support, begin()/end() record nothing and read() fails.
+class GpuTimer {
+public:
+  GpuTimer(VkDevice device, VkPhysicalDevice physicalDevice,
+           uint32_t queueFamilyIndex);
+  ~GpuTimer();
+
+  bool supported() const { return pool != VK_NULL_HANDLE; }
+
+  // Both are recorded into the command buffer around vkCmdDispatch
+  void begin(VkCommandBuffer cb);
+  void end(VkCommandBuffer cb);
+
+  // Device time between begin() and end() once the submission completed
+  bool read(uint64_t *ns);
+
+private:
+  VkDevice device;
+  VkQueryPool pool = VK_NULL_HANDLE;
+  uint64_t mask = 0;   // Valid timestamp bits
+  double period = 0.0; // Nanoseconds per tick
+  bool recorded = false;
+};
@@ -0,0 +1,181 @@
+#include "task_pool.hpp"
+#include "../cpu/stream_copy.h"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+#define DEBUG_PRINT(fmt, ...) fprintf(stderr, "[VC6] " fmt "\n", ##__VA_ARGS__)
+
+namespace {
+
+const size_t NOT_A_WORKER = (size_t)-1;
+thread_local size_t workerIndex = NOT_A_WORKER;
+
+size_t poolSize() {
+  const char *env = getenv("VC6_CPU_THREADS");
+  if (env != nullptr && *env != '\0')
+    return (size_t)strtoul(env, nullptr, 10);
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores > 1 ? cores - 1 : 0;
+}
+
+void plainCopy(void *dst, const void *src, size_t len) {
+  memcpy(dst, src, len);
+}
+
+} // namespace
+
+void TaskGroup::wait() {
+  if (pending.load() == 0)
+    return;
+  TaskPool &pool = TaskPool::instance();
+  while (pending.load() != 0) {
+    if (pool.runOne(workerIndex))
+      continue;
+    std::unique_lock<std::mutex> lock(pool.sleepMutex);
+    pool.sleepCv.wait(
+        lock, [&] { return pending.load() == 0 || pool.queued.load() > 0; });
+  }
+}
+
+TaskPool &TaskPool::instance() {
+  static TaskPool pool(poolSize());
+  return pool;
+}
+
+TaskPool::TaskPool(size_t count) {
+  for (size_t i = 0; i < count; i++)
+    queues.emplace_back(new Queue());
+  try {
+    for (size_t i = 0; i < count; i++)
+      threads.emplace_back(&TaskPool::workerLoop, this, i);
+  } catch (const std::system_error &e) {
+    // Run with the workers that did start; they steal from the queues of
+    // the missing ones
+    DEBUG_PRINT("TaskPool: %zu of %zu workers (%s)", threads.size(), count,
+                e.what());
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  sleepCv.notify_all();
+  for (std::thread &t : threads)
+    t.join();
+}
+
+void TaskPool::run(TaskGroup &group, std::function<void()> task) {
+  if (threads.empty()) {
+    task();
+    return;
+  }
+  group.pending.fetch_add(1);
+  size_t q = workerIndex < queues.size()
+                 ? workerIndex
+                 : nextQueue.fetch_add(1) % queues.size();
+  {
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+    queues[q]->tasks.push_back({std::move(task), &group});
+  }
+  queued.fetch_add(1);
+  // Taking the mutex orders this against a sleeper's predicate check
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  sleepCv.notify_all();
+}
+
+bool TaskPool::runOne(size_t self) {
+  Task task;
+  bool found = false;
+  size_t n = queues.size();
+
+  if (self < n) {
+    std::lock_guard<std::mutex> lock(queues[self]->mutex);
+    if (!queues[self]->tasks.empty()) {
+      task = std::move(queues[self]->tasks.back());
+      queues[self]->tasks.pop_back();
+      found = true;
+    }
+  }
+  for (size_t i = 0; !found && i < n; i++) {
+    size_t victim = self < n ? (self + 1 + i) % n : i;
+    if (victim == self)
+      continue;
+    std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+    if (!queues[victim]->tasks.empty()) {
+      task = std::move(queues[victim]->tasks.front());
+      queues[victim]->tasks.pop_front();
+      found = true;
+    }
+  }
+  if (!found)
+    return false;
+
+  queued.fetch_sub(1);
+  uint64_t start = Trace::now();
+  task.fn();
+  Trace::span("pool", "task", start);
+  finish(task.group);
+  return true;
+}
+
+// The group may be destroyed as soon as its count reaches zero
+void TaskPool::finish(TaskGroup *group) {
+  if (group->pending.fetch_sub(1) != 1)
+    return;
+  { std::lock_guard<std::mutex> lock(sleepMutex); }
+  sleepCv.notify_all();
+}
+
+void TaskPool::workerLoop(size_t index) {
+  workerIndex = index;
+  for (;;) {
+    if (runOne(index))
+      continue;
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepCv.wait(lock, [&] { return stopping || queued.load() > 0; });
+    if (stopping && queued.load() == 0)
+      return;
+  }
+}
+
+void TaskPool::parallelFor(size_t n, size_t grain,
+                           const std::function<void(size_t, size_t)> &fn) {
+  if (n == 0)
+    return;
+  size_t parts = std::min(workers() + 1, n / std::max<size_t>(grain, 1));
+  if (parts <= 1) {
+    fn(0, n);
+    return;
+  }
+  size_t per = (n + parts - 1) / parts;
+  TaskGroup group;
+  for (size_t begin = per; begin < n; begin += per) {
+    size_t end = std::min(n, begin + per);
+    run(group, [&fn, begin, end] { fn(begin, end); });
+  }
+  fn(0, per);
+  group.wait();
+}
+
+void TaskPool::copy(void *dst, const void *src, size_t len, bool streaming) {
+  void (*fn)(void *, const void *, size_t) =
+      streaming ? vc6_stream_copy : plainCopy;
+  if (len < COPY_PARALLEL_MIN || threads.empty()) {
+    fn(dst, src, len);
+    return;
+  }
+  // Whole 4 KB pages per slice
+  const size_t page = 4096;
+  parallelFor((len + page - 1) / page, COPY_SLICE_MIN / page,
+              [&](size_t begin, size_t end) {
+                size_t off = begin * page;
+                size_t stop = std::min(len, end * page);
+                fn((char *)dst + off, (const char *)src + off, stop - off);
+              });
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks started together; wait() returns once all of them ran. The
+// destructor waits too, so tasks may capture the caller's locals.
+class TaskGroup {
+public:
+  TaskGroup() = default;
+  ~TaskGroup() { wait(); }
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  // Runs queued tasks (this group's or others') while waiting
+  void wait();
+
+private:
+  friend class TaskPool;
+  std::atomic<size_t> pending{0};
+};
+
+// Process-wide pool of CPU workers shared by the batchers: ring copies,
+// parameter/key setup overlapped with them, and CPU fallback encryption.
+//
+// One worker per core minus one, which is left to the thread feeding the
+// GPU (VC6_CPU_THREADS overrides the count; 0 runs everything inline).
+// Each worker owns a deque: it pops its newest task and, when empty,
+// steals the oldest task of another worker. Tasks submitted from outside
+// the pool are spread round-robin. A thread waiting on a TaskGroup runs
+// tasks too, so nested groups cannot deadlock.
+class TaskPool {
+public:
+  static TaskPool &instance();
+
+  size_t workers() const { return threads.size(); }
+
+  void run(TaskGroup &group, std::function<void()> task);
+
+  // Splits [0, n) into at most workers() + 1 ranges of at least 'grain'
+  // items and runs fn(begin, end) on them, one on the calling thread
+  void parallelFor(size_t n, size_t grain,
+                   const std::function<void(size_t, size_t)> &fn);
+
+  // memcpy, split across the pool from COPY_PARALLEL_MIN bytes up. With
+  // 'streaming' the slices use non-temporal stores (vc6_stream_copy), for
+  // a write-combined destination such as an uncached ring mapping.
+  static constexpr size_t COPY_PARALLEL_MIN = 1024 * 1024;
+  static constexpr size_t COPY_SLICE_MIN = 256 * 1024;
+  void copy(void *dst, const void *src, size_t len, bool streaming = false);
+
+private:
+  friend class TaskGroup;
+
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup *group;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  explicit TaskPool(size_t count);
+  ~TaskPool();
+
+  void workerLoop(size_t index);
+  // Runs one task if any is queued: the own queue's newest first (when
+  // 'self' is a worker), then the oldest of each other queue
+  bool runOne(size_t self);
+  void finish(TaskGroup *group);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> nextQueue{0};
+
+  // Workers sleep here when there is nothing to run or steal; waiting
+  // groups too, until a task is queued or their last task finished
+  std::mutex sleepMutex;
+  std::condition_variable sleepCv;
+  bool stopping = false;
+};
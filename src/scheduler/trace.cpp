@@ -0,0 +1,271 @@
+#include "trace.hpp"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define DEBUG_PRINT(fmt, ...) fprintf(stderr, "[VC6] " fmt "\n", ##__VA_ARGS__)
+
+namespace {
+
+struct TraceEvent {
+  const char *cat;
+  const char *name;
+  char ph; // 'X' span, 'i' instant
+  uint64_t ts;
+  uint64_t dur;
+  uint64_t bytes;
+  uint64_t batch;
+};
+
+// One per thread, never freed: a dump at exit still sees threads that are
+// gone. Only the owning thread writes; 'count' publishes its events.
+struct ThreadBuffer {
+  ThreadBuffer *next;
+  TraceEvent *events;
+  uint64_t tid;
+  std::atomic<size_t> count{0};
+  std::atomic<uint64_t> dropped{0};
+};
+
+std::atomic<ThreadBuffer *> buffers{nullptr};
+std::atomic<uint64_t> batchIds{0};
+std::atomic<bool> dumping{false};
+size_t capacity = 65536;
+std::chrono::steady_clock::time_point epoch;
+char path[4096];
+char tmpPath[4096 + 4];
+struct sigaction oldInt, oldTerm;
+
+thread_local ThreadBuffer *local = nullptr;
+thread_local uint64_t localBatch = 0;
+
+ThreadBuffer *threadBuffer() {
+  if (local != nullptr)
+    return local;
+  ThreadBuffer *b = new (std::nothrow) ThreadBuffer();
+  if (b == nullptr)
+    return nullptr;
+  b->events = new (std::nothrow) TraceEvent[capacity];
+  if (b->events == nullptr) {
+    delete b;
+    return nullptr;
+  }
+  b->tid = (uint64_t)syscall(SYS_gettid);
+  b->next = buffers.load(std::memory_order_relaxed);
+  while (!buffers.compare_exchange_weak(b->next, b, std::memory_order_release,
+                                        std::memory_order_relaxed))
+    ;
+  local = b;
+  return b;
+}
+
+void append(const TraceEvent &e) {
+  ThreadBuffer *b = threadBuffer();
+  if (b == nullptr)
+    return;
+  size_t n = b->count.load(std::memory_order_relaxed);
+  if (n >= capacity) {
+    b->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  b->events[n] = e;
+  b->count.store(n + 1, std::memory_order_release);
+}
+
+// Buffered output for dump(): write(2) and hand-rolled formatting only
+class Writer {
+public:
+  explicit Writer(int fd) : fd(fd) {}
+  ~Writer() { flush(); }
+
+  void str(const char *s) {
+    while (*s)
+      put(*s++);
+  }
+  void u64(uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do {
+      tmp[n++] = (char)('0' + v % 10);
+      v /= 10;
+    } while (v != 0);
+    while (n > 0)
+      put(tmp[--n]);
+  }
+  // Nanoseconds as microseconds with three decimals
+  void us(uint64_t ns) {
+    u64(ns / 1000);
+    put('.');
+    put((char)('0' + ns / 100 % 10));
+    put((char)('0' + ns / 10 % 10));
+    put((char)('0' + ns % 10));
+  }
+  void flush() {
+    size_t done = 0;
+    while (done < len) {
+      ssize_t w = write(fd, buf + done, len - done);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w <= 0)
+        break;
+      done += (size_t)w;
+    }
+    len = 0;
+  }
+
+private:
+  int fd;
+  char buf[16384];
+  size_t len = 0;
+
+  void put(char c) {
+    if (len == sizeof(buf))
+      flush();
+    buf[len++] = c;
+  }
+};
+
+void onDumpSignal(int) {
+  int saved = errno;
+  Trace::dump();
+  errno = saved;
+}
+
+// Dump, then let the handler that was there before deal with the signal
+// (it runs once this one returns; SIG_DFL terminates as usual)
+void onExitSignal(int sig) {
+  Trace::dump();
+  sigaction(sig, sig == SIGINT ? &oldInt : &oldTerm, nullptr);
+  raise(sig);
+}
+
+void dumpAtExit() { Trace::dump(); }
+
+} // namespace
+
+bool Trace::init() {
+  const char *p = getenv("VC6_TRACE");
+  if (p == nullptr || *p == '\0')
+    return false;
+  if (strlen(p) >= sizeof(path)) {
+    DEBUG_PRINT("VC6_TRACE path too long; tracing off");
+    return false;
+  }
+  strcpy(path, p);
+  snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+  const char *events = getenv("VC6_TRACE_EVENTS");
+  if (events != nullptr && strtoull(events, nullptr, 10) > 0)
+    capacity = (size_t)strtoull(events, nullptr, 10);
+  epoch = std::chrono::steady_clock::now();
+
+  atexit(dumpAtExit);
+  struct sigaction sa = {};
+  sa.sa_handler = onDumpSignal;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR2, &sa, nullptr);
+  sa.sa_handler = onExitSignal;
+  sigaction(SIGINT, &sa, &oldInt);
+  sigaction(SIGTERM, &sa, &oldTerm);
+
+  DEBUG_PRINT("Tracing to %s (SIGUSR2 dumps)", path);
+  return true;
+}
+
+uint64_t Trace::now() {
+  if (!enabled())
+    return 0;
+  // +1 keeps a stamp taken right at the epoch distinct from "off"
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+             .count() +
+         1;
+}
+
+void Trace::span(const char *cat, const char *name, uint64_t start,
+                 uint64_t bytes, uint64_t batch) {
+  if (start == 0)
+    return;
+  uint64_t end = now();
+  append({cat, name, 'X', start, end - start, bytes, batch});
+}
+
+void Trace::instant(const char *cat, const char *name, uint64_t bytes,
+                    uint64_t batch) {
+  uint64_t t = now();
+  if (t == 0)
+    return;
+  append({cat, name, 'i', t, 0, bytes, batch});
+}
+
+uint64_t Trace::nextBatch() {
+  if (!enabled())
+    return 0;
+  localBatch = batchIds.fetch_add(1, std::memory_order_relaxed) + 1;
+  return localBatch;
+}
+
+uint64_t Trace::currentBatch() { return localBatch; }
+
+void Trace::dump() {
+  if (dumping.exchange(true, std::memory_order_acquire))
+    return; // A dump is already running (e.g. a signal during exit)
+
+  // Written aside and renamed, so a reader never sees half a file
+  int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    uint64_t pid = (uint64_t)getpid(), dropped = 0;
+    {
+      Writer w(fd);
+      w.str("{\"traceEvents\":[");
+      bool first = true;
+      for (ThreadBuffer *b = buffers.load(std::memory_order_acquire);
+           b != nullptr; b = b->next) {
+        size_t n = b->count.load(std::memory_order_acquire);
+        dropped += b->dropped.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; i++) {
+          const TraceEvent &e = b->events[i];
+          w.str(first ? "\n" : ",\n");
+          first = false;
+          w.str("{\"name\":\"");
+          w.str(e.name);
+          w.str("\",\"cat\":\"");
+          w.str(e.cat);
+          w.str(e.ph == 'X' ? "\",\"ph\":\"X\",\"dur\":"
+                            : "\",\"ph\":\"i\",\"s\":\"t");
+          if (e.ph == 'X')
+            w.us(e.dur);
+          else
+            w.str("\"");
+          w.str(",\"ts\":");
+          w.us(e.ts);
+          w.str(",\"pid\":");
+          w.u64(pid);
+          w.str(",\"tid\":");
+          w.u64(b->tid);
+          w.str(",\"args\":{\"bytes\":");
+          w.u64(e.bytes);
+          if (e.batch != 0) {
+            w.str(",\"batch\":");
+            w.u64(e.batch);
+          }
+          w.str("}}");
+        }
+      }
+      w.str("\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":");
+      w.u64(dropped);
+      w.str("}}\n");
+    }
+    close(fd);
+    rename(tmpPath, path);
+  }
+  dumping.store(false, std::memory_order_release);
+}
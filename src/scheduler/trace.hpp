@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Scheduler event tracing in Chrome trace-event format (chrome://tracing,
+// ui.perfetto.dev).
+//
+// Off unless VC6_TRACE names an output file. Each thread appends to its own
+// fixed-size buffer (VC6_TRACE_EVENTS events, default 65536; later events
+// are dropped) and publishes it with a release store of the event count, so
+// recording takes no lock. The file is written at exit, on SIGUSR2 (the
+// process keeps running; each dump rewrites the file with everything so
+// far) and on SIGINT / SIGTERM before the previous handler runs. Dumping
+// only uses async-signal-safe calls.
+//
+// Event names and categories must be string literals: only the pointer is
+// stored.
+class Trace {
+public:
+  static bool enabled() {
+    static const bool on = init();
+    return on;
+  }
+
+  // Nanoseconds on the trace clock; 0 when tracing is off, which the
+  // recording calls below take as "skip"
+  static uint64_t now();
+
+  // Span from 'start' (a now() value) to now. 'batch' ties a job to the
+  // dispatch it ran in (0 = none)
+  static void span(const char *cat, const char *name, uint64_t start,
+                   uint64_t bytes = 0, uint64_t batch = 0);
+  static void instant(const char *cat, const char *name, uint64_t bytes = 0,
+                      uint64_t batch = 0);
+
+  // Fresh id for one dispatch; also remembered as the calling thread's
+  // current batch so the job span can name it
+  static uint64_t nextBatch();
+  static uint64_t currentBatch();
+
+  // Writes the trace file; async-signal-safe
+  static void dump();
+
+private:
+  static bool init();
+};
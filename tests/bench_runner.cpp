@@ -1,89 +1,1904 @@
+#include "../src/backend/vc6_backend.h"
 #include "../src/backend/vulkan_ctx.hpp"
+#include "../src/cpu/aes_ct.h"
+#include "../src/cpu/blake3.h"
+#include "../src/cpu/chacha20.h"
+#include "../src/cpu/stream_copy.h"
+#include "../src/scheduler/aes256_batcher.hpp"
 #include "../src/scheduler/batcher.hpp"
+#include "../src/scheduler/keystream_pool.hpp"
+#include "../src/scheduler/task_pool.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/provider.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
-int main() {
-  try {
-    std::cout << "[Bench] Initializing Vulkan Context..." << std::endl;
-    VulkanContext ctx;
+// One AES-256-XTS data unit of 'len' bytes under 'iv' in a single update
+static bool xtsUnit(EVP_CIPHER *cipher, bool enc, const unsigned char *key,
+                    const unsigned char *iv, const unsigned char *in,
+                    size_t len, unsigned char *out) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  int outl = 0, finl = 0;
+  bool ok = ctx != nullptr &&
+            EVP_CipherInit_ex2(ctx, cipher, key, iv, enc, nullptr) &&
+            EVP_CipherUpdate(ctx, out, &outl, in, (int)len) &&
+            EVP_CipherFinal_ex(ctx, out + outl, &finl) &&
+            (size_t)(outl + finl) == len;
+  EVP_CIPHER_CTX_free(ctx);
+  return ok;
+}
 
-    std::cout << "[Bench] Initializing Batcher..." << std::endl;
-    Batcher batcher(&ctx);
+// XTS correctness against the default provider's AES-256-XTS: a batch of
+// sectors through the batcher (GPU tweaks), then single data units through
+// the vc6 provider, 17 and 1000 bytes included (ciphertext stealing)
+static bool xtsCheck(Batcher &batcher, const unsigned char *key) {
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  OSSL_PROVIDER *def = OSSL_PROVIDER_load(nullptr, "default");
+  EVP_CIPHER *gpu = EVP_CIPHER_fetch(nullptr, "AES-256-XTS", "provider=vc6");
+  EVP_CIPHER *cpu =
+      EVP_CIPHER_fetch(nullptr, "AES-256-XTS", "provider=default");
+  bool all = vc6 != nullptr && def != nullptr && gpu != nullptr &&
+             cpu != nullptr;
+  if (!all)
+    std::cerr << "[Check] Cannot load AES-256-XTS from the vc6 and default "
+                 "providers"
+              << std::endl;
 
-    // Parameters
-    const size_t PACKET_SIZE =
-        1024 * 1024; // 1MB (Larger batches = Less driver overhead)
-    const size_t TOTAL_DATA = 1024ULL * 1024ULL * 1024ULL; // 1GB
-    const size_t ITERATIONS = TOTAL_DATA / PACKET_SIZE;
+  const size_t SECTORS = 8, FIRST = 5;
+  size_t sectorSizes[] = {512, 4096};
+  for (size_t i = 0; all && i < 2; i++) {
+    size_t sectorSize = sectorSizes[i], len = SECTORS * sectorSize;
+    std::vector<unsigned char> in(len), g(len), c(len), back(len);
+    for (size_t j = 0; j < len; j++)
+      in[j] = (unsigned char)(j * 13 + 1);
+    unsigned char tweak[16] = {0};
+    uint64_t sector = FIRST;
+    memcpy(tweak, &sector, sizeof(sector));
+    bool ok = batcher.submitXts(in.data(), g.data(), len, key, tweak,
+                                sectorSize, 0, false) &&
+              batcher.submitXts(g.data(), back.data(), len, key, tweak,
+                                sectorSize, 0, true) &&
+              back == in;
+    for (size_t k = 0; ok && k < SECTORS; k++) {
+      unsigned char iv[16] = {0};
+      sector = FIRST + k;
+      memcpy(iv, &sector, sizeof(sector));
+      ok = xtsUnit(cpu, true, key, iv, in.data() + k * sectorSize,
+                   sectorSize, c.data() + k * sectorSize);
+    }
+    ok = ok && g == c;
+    std::cout << "[Check] AES-256-XTS batcher, " << SECTORS << " x "
+              << sectorSize << "-byte sectors vs default: "
+              << (ok ? "PASS" : "FAIL") << std::endl;
+    all = all && ok;
+  }
 
-    std::vector<unsigned char> input(PACKET_SIZE, 0xAB);
-    std::vector<unsigned char> output(PACKET_SIZE);
-    unsigned char key[32] = {0};
-    unsigned char iv[16] = {0};
+  size_t units[] = {17, 512, 1000, 4096};
+  for (size_t i = 0; all && i < 4; i++) {
+    size_t len = units[i];
+    std::vector<unsigned char> in(len), g(len), c(len), back(len);
+    for (size_t j = 0; j < len; j++)
+      in[j] = (unsigned char)(j * 7 + 3);
+    unsigned char iv[16] = {0x42, 0x24};
+    bool ok = xtsUnit(gpu, true, key, iv, in.data(), len, g.data()) &&
+              xtsUnit(cpu, true, key, iv, in.data(), len, c.data()) &&
+              g == c &&
+              xtsUnit(gpu, false, key, iv, g.data(), len, back.data()) &&
+              back == in;
+    std::cout << "[Check] AES-256-XTS provider, " << len
+              << "-byte data unit vs default: " << (ok ? "PASS" : "FAIL")
+              << std::endl;
+    all = all && ok;
+  }
 
-    // Run for both algorithms
-    const char *algNames[] = {"AES-128-CTR", "ChaCha20"};
-    Batcher::Algorithm algs[] = {Batcher::ALG_AES_CTR, Batcher::ALG_CHACHA20};
+  EVP_CIPHER_free(gpu);
+  EVP_CIPHER_free(cpu);
+  if (vc6 != nullptr)
+    OSSL_PROVIDER_unload(vc6);
+  if (def != nullptr)
+    OSSL_PROVIDER_unload(def);
+  return all;
+}
 
-    // Test sizes: 1MB (Optimal) and 16KB (OpenSSL default)
-    size_t testSizes[] = {1024 * 1024, 16 * 1024};
-    const char *sizeNames[] = {"1 MB", "16 KB"};
+// Disk-image mode: encrypt a large image sector by sector with AES-256-XTS.
+// Each dispatch covers many consecutive sectors; per-sector tweaks are
+// computed on the GPU. The output is first checked against the default
+// provider (xtsCheck()). Usage: bench_runner xts [image_mb]
+static int runXtsBench(Batcher &batcher, size_t imageMB) {
+  const size_t BATCH = 16 * 1024 * 1024;
+  std::vector<unsigned char> image(imageMB * 1024 * 1024, 0xAB);
+  std::vector<unsigned char> output(BATCH);
+  unsigned char key[64];
+  for (int i = 0; i < 64; i++)
+    key[i] = (unsigned char)i;
+  if (!xtsCheck(batcher, key))
+    return 1;
 
-    for (int s = 0; s < 2; s++) {
-      size_t currentPacketSize = testSizes[s];
-      size_t currentIterations = TOTAL_DATA / currentPacketSize;
+  size_t sectorSizes[] = {512, 4096};
+  for (size_t sectorSize : sectorSizes) {
+    std::cout << "\n[Bench] AES-256-XTS, " << imageMB << " MB image, "
+              << sectorSize << "-byte sectors" << std::endl;
 
-      std::cout << "\n================================================"
-                << std::endl;
-      std::cout << "Testing with Packet Size: " << sizeNames[s] << std::endl;
-      std::cout << "================================================"
-                << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t off = 0; off < image.size(); off += BATCH) {
+      size_t chunk = std::min(BATCH, image.size() - off);
+      // Tweak = number of the first sector in this batch (little-endian)
+      unsigned char tweak[16] = {0};
+      uint64_t sector = off / sectorSize;
+      memcpy(tweak, &sector, sizeof(sector));
+      if (!batcher.submitXts(image.data() + off, output.data(), chunk, key,
+                             tweak, sectorSize, 0, false)) {
+        std::cerr << "[Bench] XTS failed at offset " << off << std::endl;
+        return 1;
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = end - start;
 
-      for (int a = 0; a < 2; a++) {
-        std::cout << "\n[Bench] Testing Algorithm: " << algNames[a]
-                  << std::endl;
-        std::cout << "[Bench] Iterations: " << currentIterations << std::endl;
+    double sectors = (double)image.size() / sectorSize;
+    std::cout << "[Bench] Completed in " << std::fixed << std::setprecision(3)
+              << diff.count() << " seconds." << std::endl;
+    std::cout << "[Bench] Throughput: " << imageMB / diff.count()
+              << " MB/s (" << sectors / diff.count() << " sectors/s)"
+              << std::endl;
+  }
+  return 0;
+}
 
-        auto start = std::chrono::high_resolution_clock::now();
+// Multi-buffer SHA-256: 'count' independent messages per batch for a few
+// message sizes, GPU batch against OpenSSL's SHA256() one message at a time.
+// Usage: bench_runner sha256 [count]
+static int runSha256Bench(Batcher &batcher, size_t count) {
+  size_t sizes[] = {64, 1024, 4096};
+  for (size_t size : sizes) {
+    std::vector<unsigned char> data(count * size, 0xAB);
+    std::vector<const unsigned char *> msgs(count);
+    std::vector<size_t> lens(count, size);
+    std::vector<unsigned char> gpu(count * 32), cpu(count * 32);
+    for (size_t i = 0; i < count; i++) {
+      data[i * size] = (unsigned char)i; // Distinct messages
+      msgs[i] = data.data() + i * size;
+    }
 
-        for (size_t i = 0; i < currentIterations; i++) {
-          if (!batcher.submit(input.data(), output.data(), currentPacketSize,
-                              key, iv, algs[a])) {
-            std::cerr << "[Bench] Failed at iteration " << i << std::endl;
-            return 1;
-          }
-          // Adaptive logging:
-          // 1MB loop (1024 iters) -> log every 20 iters (~1 sec)
-          // 16KB loop (65536 iters) -> log every 2000 iters (~1 sec)
-          int logInterval = (currentPacketSize > 100000) ? 20 : 2000;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!batcher.submitSha256(msgs.data(), lens.data(), count, gpu.data())) {
+      std::cerr << "[Bench] SHA-256 batch failed" << std::endl;
+      return 1;
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; i++)
+      SHA256(msgs[i], size, cpu.data() + i * 32);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> g = mid - start, c = end - mid;
+    std::cout << "\n[Bench] SHA-256, " << count << " x " << size
+              << "-byte messages" << std::endl;
+    if (gpu != cpu) {
+      std::cerr << "[Bench] SHA-256 mismatch against OpenSSL" << std::endl;
+      return 1;
+    }
+    std::cout << "[Bench]   vc6 batch: " << std::fixed << std::setprecision(0)
+              << count / g.count() << " msgs/s" << std::endl;
+    std::cout << "[Bench]   CPU:       " << count / c.count()
+              << " msgs/s (vc6 = " << std::setprecision(2)
+              << c.count() / g.count() << "x)" << std::endl;
+  }
+  return 0;
+}
+
+// BLAKE3 over one 'totalMB' buffer: GPU chunk pass in 16 MB batches with the
+// workgroup CVs merged on the CPU, against the CPU-only tree.
+// Usage: bench_runner blake3 [total_mb]
+static int runBlake3Bench(Batcher &batcher, size_t totalMB) {
+  const size_t BATCH = 16 * 1024 * 1024;
+  std::vector<unsigned char> data(totalMB * 1024 * 1024);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = (unsigned char)(i * 7);
+  // One CV per 256 chunks (256 KB)
+  std::vector<unsigned char> cvs(data.size() / (256 * 1024) * 32 + 32);
+  unsigned char gpu[32], cpu[32];
+  std::cout << "\n[Bench] BLAKE3, " << totalMB << " MB" << std::endl;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t n = 0;
+  for (size_t off = 0; off < data.size(); off += BATCH) {
+    size_t count;
+    if (!batcher.submitBlake3(data.data() + off,
+                              std::min(BATCH, data.size() - off), off / 1024,
+                              cvs.data() + 32 * n, &count)) {
+      std::cerr << "[Bench] BLAKE3 chunk pass failed" << std::endl;
+      return 1;
+    }
+    n += count;
+  }
+  vc6_blake3_reduce(gpu, cvs.data(), n, 1);
+  auto mid = std::chrono::high_resolution_clock::now();
+  vc6_blake3_subtree(cpu, data.data(), data.size(), 0, 1);
+  auto end = std::chrono::high_resolution_clock::now();
+
+  if (memcmp(gpu, cpu, 32) != 0) {
+    std::cerr << "[Bench] BLAKE3 mismatch against the CPU tree" << std::endl;
+    return 1;
+  }
+  std::chrono::duration<double> g = mid - start, c = end - mid;
+  std::cout << "[Bench]   vc6: " << std::fixed << std::setprecision(2)
+            << totalMB / g.count() << " MB/s" << std::endl;
+  std::cout << "[Bench]   CPU: " << totalMB / c.count() << " MB/s (vc6 = "
+            << c.count() / g.count() << "x)" << std::endl;
+  return 0;
+}
+
+// Seals 'total' bytes as AEAD messages of 'packet' bytes (12-byte nonce,
+// 13 bytes of AAD, 16-byte tag); returns MB/s or a negative value on error
+static double aeadThroughput(EVP_CIPHER *cipher, size_t packet, size_t total) {
+  std::vector<unsigned char> input(packet, 0xAB), output(packet);
+  unsigned char key[32] = {0}, nonce[12] = {0}, aad[13] = {0}, tag[16];
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  if (ctx == nullptr)
+    return -1;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t done = 0; done < total; done += packet) {
+    int outl;
+    memcpy(nonce, &done, sizeof(done)); // Unique per message
+    if (!EVP_EncryptInit_ex(ctx, cipher, nullptr, key, nonce) ||
+        !EVP_EncryptUpdate(ctx, nullptr, &outl, aad, sizeof(aad)) ||
+        !EVP_EncryptUpdate(ctx, output.data(), &outl, input.data(),
+                           (int)packet) ||
+        !EVP_EncryptFinal_ex(ctx, output.data() + outl, &outl) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag)) {
+      EVP_CIPHER_CTX_free(ctx);
+      return -1;
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> diff = end - start;
+  EVP_CIPHER_CTX_free(ctx);
+  return (double)total / (1024.0 * 1024.0) / diff.count();
+}
+
+// One AEAD message through 'cipher' with a 'ivlen'-byte IV: the AAD, then
+// 'len' bytes in updates of at most 'chunk'. Sealing writes the tag;
+// opening checks it and fails on a mismatch. 'params' go to the init.
+static bool aeadMessage(EVP_CIPHER *cipher, bool enc, const unsigned char *key,
+                        const unsigned char *iv, size_t ivlen,
+                        const unsigned char *aad, size_t aadLen,
+                        const unsigned char *in, size_t len, size_t chunk,
+                        unsigned char *out, unsigned char *tag,
+                        const OSSL_PARAM *params = nullptr) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  int outl = 0;
+  bool ok = ctx != nullptr &&
+            EVP_CipherInit_ex2(ctx, cipher, nullptr, nullptr, enc, params) &&
+            EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_IVLEN, (int)ivlen,
+                                nullptr) > 0 &&
+            EVP_CipherInit_ex2(ctx, nullptr, key, iv, enc, nullptr) &&
+            (aadLen == 0 ||
+             EVP_CipherUpdate(ctx, nullptr, &outl, aad, (int)aadLen));
+  for (size_t done = 0; ok && done < len; done += outl) {
+    size_t n = std::min(chunk, len - done);
+    ok = EVP_CipherUpdate(ctx, out + done, &outl, in + done, (int)n) &&
+         (size_t)outl == n;
+  }
+  if (ok && !enc)
+    ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, 16, tag) > 0;
+  ok = ok && EVP_CipherFinal_ex(ctx, out + len, &outl) > 0 && outl == 0;
+  if (ok && enc)
+    ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag) > 0;
+  EVP_CIPHER_CTX_free(ctx);
+  return ok;
+}
+
+// AEAD mode: ChaCha20-Poly1305 through the vc6 provider (GPU keystream,
+// parallel Poly1305) against OpenSSL's default provider. Each message size
+// (and one that is not a multiple of 16) is first checked to give the same
+// ciphertext and tag as the default provider, with AAD.
+// Usage: bench_runner chachapoly [total_mb]
+static int runChachaPolyBench(size_t totalMB) {
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  OSSL_PROVIDER *def = OSSL_PROVIDER_load(nullptr, "default");
+  EVP_CIPHER *gpu = EVP_CIPHER_fetch(nullptr, "ChaCha20-Poly1305",
+                                     "provider=vc6");
+  EVP_CIPHER *cpu = EVP_CIPHER_fetch(nullptr, "ChaCha20-Poly1305",
+                                     "provider=default");
+  int rc = 0;
+  if (vc6 == nullptr || def == nullptr || gpu == nullptr || cpu == nullptr) {
+    std::cerr << "[Bench] Cannot load ChaCha20-Poly1305 from the vc6 and "
+                 "default providers"
+              << std::endl;
+    rc = 1;
+  }
+
+  size_t total = totalMB * 1024 * 1024;
+  size_t packets[] = {16 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+  size_t checks[] = {16 * 1024, 1024 * 1024 + 7, 16 * 1024 * 1024};
+  unsigned char key[32], nonce[12], aad[13], tagG[16], tagC[16];
+  for (int i = 0; i < 32; i++)
+    key[i] = (unsigned char)(0x80 + i);
+  for (int i = 0; i < 12; i++)
+    nonce[i] = (unsigned char)(0x40 + i);
+  for (int i = 0; i < 13; i++)
+    aad[i] = (unsigned char)(0x20 + i);
+  for (size_t i = 0; rc == 0 && i < 3; i++) {
+    size_t len = checks[i];
+    std::vector<unsigned char> msg(len), g(len + 16), c(len + 16);
+    for (size_t j = 0; j < len; j++)
+      msg[j] = (unsigned char)(j * 29 + 3);
+    bool ok = aeadMessage(gpu, true, key, nonce, 12, aad, sizeof(aad),
+                          msg.data(), len, len, g.data(), tagG) &&
+              aeadMessage(cpu, true, key, nonce, 12, aad, sizeof(aad),
+                          msg.data(), len, len, c.data(), tagC) &&
+              memcmp(g.data(), c.data(), len) == 0 &&
+              memcmp(tagG, tagC, 16) == 0;
+    std::cout << "[Check] ChaCha20-Poly1305 " << len
+              << " bytes + 13 AAD vs default: " << (ok ? "PASS" : "FAIL")
+              << std::endl;
+    if (!ok)
+      rc = 1;
+  }
+
+  for (size_t i = 0; rc == 0 && i < 3; i++) {
+    size_t packet = packets[i];
+    double g = aeadThroughput(gpu, packet, total);
+    double c = aeadThroughput(cpu, packet, total);
+    if (g < 0 || c < 0) {
+      std::cerr << "[Bench] ChaCha20-Poly1305 failed" << std::endl;
+      rc = 1;
+      break;
+    }
+    std::cout << "\n[Bench] ChaCha20-Poly1305, " << packet / 1024
+              << " KB messages, " << totalMB << " MB" << std::endl;
+    std::cout << "[Bench]   vc6:     " << std::fixed << std::setprecision(2)
+              << g << " MB/s" << std::endl;
+    std::cout << "[Bench]   default: " << c << " MB/s (vc6 = " << g / c
+              << "x)" << std::endl;
+  }
+
+  EVP_CIPHER_free(gpu);
+  EVP_CIPHER_free(cpu);
+  if (vc6 != nullptr)
+    OSSL_PROVIDER_unload(vc6);
+  if (def != nullptr)
+    OSSL_PROVIDER_unload(def);
+  return rc;
+}
+
+// Nonce-reuse check: after final(), a key-only re-init must leave the IV
+// spent, so encrypting again fails until a fresh IV is set.
+// Usage: bench_runner aead-reinit
+static int runAeadReinitCheck() {
+  static const char *const names[] = {"AES-256-GCM", "ChaCha20-Poly1305",
+                                      "XChaCha20-Poly1305"};
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  unsigned char key[32] = {1}, iv[24] = {2}, msg[64] = {3}, out[64], tag[16];
+  int rc = vc6 == nullptr ? 1 : 0;
+
+  for (const char *name : names) {
+    EVP_CIPHER *cipher = EVP_CIPHER_fetch(nullptr, name, "provider=vc6");
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int outl;
+    bool sealed = cipher != nullptr && ctx != nullptr &&
+                  EVP_EncryptInit_ex2(ctx, cipher, key, iv, nullptr) &&
+                  EVP_EncryptUpdate(ctx, out, &outl, msg, sizeof(msg)) &&
+                  EVP_EncryptFinal_ex(ctx, out + outl, &outl) &&
+                  EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, 16, tag);
+    // Same key again, no IV: the old nonce must not be re-armed
+    bool reused = sealed &&
+                  EVP_EncryptInit_ex2(ctx, nullptr, key, nullptr, nullptr) &&
+                  EVP_EncryptUpdate(ctx, out, &outl, msg, sizeof(msg)) > 0;
+    iv[0]++;
+    bool fresh = sealed &&
+                 EVP_EncryptInit_ex2(ctx, nullptr, nullptr, iv, nullptr) &&
+                 EVP_EncryptUpdate(ctx, out, &outl, msg, sizeof(msg)) > 0;
+    bool ok = sealed && !reused && fresh;
+    std::cout << "[Check] " << name << " re-init after final(): "
+              << (ok ? "PASS" : "FAIL") << std::endl;
+    if (!ok)
+      rc = 1;
+    // Decrypt without an expected tag: final() must not accept
+    iv[0]--;
+    bool untagged = sealed &&
+                    EVP_DecryptInit_ex2(ctx, nullptr, key, iv, nullptr) &&
+                    EVP_DecryptUpdate(ctx, msg, &outl, out, sizeof(out)) &&
+                    EVP_DecryptFinal_ex(ctx, msg + outl, &outl) > 0;
+    ok = sealed && !untagged;
+    std::cout << "[Check] " << name << " decrypt final() without tag: "
+              << (ok ? "PASS" : "FAIL") << std::endl;
+    if (!ok)
+      rc = 1;
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+  }
+  if (vc6 != nullptr)
+    OSSL_PROVIDER_unload(vc6);
+  return rc;
+}
+
+// GF(2^128) product in GCM's bit order (SP 800-38D, algorithm 1)
+static void gf128Mul(const unsigned char *x, const unsigned char *y,
+                     unsigned char *z) {
+  unsigned char v[16], r[16] = {0};
+  memcpy(v, y, 16);
+  for (int i = 0; i < 128; i++) {
+    if (x[i / 8] & (0x80 >> (i % 8)))
+      for (int j = 0; j < 16; j++)
+        r[j] ^= v[j];
+    int lsb = v[15] & 1;
+    for (int j = 15; j > 0; j--)
+      v[j] = (unsigned char)((v[j] >> 1) | (v[j - 1] << 7));
+    v[0] >>= 1;
+    if (lsb)
+      v[0] ^= 0xe1;
+  }
+  memcpy(z, r, 16);
+}
+
+// A 16-byte IV whose J0 = GHASH_H(IV || 0^64 || [128]_64) is 'j0':
+// IV = (j0 * H^-1 + L) * H^-1, with H^-1 = H^(2^128 - 2)
+static void gcmIvForJ0(const unsigned char *key, const unsigned char *j0,
+                       unsigned char *iv) {
+  unsigned char h[16] = {0}, hinv[16] = {0x80}, len[16] = {0};
+  int outl;
+  EVP_CIPHER *ecb = EVP_CIPHER_fetch(nullptr, "AES-256-ECB",
+                                     "provider=default");
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex2(ctx, ecb, key, nullptr, nullptr);
+  EVP_EncryptUpdate(ctx, h, &outl, h, 16);
+  EVP_CIPHER_CTX_free(ctx);
+  EVP_CIPHER_free(ecb);
+  for (int i = 0; i < 128; i++) {
+    gf128Mul(hinv, hinv, hinv);
+    if (i < 127)
+      gf128Mul(hinv, h, hinv);
+  }
+  len[15] = 128;
+  gf128Mul(j0, hinv, iv);
+  for (int i = 0; i < 16; i++)
+    iv[i] ^= len[i];
+  gf128Mul(iv, hinv, iv);
+}
+
+// GCM correctness: vc6's AES-256-GCM against the default provider on short,
+// unaligned and fused-size updates, non-12-byte IVs and a counter that
+// crosses the inc32 wrap, sealed with gcm-fused on and off; a tampered tag
+// or ciphertext must not open.
+// Usage: bench_runner gcm-check
+static int runGcmCheck() {
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  OSSL_PROVIDER *def = OSSL_PROVIDER_load(nullptr, "default");
+  EVP_CIPHER *gpu = EVP_CIPHER_fetch(nullptr, "AES-256-GCM", "provider=vc6");
+  EVP_CIPHER *cpu =
+      EVP_CIPHER_fetch(nullptr, "AES-256-GCM", "provider=default");
+  if (vc6 == nullptr || def == nullptr || gpu == nullptr || cpu == nullptr) {
+    std::cerr << "[Check] Cannot load AES-256-GCM from the vc6 and default "
+                 "providers"
+              << std::endl;
+    return 1;
+  }
+
+  struct Case {
+    const char *what;
+    size_t len, chunk, ivlen, aadLen;
+    bool wrap; // IV solved for J0 = ..ffff fff0
+  };
+  const size_t fused = 64 * 1024 + 13, multi = 4 * 1024 * 1024 + 77;
+  const Case cases[] = {
+      {"empty", 0, 1, 12, 20, false},
+      {"1 byte", 1, 1, 12, 0, false},
+      {"15 bytes", 15, 15, 12, 20, false},
+      {"17 bytes in 7-byte updates", 17, 7, 12, 20, false},
+      {"4099 bytes in 13-byte updates", 4099, 13, 12, 20, false},
+      {"fused 64 KB + 13", fused, fused, 12, 20, false},
+      {"fused 64 KB + 13 in 4099-byte updates", fused, 4099, 12, 20, false},
+      {"4 MB + 77 (two fused dispatches)", multi, multi, 12, 20, false},
+      {"8-byte IV", 4099, 4099, 8, 20, false},
+      {"16-byte IV", 4099, 4099, 16, 20, false},
+      {"60-byte IV", 4099, 4099, 60, 20, false},
+      {"counter wrap", 4099, 4099, 16, 20, true},
+      {"counter wrap, fused", fused, fused, 16, 20, true},
+      {"counter wrap, 13-byte updates", 4099, 13, 16, 20, true},
+  };
+
+  std::vector<unsigned char> msg(multi), a(multi + 16), b(multi + 16),
+      unfused(multi + 16), back(multi + 16);
+  for (size_t i = 0; i < msg.size(); i++)
+    msg[i] = (unsigned char)(i * 131 + 7);
+  unsigned char key[32], iv[64], aad[20], tagA[16], tagB[16], tagU[16];
+  int on = 1, off = 0;
+  const OSSL_PARAM fusedOn[] = {
+      OSSL_PARAM_construct_int(VC6_CIPHER_PARAM_GCM_FUSED, &on),
+      OSSL_PARAM_construct_end()};
+  const OSSL_PARAM fusedOff[] = {
+      OSSL_PARAM_construct_int(VC6_CIPHER_PARAM_GCM_FUSED, &off),
+      OSSL_PARAM_construct_end()};
+  for (int i = 0; i < 32; i++)
+    key[i] = (unsigned char)(0xa0 + i);
+  for (int i = 0; i < 20; i++)
+    aad[i] = (unsigned char)(0x50 + i);
+
+  int rc = 0;
+  for (const Case &c : cases) {
+    if (c.wrap) {
+      unsigned char j0[16] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+                              0x0f, 0x1e, 0x2d, 0x3c, 0xff, 0xff, 0xff, 0xf0};
+      gcmIvForJ0(key, j0, iv);
+    } else {
+      for (size_t i = 0; i < c.ivlen; i++)
+        iv[i] = (unsigned char)(0xc0 + i);
+    }
+    bool sealed =
+        aeadMessage(gpu, true, key, iv, c.ivlen, aad, c.aadLen, msg.data(),
+                    c.len, c.chunk, a.data(), tagA, fusedOn) &&
+        aeadMessage(gpu, true, key, iv, c.ivlen, aad, c.aadLen, msg.data(),
+                    c.len, c.chunk, unfused.data(), tagU, fusedOff) &&
+        aeadMessage(cpu, true, key, iv, c.ivlen, aad, c.aadLen, msg.data(),
+                    c.len, c.len + 1, b.data(), tagB);
+    bool fusedSame = sealed && memcmp(a.data(), unfused.data(), c.len) == 0 &&
+                     memcmp(tagA, tagU, 16) == 0;
+    bool same = fusedSame && memcmp(a.data(), b.data(), c.len) == 0 &&
+                memcmp(tagA, tagB, 16) == 0;
+    bool opened = same &&
+                  aeadMessage(gpu, false, key, iv, c.ivlen, aad, c.aadLen,
+                              a.data(), c.len, c.chunk, back.data(), tagA) &&
+                  memcmp(back.data(), msg.data(), c.len) == 0;
+    tagA[5] ^= 1;
+    bool badTag = aeadMessage(gpu, false, key, iv, c.ivlen, aad, c.aadLen,
+                              a.data(), c.len, c.chunk, back.data(), tagA);
+    tagA[5] ^= 1;
+    bool badData = false;
+    if (c.len > 0) {
+      a[c.len / 2] ^= 0x80;
+      badData = aeadMessage(gpu, false, key, iv, c.ivlen, aad, c.aadLen,
+                            a.data(), c.len, c.chunk, back.data(), tagA);
+    }
+    bool ok = same && opened && !badTag && !badData;
+    std::cout << "[Check] AES-256-GCM " << c.what << ": "
+              << (ok ? "PASS" : "FAIL");
+    if (!ok)
+      std::cout << (!sealed      ? " (seal failed)"
+                    : !fusedSame ? " (gcm-fused 1 and 0 differ)"
+                    : !same      ? " (differs from the default provider)"
+                    : !opened    ? " (open failed)"
+                                 : " (tampered message opened)");
+    std::cout << std::endl;
+    if (!ok)
+      rc = 1;
+  }
+
+  EVP_CIPHER_free(gpu);
+  EVP_CIPHER_free(cpu);
+  OSSL_PROVIDER_unload(vc6);
+  OSSL_PROVIDER_unload(def);
+  return rc;
+}
+
+static std::vector<unsigned char> fromHex(const char *hex) {
+  std::vector<unsigned char> v;
+  for (; hex[0] != '\0' && hex[1] != '\0'; hex += 2)
+    v.push_back((unsigned char)std::stoi(std::string(hex, 2), nullptr, 16));
+  return v;
+}
+
+// One stream-cipher pass through 'cipher' after discarding 'skip' bytes of
+// keystream
+static bool streamXor(EVP_CIPHER *cipher, const unsigned char *key,
+                      const unsigned char *iv, size_t skip,
+                      const unsigned char *in, size_t len,
+                      unsigned char *out) {
+  EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+  std::vector<unsigned char> pad(skip + 64);
+  int outl = 0, finl = 0;
+  bool ok = ctx != nullptr &&
+            EVP_EncryptInit_ex2(ctx, cipher, key, iv, nullptr) &&
+            (skip == 0 || (EVP_EncryptUpdate(ctx, pad.data(), &outl,
+                                             pad.data(), (int)skip) &&
+                           (size_t)outl == skip)) &&
+            EVP_EncryptUpdate(ctx, out, &outl, in, (int)len) &&
+            EVP_EncryptFinal_ex(ctx, out + outl, &finl) &&
+            (size_t)(outl + finl) == len;
+  EVP_CIPHER_CTX_free(ctx);
+  return ok;
+}
+
+// ChaCha family known answers through the vc6 provider:
+// draft-irtf-cfrg-xchacha A.3.1 (XChaCha20-Poly1305) and A.3.2 (XChaCha20;
+// the draft starts at block 1, vc6 like libsodium at block 0, so one block
+// is skipped), and ChaCha12 / ChaCha8 from draft-strombergson-chacha-test-
+// vectors TC1 (zero key and IV), also through the CPU kernel. Then the GPU
+// keystream of ChaCha20/12/8 must equal vc6_chacha_xor()'s, across a
+// 32-bit counter wrap.
+// Usage: bench_runner chacha-check
+static int runChachaCheck() {
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  if (vc6 == nullptr) {
+    std::cerr << "[Check] Cannot load the vc6 provider" << std::endl;
+    return 1;
+  }
+  int rc = 0;
+  auto report = [&rc](const char *what, bool ok) {
+    std::cout << "[Check] " << what << ": " << (ok ? "PASS" : "FAIL")
+              << std::endl;
+    if (!ok)
+      rc = 1;
+  };
+
+  unsigned char key[32];
+  for (int i = 0; i < 32; i++)
+    key[i] = (unsigned char)(0x80 + i);
+
+  {
+    const char *pt = "Ladies and Gentlemen of the class of '99: If I could "
+                     "offer you only one tip for the future, sunscreen would "
+                     "be it.";
+    auto nonce = fromHex("404142434445464748494a4b4c4d4e4f5051525354555657");
+    auto aad = fromHex("50515253c0c1c2c3c4c5c6c7");
+    auto ct = fromHex(
+        "bd6d179d3e83d43b9576579493c0e939572a1700252bfaccbed2902c21396cbb"
+        "731c7f1b0b4aa6440bf3a82f4eda7e39ae64c6708c54c216cb96b72e1213b452"
+        "2f8c9ba40db5d945b11b69b982c1bb9e3f3fac2bc369488f76b2383565d3fff9"
+        "21f9664c97637da9768812f615c68b13b52e");
+    auto tag = fromHex("c0875924c1c7987947deafd8780acf49");
+    size_t len = strlen(pt);
+    std::vector<unsigned char> out(len + 16), back(len + 16);
+    unsigned char t[16];
+    EVP_CIPHER *c =
+        EVP_CIPHER_fetch(nullptr, "XChaCha20-Poly1305", "provider=vc6");
+    bool ok = c != nullptr &&
+              aeadMessage(c, true, key, nonce.data(), 24, aad.data(),
+                          aad.size(), (const unsigned char *)pt, len, len,
+                          out.data(), t) &&
+              memcmp(out.data(), ct.data(), len) == 0 &&
+              memcmp(t, tag.data(), 16) == 0 &&
+              aeadMessage(c, false, key, nonce.data(), 24, aad.data(),
+                          aad.size(), ct.data(), len, len, back.data(),
+                          tag.data()) &&
+              memcmp(back.data(), pt, len) == 0;
+    EVP_CIPHER_free(c);
+    report("XChaCha20-Poly1305 draft-irtf-cfrg-xchacha A.3.1", ok);
+  }
+
+  {
+    const char *pt =
+        "The dhole (pronounced \"dole\") is also known as the Asiatic wild "
+        "dog, red dog, and whistling dog. It is about the size of a German "
+        "shepherd but looks more like a long-legged fox. This highly elusive "
+        "and skilled jumper is classified with wolves, coyotes, jackals, and "
+        "foxes in the taxonomic family Canidae.";
+    auto nonce = fromHex("404142434445464748494a4b4c4d4e4f5051525354555658");
+    auto ct = fromHex(
+        "7d0a2e6b7f7c65a236542630294e063b7ab9b555a5d5149aa21e4ae1e4fbce87"
+        "ecc8e08a8b5e350abe622b2ffa617b202cfad72032a3037e76ffdcdc4376ee05"
+        "3a190d7e46ca1de04144850381b9cb29f051915386b8a710b8ac4d027b8b050f"
+        "7cba5854e028d564e453b8a968824173fc16488b8970cac828f11ae53cabd201"
+        "12f87107df24ee6183d2274fe4c8b1485534ef2c5fbc1ec24bfc3663efaa08bc"
+        "047d29d25043532db8391a8a3d776bf4372a6955827ccb0cdd4af403a7ce4c63"
+        "d595c75a43e045f0cce1f29c8b93bd65afc5974922f214a40b7c402cdb91ae73"
+        "c0b63615cdad0480680f16515a7ace9d39236464328a37743ffc28f4ddb324f4"
+        "d0f5bbdc270c65b1749a6efff1fbaa09536175ccd29fb9e6057b307320d31683"
+        "8a9c71f70b5b5907a66f7ea49aadc409");
+    size_t len = strlen(pt);
+    std::vector<unsigned char> out(len);
+    EVP_CIPHER *c = EVP_CIPHER_fetch(nullptr, "XChaCha20", "provider=vc6");
+    bool ok = c != nullptr &&
+              streamXor(c, key, nonce.data(), 64, (const unsigned char *)pt,
+                        len, out.data()) &&
+              memcmp(out.data(), ct.data(), len) == 0;
+    EVP_CIPHER_free(c);
+    report("XChaCha20 draft-irtf-cfrg-xchacha A.3.2", ok);
+  }
+
+  struct Reduced {
+    const char *name, *what;
+    int rounds;
+    const char *keystream;
+  };
+  const Reduced reduced[] = {
+      {"ChaCha12", "ChaCha12 TC1 (zero key, zero IV)", 12,
+       "9bf49a6a0755f953811fce125f2683d50429c3bb49e074147e0089a52eae155f"
+       "0564f879d27ae3c02ce82834acfa8c793a629f2ca0de6919610be82f411326be"},
+      {"ChaCha8", "ChaCha8 TC1 (zero key, zero IV)", 8,
+       "3e00ef2f895f40d67f5bb8e81f09a5a12c840ec3ce9a7f3b181be188ef711a1e"
+       "984ce172b9216f419f445367456d5619314a42a3da86b001387bfdb80e0cfe42"},
+  };
+  for (const Reduced &r : reduced) {
+    auto ks = fromHex(r.keystream);
+    unsigned char zero[64] = {0}, prov[64], cpu[64];
+    EVP_CIPHER *c = EVP_CIPHER_fetch(nullptr, r.name, "provider=vc6");
+    bool ok = c != nullptr &&
+              streamXor(c, zero, zero, 0, zero, 64, prov) &&
+              memcmp(prov, ks.data(), 64) == 0;
+    vc6_chacha_xor(cpu, nullptr, 64, zero, zero, 0, r.rounds);
+    ok = ok && memcmp(cpu, ks.data(), 64) == 0;
+    EVP_CIPHER_free(c);
+    report(r.what, ok);
+  }
+
+  // GPU against the CPU kernel: 1 MB + 40 from block 0xffffff00, so the
+  // counter wraps (without carrying into the nonce) inside the job
+  void *backend = vc6_init();
+  struct Alg {
+    const char *name;
+    int id, rounds;
+  };
+  const Alg algs[] = {{"ChaCha20", VC6_ALG_CHACHA20, 20},
+                      {"ChaCha12", VC6_ALG_CHACHA12, 12},
+                      {"ChaCha8", VC6_ALG_CHACHA8, 8}};
+  const size_t len = 1024 * 1024 + 40;
+  std::vector<unsigned char> gpu(len), cpu(len);
+  unsigned char wkey[32], wiv[16] = {0x00, 0xff, 0xff, 0xff};
+  for (int i = 0; i < 32; i++)
+    wkey[i] = (unsigned char)(i * 5 + 1);
+  for (int i = 4; i < 16; i++)
+    wiv[i] = (unsigned char)(0x30 + i);
+  for (const Alg &a : algs) {
+    std::string what = std::string(a.name) + " GPU keystream vs CPU kernel";
+    if (backend == nullptr ||
+        !vc6_submit_keystream(backend, gpu.data(), len, wkey, wiv, a.id)) {
+      std::cout << "[Check] " << what << ": SKIP (no GPU)" << std::endl;
+      continue;
+    }
+    vc6_chacha_xor(cpu.data(), nullptr, len, wkey, wiv, 0, a.rounds);
+    report(what.c_str(), gpu == cpu);
+  }
+  if (backend != nullptr)
+    vc6_cleanup(backend);
+
+  OSSL_PROVIDER_unload(vc6);
+  return rc;
+}
+
+// Fills 'total' bytes with RAND_bytes_ex() calls of 'request' bytes from
+// the libctx's public DRBG; returns MB/s or a negative value on error
+static double randThroughput(OSSL_LIB_CTX *libctx, size_t request,
+                             size_t total) {
+  std::vector<unsigned char> buf(request);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t done = 0; done < total; done += request)
+    if (RAND_bytes_ex(libctx, buf.data(), request, 0) <= 0)
+      return -1;
+  auto end = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> diff = end - start;
+  return (double)total / (1024.0 * 1024.0) / diff.count();
+}
+
+// A child forked with a filled pool must not serve what the parent serves
+// next; 1 if the two draws differ
+static int randForkCheck(OSSL_LIB_CTX *libctx) {
+  unsigned char mine[32], theirs[32];
+  int fds[2];
+  if (RAND_bytes_ex(libctx, mine, sizeof(mine), 0) <= 0 || pipe(fds) != 0)
+    return 0;
+  pid_t child = fork();
+  if (child < 0)
+    return 0;
+  if (child == 0) {
+    int ok = RAND_bytes_ex(libctx, theirs, sizeof(theirs), 0) > 0 &&
+             write(fds[1], theirs, sizeof(theirs)) == (ssize_t)sizeof(theirs);
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  int status = 0;
+  bool ok = read(fds[0], theirs, sizeof(theirs)) == (ssize_t)sizeof(theirs);
+  close(fds[0]);
+  ok = waitpid(child, &status, 0) == child && ok && status == 0 &&
+       RAND_bytes_ex(libctx, mine, sizeof(mine), 0) > 0 &&
+       memcmp(mine, theirs, sizeof(mine)) != 0;
+  return ok;
+}
+
+// RAND mode: the vc6 CHACHA20-DRBG (GPU batches) against OpenSSL's default
+// CTR-DRBG, each in its own library context.
+// Usage: bench_runner rand [total_mb]
+static int runRandBench(size_t totalMB) {
+  OSSL_LIB_CTX *gpuCtx = OSSL_LIB_CTX_new();
+  OSSL_LIB_CTX *cpuCtx = OSSL_LIB_CTX_new();
+  int rc = 0;
+  if (gpuCtx == nullptr || cpuCtx == nullptr ||
+      OSSL_PROVIDER_load(gpuCtx, "default") == nullptr ||
+      OSSL_PROVIDER_load(gpuCtx, "vc6") == nullptr ||
+      OSSL_PROVIDER_load(cpuCtx, "default") == nullptr ||
+      !RAND_set_DRBG_type(gpuCtx, "CHACHA20-DRBG", "provider=vc6", nullptr,
+                          nullptr)) {
+    std::cerr << "[Bench] Cannot set up CHACHA20-DRBG from the vc6 provider"
+              << std::endl;
+    rc = 1;
+  }
+  if (rc == 0) {
+    bool forkOk = randForkCheck(gpuCtx);
+    std::cout << "[Check] CHACHA20-DRBG reseeds after fork(): "
+              << (forkOk ? "PASS" : "FAIL") << std::endl;
+    if (!forkOk)
+      rc = 1;
+  }
+
+  size_t total = totalMB * 1024 * 1024;
+  size_t requests[] = {32, 4096, 1024 * 1024};
+  for (size_t i = 0; rc == 0 && i < 3; i++) {
+    double g = randThroughput(gpuCtx, requests[i], total);
+    double c = randThroughput(cpuCtx, requests[i], total);
+    if (g < 0 || c < 0) {
+      std::cerr << "[Bench] RAND_bytes failed" << std::endl;
+      rc = 1;
+      break;
+    }
+    std::cout << "\n[Bench] RAND_bytes, " << requests[i] << "-byte requests, "
+              << totalMB << " MB" << std::endl;
+    std::cout << "[Bench]   vc6:     " << std::fixed << std::setprecision(2)
+              << g << " MB/s" << std::endl;
+    std::cout << "[Bench]   default: " << c << " MB/s (vc6 = " << g / c
+              << "x)" << std::endl;
+  }
+
+  // Freeing a library context unloads its providers
+  OSSL_LIB_CTX_free(gpuCtx);
+  OSSL_LIB_CTX_free(cpuCtx);
+  return rc;
+}
+
+// One PBKDF2-HMAC-SHA256 derivation (32-byte key); 1 on success
+static int pbkdf2Derive(EVP_KDF *kdf, int index, unsigned int iter,
+                        unsigned char *out) {
+  char pass[32];
+  unsigned char salt[16] = {0};
+  int len = snprintf(pass, sizeof(pass), "password-%d", index);
+  memcpy(salt, &index, sizeof(index));
+  char digest[] = "SHA2-256";
+  OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_PASSWORD, pass, len),
+      OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, salt,
+                                        sizeof(salt)),
+      OSSL_PARAM_construct_uint(OSSL_KDF_PARAM_ITER, &iter),
+      OSSL_PARAM_construct_utf8_string(OSSL_KDF_PARAM_DIGEST, digest, 0),
+      OSSL_PARAM_construct_end()};
+  EVP_KDF_CTX *ctx = EVP_KDF_CTX_new(kdf);
+  int ok = ctx != nullptr && EVP_KDF_derive(ctx, out, 32, params) > 0;
+  EVP_KDF_CTX_free(ctx);
+  return ok;
+}
+
+// Login storm: 'logins' concurrent PBKDF2-HMAC-SHA256 derivations (100000
+// iterations), one thread each, through the vc6 provider's batching KDF and
+// through OpenSSL's default PBKDF2. Usage: bench_runner pbkdf2 [logins]
+static int runPbkdf2Bench(size_t logins) {
+  const unsigned int ITER = 100000;
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  OSSL_PROVIDER *def = OSSL_PROVIDER_load(nullptr, "default");
+  EVP_KDF *gpuKdf = EVP_KDF_fetch(nullptr, "PBKDF2-SHA256", "provider=vc6");
+  EVP_KDF *cpuKdf = EVP_KDF_fetch(nullptr, "PBKDF2", "provider=default");
+  if (gpuKdf == nullptr || cpuKdf == nullptr) {
+    std::cerr << "[Bench] Cannot fetch PBKDF2 implementations" << std::endl;
+    EVP_KDF_free(gpuKdf);
+    EVP_KDF_free(cpuKdf);
+    OSSL_PROVIDER_unload(def);
+    OSSL_PROVIDER_unload(vc6);
+    return 1;
+  }
+
+  std::vector<unsigned char> gpu(logins * 32), cpu(logins * 32);
+  double seconds[2];
+  int failed = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    EVP_KDF *kdf = pass == 0 ? gpuKdf : cpuKdf;
+    unsigned char *out = pass == 0 ? gpu.data() : cpu.data();
+    std::vector<std::thread> threads;
+    std::vector<int> ok(logins);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < logins; i++)
+      threads.emplace_back([&, i] {
+        ok[i] = pbkdf2Derive(kdf, (int)i, ITER, out + 32 * i);
+      });
+    for (auto &t : threads)
+      t.join();
+    std::chrono::duration<double> d =
+        std::chrono::high_resolution_clock::now() - start;
+    seconds[pass] = d.count();
+    for (int o : ok)
+      failed |= !o;
+  }
+
+  // A lone derivation must not pay the collection window
+  double lone[2];
+  for (int pass = 0; pass < 2; pass++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    failed |= !pbkdf2Derive(pass == 0 ? gpuKdf : cpuKdf, 0, ITER,
+                            pass == 0 ? gpu.data() : cpu.data());
+    std::chrono::duration<double> d =
+        std::chrono::high_resolution_clock::now() - start;
+    lone[pass] = d.count();
+  }
+  EVP_KDF_free(gpuKdf);
+  EVP_KDF_free(cpuKdf);
+  OSSL_PROVIDER_unload(def);
+  OSSL_PROVIDER_unload(vc6);
+
+  if (failed || gpu != cpu) {
+    std::cerr << "[Bench] PBKDF2 failed or mismatched OpenSSL" << std::endl;
+    return 1;
+  }
+  std::cout << "\n[Bench] PBKDF2-HMAC-SHA256, " << logins
+            << " concurrent derivations x " << ITER << " iterations"
+            << std::endl;
+  std::cout << "[Bench]   vc6:     " << std::fixed << std::setprecision(1)
+            << logins / seconds[0] << " derivations/s" << std::endl;
+  std::cout << "[Bench]   default: " << logins / seconds[1]
+            << " derivations/s (vc6 = " << std::setprecision(2)
+            << seconds[1] / seconds[0] << "x)" << std::endl;
+  std::cout << "[Bench]   single derivation: vc6 " << std::setprecision(2)
+            << lone[0] * 1e3 << " ms, default " << lone[1] * 1e3 << " ms"
+            << std::endl;
+  return 0;
+}
+
+// Names of the property bits a host-visible memory type can carry
+static std::string memoryFlags(VkMemoryPropertyFlags f) {
+  static const struct {
+    VkMemoryPropertyFlags bit;
+    const char *name;
+  } names[] = {{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "DEVICE_LOCAL"},
+               {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "HOST_VISIBLE"},
+               {VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "HOST_COHERENT"},
+               {VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "HOST_CACHED"}};
+  std::string s;
+  for (const auto &n : names)
+    if (f & n.bit)
+      s += (s.empty() ? "" : "|") + std::string(n.name);
+  return s;
+}
+
+// Ring copy bandwidth: for every host-visible memory type, a 'sizeMB'
+// buffer is written and read with one thread and through the TaskPool,
+// with plain and streaming (non-temporal) stores. GB/s, best of REPS. The
+// types findRingMemoryType() picks for the two rings are marked.
+// Usage: bench_runner memcpy [size_mb]
+static int runMemcpyBench(VulkanContext &ctx, size_t sizeMB) {
+  const int REPS = 5;
+  const size_t size = sizeMB * 1024 * 1024;
+  std::vector<unsigned char> host(size, 0xAB);
+  TaskPool &pool = TaskPool::instance();
+  VkPhysicalDeviceMemoryProperties props;
+  vkGetPhysicalDeviceMemoryProperties(ctx.getPhysicalDevice(), &props);
+  // The batchers' choice, if the ring buffers allowed every type
+  uint32_t uploadType =
+      findRingMemoryType(ctx.getPhysicalDevice(), ~0u, RingUse::Upload);
+  uint32_t readbackType =
+      findRingMemoryType(ctx.getPhysicalDevice(), ~0u, RingUse::Readback);
+  std::cout << "\n[Bench] Ring copies, " << sizeMB << " MB, "
+            << pool.workers() << " pool workers, stream = "
+            << vc6_stream_copy_impl() << ", "
+            << (ctx.isUnifiedMemory() ? "unified memory"
+                                      : "staging through device-local rings")
+            << std::endl;
+
+  for (uint32_t i = 0; i < props.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags f = props.memoryTypes[i].propertyFlags;
+    if (!(f & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      continue;
+    std::cout << "[Bench] Type " << i << " (heap "
+              << props.memoryTypes[i].heapIndex << ", " << memoryFlags(f)
+              << ")"
+              << (i == uploadType ? " input ring" : "")
+              << (i == readbackType ? " output ring" : "") << std::endl;
+
+    VkMemoryAllocateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.allocationSize = size;
+    info.memoryTypeIndex = i;
+    VkDeviceMemory memory;
+    void *mapped;
+    if (vkAllocateMemory(ctx.getDevice(), &info, nullptr, &memory) !=
+        VK_SUCCESS) {
+      std::cout << "[Bench]   cannot allocate " << sizeMB << " MB"
+                << std::endl;
+      continue;
+    }
+    if (vkMapMemory(ctx.getDevice(), memory, 0, size, 0, &mapped) !=
+        VK_SUCCESS) {
+      std::cout << "[Bench]   cannot map" << std::endl;
+      vkFreeMemory(ctx.getDevice(), memory, nullptr);
+      continue;
+    }
+
+    const struct {
+      const char *name;
+      std::function<void()> copy;
+    } cases[] = {
+        {"write memcpy", [&] { memcpy(mapped, host.data(), size); }},
+        {"write stream", [&] { vc6_stream_copy(mapped, host.data(), size); }},
+        {"write pool", [&] { pool.copy(mapped, host.data(), size); }},
+        {"write pool+stream",
+         [&] { pool.copy(mapped, host.data(), size, true); }},
+        {"read memcpy", [&] { memcpy(host.data(), mapped, size); }},
+        {"read pool", [&] { pool.copy(host.data(), mapped, size); }},
+    };
+    for (const auto &c : cases) {
+      double best = 0;
+      for (int r = 0; r < REPS; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        c.copy();
+        std::chrono::duration<double> d =
+            std::chrono::high_resolution_clock::now() - start;
+        best = r == 0 ? d.count() : std::min(best, d.count());
+      }
+      std::cout << "[Bench]   " << std::left << std::setw(18) << c.name
+                << std::right << std::fixed << std::setprecision(2)
+                << size / best / 1e9 << " GB/s" << std::endl;
+    }
+    vkUnmapMemory(ctx.getDevice(), memory);
+    vkFreeMemory(ctx.getDevice(), memory, nullptr);
+  }
+  return 0;
+}
 
-          if (i % logInterval == 0) {
-            std::cout << "Iter: " << i << "\r" << std::flush;
+// ringRange() must cover [offset, offset + size) in whole atoms and never
+// run past the mapping, also one that does not end on an atom; false (and
+// a message) on the first violation
+static bool checkRingRanges() {
+  const VkDeviceSize atoms[] = {1, 64, 256};
+  const VkDeviceSize sizes[] = {1024 * 1024, 1024 * 1024 - 32};
+  for (VkDeviceSize atom : atoms) {
+    for (VkDeviceSize ringSize : sizes) {
+      RingBuffer ring = {};
+      ring.size = ringSize;
+      ring.atomSize = atom;
+      for (VkDeviceSize offset = 0; offset < ringSize; offset += 4093) {
+        const VkDeviceSize lens[] = {0, 1, 17, 4096, ringSize - offset};
+        for (VkDeviceSize size : lens) {
+          if (offset + size > ringSize)
+            continue;
+          VkMappedMemoryRange r = ringRange(ring, offset, size);
+          VkDeviceSize end =
+              r.size == VK_WHOLE_SIZE ? ringSize : r.offset + r.size;
+          bool ok = r.offset % atom == 0 && r.offset <= offset &&
+                    end >= offset + size && end <= ringSize &&
+                    (r.size == VK_WHOLE_SIZE || r.size % atom == 0) &&
+                    (size == 0 || end - offset - size < atom);
+          if (!ok) {
+            std::cerr << "[Check] ringRange(atom " << atom << ", ring "
+                      << ringSize << ", offset " << offset << ", size "
+                      << size << ") = [" << r.offset << ", " << end << ")"
+                      << std::endl;
+            return false;
           }
         }
+      }
+    }
+  }
+  return true;
+}
 
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = end - start;
+// Ring readback and upload through every host-visible memory type,
+// non-coherent ones included. vkCmdFillBuffer / vkCmdCopyBuffer stand in
+// for a shader: the CPU reads the ring first so stale lines sit in its
+// cache, then only the ringRange() of each job is flushed / invalidated.
+// Also times the invalidate of one job against the whole ring.
+// Usage: bench_runner ringcheck
+static int runRingCheck() {
+  const VkDeviceSize SIZE = 8 * 1024 * 1024;
+  const struct {
+    VkDeviceSize offset, size;
+  } jobs[] = {{0, 4}, {4, 60}, {256, 4096}, {1020, 65540}, {SIZE - 4096, 4096}};
 
-        double mb = (double)TOTAL_DATA / (1024.0 * 1024.0);
-        double throughput = mb / diff.count();
+  if (!checkRingRanges())
+    return 1;
+  std::cout << "[Check] ringRange: ok" << std::endl;
 
-        std::cout << "\n[Bench] Completed in " << std::fixed
-                  << std::setprecision(3) << diff.count() << " seconds."
-                  << std::endl;
-        std::cout << "[Bench] Throughput: " << throughput << " MB/s"
-                  << std::endl;
+  std::unique_ptr<VulkanContext> ctx;
+  try {
+    ctx.reset(new VulkanContext());
+  } catch (const std::exception &e) {
+    std::cout << "[Check] No Vulkan device (" << e.what()
+              << "), memory types not checked" << std::endl;
+    return 0;
+  }
+  VkDevice dev = ctx->getDevice();
+  VkPhysicalDeviceMemoryProperties props;
+  vkGetPhysicalDeviceMemoryProperties(ctx->getPhysicalDevice(), &props);
+  VkPhysicalDeviceProperties devProps;
+  vkGetPhysicalDeviceProperties(ctx->getPhysicalDevice(), &devProps);
+
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = ctx->getComputeQueueFamilyIndex();
+  VkCommandPool cmdPool;
+  vkCreateCommandPool(dev, &poolInfo, nullptr, &cmdPool);
+  VkCommandBufferAllocateInfo cbInfo = {};
+  cbInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbInfo.commandPool = cmdPool;
+  cbInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbInfo.commandBufferCount = 1;
+  VkCommandBuffer cb;
+  vkAllocateCommandBuffers(dev, &cbInfo, &cb);
+
+  // Records 'fn' into cb, submits it and waits
+  auto run = [&](const std::function<void()> &fn) {
+    VkCommandBufferBeginInfo begin = {};
+    begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkResetCommandBuffer(cb, 0);
+    vkBeginCommandBuffer(cb, &begin);
+    fn();
+    cmdBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+               VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+               VK_ACCESS_HOST_READ_BIT);
+    vkEndCommandBuffer(cb);
+    VkSubmitInfo submit = {};
+    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cb;
+    return vkQueueSubmit(ctx->getComputeQueue(), 1, &submit, VK_NULL_HANDLE) ==
+               VK_SUCCESS &&
+           vkQueueWaitIdle(ctx->getComputeQueue()) == VK_SUCCESS;
+  };
+
+  int rc = 0;
+  for (uint32_t i = 0; i < props.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags f = props.memoryTypes[i].propertyFlags;
+    if (!(f & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+      continue;
+
+    RingBuffer ring = {};
+    VkBufferCreateInfo bufInfo = {};
+    bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufInfo.size = SIZE;
+    bufInfo.usage =
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    vkCreateBuffer(dev, &bufInfo, nullptr, &ring.buffer);
+    VkMemoryRequirements req;
+    vkGetBufferMemoryRequirements(dev, ring.buffer, &req);
+    VkMemoryAllocateInfo alloc = {};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = i;
+    if (!(req.memoryTypeBits & (1u << i)) ||
+        vkAllocateMemory(dev, &alloc, nullptr, &ring.memory) != VK_SUCCESS) {
+      vkDestroyBuffer(dev, ring.buffer, nullptr);
+      continue;
+    }
+    vkBindBufferMemory(dev, ring.buffer, ring.memory, 0);
+    vkMapMemory(dev, ring.memory, 0, SIZE, 0, &ring.mappedUrl);
+    ring.size = SIZE;
+    ring.flags = f;
+    ring.atomSize = devProps.limits.nonCoherentAtomSize;
+    unsigned char *mapped = (unsigned char *)ring.mappedUrl;
+    VkMappedMemoryRange whole = ringRange(ring, 0, SIZE);
+
+    bool readOk = true, uploadOk = true;
+    uint32_t pattern = 0x5A000000u | i;
+    for (const auto &job : jobs) {
+      // Readback: stale bytes cached, GPU fills, ranged invalidate
+      memset(mapped, 0x11, SIZE);
+      vkFlushMappedMemoryRanges(dev, 1, &whole);
+      volatile unsigned sink = 0;
+      for (VkDeviceSize b = 0; b < SIZE; b += 64)
+        sink += mapped[b];
+      pattern += 0x01010101u;
+      readOk &= run([&] {
+        vkCmdFillBuffer(cb, ring.buffer, job.offset, job.size, pattern);
+      });
+      VkMappedMemoryRange r = ringRange(ring, job.offset, job.size);
+      vkInvalidateMappedMemoryRanges(dev, 1, &r);
+      for (VkDeviceSize b = 0; b < job.size; b += 4)
+        readOk &= memcmp(mapped + job.offset + b, &pattern, 4) == 0;
+
+      // Upload: CPU writes, ranged flush, GPU copies it to the other half
+      VkDeviceSize half = SIZE / 2, src = job.offset % half;
+      VkDeviceSize n = std::min(job.size, half - src);
+      for (VkDeviceSize b = 0; b < n; b++)
+        mapped[src + b] = (unsigned char)(b * 7 + i);
+      r = ringRange(ring, src, n);
+      vkFlushMappedMemoryRanges(dev, 1, &r);
+      uploadOk &= run([&] {
+        VkBufferCopy region = {src, half + src, n};
+        vkCmdCopyBuffer(cb, ring.buffer, ring.buffer, 1, &region);
+      });
+      r = ringRange(ring, half + src, n);
+      vkInvalidateMappedMemoryRanges(dev, 1, &r);
+      uploadOk &= memcmp(mapped + half + src, mapped + src, n) == 0;
+    }
+
+    // Invalidate cost: one 64 KB job against the whole ring (what every
+    // dispatch paid before the ranges were exact)
+    double ns[2];
+    VkMappedMemoryRange ranges[2] = {ringRange(ring, 4096, 65536), whole};
+    for (int k = 0; k < 2; k++) {
+      const int REPS = 100;
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int rep = 0; rep < REPS; rep++)
+        vkInvalidateMappedMemoryRanges(dev, 1, &ranges[k]);
+      std::chrono::duration<double> d =
+          std::chrono::high_resolution_clock::now() - start;
+      ns[k] = d.count() * 1e9 / REPS;
+    }
+
+    std::cout << "[Check] Type " << i << " (" << memoryFlags(f)
+              << "): readback " << (readOk ? "ok" : "FAIL") << ", upload "
+              << (uploadOk ? "ok" : "FAIL") << ", invalidate 64 KB "
+              << std::fixed << std::setprecision(0) << ns[0]
+              << " ns, whole " << (SIZE >> 20) << " MB " << ns[1] << " ns"
+              << std::endl;
+    rc |= !(readOk && uploadOk);
+
+    vkUnmapMemory(dev, ring.memory);
+    vkFreeMemory(dev, ring.memory, nullptr);
+    vkDestroyBuffer(dev, ring.buffer, nullptr);
+  }
+  vkDestroyCommandPool(dev, cmdPool, nullptr);
+  return rc;
+}
+
+// ---------------------------------------------------------------------------
+// Sweep suite (default mode): every algorithm through the vc6 provider next
+// to OpenSSL's default provider, plus the batchers called directly, over a
+// sweep of message sizes at 1 and N threads. One JSON document goes to
+// stdout (or --json FILE); progress goes to stderr.
+//
+// Each point runs for --seconds per thread (and at least MIN_OPS operations)
+// after one warm-up operation. Latency is per operation: one message through
+// a fresh cipher init / digest init, or one batcher submit.
+// ---------------------------------------------------------------------------
+
+struct SuiteOptions {
+  std::vector<std::string> algs; // Empty: all
+  size_t minSize = 16;
+  size_t maxSize = 64 * 1024 * 1024;
+  int threads = 4; // Also run at 1 thread
+  double seconds = 0.5;
+  const char *jsonPath = nullptr;
+  bool baseline = true;
+  bool batchers = true;
+  int cpu = -1; // Pin every thread to this core (-1: no pinning)
+};
+
+// One operation on 'size' bytes; false on error
+using BenchOp =
+    std::function<bool(const unsigned char *in, unsigned char *out, size_t)>;
+
+struct BenchTarget {
+  std::string alg;
+  std::string impl; // vc6, default, batcher, aes256_batcher, keystream_pool,
+                    // cpu
+  std::string op;   // encrypt, decrypt, digest
+  size_t maxSize;   // Largest size the implementation accepts
+  // Builds one thread's state; an empty BenchOp means setup failed
+  std::function<BenchOp()> make;
+};
+
+struct BenchResult {
+  size_t ops = 0;
+  double seconds = 0;
+  double p50 = 0, p99 = 0, p999 = 0; // Microseconds
+  std::string error;
+};
+
+static const size_t MIN_OPS = 3;
+
+// Random keys/IVs shared by all targets (the same inputs on both providers)
+static unsigned char benchKey[64], benchIv[32];
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t rank = (size_t)std::ceil(p * sorted.size());
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static BenchResult runPoint(const BenchTarget &t, size_t size, int threads,
+                            double seconds) {
+  BenchResult r;
+  std::vector<std::vector<double>> lat(threads);
+  std::vector<std::string> err(threads);
+  std::vector<double> elapsed(threads);
+
+  auto worker = [&](int id) {
+    BenchOp op = t.make();
+    if (!op) {
+      err[id] = "setup failed";
+      return;
+    }
+    std::vector<unsigned char> in(size), out(size + 64);
+    RAND_bytes(in.data(), (int)std::min<size_t>(size, 4096));
+    if (!op(in.data(), out.data(), size)) { // Warm-up
+      err[id] = "operation failed";
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    double total = 0;
+    while (total < seconds || lat[id].size() < MIN_OPS) {
+      auto a = std::chrono::steady_clock::now();
+      if (!op(in.data(), out.data(), size)) {
+        err[id] = "operation failed";
+        return;
       }
+      auto b = std::chrono::steady_clock::now();
+      lat[id].push_back(std::chrono::duration<double, std::micro>(b - a).count());
+      total = std::chrono::duration<double>(b - start).count();
     }
+    elapsed[id] = total;
+  };
 
-  } catch (const std::exception &e) {
-    std::cerr << "[Bench] Exception: " << e.what() << std::endl;
-    return 1;
+  std::vector<std::thread> pool;
+  for (int i = 0; i < threads; i++)
+    pool.emplace_back(worker, i);
+  for (auto &th : pool)
+    th.join();
+
+  std::vector<double> all;
+  for (int i = 0; i < threads; i++) {
+    if (!err[i].empty()) {
+      r.error = err[i];
+      return r;
+    }
+    all.insert(all.end(), lat[i].begin(), lat[i].end());
+    r.seconds = std::max(r.seconds, elapsed[i]);
   }
+  std::sort(all.begin(), all.end());
+  r.ops = all.size();
+  r.p50 = percentile(all, 0.50);
+  r.p99 = percentile(all, 0.99);
+  r.p999 = percentile(all, 0.999);
+  return r;
+}
+
+// EVP cipher target: one message per operation (init with key/IV, AAD and
+// tag for AEADs); block modes run without padding
+static BenchTarget cipherTarget(const char *alg, const char *impl, bool enc) {
+  BenchTarget t{alg, impl, enc ? "encrypt" : "decrypt", SIZE_MAX, nullptr};
+  std::string props = std::string("provider=") + impl;
+  std::string name = alg;
+  // OpenSSL caps an XTS data unit at 2^20 blocks
+  if (name.find("XTS") != std::string::npos)
+    t.maxSize = 16 * 1024 * 1024;
+  t.make = [name, props, enc]() -> BenchOp {
+    EVP_CIPHER *c = EVP_CIPHER_fetch(nullptr, name.c_str(), props.c_str());
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (c == nullptr || ctx == nullptr) {
+      EVP_CIPHER_free(c);
+      EVP_CIPHER_CTX_free(ctx);
+      return nullptr;
+    }
+    bool aead = (EVP_CIPHER_get_flags(c) & EVP_CIPH_FLAG_AEAD_CIPHER) != 0;
+    std::shared_ptr<EVP_CIPHER_CTX> hold(ctx, EVP_CIPHER_CTX_free);
+    std::shared_ptr<EVP_CIPHER> holdCipher(c, EVP_CIPHER_free);
+    return [hold, holdCipher, aead, enc](const unsigned char *in,
+                                         unsigned char *out, size_t len) {
+      EVP_CIPHER_CTX *x = hold.get();
+      unsigned char aad[13] = {0}, tag[16];
+      int outl, finl;
+      if (!EVP_CipherInit_ex(x, holdCipher.get(), nullptr, benchKey, benchIv,
+                             enc ? 1 : 0))
+        return false;
+      EVP_CIPHER_CTX_set_padding(x, 0);
+      if (aead && !EVP_CipherUpdate(x, nullptr, &outl, aad, sizeof(aad)))
+        return false;
+      if (!EVP_CipherUpdate(x, out, &outl, in, (int)len) ||
+          !EVP_CipherFinal_ex(x, out + outl, &finl))
+        return false;
+      return !aead ||
+             EVP_CIPHER_CTX_ctrl(x, EVP_CTRL_AEAD_GET_TAG, 16, tag) > 0;
+    };
+  };
+  return t;
+}
+
+static BenchTarget digestTarget(const char *alg, const char *impl) {
+  BenchTarget t{alg, impl, "digest", SIZE_MAX, nullptr};
+  std::string name = alg, props = std::string("provider=") + impl;
+  t.make = [name, props]() -> BenchOp {
+    EVP_MD *md = EVP_MD_fetch(nullptr, name.c_str(), props.c_str());
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (md == nullptr || ctx == nullptr) {
+      EVP_MD_free(md);
+      EVP_MD_CTX_free(ctx);
+      return nullptr;
+    }
+    std::shared_ptr<EVP_MD_CTX> hold(ctx, EVP_MD_CTX_free);
+    std::shared_ptr<EVP_MD> holdMd(md, EVP_MD_free);
+    return [hold, holdMd](const unsigned char *in, unsigned char *out,
+                          size_t len) {
+      unsigned int outl;
+      return EVP_DigestInit_ex(hold.get(), holdMd.get(), nullptr) &&
+             EVP_DigestUpdate(hold.get(), in, len) &&
+             EVP_DigestFinal_ex(hold.get(), out, &outl);
+    };
+  };
+  return t;
+}
+
+// Provider algorithms: name, is digest, has a default-provider baseline
+struct ProviderAlg {
+  const char *name;
+  bool digest;
+  bool baseline;
+};
+static const ProviderAlg providerAlgs[] = {
+    {"AES-128-CTR", false, true},        {"AES-256-CTR", false, true},
+    {"ChaCha20", false, true},           {"ChaCha12", false, false},
+    {"ChaCha8", false, false},           {"AES-256-ECB", false, true},
+    {"AES-256-CBC", false, true},        {"AES-256-XTS", false, true},
+    {"AES-256-GCM", false, true},        {"ChaCha20-Poly1305", false, true},
+    {"XChaCha20", false, false},         {"XChaCha20-Poly1305", false, false},
+    {"VC6-SHA2-256", true, false},       {"BLAKE3", true, false},
+};
+
+// Direct batcher targets; 'batcher' etc. are created once and shared by
+// all threads (their submits are thread-safe)
+static void addBatcherTargets(std::vector<BenchTarget> &targets,
+                              Batcher *batcher, AES256Batcher *aes) {
+  struct {
+    const char *alg;
+    Batcher::Algorithm id;
+    const char *op;
+  } direct[] = {{"AES-128-CTR", Batcher::ALG_AES128_CTR, "encrypt"},
+                {"AES-256-CTR", Batcher::ALG_AES256_CTR, "encrypt"},
+                {"ChaCha20", Batcher::ALG_CHACHA20, "encrypt"},
+                {"ChaCha12", Batcher::ALG_CHACHA12, "encrypt"},
+                {"ChaCha8", Batcher::ALG_CHACHA8, "encrypt"},
+                {"AES-256-ECB", Batcher::ALG_AES256_ECB_ENC, "encrypt"},
+                {"AES-256-CBC", Batcher::ALG_AES256_CBC_DEC, "decrypt"}};
+  for (auto &d : direct) {
+    Batcher::Algorithm id = d.id;
+    targets.push_back({d.alg, "batcher", d.op, SIZE_MAX, [batcher, id]() {
+                         return BenchOp([batcher, id](const unsigned char *in,
+                                                      unsigned char *out,
+                                                      size_t len) {
+                           return batcher->submit(in, out, len, benchKey,
+                                                  benchIv, id);
+                         });
+                       }});
+  }
+  targets.push_back(
+      {"AES-256-XTS", "batcher", "encrypt", SIZE_MAX, [batcher]() {
+         return BenchOp([batcher](const unsigned char *in, unsigned char *out,
+                                  size_t len) {
+           return batcher->submitXts(in, out, len, benchKey, benchIv,
+                                     std::min<size_t>(len, 4096), 0, false);
+         });
+       }});
+  targets.push_back({"BLAKE3", "batcher", "digest", SIZE_MAX, [batcher]() {
+                       return BenchOp([batcher](const unsigned char *in,
+                                                unsigned char *out,
+                                                size_t len) {
+                         // Chunk pass only; the CPU merge is the same for
+                         // every size class
+                         size_t count;
+                         return batcher->submitBlake3(in, len, 0, out,
+                                                      &count);
+                       });
+                     }});
+  targets.push_back(
+      {"AES-256-CTR", "aes256_batcher", "encrypt", SIZE_MAX, [aes]() {
+         return BenchOp([aes](const unsigned char *in, unsigned char *out,
+                              size_t len) {
+           return aes->submit(in, out, len, benchKey, benchIv);
+         });
+       }});
+  // Keystream-ahead pool: one stream per thread, 16 MB window
+  struct {
+    const char *alg;
+    Batcher::Algorithm id;
+  } streams[] = {{"AES-256-CTR", Batcher::ALG_AES256_CTR},
+                 {"ChaCha20", Batcher::ALG_CHACHA20}};
+  for (auto &st : streams) {
+    Batcher::Algorithm id = st.id;
+    targets.push_back(
+        {st.alg, "keystream_pool", "encrypt", SIZE_MAX, [batcher, id]() {
+           std::shared_ptr<KeystreamPool> pool;
+           try {
+             pool = std::make_shared<KeystreamPool>(batcher, id, benchKey,
+                                                    benchIv, 16 * 1024 * 1024);
+           } catch (const std::exception &) {
+             return BenchOp();
+           }
+           return BenchOp([pool](const unsigned char *in, unsigned char *out,
+                                 size_t len) {
+             return pool->xorInto(in, out, len);
+           });
+         }});
+  }
+}
 
+// The CPU kernels behind the backend's small-job path; against the
+// "batcher" targets this shows where a dispatch starts to pay off, and the
+// AES ones against "default" compare the bitsliced code with OpenSSL's
+// AES on the same core (see --cpu)
+static void addCpuTargets(std::vector<BenchTarget> &targets) {
+  struct {
+    const char *alg;
+    int rounds;
+  } chacha[] = {{"ChaCha20", 20}, {"ChaCha12", 12}, {"ChaCha8", 8}};
+  for (auto &c : chacha) {
+    int rounds = c.rounds;
+    targets.push_back({c.alg, "cpu", "encrypt", SIZE_MAX, [rounds]() {
+                         return BenchOp([rounds](const unsigned char *in,
+                                                 unsigned char *out,
+                                                 size_t len) {
+                           vc6_chacha_xor(out, in, len, benchKey, benchIv, 0,
+                                          rounds);
+                           return true;
+                         });
+                       }});
+  }
+  struct {
+    const char *alg;
+    size_t keyLen;
+  } aes[] = {{"AES-128-CTR", 16}, {"AES-256-CTR", 32}};
+  for (auto &a : aes) {
+    size_t keyLen = a.keyLen;
+    targets.push_back({a.alg, "cpu", "encrypt", SIZE_MAX, [keyLen]() {
+                         // Key schedule once per thread, like an EVP ctx
+                         auto k = std::make_shared<VC6_AES_CT_KEY>();
+                         vc6_aes_ct_init(k.get(), benchKey, keyLen);
+                         return BenchOp([k](const unsigned char *in,
+                                            unsigned char *out, size_t len) {
+                           vc6_aes_ct_ctr(k.get(), out, in, len, benchIv, 0);
+                           return true;
+                         });
+                       }});
+  }
+}
+
+static void jsonString(std::ostream &o, const std::string &v) {
+  o << '"';
+  for (char c : v) {
+    if (c == '"' || c == '\\')
+      o << '\\' << c;
+    else if ((unsigned char)c < 0x20)
+      o << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c
+        << std::dec << std::setfill(' ');
+    else
+      o << c;
+  }
+  o << '"';
+}
+
+// Upper bound of the log2 bucket holding the q-quantile, capped at the max
+static double bucketQuantileUs(const StageProfile::Histogram &h, double q) {
+  uint64_t rank = (uint64_t)std::ceil(q * h.count), seen = 0;
+  for (int i = 0; i < StageProfile::BUCKETS; i++) {
+    seen += h.buckets[i];
+    if (seen >= rank && seen > 0)
+      return std::min((double)(2ULL << i), (double)h.maxNs) / 1000.0;
+  }
+  return h.maxNs / 1000.0;
+}
+
+// Per-stage breakdown of one batcher over the whole run
+static void jsonStages(std::ostream &o, const char *name,
+                       StageProfile &profile) {
+  StageProfile::Histogram h[StageProfile::STAGE_COUNT];
+  profile.snapshot(h);
+  o << "    ";
+  jsonString(o, name);
+  o << ": {";
+  bool first = true;
+  for (int i = 0; i < StageProfile::STAGE_COUNT; i++) {
+    if (h[i].count == 0)
+      continue;
+    o << (first ? "\n      " : ",\n      ");
+    first = false;
+    jsonString(o, StageProfile::stageName((StageProfile::Stage)i));
+    o << ": {\"count\": " << h[i].count
+      << ", \"mean_us\": " << h[i].totalNs / 1000.0 / h[i].count
+      << ", \"min_us\": " << h[i].minNs / 1000.0
+      << ", \"p50_us\": " << bucketQuantileUs(h[i], 0.5)
+      << ", \"p99_us\": " << bucketQuantileUs(h[i], 0.99)
+      << ", \"max_us\": " << h[i].maxNs / 1000.0 << "}";
+  }
+  o << (first ? "}" : "\n    }");
+}
+
+// Backend counters over the whole run (vc6_get_stats())
+static void jsonRuntime(std::ostream &o) {
+  VC6_STATS st;
+  vc6_get_stats(&st);
+  o << "  \"runtime\": {";
+  const char *sides[2] = {"gpu", "cpu"};
+  for (int side = 0; side < 2; side++) {
+    const uint64_t *jobs = side == 0 ? st.gpu_jobs : st.cpu_jobs;
+    const uint64_t *bytes = side == 0 ? st.gpu_bytes : st.cpu_bytes;
+    o << "\n    \"" << sides[side] << "\": {";
+    bool first = true;
+    for (int i = 0; i < VC6_ALG_COUNT; i++) {
+      if (jobs[i] == 0)
+        continue;
+      o << (first ? "" : ", ");
+      first = false;
+      jsonString(o, vc6_alg_name(i));
+      o << ": {\"jobs\": " << jobs[i] << ", \"bytes\": " << bytes[i] << "}";
+    }
+    o << "},";
+  }
+  o << "\n    \"queue_depth_max\": " << st.queue_depth_max
+    << ", \"ring_high_water\": " << st.ring_high_water
+    << ", \"wait_count\": " << st.wait_count
+    << ", \"wait_ns\": " << st.wait_ns << "\n  }";
+}
+
+static bool wanted(const SuiteOptions &opt, const std::string &alg) {
+  return opt.algs.empty() ||
+         std::find(opt.algs.begin(), opt.algs.end(), alg) != opt.algs.end();
+}
+
+static int runSuite(const SuiteOptions &opt) {
+  RAND_bytes(benchKey, sizeof(benchKey));
+  RAND_bytes(benchIv, sizeof(benchIv));
+  benchIv[0] &= 0x7f; // Keep CTR counters far from wrapping
+
+  OSSL_PROVIDER *vc6 = OSSL_PROVIDER_load(nullptr, "vc6");
+  OSSL_PROVIDER *def = OSSL_PROVIDER_load(nullptr, "default");
+  if (vc6 == nullptr)
+    std::cerr << "[Bench] vc6 provider not available" << std::endl;
+
+  std::vector<BenchTarget> targets;
+  for (const ProviderAlg &a : providerAlgs) {
+    if (!wanted(opt, a.name))
+      continue;
+    std::vector<const char *> impls = {"vc6"};
+    if (opt.baseline && a.baseline)
+      impls.push_back("default");
+    for (const char *impl : impls) {
+      if (a.digest) {
+        targets.push_back(digestTarget(a.name, impl));
+      } else {
+        targets.push_back(cipherTarget(a.name, impl, true));
+        // CBC: vc6 decrypts on the GPU but encrypts on the CPU
+        if (strcmp(a.name, "AES-256-CBC") == 0)
+          targets.push_back(cipherTarget(a.name, impl, false));
+      }
+    }
+  }
+
+  std::vector<BenchTarget> cpu;
+  addCpuTargets(cpu);
+  for (auto &t : cpu)
+    if (wanted(opt, t.alg))
+      targets.push_back(t);
+
+  std::unique_ptr<VulkanContext> vk;
+  std::unique_ptr<Batcher> batcher;
+  std::unique_ptr<AES256Batcher> aes;
+  if (opt.batchers) {
+    try {
+      vk.reset(new VulkanContext());
+      batcher.reset(new Batcher(vk.get()));
+      aes.reset(new AES256Batcher(vk.get()));
+      std::vector<BenchTarget> direct;
+      addBatcherTargets(direct, batcher.get(), aes.get());
+      for (auto &t : direct)
+        if (wanted(opt, t.alg))
+          targets.push_back(t);
+    } catch (const std::exception &e) {
+      std::cerr << "[Bench] Batchers skipped: " << e.what() << std::endl;
+    }
+  }
+
+  std::vector<int> threadCounts = {1};
+  if (opt.threads > 1)
+    threadCounts.push_back(opt.threads);
+
+  std::ofstream file;
+  if (opt.jsonPath != nullptr) {
+    file.open(opt.jsonPath);
+    if (!file) {
+      std::cerr << "[Bench] Cannot write " << opt.jsonPath << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &json = opt.jsonPath != nullptr ? file : std::cout;
+  json << std::fixed << std::setprecision(3);
+  json << "{\n  \"suite\": \"vc6-bench\",\n  \"seconds_per_point\": "
+       << opt.seconds << ",\n  \"cpu_chacha\": \"" << vc6_chacha_cpu_impl()
+       << "\",\n  \"cpu_aes\": \"" << vc6_aes_ct_impl()
+       << "\",\n  \"results\": [";
+
+  bool first = true;
+  for (const BenchTarget &t : targets) {
+    for (int threads : threadCounts) {
+      for (size_t size = opt.minSize; size <= std::min(opt.maxSize, t.maxSize);
+           size *= 4) {
+        BenchResult r = runPoint(t, size, threads, opt.seconds);
+        double mbps = r.seconds > 0 ? (double)r.ops * size /
+                                          (1024.0 * 1024.0) / r.seconds
+                                    : 0;
+        std::cerr << "[Bench] " << std::left << std::setw(20) << t.alg
+                  << std::setw(15) << t.impl << std::setw(8) << t.op
+                  << std::right << std::setw(10) << size << " B x"
+                  << threads << ": ";
+        if (r.error.empty())
+          std::cerr << std::fixed << std::setprecision(2) << mbps
+                    << " MB/s, p50 " << r.p50 << " us, p99 " << r.p99
+                    << " us" << std::endl;
+        else
+          std::cerr << r.error << std::endl;
+
+        json << (first ? "\n" : ",\n") << "    {\"alg\": ";
+        first = false;
+        jsonString(json, t.alg);
+        json << ", \"impl\": ";
+        jsonString(json, t.impl);
+        json << ", \"op\": ";
+        jsonString(json, t.op);
+        json << ", \"size\": " << size << ", \"threads\": " << threads;
+        if (!r.error.empty()) {
+          json << ", \"error\": ";
+          jsonString(json, r.error);
+          json << "}";
+          break; // Larger sizes would fail the same way
+        }
+        json << ", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+             << ", \"mb_per_s\": " << mbps
+             << ", \"ops_per_s\": " << r.ops / r.seconds
+             << ", \"latency_us\": {\"p50\": " << r.p50
+             << ", \"p99\": " << r.p99 << ", \"p999\": " << r.p999 << "}}";
+      }
+    }
+  }
+  json << "\n  ]";
+  // Where the direct batcher time went; p50/p99 are log2 bucket bounds
+  if (batcher) {
+    json << ",\n  \"stages\": {\n";
+    jsonStages(json, "batcher", batcher->stageProfile());
+    json << ",\n";
+    jsonStages(json, "aes256", aes->stageProfile());
+    json << "\n  }";
+  }
+  json << ",\n";
+  jsonRuntime(json);
+  json << "\n}\n";
+
+  // Pools and batchers first, then their Vulkan context
+  targets.clear();
+  aes.reset();
+  batcher.reset();
+  vk.reset();
+  if (vc6 != nullptr)
+    OSSL_PROVIDER_unload(vc6);
+  if (def != nullptr)
+    OSSL_PROVIDER_unload(def);
   return 0;
 }
+
+// Parses a size with an optional K / M suffix; 0 on error
+static size_t parseSize(const char *s) {
+  char *end;
+  unsigned long long v = strtoull(s, &end, 10);
+  if (*end == 'K' || *end == 'k')
+    v *= 1024, end++;
+  else if (*end == 'M' || *end == 'm')
+    v *= 1024 * 1024, end++;
+  return *end == '\0' ? (size_t)v : 0;
+}
+
+static void usage() {
+  std::cerr
+      << "Usage: bench_runner [--algs A,B,..] [--min-size N] [--max-size N]\n"
+         "                    [--threads N] [--seconds S] [--json FILE]\n"
+         "                    [--no-baseline] [--no-batchers] [--cpu N]\n"
+         "       bench_runner xts|sha256|blake3|chachapoly|rand|pbkdf2 [n]\n"
+         "       bench_runner memcpy [size_mb]\n"
+         "       bench_runner aead-reinit|ringcheck|gcm-check|chacha-check\n"
+         "Sizes take K/M suffixes; the sweep goes from --min-size (16) to\n"
+         "--max-size (64M) in steps of 4x, at 1 and --threads (4) threads.\n"
+         "--cpu pins all threads to one core.\n";
+}
+
+int main(int argc, char **argv) {
+  // Provider benchmarks bring their own Vulkan context
+  if (argc > 1 && strcmp(argv[1], "chachapoly") == 0)
+    return runChachaPolyBench(argc > 2 ? strtoul(argv[2], nullptr, 10) : 256);
+  if (argc > 1 && strcmp(argv[1], "aead-reinit") == 0)
+    return runAeadReinitCheck();
+  if (argc > 1 && strcmp(argv[1], "ringcheck") == 0)
+    return runRingCheck();
+  if (argc > 1 && strcmp(argv[1], "gcm-check") == 0)
+    return runGcmCheck();
+  if (argc > 1 && strcmp(argv[1], "chacha-check") == 0)
+    return runChachaCheck();
+  if (argc > 1 && strcmp(argv[1], "rand") == 0)
+    return runRandBench(argc > 2 ? strtoul(argv[2], nullptr, 10) : 64);
+  if (argc > 1 && strcmp(argv[1], "pbkdf2") == 0)
+    return runPbkdf2Bench(argc > 2 ? strtoul(argv[2], nullptr, 10) : 64);
+
+  if (argc > 1 && (strcmp(argv[1], "sha256") == 0 ||
+                   strcmp(argv[1], "blake3") == 0 ||
+                   strcmp(argv[1], "xts") == 0 ||
+                   strcmp(argv[1], "memcpy") == 0)) {
+    try {
+      VulkanContext ctx;
+      unsigned long n = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+      if (strcmp(argv[1], "memcpy") == 0)
+        return runMemcpyBench(ctx, n ? n : 64);
+      Batcher batcher(&ctx);
+      if (strcmp(argv[1], "sha256") == 0)
+        return runSha256Bench(batcher, n ? n : 16384);
+      if (strcmp(argv[1], "blake3") == 0)
+        return runBlake3Bench(batcher, n ? n : 256);
+      return runXtsBench(batcher, n ? n : 256);
+    } catch (const std::exception &e) {
+      std::cerr << "[Bench] Exception: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  SuiteOptions opt;
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (strcmp(a, "--no-baseline") == 0) {
+      opt.baseline = false;
+      continue;
+    }
+    if (strcmp(a, "--no-batchers") == 0) {
+      opt.batchers = false;
+      continue;
+    }
+    if (v == nullptr) {
+      usage();
+      return 1;
+    }
+    i++;
+    if (strcmp(a, "--algs") == 0) {
+      std::string list = v;
+      for (size_t pos = 0; pos <= list.size();) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+          comma = list.size();
+        if (comma > pos)
+          opt.algs.push_back(list.substr(pos, comma - pos));
+        pos = comma + 1;
+      }
+    } else if (strcmp(a, "--min-size") == 0) {
+      opt.minSize = parseSize(v);
+    } else if (strcmp(a, "--max-size") == 0) {
+      opt.maxSize = parseSize(v);
+    } else if (strcmp(a, "--threads") == 0) {
+      opt.threads = atoi(v);
+    } else if (strcmp(a, "--seconds") == 0) {
+      opt.seconds = atof(v);
+    } else if (strcmp(a, "--json") == 0) {
+      opt.jsonPath = v;
+    } else if (strcmp(a, "--cpu") == 0) {
+      opt.cpu = atoi(v);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (opt.minSize == 0 || opt.maxSize < opt.minSize || opt.threads < 1 ||
+      opt.seconds <= 0) {
+    usage();
+    return 1;
+  }
+  if (opt.cpu >= 0) {
+    // Threads started later inherit the mask
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(opt.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      std::cerr << "[Bench] Cannot pin to CPU " << opt.cpu << std::endl;
+      return 1;
+    }
+  }
+  return runSuite(opt);
+}
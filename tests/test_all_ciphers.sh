@@ -63,13 +63,138 @@ run_test() {
     rm -f encrypted.bin decrypted.bin
 }
 
-# Run tests
-run_test "AES-128-CTR" "aes-128-ctr" "$TEST_KEY_128" "$TEST_IV"
-run_test "AES-256-CTR" "aes-256-ctr" "$TEST_KEY_256" "$TEST_IV"
-run_test "ChaCha20" "chacha20" "$TEST_KEY_256" "$TEST_IV"
+# Reverse direction: CPU encrypt, GPU decrypt (CBC decryption is the
+# GPU-parallel direction). Optional: input file, extra GPU-side options.
+run_decrypt_test() {
+    local name=$1
+    local cipher=$2
+    local key=$3
+    local iv=$4
+    local input=${5:-testdata.bin}
+    local gpu_opts=${6:-}
+
+    echo ""
+    echo "=== Testing $name (GPU decrypt) ==="
+
+    if ! openssl enc -$cipher -provider default \
+        -in "$input" -out encrypted.bin -K "$key" -iv "$iv" 2>/dev/null; then
+        echo "  [FAIL] CPU encryption failed"
+        FAILED=$((FAILED + 1))
+        return
+    fi
+
+    if ! openssl enc -d -$cipher -provider vc6 -propquery provider=vc6 \
+        $gpu_opts -in encrypted.bin -out decrypted.bin -K "$key" -iv "$iv" \
+        2>/dev/null; then
+        echo "  [FAIL] GPU decryption failed"
+        FAILED=$((FAILED + 1))
+        return
+    fi
+
+    if cmp -s "$input" decrypted.bin; then
+        echo "  [PASS] CPU encrypt + GPU decrypt matches original"
+        PASSED=$((PASSED + 1))
+    else
+        echo "  [FAIL] Data mismatch!"
+        cmp -l "$input" decrypted.bin | head -n 5
+        FAILED=$((FAILED + 1))
+    fi
+
+    rm -f encrypted.bin decrypted.bin
+}
+
+# Run tests ($1 tags the pass)
+run_suite() {
+    local tag=$1
+    run_test "AES-128-CTR$tag" "aes-128-ctr" "$TEST_KEY_128" "$TEST_IV"
+    run_test "AES-256-CTR$tag" "aes-256-ctr" "$TEST_KEY_256" "$TEST_IV"
+    run_test "ChaCha20$tag" "chacha20" "$TEST_KEY_256" "$TEST_IV"
+    run_test "AES-256-ECB$tag" "aes-256-ecb" "$TEST_KEY_256" "$TEST_IV"
+    run_decrypt_test "AES-256-ECB$tag" "aes-256-ecb" "$TEST_KEY_256" "$TEST_IV"
+    run_test "AES-256-CBC (CPU encrypt fallback)$tag" "aes-256-cbc" \
+        "$TEST_KEY_256" "$TEST_IV"
+    run_decrypt_test "AES-256-CBC$tag" "aes-256-cbc" "$TEST_KEY_256" "$TEST_IV"
+
+    # One update larger than a backend ring (64 MB): split into chunks, the
+    # CBC chain carried across them
+    run_decrypt_test "AES-256-ECB 80 MB update$tag" "aes-256-ecb" \
+        "$TEST_KEY_256" "$TEST_IV" testdata_large.bin "-bufsize 100000000"
+    run_decrypt_test "AES-256-CBC 80 MB update$tag" "aes-256-cbc" \
+        "$TEST_KEY_256" "$TEST_IV" testdata_large.bin "-bufsize 100000000"
+}
+
+# TLS 1.2 round trip through libssl, both ends preferring vc6's AEAD:
+# libssl drives provider ciphers through EVP_CipherUpdate(), so this is
+# the record path a real connection takes. The server's trace shows the
+# records went through vc6. The DRBG is pinned to the default provider
+# (tls_rand.cnf): CTR-DRBG needs byte-exact AES-CTR output, and vc6's
+# AES-CTR holds back partial blocks until final().
+run_tls_test() {
+    local name=$1
+    local suite=$2
+    local span=$3
+    local port=$((20000 + RANDOM % 20000))
+    local msg="vc6 TLS 1.2 record check $RANDOM"
+    local opts="-tls1_2 -cipher $suite -provider vc6 -provider default"
+    opts="$opts -propquery ?provider=vc6"
+
+    echo ""
+    echo "=== Testing $name (TLS 1.2, $suite) ==="
+
+    rm -f tls_server.out tls_trace.json
+    # s_server quits on EOF from stdin, so keep it open for the exchange
+    sleep 5 | OPENSSL_CONF=tls_rand.cnf VC6_TRACE=$WORKDIR/tls_trace.json \
+        openssl s_server -accept $port -cert tls_cert.pem -key tls_key.pem \
+        $opts -naccept 1 -quiet > tls_server.out 2>/dev/null &
+    local server=$!
+    sleep 1
+    echo "$msg" | OPENSSL_CONF=tls_rand.cnf openssl s_client \
+        -connect 127.0.0.1:$port $opts -quiet > /dev/null 2>&1 || true
+    wait $server || true
+
+    if ! grep -q "$msg" tls_server.out; then
+        echo "  [FAIL] Record did not arrive"
+        FAILED=$((FAILED + 1))
+    elif ! grep -q "$span" tls_trace.json 2>/dev/null; then
+        echo "  [FAIL] Records did not go through vc6"
+        FAILED=$((FAILED + 1))
+    else
+        echo "  [PASS] Handshake and records through vc6"
+        PASSED=$((PASSED + 1))
+    fi
+    rm -f tls_server.out tls_trace.json
+}
+
+dd if=/dev/urandom of=testdata_large.bin bs=1M count=80 2>/dev/null
+run_suite ""
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout tls_key.pem \
+    -out tls_cert.pem -days 1 -subj "/CN=localhost" 2>/dev/null
+cat > tls_rand.cnf <<EOF
+openssl_conf = init
+[init]
+random = rand_sect
+[rand_sect]
+random = CTR-DRBG
+cipher = AES-256-CTR
+properties = provider=default
+EOF
+run_tls_test "AES-256-GCM" "ECDHE-RSA-AES256-GCM-SHA384" "AES-256-GCM update"
+run_tls_test "ChaCha20-Poly1305" "ECDHE-RSA-CHACHA20-POLY1305" \
+    "ChaCha20-Poly1305 update"
+rm -f tls_key.pem tls_cert.pem tls_rand.cnf
+
+# Again through the staged (discrete GPU) path: device-local rings, copies
+# and 4 MB slices. On unified memory (lavapipe, V3D) only VC6_STAGING=1
+# reaches it.
+if [ -z "$VC6_STAGING" ]; then
+    export VC6_STAGING=1
+    run_suite " [staged]"
+    unset VC6_STAGING
+fi
 
 # Cleanup
-rm -f testdata.bin
+rm -f testdata.bin testdata_large.bin
 
 echo ""
 echo "=================================================="